@@ -90,6 +90,12 @@
 /* Define to 1 if you have the 'flock' function. */
 #cmakedefine HAVE_FLOCK 1
 
+/* Define to 1 if you have the 'mmap' function. */
+#cmakedefine HAVE_MMAP 1
+
+/* Define to 1 if you have the 'fstatat' function. */
+#cmakedefine HAVE_FSTATAT 1
+
 /* Define to 1 if you have the 'strlcpy' function. */
 #cmakedefine HAVE_LIBC_STRLCPY 1
 
@@ -108,5 +114,8 @@
 /* Define to 1 to enable trace logs - undefine to slightly increase speed */
 #cmakedefine ENABLE_TRACING 1
 
+/* Define to 1 to time emulation subsystems ("info perf" in debugger) */
+#cmakedefine ENABLE_PERF_TIMERS 1
+
 /* Define to 1 if udev support is available */
 #cmakedefine HAVE_UDEV 1
@@ -993,6 +993,7 @@ bool	Avi_RecordVideoStream ( void )
 {
 	off_t		Pos_Start , Pos_End;
 
+	Screen_RenderWait();				/* frame may still be converted */
 	Pos_Start = ftello ( AviParams.FileOut );
 
 	if ( AviParams.VideoCodec == AVI_RECORD_VIDEO_CODEC_BMP )
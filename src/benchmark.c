@@ -0,0 +1,163 @@
+/*
+  Hatari - benchmark.c
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+
+  Benchmark mode statistics.  While running in benchmark mode, host time
+  spent in emulated VBLs and executed CPU instructions are collected, along
+  with the per-subsystem perftimer.c timings when Hatari is built with
+  ENABLE_PERF_TIMERS.  When the given number of VBLs has been run, the
+  results are written as JSON for automated (CI) performance tracking.
+*/
+const char Benchmark_fileid[] = "Hatari benchmark.c";
+
+#include <SDL.h>
+#include <inttypes.h>
+
+#include "main.h"
+#include "configuration.h"
+#include "benchmark.h"
+#include "clocks_timings.h"
+#include "log.h"
+#include "m68000.h"
+#include "options.h"
+#include "perftimer.h"
+#include "screen.h"
+#include "version.h"
+#include "video.h"
+
+static struct {
+	bool bStarted;
+	Uint64 nStartCounter;    /* host performance counter at start */
+	Uint64 nVBLs;
+	Uint64 nEmulatedMicro;   /* emulated time in micro seconds */
+	Uint64 nInstructions;
+	int nLastInstrCnt;
+	Uint64 nTimerNsecs[PERF_TIMER_MAX];
+} Bench;
+
+
+/**
+ * Update statistics on each VBL, called from Main_WaitOnVbl()
+ * while in benchmark mode.  First call starts the measurement.
+ */
+void Benchmark_VBL(void)
+{
+	int instr_cnt = regs.instruction_cnt;
+	Uint32 nsecs, calls;
+	const char *name;
+	int i;
+
+	if (!Bench.bStarted)
+	{
+		memset(&Bench, 0, sizeof(Bench));
+		Bench.bStarted = true;
+		Bench.nStartCounter = SDL_GetPerformanceCounter();
+		Bench.nLastInstrCnt = instr_cnt;
+		return;
+	}
+	Bench.nVBLs++;
+	Bench.nEmulatedMicro += ClocksTimings_GetVBLDuration_micro(
+		ConfigureParams.System.nMachineType, nScreenRefreshRate);
+	/* CPU core counter is 32-bit, so accumulate the difference */
+	Bench.nInstructions += (Uint32)(instr_cnt - Bench.nLastInstrCnt);
+	Bench.nLastInstrCnt = instr_cnt;
+
+	/* PerfTimer_VBL() has just collected timings for this VBL */
+	for (i = 0; i < PERF_TIMER_MAX; i++)
+	{
+		if (PerfTimer_GetLast(i, &name, &nsecs, &calls))
+			Bench.nTimerNsecs[i] += nsecs;
+	}
+}
+
+
+/**
+ * Return name of the emulated machine type for the results
+ */
+static const char *Benchmark_MachineName(void)
+{
+	switch (ConfigureParams.System.nMachineType)
+	{
+	case MACHINE_ST:
+		return "st";
+	case MACHINE_MEGA_ST:
+		return "megast";
+	case MACHINE_STE:
+		return "ste";
+	case MACHINE_MEGA_STE:
+		return "megaste";
+	case MACHINE_TT:
+		return "tt";
+	case MACHINE_FALCON:
+		return "falcon";
+	}
+	return "unknown";
+}
+
+
+/**
+ * Write benchmark results as JSON to the file given with --bench-json
+ * ("-" for stdout).  Called when the requested number of VBLs has run.
+ */
+void Benchmark_Report(void)
+{
+	double freq = SDL_GetPerformanceFrequency();
+	double host, emulated;
+	Uint32 nsecs, calls;
+	const char *name;
+	const char *sep = "{";
+	FILE *fp;
+	int i;
+
+	if (!Bench.bStarted || !BenchmarkJsonFile[0])
+		return;
+
+	if (strcmp(BenchmarkJsonFile, "-") == 0)
+		fp = stdout;
+	else
+		fp = fopen(BenchmarkJsonFile, "w");
+	if (!fp)
+	{
+		Log_Printf(LOG_ERROR, "Can't write benchmark results to '%s'!\n",
+			   BenchmarkJsonFile);
+		return;
+	}
+
+	host = (SDL_GetPerformanceCounter() - Bench.nStartCounter) / freq;
+	emulated = Bench.nEmulatedMicro / 1000000.0;
+	if (host <= 0.0)
+		host = 1.0 / freq;
+
+	fprintf(fp, "{\n");
+	fprintf(fp, "  \"version\": \"%s\",\n", PROG_NAME);
+	fprintf(fp, "  \"machine\": \"%s\",\n", Benchmark_MachineName());
+	fprintf(fp, "  \"vbls\": %"PRIu64",\n", Bench.nVBLs);
+	fprintf(fp, "  \"host_seconds\": %.6f,\n", host);
+	fprintf(fp, "  \"emulated_seconds\": %.6f,\n", emulated);
+	fprintf(fp, "  \"speed\": %.4f,\n", emulated / host);
+	fprintf(fp, "  \"vbls_per_second\": %.2f,\n", Bench.nVBLs / host);
+	fprintf(fp, "  \"cpu_instructions\": %"PRIu64",\n", Bench.nInstructions);
+	fprintf(fp, "  \"instructions_per_second\": %.0f,\n", Bench.nInstructions / host);
+	fprintf(fp, "  \"subsystem_seconds\": ");
+	for (i = 0; i < PERF_TIMER_MAX; i++)
+	{
+		if (!PerfTimer_GetLast(i, &name, &nsecs, &calls))
+			continue;
+		fprintf(fp, "%s\n    \"%s\": %.6f", sep,
+			name, Bench.nTimerNsecs[i] / 1.0e9);
+		sep = ",";
+	}
+	/* timings are available only with ENABLE_PERF_TIMERS */
+	if (*sep == ',')
+		fprintf(fp, "\n  }\n");
+	else
+		fprintf(fp, "null\n");
+	fprintf(fp, "}\n");
+
+	if (fp == stdout)
+		fflush(fp);
+	else
+		fclose(fp);
+}
@@ -0,0 +1,404 @@
+/*
+  Hatari - bitplanes.c
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+
+  Conversion of Atari bitplane screen data to chunky pixels, with
+  SIMD versions for SSE2, AVX2 and NEON.  The x86 versions are
+  selected at run-time based on host CPU features.
+
+  SIMD versions work by broadcasting each bitplane word to all
+  vector bytes, and testing in each byte the bit for one pixel.
+  As bytes of a 16-bit word come in the order high, low, the result
+  bytes are for pixels 0, 8, 1, 9, ..., which are then de-interleaved.
+*/
+const char Bitplanes_fileid[] = "Hatari bitplanes.c";
+
+#include <SDL_endian.h>
+#include "main.h"
+#include "bitplanes.h"
+
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN && defined(__GNUC__) \
+    && (defined(__x86_64__) || defined(__i386__))
+# define BITPLANES_X86 1
+# include <immintrin.h>
+#endif
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN && defined(__ARM_NEON)
+# define BITPLANES_NEON 1
+# include <arm_neon.h>
+#endif
+
+/* bit for each pixel within the bytes of a (broadcasted) bitplane word */
+#if BITPLANES_X86 || BITPLANES_NEON
+static const Uint8 PixelBits[16] __attribute__((aligned(16))) = {
+	0x80, 0x80, 0x40, 0x40, 0x20, 0x20, 0x10, 0x10,
+	0x08, 0x08, 0x04, 0x04, 0x02, 0x02, 0x01, 0x01
+};
+#endif
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Convert 16 pixels in bitplane format to palette indexes,
+ * with bit-shuffling on 32-bit words.
+ */
+static void Bitplanes_ToIndex_Scalar(const Uint16 *planes, int bpp, Uint8 *idx)
+{
+	const Uint8 *src = (const Uint8 *)planes;
+	Uint32 a, b, c, d, x;
+
+	/* read bitplane words the same way regardless of host endianness,
+	 * 'd' gets planes 0 & 1, 'c' planes 2 & 3, 'b' planes 4 & 5
+	 * and 'a' planes 6 & 7
+	 */
+#define PLANES(i) (src[4*(i)] | (Uint32)src[4*(i)+1] << 8 | \
+                   (Uint32)src[4*(i)+2] << 16 | (Uint32)src[4*(i)+3] << 24)
+	a = b = c = 0;
+	switch (bpp) {
+	case 8:
+		a = PLANES(3);
+		b = PLANES(2);
+		/* fall through */
+	case 4:
+		c = PLANES(1);
+		/* fall through */
+	case 2:
+		d = PLANES(0);
+		break;
+	default:
+		d = src[0] | (Uint32)src[1] << 8;
+		break;
+	}
+#undef PLANES
+
+	x = a;
+	a =  (a & 0xf0f0f0f0)       | ((c & 0xf0f0f0f0) >> 4);
+	c = ((x & 0x0f0f0f0f) << 4) |  (c & 0x0f0f0f0f);
+
+	x = b;
+	b =  (b & 0xf0f0f0f0)       | ((d & 0xf0f0f0f0) >> 4);
+	d = ((x & 0x0f0f0f0f) << 4) |  (d & 0x0f0f0f0f);
+
+	x = a;
+	a =  (a & 0xcccccccc)       | ((b & 0xcccccccc) >> 2);
+	b = ((x & 0x33333333) << 2) |  (b & 0x33333333);
+	x = c;
+	c =  (c & 0xcccccccc)       | ((d & 0xcccccccc) >> 2);
+	d = ((x & 0x33333333) << 2) |  (d & 0x33333333);
+
+	a = (a & 0xaaaa5555) | ((a & 0x0000aaaa) << 15) | ((a & 0x55550000) >> 15);
+	b = (b & 0xaaaa5555) | ((b & 0x0000aaaa) << 15) | ((b & 0x55550000) >> 15);
+	c = (c & 0xaaaa5555) | ((c & 0x0000aaaa) << 15) | ((c & 0x55550000) >> 15);
+	d = (d & 0xaaaa5555) | ((d & 0x0000aaaa) << 15) | ((d & 0x55550000) >> 15);
+
+	idx[0] = a >> 16;
+	idx[1] = a;
+	idx[2] = b >> 16;
+	idx[3] = b;
+	idx[4] = c >> 16;
+	idx[5] = c;
+	idx[6] = d >> 16;
+	idx[7] = d;
+	idx[8] = a >> 24;
+	idx[9] = a >> 8;
+	idx[10] = b >> 24;
+	idx[11] = b >> 8;
+	idx[12] = c >> 24;
+	idx[13] = c >> 8;
+	idx[14] = d >> 24;
+	idx[15] = d >> 8;
+}
+
+static void Bitplanes_ToChunky16_Scalar(const Uint16 *planes, int bpp, int blocks,
+                                        const Uint32 *pal, Uint16 *hvram)
+{
+	Uint8 idx[16];
+	int i;
+
+	for (; blocks > 0; blocks--, planes += bpp, hvram += 16)
+	{
+		Bitplanes_ToIndex_Scalar(planes, bpp, idx);
+		for (i = 0; i < 16; i++)
+			hvram[i] = pal[idx[i]];
+	}
+}
+
+static void Bitplanes_ToChunky32_Scalar(const Uint16 *planes, int bpp, int blocks,
+                                        const Uint32 *pal, Uint32 *hvram)
+{
+	Uint8 idx[16];
+	int i;
+
+	for (; blocks > 0; blocks--, planes += bpp, hvram += 16)
+	{
+		Bitplanes_ToIndex_Scalar(planes, bpp, idx);
+		for (i = 0; i < 16; i++)
+			hvram[i] = pal[idx[i]];
+	}
+}
+
+static const BITPLANE_KERNELS Bitplanes_Scalar = {
+	"scalar",
+	Bitplanes_ToIndex_Scalar,
+	Bitplanes_ToChunky16_Scalar,
+	Bitplanes_ToChunky32_Scalar
+};
+
+
+#if BITPLANES_X86
+/*-----------------------------------------------------------------------*/
+/**
+ * SSE2 versions
+ */
+static inline __attribute__((target("sse2")))
+__m128i Bitplanes_Index_SSE2(const Uint16 *planes, int bpp)
+{
+	__m128i bits = _mm_load_si128((const __m128i *)PixelBits);
+	__m128i acc = _mm_setzero_si128();
+	__m128i v;
+	int i;
+
+	for (i = 0; i < bpp; i++)
+	{
+		v = _mm_set1_epi16(planes[i]);
+		v = _mm_cmpeq_epi8(_mm_and_si128(v, bits), bits);
+		acc = _mm_or_si128(acc, _mm_and_si128(v, _mm_set1_epi8(1 << i)));
+	}
+	/* pixels 0-7 are in even bytes, 8-15 in odd ones */
+	return _mm_packus_epi16(_mm_and_si128(acc, _mm_set1_epi16(0x00ff)),
+	                        _mm_srli_epi16(acc, 8));
+}
+
+static __attribute__((target("sse2")))
+void Bitplanes_ToIndex_SSE2(const Uint16 *planes, int bpp, Uint8 *idx)
+{
+	_mm_storeu_si128((__m128i *)idx, Bitplanes_Index_SSE2(planes, bpp));
+}
+
+static __attribute__((target("sse2")))
+void Bitplanes_ToChunky16_SSE2(const Uint16 *planes, int bpp, int blocks,
+                               const Uint32 *pal, Uint16 *hvram)
+{
+	Uint8 idx[16] __attribute__((aligned(16)));
+	int i;
+
+	for (; blocks > 0; blocks--, planes += bpp, hvram += 16)
+	{
+		_mm_store_si128((__m128i *)idx, Bitplanes_Index_SSE2(planes, bpp));
+		for (i = 0; i < 16; i++)
+			hvram[i] = pal[idx[i]];
+	}
+}
+
+static __attribute__((target("sse2")))
+void Bitplanes_ToChunky32_SSE2(const Uint16 *planes, int bpp, int blocks,
+                               const Uint32 *pal, Uint32 *hvram)
+{
+	Uint8 idx[16] __attribute__((aligned(16)));
+	int i;
+
+	for (; blocks > 0; blocks--, planes += bpp, hvram += 16)
+	{
+		_mm_store_si128((__m128i *)idx, Bitplanes_Index_SSE2(planes, bpp));
+		for (i = 0; i < 16; i++)
+			hvram[i] = pal[idx[i]];
+	}
+}
+
+static const BITPLANE_KERNELS Bitplanes_SSE2 = {
+	"SSE2",
+	Bitplanes_ToIndex_SSE2,
+	Bitplanes_ToChunky16_SSE2,
+	Bitplanes_ToChunky32_SSE2
+};
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * AVX2 versions, converting 2 blocks at a time and
+ * doing the palette lookups with gather instructions
+ */
+static inline __attribute__((target("avx2")))
+__m256i Bitplanes_Index_AVX2(const Uint16 *planes, int bpp)
+{
+	__m256i bits = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)PixelBits));
+	__m256i acc = _mm256_setzero_si256();
+	__m256i v;
+	int i;
+
+	for (i = 0; i < bpp; i++)
+	{
+		/* first block in the low lane, second one in high lane */
+		v = _mm256_setr_m128i(_mm_set1_epi16(planes[i]), _mm_set1_epi16(planes[bpp+i]));
+		v = _mm256_cmpeq_epi8(_mm256_and_si256(v, bits), bits);
+		acc = _mm256_or_si256(acc, _mm256_and_si256(v, _mm256_set1_epi8(1 << i)));
+	}
+	return _mm256_packus_epi16(_mm256_and_si256(acc, _mm256_set1_epi16(0x00ff)),
+	                           _mm256_srli_epi16(acc, 8));
+}
+
+static __attribute__((target("avx2")))
+void Bitplanes_ToChunky16_AVX2(const Uint16 *planes, int bpp, int blocks,
+                               const Uint32 *pal, Uint16 *hvram)
+{
+	__m256i idx, lo, hi;
+	int i;
+
+	for (; blocks > 1; blocks -= 2, planes += 2*bpp, hvram += 32)
+	{
+		idx = Bitplanes_Index_AVX2(planes, bpp);
+		for (i = 0; i < 2; i++)
+		{
+			__m128i lane = i ? _mm256_extracti128_si256(idx, 1) : _mm256_castsi256_si128(idx);
+			lo = _mm256_i32gather_epi32((const int *)pal, _mm256_cvtepu8_epi32(lane), 4);
+			hi = _mm256_i32gather_epi32((const int *)pal, _mm256_cvtepu8_epi32(_mm_srli_si128(lane, 8)), 4);
+			/* keep low 16 bits of each color, in pixel order */
+			lo = _mm256_packus_epi32(_mm256_and_si256(lo, _mm256_set1_epi32(0xffff)),
+			                         _mm256_and_si256(hi, _mm256_set1_epi32(0xffff)));
+			lo = _mm256_permute4x64_epi64(lo, 0xd8);
+			_mm256_storeu_si256((__m256i *)(hvram + 16*i), lo);
+		}
+	}
+	if (blocks)
+		Bitplanes_ToChunky16_SSE2(planes, bpp, 1, pal, hvram);
+}
+
+static __attribute__((target("avx2")))
+void Bitplanes_ToChunky32_AVX2(const Uint16 *planes, int bpp, int blocks,
+                               const Uint32 *pal, Uint32 *hvram)
+{
+	__m256i idx;
+	__m128i lane;
+	int i;
+
+	for (; blocks > 1; blocks -= 2, planes += 2*bpp, hvram += 32)
+	{
+		idx = Bitplanes_Index_AVX2(planes, bpp);
+		for (i = 0; i < 4; i++)
+		{
+			lane = (i & 2) ? _mm256_extracti128_si256(idx, 1) : _mm256_castsi256_si128(idx);
+			if (i & 1)
+				lane = _mm_srli_si128(lane, 8);
+			_mm256_storeu_si256((__m256i *)(hvram + 8*i),
+			                    _mm256_i32gather_epi32((const int *)pal,
+			                                           _mm256_cvtepu8_epi32(lane), 4));
+		}
+	}
+	if (blocks)
+		Bitplanes_ToChunky32_SSE2(planes, bpp, 1, pal, hvram);
+}
+
+static const BITPLANE_KERNELS Bitplanes_AVX2 = {
+	"AVX2",
+	Bitplanes_ToIndex_SSE2,
+	Bitplanes_ToChunky16_AVX2,
+	Bitplanes_ToChunky32_AVX2
+};
+#endif	/* BITPLANES_X86 */
+
+
+#if BITPLANES_NEON
+/*-----------------------------------------------------------------------*/
+/**
+ * NEON versions
+ */
+static inline uint8x16_t Bitplanes_Index_NEON(const Uint16 *planes, int bpp)
+{
+	uint8x16_t bits = vld1q_u8(PixelBits);
+	uint8x16_t acc = vdupq_n_u8(0);
+	uint8x16_t v;
+	uint8x8x2_t pix;
+	int i;
+
+	for (i = 0; i < bpp; i++)
+	{
+		v = vreinterpretq_u8_u16(vdupq_n_u16(planes[i]));
+		v = vtstq_u8(v, bits);
+		acc = vorrq_u8(acc, vandq_u8(v, vdupq_n_u8(1 << i)));
+	}
+	/* pixels 0-7 are in even bytes, 8-15 in odd ones */
+	pix = vuzp_u8(vget_low_u8(acc), vget_high_u8(acc));
+	return vcombine_u8(pix.val[0], pix.val[1]);
+}
+
+static void Bitplanes_ToIndex_NEON(const Uint16 *planes, int bpp, Uint8 *idx)
+{
+	vst1q_u8(idx, Bitplanes_Index_NEON(planes, bpp));
+}
+
+static void Bitplanes_ToChunky16_NEON(const Uint16 *planes, int bpp, int blocks,
+                                      const Uint32 *pal, Uint16 *hvram)
+{
+	Uint8 idx[16];
+	int i;
+
+	for (; blocks > 0; blocks--, planes += bpp, hvram += 16)
+	{
+		vst1q_u8(idx, Bitplanes_Index_NEON(planes, bpp));
+		for (i = 0; i < 16; i++)
+			hvram[i] = pal[idx[i]];
+	}
+}
+
+static void Bitplanes_ToChunky32_NEON(const Uint16 *planes, int bpp, int blocks,
+                                      const Uint32 *pal, Uint32 *hvram)
+{
+	Uint8 idx[16];
+	int i;
+
+	for (; blocks > 0; blocks--, planes += bpp, hvram += 16)
+	{
+		vst1q_u8(idx, Bitplanes_Index_NEON(planes, bpp));
+		for (i = 0; i < 16; i++)
+			hvram[i] = pal[idx[i]];
+	}
+}
+
+static const BITPLANE_KERNELS Bitplanes_NEON = {
+	"NEON",
+	Bitplanes_ToIndex_NEON,
+	Bitplanes_ToChunky16_NEON,
+	Bitplanes_ToChunky32_NEON
+};
+#endif	/* BITPLANES_NEON */
+
+
+const BITPLANE_KERNELS *Bitplanes = &Bitplanes_Scalar;
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Get conversion functions supported by host CPU into given list,
+ * slowest first.  Return their count.
+ */
+int Bitplanes_GetKernels(const BITPLANE_KERNELS **list, int max)
+{
+	int count = 0;
+
+	if (count < max)
+		list[count++] = &Bitplanes_Scalar;
+#if BITPLANES_X86
+	__builtin_cpu_init();
+	if (count < max && __builtin_cpu_supports("sse2"))
+		list[count++] = &Bitplanes_SSE2;
+	if (count < max && __builtin_cpu_supports("avx2"))
+		list[count++] = &Bitplanes_AVX2;
+#endif
+#if BITPLANES_NEON
+	if (count < max)
+		list[count++] = &Bitplanes_NEON;
+#endif
+	return count;
+}
+
+/**
+ * Select fastest conversion functions supported by host CPU
+ */
+void Bitplanes_Init(void)
+{
+	const BITPLANE_KERNELS *list[4];
+	int count;
+
+	count = Bitplanes_GetKernels(list, sizeof(list)/sizeof(list[0]));
+	Bitplanes = list[count - 1];
+}
@@ -121,6 +121,7 @@ const char Blitter_fileid[] = "Hatari blitter.c";
 #include "video.h"
 #include "hatari-glue.h"
 #include "falcon/dsp.h"
+#include "perftimer.h"
 
 
 /* BLiTTER registers, incs are signed, others unsigned */
@@ -1406,7 +1407,9 @@ void Blitter_InterruptHandler(void)
 
 	if (BlitterRegs.ctrl & 0x80)
 	{
+		PerfTimer_Begin(PERF_TIMER_BLITTER);
 		Blitter_Start();
+		PerfTimer_End();
 	}
 }
 
@@ -1583,7 +1586,9 @@ int	Blitter_Check_Simultaneous_CPU ( void )
 
 			/* Start the main blitter part */
 			BlitterPhase = BLITTER_PHASE_START;
+			PerfTimer_Begin(PERF_TIMER_BLITTER);
 			Blitter_Start();
+			PerfTimer_End();
 		}
 	}
 
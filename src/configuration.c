@@ -99,6 +99,7 @@ static const struct Config_Tag configs_Screen[] =
 	{ "nZoomFactor", Float_Tag, &ConfigureParams.Screen.nZoomFactor },
 	{ "bUseSdlRenderer", Bool_Tag, &ConfigureParams.Screen.bUseSdlRenderer },
 	{ "bUseVsync", Bool_Tag, &ConfigureParams.Screen.bUseVsync },
+	{ "bRenderThread", Bool_Tag, &ConfigureParams.Screen.bRenderThread },
 	{ NULL , Error_Tag, NULL }
 };
 
@@ -317,6 +318,7 @@ static const struct Config_Tag configs_HardDisk[] =
 	{ "nWriteProtection", Int_Tag, &ConfigureParams.HardDisk.nWriteProtection },
 	{ "bFilenameConversion", Bool_Tag, &ConfigureParams.HardDisk.bFilenameConversion },
 	{ "bGemdosHostTime", Bool_Tag, &ConfigureParams.HardDisk.bGemdosHostTime },
+	{ "bMmapImages", Bool_Tag, &ConfigureParams.HardDisk.bMmapImages },
 	{ NULL , Error_Tag, NULL }
 };
 
@@ -569,6 +571,7 @@ void Configuration_SetDefault(void)
 	ConfigureParams.HardDisk.bBootFromHardDisk = false;
 	ConfigureParams.HardDisk.bFilenameConversion = false;
 	ConfigureParams.HardDisk.bGemdosHostTime = false;
+	ConfigureParams.HardDisk.bMmapImages = false;
 	ConfigureParams.HardDisk.nGemdosCase = GEMDOS_NOP;
 	ConfigureParams.HardDisk.nWriteProtection = WRITEPROT_OFF;
 	ConfigureParams.HardDisk.nGemdosDrive = DRIVE_C;
@@ -722,6 +725,7 @@ void Configuration_SetDefault(void)
 	ConfigureParams.Screen.nZoomFactor = 1.0;
 	ConfigureParams.Screen.bUseSdlRenderer = true;
 	ConfigureParams.Screen.bUseVsync = false;
+	ConfigureParams.Screen.bRenderThread = false;
 
 	/* Set defaults for Sound */
 	ConfigureParams.Sound.bEnableMicrophone = true;
@@ -29,7 +29,7 @@ static void ConvertLowRes_320x16Bit_Spec(void)
 
 		/* Get screen addresses, 'edi'-ST screen, 'esi'-PC screen */
 		eax = STScreenLineOffset[y] + STScreenLeftSkipBytes;  /* Offset for this line + Amount to skip on left hand side */
-		edi = (Uint32 *)((Uint8 *)pSTScreen + eax);       /* ST format screen 4-plane 16 colors */
+		edi = (Uint32 *)((Uint8 *)pSTScreenConv + eax);   /* ST format screen 4-plane 16 colors */
 		esi = (Uint16 *)pPCScreenDest;                    /* PC format screen */
 
 		x = STScreenWidthBytes >> 3;    /* Amount to draw across in 16-pixels (8 bytes) */
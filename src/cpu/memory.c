@@ -29,6 +29,7 @@ const char Memory_fileid[] = "Hatari memory.c";
 #include "configuration.h"
 
 #include "newcpu.h"
+#include "watchpoint.h"
 
 
 /* Set illegal_mem to 1 for debug output: */
@@ -892,6 +893,96 @@ static void REGPARAM3 SysMem_bput_MMU(uaecptr addr, uae_u32 b)
 }
 
 
+/*
+ * Same put functions for ST RAM and ST RAM system, but also marking the
+ * written pages for STMemory_DirtyPages_xxx(). These are only installed
+ * by memory_set_dirty_tracking() while tracking is enabled.
+ */
+static bool dirty_tracking;
+
+static inline void STmem_MarkDirty(uaecptr addr, int size, bool mmu)
+{
+	addr -= STmem_start & STmem_mask;
+	addr &= STmem_mask;
+	if (mmu)
+		addr = STMemory_MMU_Translate_Addr ( addr );
+	STMemory_DirtyPages_Mark(addr, size);
+}
+
+static void REGPARAM3 STmem_lput_Dirty(uaecptr addr, uae_u32 l)
+{
+	STmem_lput(addr, l);
+	STmem_MarkDirty(addr, 4, false);
+}
+
+static void REGPARAM3 STmem_wput_Dirty(uaecptr addr, uae_u32 w)
+{
+	STmem_wput(addr, w);
+	STmem_MarkDirty(addr, 2, false);
+}
+
+static void REGPARAM3 STmem_bput_Dirty(uaecptr addr, uae_u32 b)
+{
+	STmem_bput(addr, b);
+	STmem_MarkDirty(addr, 1, false);
+}
+
+static void REGPARAM3 STmem_lput_MMU_Dirty(uaecptr addr, uae_u32 l)
+{
+	STmem_lput_MMU(addr, l);
+	STmem_MarkDirty(addr, 4, true);
+}
+
+static void REGPARAM3 STmem_wput_MMU_Dirty(uaecptr addr, uae_u32 w)
+{
+	STmem_wput_MMU(addr, w);
+	STmem_MarkDirty(addr, 2, true);
+}
+
+static void REGPARAM3 STmem_bput_MMU_Dirty(uaecptr addr, uae_u32 b)
+{
+	STmem_bput_MMU(addr, b);
+	STmem_MarkDirty(addr, 1, true);
+}
+
+/* For the system area, pages can also be marked when the write gave a bus error */
+static void REGPARAM3 SysMem_lput_Dirty(uaecptr addr, uae_u32 l)
+{
+	SysMem_lput(addr, l);
+	STmem_MarkDirty(addr, 4, false);
+}
+
+static void REGPARAM3 SysMem_wput_Dirty(uaecptr addr, uae_u32 w)
+{
+	SysMem_wput(addr, w);
+	STmem_MarkDirty(addr, 2, false);
+}
+
+static void REGPARAM3 SysMem_bput_Dirty(uaecptr addr, uae_u32 b)
+{
+	SysMem_bput(addr, b);
+	STmem_MarkDirty(addr, 1, false);
+}
+
+static void REGPARAM3 SysMem_lput_MMU_Dirty(uaecptr addr, uae_u32 l)
+{
+	SysMem_lput_MMU(addr, l);
+	STmem_MarkDirty(addr, 4, true);
+}
+
+static void REGPARAM3 SysMem_wput_MMU_Dirty(uaecptr addr, uae_u32 w)
+{
+	SysMem_wput_MMU(addr, w);
+	STmem_MarkDirty(addr, 2, true);
+}
+
+static void REGPARAM3 SysMem_bput_MMU_Dirty(uaecptr addr, uae_u32 b)
+{
+	SysMem_bput_MMU(addr, b);
+	STmem_MarkDirty(addr, 1, true);
+}
+
+
 /*
  * **** Void memory ****
  * Between the ST-RAM end and the 4 MB barrier, there is a void memory space:
@@ -1504,6 +1595,215 @@ static void init_bank (addrbank *ab , uae_u32 size)
 }
 
 
+#ifdef WINUAE_FOR_HATARI
+/*
+ * Select the put functions of the ST RAM banks, with or without dirty
+ * page tracking. When tracking, direct write access must be disabled
+ * so that all writes go through the put functions.
+ */
+static void set_bank_put_funcs (addrbank *ab , mem_put_func lput , mem_put_func wput , mem_put_func bput)
+{
+	ab->lput = lput;
+	ab->wput = wput;
+	ab->bput = bput;
+	ab->baseaddr_direct_w = NULL;
+	if ( !dirty_tracking )
+		set_direct_memory ( ab );
+}
+
+void memory_set_dirty_tracking ( bool enable )
+{
+	dirty_tracking = enable;
+
+	if ( enable )
+	{
+		set_bank_put_funcs ( &STmem_bank , STmem_lput_Dirty , STmem_wput_Dirty , STmem_bput_Dirty );
+		set_bank_put_funcs ( &SysMem_bank , SysMem_lput_Dirty , SysMem_wput_Dirty , SysMem_bput_Dirty );
+		set_bank_put_funcs ( &STmem_bank_MMU , STmem_lput_MMU_Dirty , STmem_wput_MMU_Dirty , STmem_bput_MMU_Dirty );
+		set_bank_put_funcs ( &SysMem_bank_MMU , SysMem_lput_MMU_Dirty , SysMem_wput_MMU_Dirty , SysMem_bput_MMU_Dirty );
+	}
+	else
+	{
+		set_bank_put_funcs ( &STmem_bank , STmem_lput , STmem_wput , STmem_bput );
+		set_bank_put_funcs ( &SysMem_bank , SysMem_lput , SysMem_wput , SysMem_bput );
+		set_bank_put_funcs ( &STmem_bank_MMU , STmem_lput_MMU , STmem_wput_MMU , STmem_bput_MMU );
+		set_bank_put_funcs ( &SysMem_bank_MMU , SysMem_lput_MMU , SysMem_wput_MMU , SysMem_bput_MMU );
+	}
+}
+
+
+/*
+ * Watchpoint banks : each 64 KB entry of mem_banks[] containing a watched
+ * address is replaced by a copy of its bank, whose get/put functions call
+ * the original ones and then Watchpoint_Check(). Other entries keep their
+ * original banks, so they run at full speed. The copies have no direct
+ * memory access, so that all accesses go through the functions.
+ */
+#define WATCH_BANK_MAX	32		/* see MAX_WATCHED_BANKS */
+
+static struct {
+	addrbank *orig;
+	addrbank bank;
+} watch_store[WATCH_BANK_MAX];
+static int watch_store_count;
+
+static uae_u32 watch_banks[WATCH_BANK_MAX];	/* watched entries, without 24-bit aliases */
+static int watch_bank_count;
+static addrbank *watch_orig[MEMORY_BANKS];	/* original banks of watched entries */
+
+static inline void watch_check ( uaecptr addr , int size , int mode )
+{
+	if ( last_address_space_24 )
+		addr &= 0x00ffffff;
+	Watchpoint_Check ( addr , size , mode );
+}
+
+static uae_u32 REGPARAM3 watch_lget ( uaecptr addr )
+{
+	uae_u32 v = watch_orig[ bankindex ( addr ) ]->lget ( addr );
+	watch_check ( addr , 4 , WATCH_READ );
+	return v;
+}
+
+static uae_u32 REGPARAM3 watch_wget ( uaecptr addr )
+{
+	uae_u32 v = watch_orig[ bankindex ( addr ) ]->wget ( addr );
+	watch_check ( addr , 2 , WATCH_READ );
+	return v;
+}
+
+static uae_u32 REGPARAM3 watch_bget ( uaecptr addr )
+{
+	uae_u32 v = watch_orig[ bankindex ( addr ) ]->bget ( addr );
+	watch_check ( addr , 1 , WATCH_READ );
+	return v;
+}
+
+static void REGPARAM3 watch_lput ( uaecptr addr , uae_u32 l )
+{
+	watch_orig[ bankindex ( addr ) ]->lput ( addr , l );
+	watch_check ( addr , 4 , WATCH_WRITE );
+}
+
+static void REGPARAM3 watch_wput ( uaecptr addr , uae_u32 w )
+{
+	watch_orig[ bankindex ( addr ) ]->wput ( addr , w );
+	watch_check ( addr , 2 , WATCH_WRITE );
+}
+
+static void REGPARAM3 watch_bput ( uaecptr addr , uae_u32 b )
+{
+	watch_orig[ bankindex ( addr ) ]->bput ( addr , b );
+	watch_check ( addr , 1 , WATCH_WRITE );
+}
+
+static bool watch_is_bank ( addrbank *ab )
+{
+	int i;
+
+	for ( i = 0 ; i < watch_store_count ; i++ )
+		if ( ab == &watch_store[ i ].bank )
+			return true;
+	return false;
+}
+
+/*
+ * Return the watching copy of a bank, creating it if needed
+ */
+static addrbank *watch_get_bank ( addrbank *orig )
+{
+	addrbank *ab;
+	int i;
+
+	for ( i = 0 ; i < watch_store_count ; i++ )
+		if ( watch_store[ i ].orig == orig )
+			return &watch_store[ i ].bank;
+
+	if ( watch_store_count == WATCH_BANK_MAX )
+		return NULL;
+
+	watch_store[ watch_store_count ].orig = orig;
+	ab = &watch_store[ watch_store_count++ ].bank;
+	memcpy ( ab , orig , sizeof ( addrbank ) );
+	ab->lget = watch_lget;
+	ab->wget = watch_wget;
+	ab->bget = watch_bget;
+	ab->lput = watch_lput;
+	ab->wput = watch_wput;
+	ab->bput = watch_bput;
+	ab->baseaddr_direct_r = NULL;
+	ab->baseaddr_direct_w = NULL;
+	return ab;
+}
+
+/*
+ * Call given function for all mem_banks[] entries of the watched banks,
+ * including their aliases when using a 24-bit address space
+ */
+static void watch_for_each ( void (*func)(int index) )
+{
+	int i, alias;
+
+	for ( i = 0 ; i < watch_bank_count ; i++ )
+	{
+		if ( !last_address_space_24 )
+		{
+			func ( watch_banks[ i ] );
+			continue;
+		}
+		for ( alias = watch_banks[ i ] & 0xff ; alias < MEMORY_BANKS ; alias += 0x100 )
+			func ( alias );
+	}
+}
+
+static void watch_restore_entry ( int index )
+{
+	if ( watch_orig[ index ] && watch_is_bank ( mem_banks[ index ] ) )
+		put_mem_bank ( index << 16 , watch_orig[ index ] , watch_orig[ index ]->start );
+	watch_orig[ index ] = NULL;
+}
+
+static void watch_replace_entry ( int index )
+{
+	addrbank *orig = mem_banks[ index ];
+	addrbank *ab;
+
+	if ( watch_is_bank ( orig ) )
+		return;
+	ab = watch_get_bank ( orig );
+	if ( !ab )
+		return;
+	watch_orig[ index ] = orig;
+	put_mem_bank ( index << 16 , ab , orig->start );
+}
+
+/*
+ * (Re-)install the watching banks, after watched banks or the memory
+ * mapping changed. Copies are re-created, as the original banks
+ * may have been re-initialized.
+ */
+static void memory_watch_apply ( void )
+{
+	watch_for_each ( watch_restore_entry );
+	watch_store_count = 0;
+	watch_for_each ( watch_replace_entry );
+}
+
+void memory_set_watched_banks ( const uae_u32 *banks , int count )
+{
+	/* restore the previously watched ones */
+	watch_for_each ( watch_restore_entry );
+
+	if ( count > WATCH_BANK_MAX )
+		count = WATCH_BANK_MAX;
+	memcpy ( watch_banks , banks , count * sizeof ( uae_u32 ) );
+	watch_bank_count = count;
+
+	memory_watch_apply ();
+}
+#endif
+
+
 #ifdef WINUAE_FOR_HATARI
 /*
  * Check if an address points to a memory region that causes bus error
@@ -1735,6 +2035,10 @@ void memory_init(uae_u32 NewSTMemSize, uae_u32 NewTTMemSize, uae_u32 NewRomMemSt
 	SysMem_bank_MMU.start = STmem_start;
 	init_bank ( &SysMem_bank_MMU , STmem_size );
 
+	/* init_bank() restored direct write access */
+	if ( dirty_tracking )
+		memory_set_dirty_tracking ( true );
+
 	dummy_bank.baseaddr = NULL;				/* No real memory allocated for this region */
 	init_bank ( &dummy_bank , 0 );
 	VoidMem_bank.baseaddr = NULL;			/* No real memory allocated for this region */
@@ -1932,6 +2236,9 @@ static void map_banks2 (addrbank *bank, int start, int size, int realsize, int q
 #ifndef WINUAE_FOR_HATARI
 		if (quick <= 0)
 			debug_bankchange (old);
+#else
+		if ( watch_bank_count )
+			memory_watch_apply ();
 #endif
 		return;
 	}
@@ -1965,6 +2272,9 @@ static void map_banks2 (addrbank *bank, int start, int size, int realsize, int q
 	if (quick <= 0)
 		debug_bankchange (old);
 	fill_ce_banks ();
+#else
+	if ( watch_bank_count )
+		memory_watch_apply ();
 #endif
 }
 
@@ -516,6 +516,8 @@ extern addrbank *get_mem_bank_real(uaecptr);
 extern bool memory_region_bus_error ( uaecptr addr );
 extern bool memory_region_iomem ( uaecptr addr );
 extern void memory_map_Standard_RAM ( Uint32 MMU_Bank0_Size , Uint32 MMU_Bank1_Size );
+extern void memory_set_dirty_tracking ( bool enable );
+extern void memory_set_watched_banks ( const uae_u32 *banks , int count );
 #endif
 extern void memory_init(uae_u32 NewSTMemSize, uae_u32 NewTTMemSize, uae_u32 NewRomMemStart);
 extern void memory_uninit (void);
@@ -6638,6 +6638,7 @@ static void m68k_run_3p(void)
 				do_cycles(cycles);
 #else
 				cycles = cpu_cycles = CYCLE_UNIT / 2;
+				regs.instruction_cnt++;
 				M68000_AddCycles_CE(cycles * 2 / CYCLE_UNIT);
 
 				if ( WaitStateCycles ) {
@@ -7165,6 +7166,7 @@ static void m68k_run_2_000(void)
 #endif
 
 				cpu_cycles = (*cpufunctbl[r->opcode])(r->opcode) & 0xffff;
+				r->instruction_cnt++;
 				cpu_cycles = adjust_cycles (cpu_cycles);
 				do_cycles(cpu_cycles);
 #ifdef WINUAE_FOR_HATARI
@@ -7256,6 +7258,7 @@ static void m68k_run_2_020(void)
 				}
 #endif
 				cpu_cycles = (*cpufunctbl[r->opcode])(r->opcode) >> 16;
+				r->instruction_cnt++;
 				cpu_cycles = adjust_cycles(cpu_cycles);
 				do_cycles(cpu_cycles);
 #ifdef WINUAE_FOR_HATARI
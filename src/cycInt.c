@@ -69,6 +69,7 @@ const char CycInt_fileid[] = "Hatari cycInt.c";
 #include "video.h"
 #include "acia.h"
 #include "clocks_timings.h"
+#include "perftimer.h"
 
 
 //#define	CYCINT_DEBUG
@@ -791,6 +792,8 @@ void	CycInt_CallActiveHandler(Uint64 Clock)
 	CycInt_DelayedCycles = PendingInterruptCount;
 //fprintf ( stderr , "int call handler pending=%d\n" , PendingInterruptCount );
 
+	PerfTimer_Begin ( PERF_TIMER_CYCINT + CycInt_ActiveInt );
 	CALL_VAR ( InterruptHandlers[CycInt_ActiveInt].pFunction );
+	PerfTimer_End ();
 }
 
@@ -45,6 +45,10 @@ const char BreakCond_fileid[] = "Hatari breakcond.c";
 
 #define BC_DEFAULT_DSP_SPACE 'P'
 
+/* bits in the hashed PC filter, must be a power of two */
+#define BC_PCFILTER_BITS 4096
+#define BC_PCFILTER_HASH(pc) (((pc) >> 1) & (BC_PCFILTER_BITS-1))
+
 typedef struct {
 	bool is_indirect;
 	char dsp_space;	/* DSP has P, X, Y address spaces, zero if not DSP */
@@ -79,14 +83,37 @@ typedef struct {
 	bool deleted;   /* delayed delete flag */
 } bc_options_t;
 
+typedef Uint32 (*bc_getter_t)(const bc_value_t *bc_value);
+
+/* condition lowered for matching, see BreakCond_Compile() */
+typedef struct {
+	bc_getter_t lget;
+	const bc_value_t *lvalue;
+	bc_getter_t rget;	/* NULL when right side is constant */
+	const bc_value_t *rvalue;
+	Uint32 lmask;
+	Uint32 rmask;
+	Uint32 rconst;	/* masked right side constant */
+	char comparison;
+	bc_condition_t *condition;	/* for tracking */
+} bc_compiled_t;
+
 typedef struct {
 	char *expression;
 	bc_options_t options;
 	bc_condition_t *conditions;
 	int ccount;	/* condition count */
+	bc_compiled_t *compiled;	/* conditions in evaluation order */
+	int compiled_count;	/* non-constant condition count */
+	bool never;	/* a constant condition is always false */
 	int hits;	/* how many times breakpoint hit */
 } bc_breakpoint_t;
 
+typedef struct {
+	Uint32 pc;	/* address in "pc = <address>" condition */
+	int index;	/* breakpoint array index */
+} bc_pcindex_t;
+
 typedef struct {
 	bc_breakpoint_t *breakpoint;
 	bc_breakpoint_t *breakpoint2delete;	/* delayed delete of old alloc */
@@ -95,6 +122,18 @@ typedef struct {
 	int allocated;
 	bool delayed_change;
 	const debug_reason_t reason;
+
+	/* Breakpoints with a "pc = <address>" condition are looked up
+	 * by PC, so only the others need to be checked on every
+	 * instruction. Rebuilt on next match when breakpoints change.
+	 */
+	bool index_changed;
+	bc_pcindex_t *pcindex;	/* sorted by PC, then by index */
+	int pcindex_count;
+	int *generic;		/* indexes of the other breakpoints */
+	int generic_count;
+	int index_allocated;
+	Uint32 pcfilter[BC_PCFILTER_BITS/32];	/* hashed PCs in pcindex */
 } bc_breakpoints_t;
 
 static bc_breakpoints_t CpuBreakPoints = {
@@ -111,6 +150,7 @@ static bc_breakpoints_t DspBreakPoints = {
 static void BreakCond_DoDelayedActions(bc_breakpoints_t *bps);
 static bool BreakCond_Remove(bc_breakpoints_t *bps, int position);
 static void BreakCond_Print(bc_breakpoint_t *bp);
+static Uint32 GetCpuPC(void);
 
 
 /**
@@ -258,43 +298,204 @@ static void BreakCond_UpdateTracked(bc_condition_t *condition, Uint32 value)
 }
 
 
+/* Specialized value accessors for compiled conditions.
+ * Masking is done by the caller.
+ */
+static Uint32 BreakCond_GetNumber(const bc_value_t *bc_value)
+{
+	return bc_value->value.number;
+}
+static Uint32 BreakCond_GetFunction32(const bc_value_t *bc_value)
+{
+	return bc_value->value.func32();
+}
+static Uint32 BreakCond_GetReg16(const bc_value_t *bc_value)
+{
+	return *(bc_value->value.reg16);
+}
+static Uint32 BreakCond_GetReg32(const bc_value_t *bc_value)
+{
+	return *(bc_value->value.reg32);
+}
+static Uint32 BreakCond_GetMemoryByte(const bc_value_t *bc_value)
+{
+	return STMemory_ReadByte(bc_value->value.number);
+}
+static Uint32 BreakCond_GetMemoryWord(const bc_value_t *bc_value)
+{
+	return STMemory_ReadWord(bc_value->value.number);
+}
+static Uint32 BreakCond_GetMemoryLong(const bc_value_t *bc_value)
+{
+	return STMemory_ReadLong(bc_value->value.number);
+}
+
+/**
+ * Return accessor for given value, and relative cost of calling it
+ */
+static bc_getter_t BreakCond_GetGetter(const bc_value_t *bc_value, int *cost)
+{
+	if (!bc_value->is_indirect) {
+		switch (bc_value->valuetype) {
+		case VALUE_TYPE_NUMBER:
+			*cost = 0;
+			return BreakCond_GetNumber;
+		case VALUE_TYPE_FUNCTION32:
+			*cost = 2;
+			return BreakCond_GetFunction32;
+		case VALUE_TYPE_REG16:
+			*cost = 1;
+			return BreakCond_GetReg16;
+		case VALUE_TYPE_VAR32:
+		case VALUE_TYPE_REG32:
+			*cost = 1;
+			return BreakCond_GetReg32;
+		default:
+			break;
+		}
+	} else if (!bc_value->dsp_space && bc_value->valuetype == VALUE_TYPE_NUMBER) {
+		/* fixed ST memory address */
+		*cost = 3;
+		switch (bc_value->bits) {
+		case 8:
+			return BreakCond_GetMemoryByte;
+		case 16:
+			return BreakCond_GetMemoryWord;
+		case 32:
+			return BreakCond_GetMemoryLong;
+		default:
+			break;
+		}
+	}
+	/* register indirect or DSP memory */
+	*cost = 4;
+	return BreakCond_GetValue;
+}
+
+/**
+ * Return result of given comparison between given values
+ */
+static inline bool BreakCond_Compare(char comparison, Uint32 lvalue, Uint32 rvalue)
+{
+	switch (comparison) {
+	case '<':
+		return (lvalue < rvalue);
+	case '>':
+		return (lvalue > rvalue);
+	case '=':
+		return (lvalue == rvalue);
+	case '!':
+		return (lvalue != rvalue);
+	default:
+		fprintf(stderr, "ERROR: Unknown breakpoint value comparison operator '%c'!\n",
+			comparison);
+		abort();
+	}
+}
+
+/**
+ * Lower given breakpoint's conditions for matching:
+ * - each value gets an accessor specialized for its type
+ * - a constant side is moved to the right and pre-masked
+ * - conditions with constants on both sides are folded away
+ * - conditions are ordered so that cheapest ones get checked first,
+ *   unless value changes are tracked (those depend on the order)
+ * Needs to be called after BreakCond_CheckTracking().
+ */
+static void BreakCond_Compile(bc_breakpoint_t *bp)
+{
+	bc_condition_t *condition;
+	bc_compiled_t *c, tmp;
+	int i, j, lcost, rcost, *costs;
+	bool track = false;
+
+	bp->compiled = calloc(bp->ccount, sizeof(bc_compiled_t));
+	costs = calloc(bp->ccount, sizeof(int));
+	assert(bp->compiled && costs);
+	bp->compiled_count = 0;
+	bp->never = false;
+
+	condition = bp->conditions;
+	for (i = 0; i < bp->ccount; condition++, i++) {
+		c = bp->compiled + bp->compiled_count;
+		c->condition = condition;
+		c->comparison = condition->comparison;
+		c->lvalue = &(condition->lvalue);
+		c->rvalue = &(condition->rvalue);
+		c->lget = BreakCond_GetGetter(c->lvalue, &lcost);
+		c->rget = BreakCond_GetGetter(c->rvalue, &rcost);
+
+		if (lcost == 0 && rcost != 0) {
+			/* swap constant to the right */
+			c->lvalue = &(condition->rvalue);
+			c->rvalue = &(condition->lvalue);
+			c->lget = c->rget;
+			rcost = lcost;
+			if (c->comparison == '<') {
+				c->comparison = '>';
+			} else if (c->comparison == '>') {
+				c->comparison = '<';
+			}
+		}
+		c->lmask = c->lvalue->mask;
+		c->rmask = c->rvalue->mask;
+		if (rcost == 0) {
+			c->rget = NULL;
+			c->rconst = c->rvalue->value.number & c->rmask;
+			if (c->lget == BreakCond_GetNumber) {
+				/* both sides constant */
+				if (!BreakCond_Compare(c->comparison, c->lvalue->value.number & c->lmask, c->rconst)) {
+					bp->never = true;
+				}
+				continue;
+			}
+		}
+		if (condition->track) {
+			track = true;
+		}
+		costs[bp->compiled_count++] = lcost + rcost;
+	}
+
+	/* insertion sort, stable for conditions with same cost */
+	for (i = 1; !track && i < bp->compiled_count; i++) {
+		tmp = bp->compiled[i];
+		lcost = costs[i];
+		for (j = i; j > 0 && costs[j-1] > lcost; j--) {
+			bp->compiled[j] = bp->compiled[j-1];
+			costs[j] = costs[j-1];
+		}
+		bp->compiled[j] = tmp;
+		costs[j] = lcost;
+	}
+	free(costs);
+}
+
 /**
  * Return true if all of the given breakpoint's conditions match
  */
-static bool BreakCond_MatchConditions(bc_condition_t *condition, int count)
+static bool BreakCond_MatchConditions(bc_breakpoint_t *bp)
 {
+	const bc_compiled_t *c = bp->compiled;
 	Uint32 lvalue, rvalue;
-	bool hit = false;
 	int i;
 
-	for (i = 0; i < count; condition++, i++) {
-
-		lvalue = BreakCond_GetValue(&(condition->lvalue));
-		rvalue = BreakCond_GetValue(&(condition->rvalue));
+	if (unlikely(bp->never)) {
+		return false;
+	}
+	for (i = 0; i < bp->compiled_count; c++, i++) {
 
-		switch (condition->comparison) {
-		case '<':
-			hit = (lvalue < rvalue);
-			break;
-		case '>':
-			hit = (lvalue > rvalue);
-			break;
-		case '=':
-			hit = (lvalue == rvalue);
-			break;
-		case '!':
-			hit = (lvalue != rvalue);
-			break;
-		default:
-			fprintf(stderr, "ERROR: Unknown breakpoint value comparison operator '%c'!\n",
-				condition->comparison);
-			abort();
+		lvalue = c->lget(c->lvalue) & c->lmask;
+		if (c->rget) {
+			rvalue = c->rget(c->rvalue) & c->rmask;
+		} else {
+			rvalue = c->rconst;
 		}
-		if (likely(!hit)) {
+		if (likely(!BreakCond_Compare(c->comparison, lvalue, rvalue))) {
 			return false;
 		}
-		if (condition->track) {
-			BreakCond_UpdateTracked(condition, lvalue);
+		if (c->condition->track) {
+			BreakCond_UpdateTracked(c->condition, lvalue);
+			bp->compiled[i].rconst = lvalue & c->rmask;
 		}
 	}
 	/* all conditions matched */
@@ -302,26 +503,152 @@ static bool BreakCond_MatchConditions(bc_condition_t *condition, int count)
 }
 
 
+/**
+ * If given condition is "pc = <address>" (either way round),
+ * set the address to given pointer and return true.
+ */
+static bool BreakCond_GetConditionPC(const bc_condition_t *condition, Uint32 *pc)
+{
+	const bc_value_t *reg = &(condition->lvalue);
+	const bc_value_t *num = &(condition->rvalue);
+
+	if (condition->comparison != '=' || condition->track) {
+		return false;
+	}
+	if (reg->valuetype == VALUE_TYPE_NUMBER) {
+		reg = &(condition->rvalue);
+		num = &(condition->lvalue);
+	}
+	if (reg->valuetype != VALUE_TYPE_FUNCTION32 ||
+	    reg->value.func32 != GetCpuPC ||
+	    reg->is_indirect || reg->mask != BITMASK(32)) {
+		return false;
+	}
+	if (num->valuetype != VALUE_TYPE_NUMBER ||
+	    num->is_indirect || num->mask != BITMASK(32)) {
+		return false;
+	}
+	*pc = num->value.number;
+	return true;
+}
+
+/**
+ * Sort PC index entries by PC, and by breakpoint index within same PC
+ */
+static int BreakCond_ComparePCIndex(const void *a, const void *b)
+{
+	const bc_pcindex_t *ia = a, *ib = b;
+
+	if (ia->pc != ib->pc) {
+		return ia->pc < ib->pc ? -1 : 1;
+	}
+	return ia->index - ib->index;
+}
+
+/**
+ * Rebuild PC index and list of other breakpoints after breakpoints change
+ */
+static void BreakCond_BuildIndex(bc_breakpoints_t *bps)
+{
+	bc_breakpoint_t *bp;
+	Uint32 pc;
+	int i, j;
+
+	if (bps->index_allocated < bps->count) {
+		bps->index_allocated = bps->allocated;
+		bps->pcindex = realloc(bps->pcindex, bps->index_allocated * sizeof(bc_pcindex_t));
+		bps->generic = realloc(bps->generic, bps->index_allocated * sizeof(int));
+		assert(bps->pcindex && bps->generic);
+	}
+	memset(bps->pcfilter, 0, sizeof(bps->pcfilter));
+	bps->pcindex_count = bps->generic_count = 0;
+
+	bp = bps->breakpoint;
+	for (i = 0; i < bps->count; bp++, i++) {
+		for (j = 0; j < bp->ccount; j++) {
+			if (BreakCond_GetConditionPC(&(bp->conditions[j]), &pc)) {
+				break;
+			}
+		}
+		if (j < bp->ccount) {
+			bps->pcindex[bps->pcindex_count].pc = pc;
+			bps->pcindex[bps->pcindex_count].index = i;
+			bps->pcindex_count++;
+			bps->pcfilter[BC_PCFILTER_HASH(pc) >> 5] |= 1u << (BC_PCFILTER_HASH(pc) & 31);
+		} else {
+			bps->generic[bps->generic_count++] = i;
+		}
+	}
+	qsort(bps->pcindex, bps->pcindex_count, sizeof(bc_pcindex_t), BreakCond_ComparePCIndex);
+	bps->index_changed = false;
+}
+
+/**
+ * Find PC index entries matching given PC.
+ * Return index of first entry and set count of matching entries.
+ */
+static int BreakCond_LookupPC(bc_breakpoints_t *bps, Uint32 pc, int *count)
+{
+	int lo = 0, hi = bps->pcindex_count, mid;
+
+	*count = 0;
+	if (likely(!(bps->pcfilter[BC_PCFILTER_HASH(pc) >> 5] & (1u << (BC_PCFILTER_HASH(pc) & 31))))) {
+		return 0;
+	}
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (bps->pcindex[mid].pc < pc) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	for (mid = lo; mid < bps->pcindex_count && bps->pcindex[mid].pc == pc; mid++) {
+		(*count)++;
+	}
+	return lo;
+}
+
 /**
  * Check and show which breakpoints' conditions matched
  * @return	true if (non-tracing) breakpoint was hit,
  *		or false if none matched
  */
-static bool BreakCond_MatchBreakPoints(bc_breakpoints_t *bps)
+static bool BreakCond_MatchBreakPoints(bc_breakpoints_t *bps, Uint32 pc)
 {
-	bc_breakpoint_t *bp;
+	bc_breakpoint_t *bp, *first;
 	bool changes = false;
 	bool hit = false;
-	int i;
+	int i, g, p, pcend, pccount;
+
+	if (unlikely(bps->index_changed)) {
+		BreakCond_BuildIndex(bps);
+	}
+	p = BreakCond_LookupPC(bps, pc, &pccount);
+	if (likely(!pccount && !bps->generic_count)) {
+		return false;
+	}
+	pcend = p + pccount;
 
 	/* array should not be changed while it's being traversed */
 	assert(likely(!bps->delayed_change));
 	bps->delayed_change = true;
 
-	bp = bps->breakpoint;
-	for (i = 0; i < bps->count; bp++, i++) {
+	/* go through PC matches and other breakpoints in index order */
+	first = bps->breakpoint;
+	g = 0;
+	for (;;) {
+		if (g < bps->generic_count &&
+		    (p >= pcend || bps->generic[g] < bps->pcindex[p].index)) {
+			i = bps->generic[g++];
+		} else if (p < pcend) {
+			i = bps->pcindex[p++].index;
+		} else {
+			break;
+		}
+		bp = first + i;
 
-		if (BreakCond_MatchConditions(bp->conditions, bp->ccount)) {
+		if (BreakCond_MatchConditions(bp)) {
 			bp->hits++;
 			if (bp->options.skip) {
 				if (bp->hits % bp->options.skip) {
@@ -379,7 +706,38 @@ static bool BreakCond_MatchBreakPoints(bc_breakpoints_t *bps)
  */
 bool BreakCond_MatchCpu(void)
 {
-	return BreakCond_MatchBreakPoints(&CpuBreakPoints);
+	return BreakCond_MatchBreakPoints(&CpuBreakPoints, M68000_GetPC());
+}
+
+/**
+ * Return true if conditions of any non-tracing CPU breakpoint match
+ * at current PC.  Unlike BreakCond_MatchCpu(), this doesn't count
+ * hits, nor do breakpoint options or actions, so it can be used
+ * for checking where breakpoints would have been hit (rewind).
+ */
+bool BreakCond_PeekCpu(void)
+{
+	bc_breakpoints_t *bps = &CpuBreakPoints;
+	bc_breakpoint_t *bp;
+	int i, p, pccount;
+
+	if (unlikely(bps->index_changed)) {
+		BreakCond_BuildIndex(bps);
+	}
+	p = BreakCond_LookupPC(bps, M68000_GetPC(), &pccount);
+	for (i = 0; i < pccount; i++) {
+		bp = bps->breakpoint + bps->pcindex[p + i].index;
+		if (!bp->options.trace && BreakCond_MatchConditions(bp)) {
+			return true;
+		}
+	}
+	for (i = 0; i < bps->generic_count; i++) {
+		bp = bps->breakpoint + bps->generic[i];
+		if (!bp->options.trace && BreakCond_MatchConditions(bp)) {
+			return true;
+		}
+	}
+	return false;
 }
 
 /**
@@ -387,7 +745,8 @@ bool BreakCond_MatchCpu(void)
  */
 bool BreakCond_MatchDsp(void)
 {
-	return BreakCond_MatchBreakPoints(&DspBreakPoints);
+	/* DSP breakpoints aren't PC indexed */
+	return BreakCond_MatchBreakPoints(&DspBreakPoints, 0);
 }
 
 /**
@@ -1208,6 +1567,7 @@ static bool BreakCond_Parse(const char *expression, bc_options_t *options, bool
 	}
 	if (ccount > 0) {
 		bps->count++;
+		bps->index_changed = true;
 		if (!options->quiet) {
 			fprintf(stderr, "%s condition breakpoint %d with %d condition(s) added:\n\t%s\n",
 				bps->name, bps->count, ccount, bp->expression);
@@ -1235,6 +1595,7 @@ static bool BreakCond_Parse(const char *expression, bc_options_t *options, bool
 			}
 		}
 		BreakCond_CheckTracking(bp);
+		BreakCond_Compile(bp);
 
 		bp->options.quiet = options->quiet;
 		bp->options.skip = options->skip;
@@ -1357,8 +1718,10 @@ static bool BreakCond_Remove(bc_breakpoints_t *bps, int position)
 	}
 	free(bp->expression);
 	free(bp->conditions);
+	free(bp->compiled);
 	bp->expression = NULL;
 	bp->conditions = NULL;
+	bp->compiled = NULL;
 
 	if (bp->options.filename) {
 		free(bp->options.filename);
@@ -1368,6 +1731,7 @@ static bool BreakCond_Remove(bc_breakpoints_t *bps, int position)
 		memmove(bp, bp + 1, (bps->count - position) * sizeof(bc_breakpoint_t));
 	}
 	bps->count--;
+	bps->index_changed = true;
 	return true;
 }
 
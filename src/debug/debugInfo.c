@@ -35,6 +35,7 @@ const char DebugInfo_fileid[] = "Hatari debuginfo.c";
 #include "m68000.h"
 #include "mfp.h"
 #include "nvram.h"
+#include "perftimer.h"
 #include "psg.h"
 #include "rtc.h"
 #include "stMemory.h"
@@ -678,6 +679,7 @@ static const struct {
 	{ false,"mmu",       M68000_MMU_Info,      NULL, "Show MMU register contents" },
 	{ false,"nvram",     NvRam_Info,           NULL, "Show (TT/Falcon) NVRAM contents" },
 	{ false,"osheader",  DebugInfo_OSHeader,   NULL, "Show TOS OS header contents" },
+	{ false,"perf",      PerfTimer_Info,       NULL, "Show host time spent in emulation subsystems per VBL (with <value>, reset averages)" },
 	{ true, "regaddr",   DebugInfo_RegAddr, DebugInfo_RegAddrArgs, "Show <disasm|memdump> from CPU/DSP address pointed by <register>" },
 	{ true, "registers", DebugInfo_CpuRegister,NULL, "Show CPU register contents" },
 	{ false,"rtc",       Rtc_Info,             NULL, "Show (Mega ST/STE) RTC register contents" },
@@ -35,6 +35,8 @@ const char DebugCpu_fileid[] = "Hatari debugcpu.c";
 #include "console.h"
 #include "options.h"
 #include "vars.h"
+#include "rewind.h"
+#include "watchpoint.h"
 
 
 #define MEMDUMP_COLS   16      /* memdump, number of bytes per row */
@@ -893,6 +895,11 @@ Uint32 DebugCpu_InstrCount(void)
  */
 void DebugCpu_Check(void)
 {
+	if (Rewind_Enabled() && Rewind_Check())
+	{
+		/* instruction is being replayed for rewind */
+		return;
+	}
 	nCpuInstructions++;
 	if (bCpuProfiling)
 	{
@@ -914,6 +921,12 @@ void DebugCpu_Check(void)
 		uaecptr nextpc;
 		m68k_dumpstate_file(TraceFile, &nextpc, 0xffffffff);
 	}
+	if (Watchpoint_CheckHit())
+	{
+		DebugUI(REASON_CPU_WATCHPOINT);
+		if (nCpuSteps)
+			nCpuSteps++;
+	}
 	if (nCpuActiveCBs)
 	{
 		if (BreakCond_MatchCpu())
@@ -952,7 +965,7 @@ void DebugCpu_SetDebugging(void)
 	bCpuProfiling = Profile_CpuStart();
 	nCpuActiveCBs = BreakCond_CpuBreakPointCount();
 
-	if (nCpuActiveCBs || nCpuSteps || bCpuProfiling || History_TrackCpu()
+	if (nCpuActiveCBs || nCpuSteps || bCpuProfiling || History_TrackCpu() || Rewind_Enabled()
 	    || LOG_TRACE_LEVEL((TRACE_CPU_DISASM|TRACE_CPU_SYMBOLS|TRACE_CPU_REGS))
 	    || ConOutDevices)
 	{
@@ -1032,6 +1045,16 @@ static const dbgcommand_t cpucommands[] =
 	  "load CPU symbols & their addresses",
 	  Symbols_Description,
 	  false },
+	{ Watchpoint_Command, Symbols_MatchCpuDataAddress,
+	  "watch", "",
+	  "set/remove/list memory access watchpoints",
+	  Watchpoint_Description,
+	  false },
+	{ Rewind_Command, NULL,
+	  "rewind", "",
+	  "step or run CPU backwards",
+	  Rewind_Description,
+	  false },
 	{ DebugCpu_Step, NULL,
 	  "step", "s",
 	  "single-step CPU",
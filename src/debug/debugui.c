@@ -45,6 +45,7 @@ const char DebugUI_fileid[] = "Hatari debugui.c";
 #include "debugui.h"
 #include "evaluate.h"
 #include "history.h"
+#include "rewind.h"
 #include "symbols.h"
 #include "vars.h"
 
@@ -67,12 +68,19 @@ static char *finalDir;
 static DebugUI_ProcessRemoteCommands remoteDebugcmdCallback = NULL;
 
 /**
- * Save/Restore snapshot of debugging session variables
+ * Save/Restore snapshot of debugging session variables.
+ * NULL path is for in-memory snapshots, which don't touch breakpoints.
  */
 void DebugUI_MemorySnapShot_Capture(const char *path, bool bSave)
 {
 	char *filename;
 
+	if (!path)
+	{
+		Rewind_MemorySnapShot_Capture(bSave);
+		return;
+	}
+
 	filename = Str_Alloc(strlen(path) + strlen(".debug"));
 	strcpy(filename, path);
 	strcat(filename, ".debug");
@@ -970,10 +978,13 @@ static const dbgcommand_t uicommand[] =
 	{ History_Parse, History_Match,
 	  "history", "hi",
 	  "show last CPU/DSP PC values & executed instructions",
-	  "cpu|dsp|on|off|<count> [limit]|save <file>\n"
+	  "cpu|dsp|on|off [limit] [regs]|<count>|find <reg> <value>|save <file>\n"
 	  "\t'cpu' and 'dsp' enable instruction history tracking for just given\n"
 	  "\tprocessor, 'on' tracks them both, 'off' will disable history.\n"
-	  "\tOptional 'limit' will set how many past instructions are tracked.\n"
+	  "\tOptional 'limit' will set about how many past instructions are\n"
+	  "\ttracked, and 'regs' tracks also CPU register (d0-a7, sr) changes.\n"
+	  "\t'find' shows last instruction where given CPU register (pc, sr,\n"
+	  "\td0-a7) had given value.\n"
 	  "\tGiving just count will show (at max) given number of last saved PC\n"
 	  "\tvalues and instructions currently at corresponding RAM addresses.",
 	  false },
@@ -1201,6 +1212,7 @@ void DebugUI(debug_reason_t reason)
 		* on how to continue in case he invoked the debugger by accident.
 		*/
 		Statusbar_AddMessage("Console Debugger", 100);
+		Screen_RenderWait();
 		Statusbar_Update(sdlscrn, true);
 
 		cmdret = DEBUGGER_CMDDONE;
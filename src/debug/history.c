@@ -11,6 +11,7 @@
 const char History_fileid[] = "Hatari history.c";
 
 #include <assert.h>
+#include <ctype.h>
 #include <errno.h>
 #include "main.h"
 #include "debugui.h"
@@ -25,27 +26,74 @@ const char History_fileid[] = "Hatari history.c";
 
 #define HISTORY_ITEMS_MIN 64
 
+/* History is stored as variable-length, delta-encoded records in
+ * fixed size chunks, which form a ring.  Each chunk starts with the
+ * full state, so it can be decoded on its own.
+ */
+#define HISTORY_CHUNK_SIZE (64*1024)
+/* largest possible encoded record */
+#define HISTORY_RECORD_MAX 112
+/* average encoded record sizes, used for sizing the ring from the limit */
+#define HISTORY_RECORD_AVG 3
+#define HISTORY_RECORD_AVG_REGS 6
+/* how many debugger entry reasons are remembered */
+#define HISTORY_MARKS 64
+
+/* record flags byte; bits 3-7 are CPU cycles since previous record */
+#define HIST_FLAG_DSP	0x01	/* DSP PC record */
+#define HIST_FLAG_SR	0x02	/* SR changed, value follows */
+#define HIST_FLAG_REGS	0x04	/* registers changed, mask & deltas follow */
+#define HIST_CYCLES_SHIFT 3
+#define HIST_CYCLES_VARINT 31	/* cycles didn't fit, value follows */
+
 history_type_t HistoryTracking;
 
+/* state after a record */
 typedef struct {
-	bool shown:1;
-	bool valid:1;
-	bool for_dsp:1;
-	/* reason for debugger entry/breakpoint hit */
-	debug_reason_t reason:8;
-	union {
-		Uint16 dsp;
-		Uint32 cpu;
-	} pc;
-} hist_item_t;
+	Uint64 cycles;
+	Uint32 cpu_pc;
+	Uint32 regs[16];
+	Uint16 sr;
+	Uint16 dsp_pc;
+} hist_state_t;
+
+typedef struct {
+	Uint64 first;      /* number of first record in chunk */
+	Uint32 count;      /* records in chunk */
+	Uint32 used;       /* bytes used in data */
+	hist_state_t state;  /* state before first record */
+	Uint8 data[HISTORY_CHUNK_SIZE];
+} hist_chunk_t;
 
 static struct {
-	unsigned idx;      /* index to current history item */
-	unsigned count;    /* how many items of history are collected */
-	unsigned limit;    /* ring-buffer size */
-	hist_item_t *item; /* ring-buffer */
+	hist_chunk_t **chunk;  /* ring-buffer of chunks, allocated on use */
+	unsigned nchunks;  /* ring-buffer size */
+	unsigned head;     /* chunk being written */
+	unsigned used;     /* how many chunks contain records */
+	unsigned limit;    /* requested number of instructions */
+	bool regs;         /* whether register changes are tracked */
+	Uint64 total;      /* how many records have been added */
+	Uint64 shown;      /* records before this one have been shown */
+	hist_state_t state;  /* state after last record */
+	/* reasons for debugger entry/breakpoint hit */
+	struct {
+		Uint64 record;
+		debug_reason_t reason;
+	} mark[HISTORY_MARKS];
+	unsigned marks;
 } History;
 
+/* decoding position */
+typedef struct {
+	unsigned n;        /* chunk, counted from oldest */
+	const hist_chunk_t *chunk;
+	const Uint8 *data;
+	Uint32 left;       /* records left in chunk */
+	Uint64 next;       /* number of next record */
+	history_record_t rec;
+	hist_state_t state;
+} hist_iter_t;
+
 
 /**
  * Convert debugger entry/breakpoint entry reason to a string
@@ -67,28 +115,50 @@ static const char* History_ReasonStr(debug_reason_t reason)
 		return "Program break";
 	case REASON_USER:
 		return "User break";
+	case REASON_CPU_WATCHPOINT:
+		return "CPU watchpoint";
 	default:
 		return "Unknown reason";
 	}
 }
 
 
+/**
+ * Free all history chunks
+ */
+static void History_Free(void)
+{
+	unsigned i;
+
+	if (History.chunk) {
+		for (i = 0; i < History.nchunks; i++) {
+			free(History.chunk[i]);
+		}
+		free(History.chunk);
+	}
+	memset(&History, 0, sizeof(History));
+}
+
 /**
  * Set what kind of history is collected.
  * Clear history if tracking type changes as rest of
  * data wouldn't then be anymore valid.
  */
-static void History_Enable(history_type_t track, unsigned limit)
+static void History_Enable(history_type_t track, unsigned limit, bool regs)
 {
 	const char *msg;
-	if (track != HistoryTracking || limit != History.limit) {
+	Uint64 size;
+
+	if (track != HistoryTracking || limit != History.limit || regs != History.regs) {
 		fprintf(stderr, "Re-allocating & zeroing history due to type/limit change.\n");
-		if (History.item) {
-			free(History.item);
-		}
-		memset(&History, 0, sizeof(History));
-		History.item = calloc(limit, sizeof(History.item[0]));
+		History_Free();
+		size = (Uint64)limit * (regs ? HISTORY_RECORD_AVG_REGS : HISTORY_RECORD_AVG);
+		History.nchunks = size / HISTORY_CHUNK_SIZE + 2;
+		History.chunk = calloc(History.nchunks, sizeof(History.chunk[0]));
+		assert(History.chunk);
 		History.limit = limit;
+		History.regs = regs;
+		History.state.cycles = CyclesGlobalClockCounter;
 	}
 	switch (track) {
 	case HISTORY_TRACK_NONE:
@@ -107,20 +177,79 @@ static void History_Enable(history_type_t track, unsigned limit)
 		msg = "error";
 	}
 	HistoryTracking = track;
-	fprintf(stderr, "History tracking %s (max. %d instructions).\n", msg, limit);
+	fprintf(stderr, "History tracking %s (about %d instructions%s, max. %u MB).\n",
+		msg, limit, regs ? " with registers" : "",
+		(unsigned)(((Uint64)History.nchunks * sizeof(hist_chunk_t)) >> 20));
 }
 
 /**
- * Advance & initialize next history item in ring buffer
+ * Return chunk to write next record to, starting a new one if needed
  */
-static void History_Advance(void)
+static hist_chunk_t *History_NextChunk(void)
 {
-	History.idx++;
-	History.idx %= History.limit;
-	History.item[History.idx].valid = true;
-	History.item[History.idx].shown = false;
-	History.item[History.idx].reason = REASON_NONE;
-	History.count++;
+	hist_chunk_t *chunk = History.chunk[History.head];
+
+	if (chunk) {
+		History.head = (History.head + 1) % History.nchunks;
+		chunk = History.chunk[History.head];
+	}
+	if (!chunk) {
+		chunk = malloc(sizeof(hist_chunk_t));
+		assert(chunk);
+		History.chunk[History.head] = chunk;
+	}
+	if (History.used < History.nchunks) {
+		History.used++;
+	}
+	chunk->first = History.total;
+	chunk->count = 0;
+	chunk->used = 0;
+	chunk->state = History.state;
+	return chunk;
+}
+
+static inline hist_chunk_t *History_CurrentChunk(void)
+{
+	hist_chunk_t *chunk = History.chunk[History.head];
+
+	if (unlikely(!chunk || chunk->used + HISTORY_RECORD_MAX > HISTORY_CHUNK_SIZE)) {
+		chunk = History_NextChunk();
+	}
+	return chunk;
+}
+
+static inline Uint8 *History_PutVarint(Uint8 *p, Uint64 value)
+{
+	while (value >= 0x80) {
+		*p++ = (Uint8)value | 0x80;
+		value >>= 7;
+	}
+	*p++ = (Uint8)value;
+	return p;
+}
+
+static inline const Uint8 *History_GetVarint(const Uint8 *p, Uint64 *value)
+{
+	Uint64 v = 0;
+	int shift = 0;
+
+	while (*p & 0x80) {
+		v |= (Uint64)(*p++ & 0x7f) << shift;
+		shift += 7;
+	}
+	*value = v | (Uint64)*p++ << shift;
+	return p;
+}
+
+/* signed deltas are zigzag encoded so that small ones stay small */
+static inline Uint32 History_ZigZag(Uint32 delta)
+{
+	return (delta << 1) ^ (Uint32)((Sint32)delta >> 31);
+}
+
+static inline Uint32 History_UnZigZag(Uint32 value)
+{
+	return (value >> 1) ^ -(value & 1);
 }
 
 /**
@@ -128,11 +257,54 @@ static void History_Advance(void)
  */
 void History_AddCpu(void)
 {
+	hist_chunk_t *chunk = History_CurrentChunk();
+	Uint8 *p, *start = chunk->data + chunk->used;
+	Uint64 cycles = CyclesGlobalClockCounter - History.state.cycles;
 	Uint32 pc = M68000_GetPC();
+	Uint16 sr = M68000_GetSR();
+	Uint32 mask = 0;
+	Uint8 flags;
+	int i;
+
+	if (History.regs) {
+		for (i = 0; i < 16; i++) {
+			if (Regs[i] != History.state.regs[i]) {
+				mask |= 1 << i;
+			}
+		}
+	}
+	flags = (mask ? HIST_FLAG_REGS : 0) | (sr != History.state.sr ? HIST_FLAG_SR : 0);
+	if (cycles < HIST_CYCLES_VARINT) {
+		flags |= cycles << HIST_CYCLES_SHIFT;
+	} else {
+		flags |= HIST_CYCLES_VARINT << HIST_CYCLES_SHIFT;
+	}
+	p = start;
+	*p++ = flags;
+	p = History_PutVarint(p, History_ZigZag(pc - History.state.cpu_pc));
+	if (cycles >= HIST_CYCLES_VARINT) {
+		p = History_PutVarint(p, cycles);
+	}
+	if (flags & HIST_FLAG_SR) {
+		*p++ = sr >> 8;
+		*p++ = sr;
+	}
+	if (mask) {
+		p = History_PutVarint(p, mask);
+		for (i = 0; i < 16; i++) {
+			if (mask & (1 << i)) {
+				p = History_PutVarint(p, History_ZigZag(Regs[i] - History.state.regs[i]));
+				History.state.regs[i] = Regs[i];
+			}
+		}
+	}
+	History.state.cpu_pc = pc;
+	History.state.sr = sr;
+	History.state.cycles += cycles;
 
-	History_Advance();
-	History.item[History.idx].for_dsp = false;
-	History.item[History.idx].pc.cpu = pc;
+	chunk->used += p - start;
+	chunk->count++;
+	History.total++;
 }
 
 /**
@@ -140,11 +312,18 @@ void History_AddCpu(void)
  */
 void History_AddDsp(void)
 {
+	hist_chunk_t *chunk = History_CurrentChunk();
+	Uint8 *p, *start = chunk->data + chunk->used;
 	Uint16 pc = DSP_GetPC();
 
-	History_Advance();
-	History.item[History.idx].for_dsp = true;
-	History.item[History.idx].pc.dsp = pc;
+	p = start;
+	*p++ = HIST_FLAG_DSP;
+	p = History_PutVarint(p, History_ZigZag((Sint16)(pc - History.state.dsp_pc)));
+	History.state.dsp_pc = pc;
+
+	chunk->used += p - start;
+	chunk->count++;
+	History.total++;
 }
 
 /**
@@ -152,67 +331,282 @@ void History_AddDsp(void)
  */
 void History_Mark(debug_reason_t reason)
 {
-	if (History.item) {
-		History.item[History.idx].reason = reason;
+	if (History.total) {
+		History.mark[History.marks].record = History.total - 1;
+		History.mark[History.marks].reason = reason;
+		History.marks = (History.marks + 1) % HISTORY_MARKS;
 	}
 }
 
 /**
- * Output collected CPU/DSP debugger/breakpoint history
+ * Return reason given for history record, or REASON_NONE
  */
-static Uint32 History_Output(Uint32 count, FILE *fp)
+static debug_reason_t History_GetMark(Uint64 record)
 {
-	bool show_all;
-	Uint32 retval;
 	int i;
 
-	if (History.count > History.limit) {
-		History.count = History.limit;
+	for (i = 0; i < HISTORY_MARKS; i++) {
+		if (History.mark[i].record == record && History.mark[i].reason != REASON_NONE) {
+			return History.mark[i].reason;
+		}
+	}
+	return REASON_NONE;
+}
+
+/**
+ * Return number of the oldest record still in history
+ */
+static Uint64 History_First(void)
+{
+	if (!History.used) {
+		return History.total;
+	}
+	return History.chunk[(History.head + 1 + History.nchunks - History.used) % History.nchunks]->first;
+}
+
+/**
+ * Return number of available history records
+ */
+Uint32 History_Count(void)
+{
+	Uint64 count = History.total - History_First();
+	return count > 0xffffffff ? 0xffffffff : count;
+}
+
+/**
+ * Whether history records include register values
+ */
+bool History_HasRegs(void)
+{
+	return History.regs;
+}
+
+/**
+ * Start decoding from beginning of given chunk, counted from oldest.
+ * Return false if there's no such chunk.
+ */
+static bool History_IterChunk(hist_iter_t *it, unsigned n)
+{
+	if (n >= History.used) {
+		return false;
+	}
+	it->n = n;
+	it->chunk = History.chunk[(History.head + 1 + History.nchunks - History.used + n) % History.nchunks];
+	it->data = it->chunk->data;
+	it->left = it->chunk->count;
+	it->state = it->chunk->state;
+	it->next = it->chunk->first;
+	return true;
+}
+
+/**
+ * Decode next record.  Return false when there are no more.
+ */
+static bool History_IterNext(hist_iter_t *it)
+{
+	hist_state_t *state = &(it->state);
+	const Uint8 *p;
+	Uint64 value;
+	Uint32 mask;
+	Uint8 flags;
+	int i;
+
+	while (!it->left) {
+		if (!History_IterChunk(it, it->n + 1)) {
+			return false;
+		}
 	}
-	if (count > History.count) {
-		count = History.count;
+	it->rec.record = it->next++;
+	p = it->data;
+	flags = *p++;
+	p = History_GetVarint(p, &value);
+	if (flags & HIST_FLAG_DSP) {
+		state->dsp_pc += History_UnZigZag(value);
+		it->rec.pc = state->dsp_pc;
+		it->rec.cycles = 0;
+		it->rec.for_dsp = true;
 	} else {
-		if (!count) {
-			/* default to all */
-			count = History.count;
+		state->cpu_pc += History_UnZigZag(value);
+		it->rec.pc = state->cpu_pc;
+		it->rec.for_dsp = false;
+		value = flags >> HIST_CYCLES_SHIFT;
+		if (value == HIST_CYCLES_VARINT) {
+			p = History_GetVarint(p, &value);
+		}
+		state->cycles += value;
+		it->rec.cycles = value;
+		if (flags & HIST_FLAG_SR) {
+			state->sr = p[0] << 8 | p[1];
+			p += 2;
+		}
+		if (flags & HIST_FLAG_REGS) {
+			p = History_GetVarint(p, &value);
+			mask = value;
+			for (i = 0; i < 16; i++) {
+				if (mask & (1 << i)) {
+					p = History_GetVarint(p, &value);
+					state->regs[i] += History_UnZigZag(value);
+				}
+			}
 		}
 	}
-	if (count <= 0) {
-		fprintf(stderr, "No history items to show.\n");
+	it->rec.sr = state->sr;
+	memcpy(it->rec.regs, state->regs, sizeof(it->rec.regs));
+	it->data = p;
+	it->left--;
+	return true;
+}
+
+/**
+ * Start decoding from given record number.
+ * Return false if it's not in history.
+ */
+static bool History_IterSeek(hist_iter_t *it, Uint64 record)
+{
+	unsigned n;
+
+	if (record < History_First() || record >= History.total) {
+		return false;
+	}
+	for (n = History.used; n-- > 0; ) {
+		History_IterChunk(it, n);
+		if (it->chunk->first <= record) {
+			break;
+		}
+	}
+	while (it->next < record) {
+		History_IterNext(it);
+	}
+	return true;
+}
+
+/**
+ * Call given function for (at max) given number of records, starting
+ * from given record number.  Return number of records given to the
+ * function.
+ */
+static Uint32 History_WalkFrom(Uint64 record, Uint32 count, history_func_t func, void *arg)
+{
+	hist_iter_t it;
+	Uint32 i;
+
+	if (!count || !History_IterSeek(&it, record)) {
 		return 0;
 	}
-	retval = count;
+	for (i = 0; i < count && History_IterNext(&it); i++) {
+		func(&it.rec, arg);
+	}
+	return i;
+}
 
-	i = History.idx;
-	show_all = false;
-	if (History.item[i].shown) {
-		/* even last item already shown, show all again */
-		show_all = true;
+/**
+ * Call given function for (at max) given number of last records,
+ * oldest first.  Return number of records given to the function.
+ */
+Uint32 History_Walk(Uint32 count, history_func_t func, void *arg)
+{
+	if (count > History_Count()) {
+		count = History_Count();
 	}
-	i = (i + History.limit - count) % History.limit;
+	return History_WalkFrom(History.total - count, count, func, arg);
+}
 
-	while (count-- > 0) {
-		i++;
-		i %= History.limit;
-		if (!History.item[i].valid) {
-			fprintf(fp, "ERROR: invalid history item %d!", count);
-		}
-		if (History.item[i].shown && !show_all) {
-			continue;
-		}
-		History.item[i].shown = true;
-
-		if (History.item[i].for_dsp) {
-			Uint16 pc = History.item[i].pc.dsp;
-			DSP_DisasmAddress(fp, pc, pc);
-		} else {
-			Uint32 dummy;
-			Disasm(fp, History.item[i].pc.cpu, &dummy, 1);
+/**
+ * Find last history record where given register (index to Regs[],
+ * HISTORY_FIND_PC or HISTORY_FIND_SR) had given value.
+ * If found, set how many records back from the last one it is,
+ * and return true.
+ */
+bool History_Find(int reg, Uint32 value, Uint32 *back)
+{
+	hist_iter_t it;
+	Uint64 found;
+	bool match;
+	int n;
+
+	if (reg < HISTORY_FIND_PC && !History.regs) {
+		return false;
+	}
+	/* go through chunks from newest to oldest */
+	for (n = History.used - 1; n >= 0; n--) {
+		History_IterChunk(&it, n);
+		found = 0;
+		match = false;
+		while (it.left && History_IterNext(&it)) {
+			if (it.rec.for_dsp) {
+				continue;
+			}
+			if (reg == HISTORY_FIND_PC) {
+				match = (it.rec.pc == value);
+			} else if (reg == HISTORY_FIND_SR) {
+				match = (it.rec.sr == value);
+			} else {
+				match = (it.rec.regs[reg] == value);
+			}
+			if (match) {
+				found = it.rec.record + 1;
+			}
 		}
-		if (History.item[i].reason != REASON_NONE) {
-			fprintf(fp, "Debugger: *%s*\n", History_ReasonStr(History.item[i].reason));
+		if (found) {
+			*back = History.total - found;
+			return true;
 		}
 	}
+	return false;
+}
+
+/* History_Output() state */
+typedef struct {
+	FILE *fp;
+	bool show_all;
+} hist_output_t;
+
+/**
+ * Output disassembly for given record
+ */
+static void History_OutputRecord(const history_record_t *rec, void *arg)
+{
+	hist_output_t *out = arg;
+	debug_reason_t reason;
+
+	if (rec->record < History.shown && !out->show_all) {
+		return;
+	}
+	if (rec->for_dsp) {
+		Uint16 pc = rec->pc;
+		DSP_DisasmAddress(out->fp, pc, pc);
+	} else {
+		Uint32 dummy;
+		Disasm(out->fp, rec->pc, &dummy, 1);
+	}
+	reason = History_GetMark(rec->record);
+	if (reason != REASON_NONE) {
+		fprintf(out->fp, "Debugger: *%s*\n", History_ReasonStr(reason));
+	}
+}
+
+/**
+ * Output collected CPU/DSP debugger/breakpoint history
+ */
+static Uint32 History_Output(Uint32 count, FILE *fp)
+{
+	hist_output_t out;
+	Uint32 retval;
+
+	if (!count || count > History_Count()) {
+		/* default to all */
+		count = History_Count();
+	}
+	if (count <= 0) {
+		fprintf(stderr, "No history items to show.\n");
+		return 0;
+	}
+	out.fp = fp;
+	/* even last item already shown, show all again */
+	out.show_all = (History.shown >= History.total);
+
+	retval = History_Walk(count, History_OutputRecord, &out);
+	History.shown = History.total;
 	return retval;
 }
 
@@ -247,20 +641,86 @@ static void History_Save(const char *name)
  */
 char *History_Match(const char *text, int state)
 {
-	static const char* cmds[] = { "cpu", "dsp", "off", "save" };
+	static const char* cmds[] = { "cpu", "dsp", "find", "off", "on", "regs", "save" };
 	return DebugUI_MatchHelper(cmds, ARRAY_SIZE(cmds), text, state);
 }
 
+/**
+ * Return History_Find() register index for given name, or -1
+ */
+static int History_FindIndex(const char *name)
+{
+	if (strcasecmp(name, "pc") == 0) {
+		return HISTORY_FIND_PC;
+	}
+	if (strcasecmp(name, "sr") == 0) {
+		return HISTORY_FIND_SR;
+	}
+	if (strlen(name) == 2 && name[1] >= '0' && name[1] <= '7') {
+		switch (tolower((unsigned char)name[0])) {
+		case 'd':
+			return name[1] - '0';
+		case 'a':
+			return 8 + name[1] - '0';
+		}
+	}
+	return -1;
+}
+
+/**
+ * Show last CPU history record where given register had given value
+ */
+static void History_FindCmd(const char *name, const char *value)
+{
+	hist_output_t out;
+	Uint32 number, back;
+	int reg;
+
+	reg = History_FindIndex(name);
+	if (reg < 0) {
+		fprintf(stderr, "ERROR: '%s' isn't pc, sr or d0-a7 register!\n", name);
+		return;
+	}
+	if (!Eval_Number(value, &number)) {
+		return;
+	}
+	if (reg < HISTORY_FIND_PC && !History.regs) {
+		fprintf(stderr, "ERROR: register values aren't tracked, use 'history cpu regs'.\n");
+		return;
+	}
+	if (!History_Find(reg, number, &back)) {
+		fprintf(stderr, "%s value $%x not found in history.\n", name, number);
+		return;
+	}
+	fprintf(stderr, "%s was $%x %u instructions ago:\n", name, number, back);
+	/* show the found instruction and (at max) 7 ones after it */
+	out.fp = stderr;
+	out.show_all = true;
+	History_WalkFrom(History.total - back - 1, 8, History_OutputRecord, &out);
+}
+
 /**
  * Command: Show collected CPU/DSP debugger/breakpoint history
  */
 int History_Parse(int nArgc, char *psArgs[])
 {
 	int count, limit = 0;
+	bool regs = false;
 
 	if (nArgc < 2) {
 		return DebugUI_PrintCmdHelp(psArgs[0]);
 	}
+	if (strcmp(psArgs[1], "find") == 0) {
+		if (nArgc != 4) {
+			return DebugUI_PrintCmdHelp(psArgs[0]);
+		}
+		History_FindCmd(psArgs[2], psArgs[3]);
+		return DEBUGGER_CMDDONE;
+	}
+	if (nArgc > 2 && strcmp(psArgs[nArgc-1], "regs") == 0) {
+		regs = true;
+		nArgc--;
+	}
 	if (nArgc > 2) {
 		limit = atoi(psArgs[2]);
 	}
@@ -276,19 +736,19 @@ int History_Parse(int nArgc, char *psArgs[])
 	if (count <= 0) {
 		/* no count -> enable or disable? */
 		if (strcmp(psArgs[1], "on") == 0) {
-			History_Enable(HISTORY_TRACK_ALL, limit);
+			History_Enable(HISTORY_TRACK_ALL, limit, regs);
 			return DEBUGGER_CMDDONE;
 		}
 		if (strcmp(psArgs[1], "off") == 0) {
-			History_Enable(HISTORY_TRACK_NONE, limit);
+			History_Enable(HISTORY_TRACK_NONE, limit, false);
 			return DEBUGGER_CMDDONE;
 		}
 		if (strcmp(psArgs[1], "cpu") == 0) {
-			History_Enable(HISTORY_TRACK_CPU, limit);
+			History_Enable(HISTORY_TRACK_CPU, limit, regs);
 			return DEBUGGER_CMDDONE;
 		}
 		if (strcmp(psArgs[1], "dsp") == 0) {
-			History_Enable(HISTORY_TRACK_DSP, limit);
+			History_Enable(HISTORY_TRACK_DSP, limit, false);
 			return DEBUGGER_CMDDONE;
 		}
 		if (nArgc == 3 && strcmp(psArgs[1], "save") == 0) {
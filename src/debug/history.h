@@ -27,6 +27,22 @@ static inline bool History_TrackDsp(void)
 	return HistoryTracking & HISTORY_TRACK_DSP;
 }
 
+/* a decoded history record */
+typedef struct {
+	Uint64 record;     /* running number of the record */
+	Uint64 cycles;     /* CPU cycles since previous record */
+	Uint32 pc;
+	Uint32 regs[16];   /* D0-D7, A0-A7; zero unless tracked */
+	Uint16 sr;
+	bool for_dsp;
+} history_record_t;
+
+typedef void (*history_func_t)(const history_record_t *rec, void *arg);
+
+/* History_Find() register indexes besides 0-15 for D0-A7 */
+#define HISTORY_FIND_PC	16
+#define HISTORY_FIND_SR	17
+
 /* for debugcpu/dsp.c */
 extern void History_AddCpu(void);
 extern void History_AddDsp(void);
@@ -34,6 +50,12 @@ extern void History_AddDsp(void);
 /* for debugInfo.c */
 extern void History_Show(FILE *fp, Uint32 count);
 
+/* for remotedebug.c */
+extern Uint32 History_Count(void);
+extern bool History_HasRegs(void);
+extern Uint32 History_Walk(Uint32 count, history_func_t func, void *arg);
+extern bool History_Find(int reg, Uint32 value, Uint32 *back);
+
 /* for debugui */
 extern void History_Mark(debug_reason_t reason);
 extern char *History_Match(const char *text, int state);
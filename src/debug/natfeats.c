@@ -113,6 +113,7 @@ static bool nf_name(Uint32 stack, Uint32 subid, Uint32 *retval)
 	}
 	buf = (char *)STMemory_STAddrToPointer ( ptr );
 	*retval = snprintf(buf, len, "%s", str);
+	STMemory_DirtyPages_MarkPointer(buf, len);
 	return true;
 }
 
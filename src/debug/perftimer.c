@@ -0,0 +1,196 @@
+/*
+  Hatari - perftimer.c
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+
+  perftimer.c - host time spent in emulation subsystems, for finding out
+  what makes emulation slow.  Timers are started & stopped around the
+  subsystem entry points and cycInt handlers, and their results are
+  collected on each VBL.  Time not spent in any of them is counted for
+  the CPU core.  Results can be viewed with "info perf", are sent to
+  remote debugger clients and are summed to benchmark mode results.
+
+  Timers use CPU time stamp counter (on x86) as it's much cheaper to read
+  than OS clocks.  It's converted to real time using SDL performance
+  counter time over the whole VBL.
+*/
+const char PerfTimer_fileid[] = "Hatari perftimer.c";
+
+#include <SDL.h>
+#include <inttypes.h>
+#include "main.h"
+#include "perftimer.h"
+
+#if ENABLE_PERF_TIMERS
+
+static const char *PerfTimerNames[PERF_TIMER_MAX] = {
+	[PERF_TIMER_CPU]        = "cpu",
+	[PERF_TIMER_SCREEN]     = "screen",
+	[PERF_TIMER_VIDEO_LINE] = "videoline",
+	[PERF_TIMER_SOUND]      = "sound",
+	[PERF_TIMER_BLITTER]    = "blitter",
+	[PERF_TIMER_DSP]        = "dsp",
+	[PERF_TIMER_IDLE]       = "idle",
+	[PERF_TIMER_CYCINT + INTERRUPT_VIDEO_VBL]          = "int_vbl",
+	[PERF_TIMER_CYCINT + INTERRUPT_VIDEO_HBL]          = "int_hbl",
+	[PERF_TIMER_CYCINT + INTERRUPT_VIDEO_ENDLINE]      = "int_endline",
+	[PERF_TIMER_CYCINT + INTERRUPT_MFP_MAIN_TIMERA]    = "int_mfp_timera",
+	[PERF_TIMER_CYCINT + INTERRUPT_MFP_MAIN_TIMERB]    = "int_mfp_timerb",
+	[PERF_TIMER_CYCINT + INTERRUPT_MFP_MAIN_TIMERC]    = "int_mfp_timerc",
+	[PERF_TIMER_CYCINT + INTERRUPT_MFP_MAIN_TIMERD]    = "int_mfp_timerd",
+	[PERF_TIMER_CYCINT + INTERRUPT_MFP_TT_TIMERA]      = "int_tt_timera",
+	[PERF_TIMER_CYCINT + INTERRUPT_MFP_TT_TIMERB]      = "int_tt_timerb",
+	[PERF_TIMER_CYCINT + INTERRUPT_MFP_TT_TIMERC]      = "int_tt_timerc",
+	[PERF_TIMER_CYCINT + INTERRUPT_MFP_TT_TIMERD]      = "int_tt_timerd",
+	[PERF_TIMER_CYCINT + INTERRUPT_ACIA_IKBD]          = "int_acia",
+	[PERF_TIMER_CYCINT + INTERRUPT_IKBD_RESETTIMER]    = "int_ikbd_reset",
+	[PERF_TIMER_CYCINT + INTERRUPT_IKBD_AUTOSEND]      = "int_ikbd_autosend",
+	[PERF_TIMER_CYCINT + INTERRUPT_DMASOUND_MICROWIRE] = "int_microwire",
+	[PERF_TIMER_CYCINT + INTERRUPT_CROSSBAR_25MHZ]     = "int_crossbar_25mhz",
+	[PERF_TIMER_CYCINT + INTERRUPT_CROSSBAR_32MHZ]     = "int_crossbar_32mhz",
+	[PERF_TIMER_CYCINT + INTERRUPT_FDC]                = "int_fdc",
+	[PERF_TIMER_CYCINT + INTERRUPT_BLITTER]            = "int_blitter",
+	[PERF_TIMER_CYCINT + INTERRUPT_MIDI]               = "int_midi",
+};
+
+perf_timers_t PerfTimers;
+
+static struct {
+	Uint64 start;		/* PerfTimer_Read() at previous VBL */
+	Uint64 host_start;	/* SDL performance counter at previous VBL */
+	Uint32 vbls;		/* VBLs collected to totals */
+	Uint32 last_nsecs[PERF_TIMER_MAX];
+	Uint32 last_calls[PERF_TIMER_MAX];
+	Uint64 total_nsecs[PERF_TIMER_MAX];
+	Uint64 total_calls[PERF_TIMER_MAX];
+} Frame;
+
+
+/**
+ * Collect timer results for the VBL that just ended, called on each VBL
+ */
+void PerfTimer_VBL(void)
+{
+	Uint64 now = PerfTimer_Read();
+	Uint64 host_now = SDL_GetPerformanceCounter();
+	Uint64 ticks, elapsed, others = 0;
+	double nsecs_per_tick;
+	int i, depth;
+
+	if (PerfTimers.depth < 0)
+		PerfTimers.depth = 0;	/* should not happen */
+	depth = PerfTimers.depth;
+	if (depth > PERF_TIMER_DEPTH)
+		depth = PERF_TIMER_DEPTH;
+
+	/* count time of still running timers up to now for this
+	 * VBL, innermost first so that it's excluded from outer ones
+	 */
+	for (i = depth - 1; i >= 0; i--)
+	{
+		elapsed = now - PerfTimers.stack[i].start;
+		PerfTimers.ticks[PerfTimers.stack[i].id] += elapsed - PerfTimers.stack[i].child;
+		if (i > 0)
+			PerfTimers.stack[i-1].child += elapsed;
+		PerfTimers.stack[i].start = now;
+		PerfTimers.stack[i].child = 0;
+	}
+
+	ticks = now - Frame.start;
+	if (Frame.start && ticks)
+	{
+		nsecs_per_tick = (host_now - Frame.host_start) * 1.0e9
+			/ SDL_GetPerformanceFrequency() / ticks;
+
+		for (i = 1; i < PERF_TIMER_MAX; i++)
+			others += PerfTimers.ticks[i];
+		if (ticks > others)
+			PerfTimers.ticks[PERF_TIMER_CPU] += ticks - others;
+
+		for (i = 0; i < PERF_TIMER_MAX; i++)
+		{
+			Frame.last_nsecs[i] = PerfTimers.ticks[i] * nsecs_per_tick;
+			Frame.last_calls[i] = PerfTimers.calls[i];
+			Frame.total_nsecs[i] += Frame.last_nsecs[i];
+			Frame.total_calls[i] += Frame.last_calls[i];
+		}
+		Frame.vbls++;
+	}
+	memset(PerfTimers.ticks, 0, sizeof(PerfTimers.ticks));
+	memset(PerfTimers.calls, 0, sizeof(PerfTimers.calls));
+	Frame.start = now;
+	Frame.host_start = host_now;
+}
+
+
+/**
+ * Show subsystem timings for the last VBL, and averages over the VBLs
+ * since start or previous reset.  Non-zero arg resets the averages.
+ */
+void PerfTimer_Info(FILE *fp, Uint32 arg)
+{
+	Uint64 total = 0;
+	int i;
+
+	if (!Frame.vbls)
+	{
+		fprintf(fp, "No VBLs timed yet.\n");
+		return;
+	}
+	for (i = 0; i < PERF_TIMER_MAX; i++)
+		total += Frame.total_nsecs[i];
+	if (!total)
+		total = 1;
+
+	fprintf(fp, "Host time per VBL, average over %u VBLs:\n", Frame.vbls);
+	fprintf(fp, "  %-20s %10s %10s %6s %9s\n",
+		"timer", "last us", "avg us", "%", "calls/VBL");
+	for (i = 0; i < PERF_TIMER_MAX; i++)
+	{
+		if (!Frame.total_nsecs[i] || !PerfTimerNames[i])
+			continue;
+		fprintf(fp, "  %-20s %10.1f %10.1f %6.2f %9.1f\n",
+			PerfTimerNames[i], Frame.last_nsecs[i] / 1000.0,
+			Frame.total_nsecs[i] / 1000.0 / Frame.vbls,
+			100.0 * Frame.total_nsecs[i] / total,
+			(double)Frame.total_calls[i] / Frame.vbls);
+	}
+
+	if (arg)
+	{
+		memset(Frame.total_nsecs, 0, sizeof(Frame.total_nsecs));
+		memset(Frame.total_calls, 0, sizeof(Frame.total_calls));
+		Frame.vbls = 0;
+		fprintf(fp, "Averages reset.\n");
+	}
+}
+
+
+/**
+ * Get name, host time and call count of given timer for the last VBL.
+ * Return false for invalid timer IDs.
+ */
+bool PerfTimer_GetLast(int id, const char **name, Uint32 *nsecs, Uint32 *calls)
+{
+	if (id < 0 || id >= PERF_TIMER_MAX || !PerfTimerNames[id])
+		return false;
+	*name = PerfTimerNames[id];
+	*nsecs = Frame.last_nsecs[id];
+	*calls = Frame.last_calls[id];
+	return true;
+}
+
+#else	/* !ENABLE_PERF_TIMERS */
+
+void PerfTimer_Info(FILE *fp, Uint32 arg)
+{
+	fprintf(fp, "Hatari is built without ENABLE_PERF_TIMERS, no timings available.\n");
+}
+
+bool PerfTimer_GetLast(int id, const char **name, Uint32 *nsecs, Uint32 *calls)
+{
+	return false;
+}
+
+#endif	/* ENABLE_PERF_TIMERS */
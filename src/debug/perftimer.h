@@ -0,0 +1,106 @@
+/*
+  Hatari - perftimer.h
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+
+  Host time spent in emulation subsystems.  Timers nest, and each one
+  gets only its own time, not that of the timers started within it.
+  Without ENABLE_PERF_TIMERS, the timer functions compile to nothing.
+*/
+
+#ifndef HATARI_PERFTIMER_H
+#define HATARI_PERFTIMER_H
+
+#include "cycles.h"
+#include "cycInt.h"
+
+typedef enum {
+	PERF_TIMER_CPU,		/* time not spent in any of the other timers */
+	PERF_TIMER_SCREEN,	/* screen conversion & blit */
+	PERF_TIMER_VIDEO_LINE,	/* copying ST screen line at HBL */
+	PERF_TIMER_SOUND,
+	PERF_TIMER_BLITTER,
+	PERF_TIMER_DSP,
+	PERF_TIMER_IDLE,	/* waiting for VBL to sync to real time */
+	PERF_TIMER_CYCINT,	/* cycInt handlers, indexed by interrupt_id */
+	PERF_TIMER_MAX = PERF_TIMER_CYCINT + MAX_INTERRUPTS
+} perf_timer_id;
+
+#if ENABLE_PERF_TIMERS
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# include <x86intrin.h>
+# define PerfTimer_Read()	__rdtsc()
+#else
+# include <SDL_timer.h>
+# define PerfTimer_Read()	SDL_GetPerformanceCounter()
+#endif
+
+/* how deep timers can nest, deeper ones are ignored */
+#define PERF_TIMER_DEPTH	8
+
+typedef struct {
+	int depth;
+	struct {
+		perf_timer_id id;
+		Uint64 start;	/* counter at start / VBL */
+		Uint64 child;	/* time spent in nested timers */
+	} stack[PERF_TIMER_DEPTH];
+	Uint64 ticks[PERF_TIMER_MAX];	/* for current VBL */
+	Uint32 calls[PERF_TIMER_MAX];
+} perf_timers_t;
+
+extern perf_timers_t PerfTimers;
+
+/**
+ * Start timing given subsystem, until matching PerfTimer_End()
+ */
+static inline void PerfTimer_Begin(perf_timer_id id)
+{
+	int depth = PerfTimers.depth++;
+
+	if (likely(depth < PERF_TIMER_DEPTH))
+	{
+		PerfTimers.stack[depth].id = id;
+		PerfTimers.stack[depth].child = 0;
+		PerfTimers.stack[depth].start = PerfTimer_Read();
+	}
+}
+
+/**
+ * Stop last started timer
+ */
+static inline void PerfTimer_End(void)
+{
+	int depth = --PerfTimers.depth;
+	Uint64 elapsed;
+
+	if (likely(depth < PERF_TIMER_DEPTH))
+	{
+		elapsed = PerfTimer_Read() - PerfTimers.stack[depth].start;
+		PerfTimers.ticks[PerfTimers.stack[depth].id] += elapsed - PerfTimers.stack[depth].child;
+		PerfTimers.calls[PerfTimers.stack[depth].id]++;
+		if (depth > 0)
+			PerfTimers.stack[depth-1].child += elapsed;
+	}
+}
+
+/* for video.c */
+extern void PerfTimer_VBL(void);
+
+#else	/* !ENABLE_PERF_TIMERS */
+
+static inline void PerfTimer_Begin(perf_timer_id id) { }
+static inline void PerfTimer_End(void) { }
+static inline void PerfTimer_VBL(void) { }
+
+#endif	/* ENABLE_PERF_TIMERS */
+
+/* for debugInfo.c */
+extern void PerfTimer_Info(FILE *fp, Uint32 arg);
+
+/* for remotedebug.c */
+extern bool PerfTimer_GetLast(int id, const char **name, Uint32 *nsecs, Uint32 *calls);
+
+#endif /* HATARI_PERFTIMER_H */
@@ -58,6 +58,8 @@ typedef struct ProfileLine
 	Uint32 addr;	/* CPU address of this entry */
 } ProfileLine;
 extern bool Profile_CpuQuery(Uint32 index, ProfileLine* result);
+extern Uint32 Profile_CpuQueryChangedCount(void);
+extern bool Profile_CpuQueryChanged(Uint32 n, ProfileLine* result);
 extern bool Profile_CpuIsEnabled(void);
 
 #endif
@@ -103,6 +103,10 @@ static struct {
 	Uint32 d_miss_counts[MAX_D_MISSES]; /* D-cache miss counts */
 	bool processed;	      /* true when data is already processed */
 	bool enabled;         /* true when profiling enabled */
+	Uint32 *changed;      /* indexes of items executed since start */
+	Uint32 changed_count; /* number of used changed[] items */
+	Uint32 changed_alloc; /* number of allocated changed[] items */
+	bool changed_sorted;  /* true when changed[] is in index order */
 } cpu_profile;
 
 /* full counts for warnings that are printed without rate-limiting */
@@ -889,6 +893,7 @@ bool Profile_CpuStart(void)
 	savePrevFamily = cpu_profile.prev_family;
 	savePrevPC = cpu_profile.prev_pc;
 
+	free(cpu_profile.changed);
 	memset(&cpu_profile, 0, sizeof(cpu_profile));
 
 	/* Restore the saved values after the memset. */
@@ -1146,6 +1151,33 @@ static Uint32 warn_too_large(const char *name, const int value, const int limit,
 	return limit - 1;
 }
 
+/**
+ * Remember that item at given index was executed for the first time
+ * since profiling started, so that remote debugger can send just the
+ * executed items instead of checking the whole profile data.
+ */
+static void add_changed_index(Uint32 idx)
+{
+	Uint32 *changed;
+	Uint32 alloc;
+
+	if (idx >= cpu_profile.size) {
+		/* invalid PC entry isn't reported */
+		return;
+	}
+	if (cpu_profile.changed_count == cpu_profile.changed_alloc) {
+		alloc = cpu_profile.changed_alloc ? 2 * cpu_profile.changed_alloc : 4096;
+		changed = realloc(cpu_profile.changed, alloc * sizeof(*changed));
+		if (!changed) {
+			return;
+		}
+		cpu_profile.changed = changed;
+		cpu_profile.changed_alloc = alloc;
+	}
+	cpu_profile.changed[cpu_profile.changed_count++] = idx;
+	cpu_profile.changed_sorted = false;
+}
+
 /**
  * Update CPU cycle and count statistics for PC address.
  *
@@ -1202,6 +1234,9 @@ void Profile_CpuUpdate(void)
 	assert(idx <= cpu_profile.size);
 	prev = cpu_profile.data + idx;
 
+	if (unlikely(!prev->count)) {
+		add_changed_index(idx);
+	}
 	if (likely(prev->count < MAX_CPU_PROFILE_VALUE)) {
 		prev->count++;
 	}
@@ -1510,6 +1545,51 @@ bool Profile_CpuQuery(Uint32 index, ProfileLine* result)
 	return true;
 }
 
+/**
+ * qsort callback for changed[] indexes
+ */
+static int cmp_changed_index(const void *p1, const void *p2)
+{
+	Uint32 idx1 = *(const Uint32*)p1;
+	Uint32 idx2 = *(const Uint32*)p2;
+	return (idx1 > idx2) - (idx1 < idx2);
+}
+
+/**
+ * Return number of profile items executed since profiling started,
+ * which can be read with Profile_CpuQueryChanged().
+ */
+Uint32 Profile_CpuQueryChangedCount(void)
+{
+	if (!cpu_profile.data) {
+		return 0;
+	}
+	if (!cpu_profile.changed_sorted) {
+		qsort(cpu_profile.changed, cpu_profile.changed_count,
+		      sizeof(*cpu_profile.changed), cmp_changed_index);
+		cpu_profile.changed_sorted = true;
+	}
+	return cpu_profile.changed_count;
+}
+
+/**
+ * Get Nth executed profile item, in index (mostly address) order.
+ * Profile_CpuQueryChangedCount() needs to be called first.
+ */
+bool Profile_CpuQueryChanged(Uint32 n, ProfileLine* result)
+{
+	cpu_profile_item_t *item;
+
+	if (!cpu_profile.data || n >= cpu_profile.changed_count) {
+		return false;
+	}
+	item = cpu_profile.data + cpu_profile.changed[n];
+	result->count = item->count;
+	result->cycles = item->cycles;
+	result->addr = index2address(cpu_profile.changed[n]);
+	return true;
+}
+
 bool Profile_CpuIsEnabled(void)
 {
 	Uint32 *disasm_addr;
@@ -17,10 +17,14 @@
 #include <stdlib.h>
 
 #if HAVE_UNIX_DOMAIN_SOCKETS
+#include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/fcntl.h>
+#include <poll.h>
+#include <unistd.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #endif
 
@@ -45,6 +49,9 @@
 #include "dmaSnd.h"
 #include "blitter.h"
 #include "profile.h"
+#include "history.h"
+#include "rewind.h"
+#include "perftimer.h"
 // For status bar updates
 #include "screen.h"
 #include "statusbar.h"
@@ -54,8 +61,9 @@
 // TCP port for remote debugger access
 #define RDB_PORT                   (56001)
 
-// Max character count in a command sent to Hatari
-#define RDB_INPUT_TMP_SIZE         (300)
+// Max character count read from the socket at once. Big enough
+// that a client's batch of commands normally arrives in one read.
+#define RDB_INPUT_TMP_SIZE         (4096)
 
 // Starting size of the growing buffer containing commands to process
 #define RDB_CMD_BUFFER_START_SIZE  (512)
@@ -63,12 +71,45 @@
 // How many bytes we collect to send chunks for the "mem" command
 #define RDB_MEM_BLOCK_SIZE         (2048)
 
-// How many bytes in the internal network send buffer
-#define RDB_SEND_BUFFER_SIZE       (512)
+// How many bytes in the internal network send buffer. All responses
+// to a batch of commands are collected here and sent together, unless
+// they are too big to fit.
+#define RDB_SEND_BUFFER_SIZE       (16384)
+
+// How long to wait for the client to accept more data before dropping
+// the connection, so that a client which stops reading can't hang Hatari
+#define RDB_SEND_TIMEOUT_MSEC      (5000)
+
+// How many client memory slots can be tracked by "memdelta"
+#define RDB_MEMDELTA_SLOTS         (32)
+
+// Changed runs separated by fewer unchanged bytes than this are merged,
+// since each run costs an offset and size
+#define RDB_MEMDELTA_MERGE_GAP     (8)
+
+// Largest range accepted by "memdelta" and "subscribe", the whole 24-bit
+// address space. Both the shadow and scratch copies are this big at most.
+#define RDB_MEMDELTA_MAX_SIZE      (0x1000000)
+
+// "memfind"/"memfindall" limits: patterns per request, bytes per pattern,
+// results per request, and the size of each chunk of memory scanned
+#define RDB_MEMFIND_MAX_PATTERNS   (8)
+#define RDB_MEMFIND_MAX_SIZE       (1024)
+#define RDB_MEMFIND_MAX_HITS       (4096)
+#define RDB_MEMFIND_CHUNK          (0x10000)
+
+// How many memory ranges can be pushed by "subscribe"
+#define RDB_SUBSCRIBE_MAX_RANGES   (16)
+
+// "subscribe" flags for extra data to push
+#define RDB_SUBSCRIBE_REGS         (1 << 0)
+#define RDB_SUBSCRIBE_VIDEO        (1 << 1)
+#define RDB_SUBSCRIBE_PERF         (1 << 2)
 
 // Network timeout when in break loop, to allow event handler update.
-// Currently 0.5sec
-#define RDB_SELECT_TIMEOUT_USEC   (500000)
+// SDL has no descriptor for window system events, so they are pumped
+// at this rate while waiting. Currently 20msec
+#define RDB_POLL_TIMEOUT_MSEC     (20)
 
 /* Remote debugging break command was sent from debugger */
 static bool bRemoteBreakRequest = false;
@@ -80,7 +121,16 @@ static bool bRemoteBreakIsActive = false;
 /* 0x1003 -- add reset commands */
 /* 0x1004    add ffwd command, and ffwd status in NotifyStatus() */
 /* 0x1005    add memfind command, add stramsize to $config notification */
-#define REMOTEDEBUG_PROTOCOL_ID	(0x1005)
+/* 0x1006    add binary command and length-prefixed binary response frames */
+/* 0x1007    add memdelta command */
+/* 0x1008    add memfindall command */
+/* 0x1009    add subscribe command and !regs/!video/!memdelta notifications */
+/* 0x100A    !profile only sends addresses executed since the last run, and
+             uses variable-length values in binary mode */
+/* 0x100B    add history and historyfind commands */
+/* 0x100C    add rewind, stepback and runback commands */
+/* 0x100D    add infoperf command and !perf notification */
+#define REMOTEDEBUG_PROTOCOL_ID	(0x100D)
 
 /* Char ID to denote terminator of a token. This is under the ASCII "normal"
 	character value range so that 32-255 can be used */
@@ -157,6 +207,25 @@ static void RemoteDebugBuffer_RemoveStart(RemoteDebugBuffer* buf, size_t count)
 	buf->write_pos -= count;
 }
 
+// -----------------------------------------------------------------------------
+// Copy of the memory range last sent to the client by "memdelta"
+// for one of its memory slots
+typedef struct RemoteDebugShadow
+{
+	Uint32 addr;
+	Uint32 size;
+	Uint8* data;		/* NULL when not yet sent */
+} RemoteDebugShadow;
+
+// -----------------------------------------------------------------------------
+// Memory range pushed to the client while running, for one of its slots
+typedef struct RemoteDebugSubRange
+{
+	int slot;
+	Uint32 addr;
+	Uint32 size;
+} RemoteDebugSubRange;
+
 // -----------------------------------------------------------------------------
 // Structure managing connection state
 typedef struct RemoteDebugState
@@ -183,42 +252,155 @@ typedef struct RemoteDebugState
 	/* Output (send) buffer data */
 	char sendBuffer[RDB_SEND_BUFFER_SIZE];	/* buffer for replies */
 	int sendBufferPos;					/* next byte to write into buffer */
+
+	/* Binary protocol mode. When active, each response/notification is
+	   collected into frame_buf and sent as a length-prefixed frame */
+	bool binaryMode;					/* current mode for output */
+	bool binaryModeNext;				/* mode to switch to after current response */
+	bool binaryFrameSent;				/* command already sent its complete frame */
+	RemoteDebugBuffer frame_buf;		/* payload of the frame being built */
+
+	/* "memdelta" data, valid for the current connection only */
+	RemoteDebugShadow shadows[RDB_MEMDELTA_SLOTS];
+	Uint8* deltaScratch;				/* current memory contents to compare */
+	Uint32 deltaScratchSize;
+
+	/* "subscribe" data, pushed while running every subInterval VBLs */
+	Uint32 subInterval;					/* 0 when there is no subscription */
+	Uint32 subFlags;					/* RDB_SUBSCRIBE_xxx */
+	int subNumRanges;
+	RemoteDebugSubRange subRanges[RDB_SUBSCRIBE_MAX_RANGES];
+	int subLastVbl;						/* nVBLs when last pushed */
 } RemoteDebugState;
 
+static void RemoteDebugState_Disconnect(RemoteDebugState* state);
+
+// -----------------------------------------------------------------------------
+// Send a whole block of data. The connection is non-blocking while the
+// emulation runs, so wait for space if the network buffer is full.
+static void send_all(RemoteDebugState* state, const char* data, size_t size)
+{
+	struct timeval timeout;
+	fd_set set;
+	int sent;
+
+	while (size > 0 && state->AcceptedFD != -1)
+	{
+		sent = send(state->AcceptedFD, data, size, 0);
+		if (sent < 0)
+		{
+#if HAVE_WINSOCK_SOCKETS
+			if (WSAGetLastError() != WSAEWOULDBLOCK)
+				return;
+#else
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				return;		/* lost connection is handled by recv() */
+#endif
+			FD_ZERO(&set);
+			FD_SET(state->AcceptedFD, &set);
+			timeout.tv_sec = RDB_SEND_TIMEOUT_MSEC / 1000;
+			timeout.tv_usec = (RDB_SEND_TIMEOUT_MSEC % 1000) * 1000;
+			if (select(state->AcceptedFD + 1, NULL, &set, NULL, &timeout) == 0)
+			{
+				printf("Remote Debug client stopped reading, connection dropped\n");
+				RemoteDebugState_Disconnect(state);
+				return;
+			}
+			continue;
+		}
+		data += sent;
+		size -= sent;
+	}
+}
+
 // -----------------------------------------------------------------------------
 // Force send of data in sendBuffer
 static void flush_data(RemoteDebugState* state)
 {
 	// Flush existing data
-	send(state->AcceptedFD, state->sendBuffer, state->sendBufferPos, 0);
+	send_all(state, state->sendBuffer, state->sendBufferPos);
 	state->sendBufferPos = 0;
 }
 
 // -----------------------------------------------------------------------------
 // Add data to sendBuffer, flush if necessary
-static void add_data(RemoteDebugState* state, const char* data, size_t size)
+static void queue_data(RemoteDebugState* state, const char* data, size_t size)
 {
 	// Flush data if it won't fit
 	if (state->sendBufferPos + size > RDB_SEND_BUFFER_SIZE)
 		flush_data(state);
 
+	// Large blocks bypass the buffer
+	if (size > RDB_SEND_BUFFER_SIZE)
+	{
+		send_all(state, data, size);
+		return;
+	}
+
 	memcpy(state->sendBuffer + state->sendBufferPos, data, size);
 	state->sendBufferPos += size;
 }
 
+// -----------------------------------------------------------------------------
+// Add response data. In binary mode this goes into the current frame,
+// otherwise directly to the send buffer.
+static void add_data(RemoteDebugState* state, const char* data, size_t size)
+{
+	if (state->binaryMode)
+		RemoteDebugBuffer_Add(&state->frame_buf, data, size);
+	else
+		queue_data(state, data, size);
+}
+
+// -----------------------------------------------------------------------------
+// Binary mode: write a 32-bit value as little-endian bytes
+static void add_u32_le(RemoteDebugState* state, uint32_t val)
+{
+	char bytes[4];
+	bytes[0] = (char)(val);
+	bytes[1] = (char)(val >> 8);
+	bytes[2] = (char)(val >> 16);
+	bytes[3] = (char)(val >> 24);
+	add_data(state, bytes, sizeof(bytes));
+}
+
+// -----------------------------------------------------------------------------
+// Binary mode: write a value 7 bits per byte, lowest bits first. The top
+// bit is set in every byte except the last.
+static void add_varint(RemoteDebugState* state, uint32_t val)
+{
+	char bytes[5];
+	int size = 0;
+	while (val >= 0x80)
+	{
+		bytes[size++] = (char)(0x80 | (val & 0x7f));
+		val >>= 7;
+	}
+	bytes[size++] = (char)val;
+	add_data(state, bytes, size);
+}
+
 // -----------------------------------------------------------------------------
 // Transmission functions (wrapped for platform portability)
 // -----------------------------------------------------------------------------
+// In binary mode, strings include their null terminator.
 static void send_str(RemoteDebugState* state, const char* pStr)
 {
-	add_data(state, pStr, strlen(pStr));
+	add_data(state, pStr, strlen(pStr) + (state->binaryMode ? 1 : 0));
 }
 
 // -----------------------------------------------------------------------------
+// In binary mode, values are sent as 4 little-endian bytes.
 static void send_hex(RemoteDebugState* state, uint32_t val)
 {
 	char str[9];
-	int size = sprintf(str, "%X", val);
+	int size;
+	if (state->binaryMode)
+	{
+		add_u32_le(state, val);
+		return;
+	}
+	size = sprintf(str, "%X", val);
 	add_data(state, str, size);
 }
 
@@ -229,16 +411,54 @@ static void send_char(RemoteDebugState* state, char val)
 }
 
 // -----------------------------------------------------------------------------
+// In binary mode, bools are sent as a single 0/1 byte.
 static void send_bool(RemoteDebugState* state, bool val)
 {
-	send_char(state, val ? '1' : '0');
+	if (state->binaryMode)
+		send_char(state, val ? 1 : 0);
+	else
+		send_char(state, val ? '1' : '0');
+}
+
+// -----------------------------------------------------------------------------
+// Send a block of memory: raw in binary mode, otherwise as 4 uuencoded
+// chars per 3 bytes
+static void send_mem_data(RemoteDebugState* state, const Uint8* data, Uint32 size)
+{
+	char group[4];
+	Uint32 accum;
+
+	if (state->binaryMode)
+	{
+		add_data(state, (const char*)data, size);
+		return;
+	}
+
+	for (Uint32 pos = 0; pos < size; pos += 3)
+	{
+		// Accumulate 3 bytes into 24 bits of a u32
+		accum = 0;
+		for (Uint32 i = pos; i < pos + 3; ++i)
+		{
+			accum <<= 8;
+			if (i < size)
+				accum |= data[i];
+		}
+		group[0] = 32 + ((accum >> 18) & 0x3f);
+		group[1] = 32 + ((accum >> 12) & 0x3f);
+		group[2] = 32 + ((accum >>  6) & 0x3f);
+		group[3] = 32 + ((accum      ) & 0x3f);
+		add_data(state, group, sizeof(group));
+	}
 }
 
 // -----------------------------------------------------------------------------
 // Send the normal parameter separator (0x1)
+// Binary mode fields are fixed-size or terminated, so no separator is sent.
 static void send_sep(RemoteDebugState* state)
 {
-	send_char(state, SEPARATOR_VAL);
+	if (!state->binaryMode)
+		send_char(state, SEPARATOR_VAL);
 }
 
 // -----------------------------------------------------------------------------
@@ -251,9 +471,55 @@ static void send_key_value(RemoteDebugState* state, const char* pStr, uint32_t v
 }
 
 // -----------------------------------------------------------------------------
+// Binary mode: queue the little-endian payload size which starts a frame
+static void queue_frame_header(RemoteDebugState* state, uint32_t size)
+{
+	char header[4];
+	header[0] = (char)(size);
+	header[1] = (char)(size >> 8);
+	header[2] = (char)(size >> 16);
+	header[3] = (char)(size >> 24);
+	queue_data(state, header, sizeof(header));
+}
+
+// -----------------------------------------------------------------------------
+// Finish a response or notification. In binary mode, this sends
+// the collected frame as "<u32 LE payload size> <payload>".
 static void send_term(RemoteDebugState* state)
 {
-	send_char(state, 0);
+	uint32_t size;
+
+	if (!state->binaryMode)
+	{
+		send_char(state, 0);
+		return;
+	}
+
+	// Frame was already completed by the command itself
+	if (state->binaryFrameSent)
+	{
+		state->binaryFrameSent = false;
+		return;
+	}
+
+	size = (uint32_t)state->frame_buf.write_pos;
+	queue_frame_header(state, size);
+	queue_data(state, state->frame_buf.data, size);
+	state->frame_buf.write_pos = 0;
+}
+
+// -----------------------------------------------------------------------------
+// Binary mode: send the current frame, with its size increased by
+// <extra_size> bytes which the caller then sends with queue_data().
+// This lets large payloads go straight from emulated memory to the socket.
+static void send_frame_start(RemoteDebugState* state, uint32_t extra_size)
+{
+	uint32_t size = (uint32_t)state->frame_buf.write_pos;
+
+	queue_frame_header(state, size + extra_size);
+	queue_data(state, state->frame_buf.data, size);
+	state->frame_buf.write_pos = 0;
+	state->binaryFrameSent = true;
 }
 
 //-----------------------------------------------------------------------------
@@ -311,9 +577,16 @@ static int RemoteDebug_NotifyConfig(RemoteDebugState* state)
 	return 0;
 }
 
+// -----------------------------------------------------------------------------
+// Send the profile counts gathered since the CPU last started running.
+// Profile data is cleared on each run, so these are added to the previous
+// totals by the client.
+// ASCII format:  "!profile <enabled> [<addr delta> <count> <cycles>]*"
+// Binary format: "!profile" <enabled> <num entries> then varints of
+//                [<addr delta> <count> <cycles>]*
 static void RemoteDebug_NotifyProfile(RemoteDebugState* state)
 {
-	int index;
+	Uint32 index, numItems;
 	ProfileLine result;
 	Uint32 lastaddr;
 
@@ -321,25 +594,38 @@ static void RemoteDebug_NotifyProfile(RemoteDebugState* state)
 	send_sep(state);
 	send_hex(state, Profile_CpuIsEnabled() ? 1 : 0);
 	send_sep(state);
-	
-	index = 0;
+
+	// Only the addresses executed in the last run, rather than
+	// checking every entry of the profile data
+	numItems = Profile_CpuQueryChangedCount();
+	if (state->binaryMode)
+		send_hex(state, numItems);
+
 	lastaddr = 0;
-	while (Profile_CpuQuery(index, &result))
+	for (index = 0; index < numItems; ++index)
 	{
-		if (result.count)
+		if (!Profile_CpuQueryChanged(index, &result))
+			break;
+
+		// NOTE: address is encoded as delta from previous
+		// entry, starting from 0. This provides a very simple
+		// size reduction.
+		if (state->binaryMode)
+		{
+			add_varint(state, result.addr - lastaddr);
+			add_varint(state, result.count);
+			add_varint(state, result.cycles);
+		}
+		else
 		{
-			// NOTE: address is encoded as delta from previous
-			// entry, starting from 0. This provides a very simple
-			// size reduction.
 			send_hex(state, result.addr - lastaddr);
 			send_sep(state);
 			send_hex(state, result.count);
 			send_sep(state);
 			send_hex(state, result.cycles);
 			send_sep(state);
-			lastaddr = result.addr;
 		}
-		++index;
+		lastaddr = result.addr;
 	}
 	send_term(state);
 }
@@ -473,15 +759,63 @@ static int RemoteDebug_run(int nArgc, char *psArgs[], RemoteDebugState* state)
 	return 0;
 }
 
-/**
- * Dump register contents. 
- * This also includes Hatari variables, which we treat as a subset of regs.
- * 
- * Input: "regs\n"
- * 
- * Output: "regs <reg:value>*N\n"
- */
-static int RemoteDebug_regs(int nArgc, char *psArgs[], RemoteDebugState* state)
+// -----------------------------------------------------------------------------
+/* "rewind <0|1> [<interval> <count>]" Disable or enable rewind, with */
+/* snapshots taken every <interval> VBLs, keeping <count> last ones */
+/* returns "OK <position>", position being instructions since it was enabled */
+static int RemoteDebug_rewind(int nArgc, char *psArgs[], RemoteDebugState* state)
+{
+	Uint32 enable, interval = 0, count = 0;
+
+	if (nArgc < 2 || !Eval_Number(psArgs[1], &enable))
+		return 1;
+	if (nArgc == 4)
+	{
+		if (!Eval_Number(psArgs[2], &interval) || !Eval_Number(psArgs[3], &count))
+			return 1;
+	}
+	if (!Rewind_Enable(enable != 0, interval, count))
+		return 1;
+
+	send_str(state, "OK");
+	send_sep(state);
+	send_hex(state, Rewind_GetPosition());
+	return 0;
+}
+
+// -----------------------------------------------------------------------------
+/* "stepback [<count>]" Step back <count> (default 1) instructions */
+/* Emulation state is restored from a rewind snapshot and replayed up to the */
+/* target, so this runs like "step" and the stop is notified the same way. */
+static int RemoteDebug_stepback(int nArgc, char *psArgs[], RemoteDebugState* state)
+{
+	Uint32 count = 1;
+
+	if (nArgc >= 2 && !Eval_Number(psArgs[1], &count))
+		return 1;
+	if (!Rewind_StepBack(count))
+		return 1;
+
+	send_str(state, "OK");
+	bRemoteBreakIsActive = false;
+	return 0;
+}
+
+// -----------------------------------------------------------------------------
+/* "runback" Run back to the last CPU breakpoint hit in rewind history */
+static int RemoteDebug_runback(int nArgc, char *psArgs[], RemoteDebugState* state)
+{
+	if (!Rewind_RunBack())
+		return 1;
+
+	send_str(state, "OK");
+	bRemoteBreakIsActive = false;
+	return 0;
+}
+
+// -----------------------------------------------------------------------------
+// Send all registers and variables as name/value pairs
+static void send_regs_fields(RemoteDebugState* state)
 {
 	int regIdx;
 	Uint32 varIndex;
@@ -495,9 +829,6 @@ static int RemoteDebug_regs(int nArgc, char *psArgs[], RemoteDebugState* state)
 		"D0", "D1", "D2", "D3", "D4", "D5", "D6", "D7",
 		"A0", "A1", "A2", "A3", "A4", "A5", "A6", "A7" };
 
-	send_str(state, "OK");
-	send_sep(state);
-
 	// Normal regs
 	for (regIdx = 0; regIdx < ARRAY_SIZE(regIds); ++regIdx)
 		send_key_value(state, regNames[regIdx], Regs[regIds[regIdx]]);
@@ -527,6 +858,21 @@ static int RemoteDebug_regs(int nArgc, char *psArgs[], RemoteDebugState* state)
 		send_key_value(state, "SFC", regs.sfc);
 		send_key_value(state, "VBR", regs.vbr);
 	}
+}
+
+/**
+ * Dump register contents. 
+ * This also includes Hatari variables, which we treat as a subset of regs.
+ * 
+ * Input: "regs\n"
+ * 
+ * Output: "regs <reg:value>*N\n"
+ */
+static int RemoteDebug_regs(int nArgc, char *psArgs[], RemoteDebugState* state)
+{
+	send_str(state, "OK");
+	send_sep(state);
+	send_regs_fields(state);
 	return 0;
 }
 
@@ -536,6 +882,7 @@ static int RemoteDebug_regs(int nArgc, char *psArgs[], RemoteDebugState* state)
  * Input: "mem <start addr> <size in bytes>\n"
  *
  * Output: "mem <address-expr> <size-expr> <memory as base16 string>\n"
+ * In binary mode, the memory is sent as raw bytes.
  */
 
 static int RemoteDebug_mem(int nArgc, char *psArgs[], RemoteDebugState* state)
@@ -573,48 +920,226 @@ static int RemoteDebug_mem(int nArgc, char *psArgs[], RemoteDebugState* state)
 	send_hex(state, memdump_count);
 	send_sep(state);
 
-	// Need to flush here before we switch to our existing buffer system
-	flush_data(state);
+	// Binary mode sends raw bytes as the rest of the frame, straight
+	// from each memory bank
+	if (state->binaryMode)
+	{
+		static const char zeroes[RDB_MEM_BLOCK_SIZE];
+		Uint32 run;
+		Uint8* p;
+
+		send_frame_start(state, memdump_count);
+		while (memdump_count > 0)
+		{
+			p = STMemory_GetRunPointer(memdump_addr, memdump_count, &run);
+			if (p)
+			{
+				queue_data(state, (const char*)p, run);
+			}
+			else
+			{
+				// No memory here, so send zeroes like STMemory_ReadByte()
+				if (run > RDB_MEM_BLOCK_SIZE)
+					run = RDB_MEM_BLOCK_SIZE;
+				queue_data(state, zeroes, run);
+			}
+			memdump_addr += run;
+			memdump_count -= run;
+		}
+		return 0;
+	}
 
-	// Send data in blocks of "buffer_size" memory bytes
+	// Read memory in blocks of "RDB_MEM_BLOCK_SIZE * 3" bytes, and send them
+	// uuencoded in blocks of "RDB_MEM_BLOCK_SIZE * 4" chars
 	// (We don't need a terminator when sending)
 	const uint32_t buffer_size = RDB_MEM_BLOCK_SIZE*4;
 	char* buffer = malloc(buffer_size);
+	Uint8* raw = malloc(RDB_MEM_BLOCK_SIZE*3);
 
 	Uint32 read_pos = 0;
 	Uint32 write_pos = 0;
 	Uint32 accum;
 	while (read_pos < memdump_count)
 	{
-		// Accumulate 3 bytes into 24 bits of a u32
-		accum = 0;
-		for (int i = 0; i < 3; ++i)
+		Uint32 raw_size = memdump_count - read_pos;
+		if (raw_size > RDB_MEM_BLOCK_SIZE*3)
+			raw_size = RDB_MEM_BLOCK_SIZE*3;
+		STMemory_ReadBlock(memdump_addr + read_pos, raw, raw_size);
+
+		for (Uint32 raw_pos = 0; raw_pos < raw_size; raw_pos += 3)
 		{
-			accum <<= 8;
-			if (read_pos < memdump_count)
-				accum |= STMemory_ReadByte(memdump_addr + read_pos);
-			++read_pos;
+			// Accumulate 3 bytes into 24 bits of a u32
+			accum = 0;
+			for (Uint32 i = raw_pos; i < raw_pos + 3; ++i)
+			{
+				accum <<= 8;
+				if (i < raw_size)
+					accum |= raw[i];
+			}
+
+			// Now write 4 chars out as ASCII uuencode
+			buffer[write_pos++] = 32 + ((accum >> 18) & 0x3f);
+			buffer[write_pos++] = 32 + ((accum >> 12) & 0x3f);
+			buffer[write_pos++] = 32 + ((accum >>  6) & 0x3f);
+			buffer[write_pos++] = 32 + ((accum      ) & 0x3f);
 		}
+		read_pos += raw_size;
+
+		queue_data(state, buffer, write_pos);
+		write_pos = 0;
+	}
+
+	free(raw);
+	free(buffer);
+	return 0;
+}
 
-		// Now write 4 chars out as ASCII uuencode
-		buffer[write_pos++] = 32 + ((accum >> 18) & 0x3f);
-		buffer[write_pos++] = 32 + ((accum >> 12) & 0x3f);
-		buffer[write_pos++] = 32 + ((accum >>  6) & 0x3f);
-		buffer[write_pos++] = 32 + ((accum      ) & 0x3f);
+/**
+ * Read the current contents of a "memdelta" range into deltaScratch.
+ * Sets *pFull if the whole range has to be sent (first time, range
+ * changed or forced), and allocates the new shadow copy for it.
+ * Returns 1 if the client needs an update, 0 if it already has exactly
+ * this data, or -1 if there's not enough memory for the copies.
+ */
+static int memdelta_read(RemoteDebugState* state, int slot, Uint32 addr,
+                         Uint32 size, bool force, bool* pFull)
+{
+	RemoteDebugShadow* shadow = &state->shadows[slot];
+	Uint8* data;
 
-		// Flush?
-		if (write_pos == RDB_MEM_BLOCK_SIZE*4)
+	if (state->deltaScratchSize < size)
+	{
+		free(state->deltaScratch);
+		state->deltaScratch = malloc(size);
+		if (!state->deltaScratch)
 		{
-			send(state->AcceptedFD, buffer, write_pos, 0);
-			write_pos = 0;
+			state->deltaScratchSize = 0;
+			return -1;
 		}
+		state->deltaScratchSize = size;
 	}
+	STMemory_ReadBlock(addr, state->deltaScratch, size);
 
-	// Flush remainder
-	if (write_pos != 0)
-		send(state->AcceptedFD, buffer, write_pos, 0);
+	*pFull = force || shadow->data == NULL || shadow->addr != addr ||
+	         shadow->size != size;
+	if (!*pFull)
+		return memcmp(state->deltaScratch, shadow->data, size) != 0;
 
-	free(buffer);
+	// Keep the old copy if there's no memory for the new one
+	data = malloc(size ? size : 1);
+	if (!data)
+		return -1;
+	free(shadow->data);
+	shadow->data = data;
+	shadow->addr = addr;
+	shadow->size = size;
+	return 1;
+}
+
+/**
+ * Send "<addr> <size> <full> [<offset> <count> <data>]*" for the range,
+ * using the contents read by memdelta_read(), and update the shadow copy.
+ */
+static void send_memdelta_runs(RemoteDebugState* state, int slot, Uint32 addr,
+                               Uint32 size, bool full)
+{
+	RemoteDebugShadow* shadow = &state->shadows[slot];
+	const Uint8* current = state->deltaScratch;
+	Uint32 pos, start, end, scan;
+
+	send_hex(state, addr);
+	send_sep(state);
+	send_hex(state, size);
+	send_sep(state);
+	send_bool(state, full);
+	send_sep(state);
+
+	if (full)
+	{
+		// New copy (allocated by memdelta_read()), which is sent as one run
+		memcpy(shadow->data, current, size);
+
+		send_hex(state, 0);
+		send_sep(state);
+		send_hex(state, size);
+		send_sep(state);
+		send_mem_data(state, shadow->data, size);
+		send_sep(state);
+		return;
+	}
+
+	pos = 0;
+	while (pos < size)
+	{
+		// Skip unchanged data, quickly at first
+		while (pos + 64 <= size && memcmp(current + pos, shadow->data + pos, 64) == 0)
+			pos += 64;
+		while (pos < size && current[pos] == shadow->data[pos])
+			++pos;
+		if (pos == size)
+			break;
+
+		// Extend the run until a long enough unchanged gap
+		start = pos;
+		end = pos + 1;
+		for (scan = end; scan < size && scan - end < RDB_MEMDELTA_MERGE_GAP; ++scan)
+		{
+			if (current[scan] != shadow->data[scan])
+				end = scan + 1;
+		}
+
+		send_hex(state, start);
+		send_sep(state);
+		send_hex(state, end - start);
+		send_sep(state);
+		send_mem_data(state, current + start, end - start);
+		send_sep(state);
+
+		// Client now holds this data
+		memcpy(shadow->data + start, current + start, end - start);
+		pos = end;
+	}
+}
+
+/**
+ * Send the changes in an area of ST memory since it was last sent for
+ * the client's memory slot.
+ *
+ * Input: "memdelta <slot> <start addr> <size in bytes> [<force full>]\n"
+ *
+ * Output: "OK <addr> <size> <full> [<offset> <count> <data>]*N\n"
+ * If "full" is 1 (first request, range changed or forced), a single run
+ * covers the whole range. Data is uuencoded as in "mem", or raw
+ * in binary mode.
+ * Ranges over RDB_MEMDELTA_MAX_SIZE bytes are refused.
+ */
+static int RemoteDebug_memdelta(int nArgc, char *psArgs[], RemoteDebugState* state)
+{
+	Uint32 addr = 0;
+	Uint32 size = 0;
+	int offset = 0;
+	int slot;
+	bool full;
+
+	if (nArgc < 4)
+		return 1;
+
+	slot = atoi(psArgs[1]);
+	if (slot < 0 || slot >= RDB_MEMDELTA_SLOTS)
+		return 1;
+	if (Eval_Expression(psArgs[2], &addr, &offset, false))
+		return 1;
+	if (Eval_Expression(psArgs[3], &size, &offset, false))
+		return 1;
+	if (size > RDB_MEMDELTA_MAX_SIZE)
+		return 1;
+	if (memdelta_read(state, slot, addr, size,
+	                  nArgc >= 5 && atoi(psArgs[4]) != 0, &full) < 0)
+		return 1;
+
+	send_str(state, "OK");
+	send_sep(state);
+	send_memdelta_runs(state, slot, addr, size, full);
 	return 0;
 }
 
@@ -767,13 +1292,17 @@ static int RemoteDebug_symlist(int nArgc, char *psArgs[], RemoteDebugState* stat
 	for (i = 0; i < count; ++i)
 	{
 		rdb_symbol_t query;
+		char typeStr[2];
 		if (!Symbols_GetCpuSymbol(i, &query))
 			break;
 		send_str(state, query.name);
 		send_sep(state);
 		send_hex(state, query.address);
 		send_sep(state);
-		send_char(state, query.type);
+		// Sent as a string so that it is terminated in binary mode
+		typeStr[0] = query.type;
+		typeStr[1] = 0;
+		send_str(state, typeStr);
 		send_sep(state);
 	}
 	return 0;
@@ -872,23 +1401,66 @@ static int RemoteDebug_infoym(int nArgc, char *psArgs[], RemoteDebugState* state
 	return 0;
 }
 
+#if ENABLE_PERF_TIMERS
 // -----------------------------------------------------------------------------
-/* "profile <int>" Enables/disables CPU profiling. */
-/* returns "OK <val>" if successful */
-static int RemoteDebug_profile(int nArgc, char *psArgs[], RemoteDebugState* state)
+// Send host time used by emulation subsystems during the last VBL,
+// as "<vbl count> [<timer name> <nsecs> <calls>]*"
+static void send_perf_fields(RemoteDebugState* state)
 {
-	int enable;
-	if (nArgc == 2)
-	{
-		enable = atoi(psArgs[1]);
-		Profile_CpuEnable(enable);
+	const char *name;
+	Uint32 nsecs, calls;
+	int id;
 
-		send_str(state, "OK");
+	send_hex(state, nVBLs);
+	for (id = 0; id < PERF_TIMER_MAX; ++id)
+	{
+		if (!PerfTimer_GetLast(id, &name, &nsecs, &calls))
+			continue;
+		if (nsecs == 0 && calls == 0)
+			continue;
 		send_sep(state);
-		send_hex(state, enable);
-		return 0;
+		send_str(state, name);
+		send_sep(state);
+		send_hex(state, nsecs);
+		send_sep(state);
+		send_hex(state, calls);
 	}
-	return 1;
+}
+#endif
+
+// -----------------------------------------------------------------------------
+/* "infoperf" returns subsystem timings for the last VBL */
+/* returns "OK <vbl count> [<timer name> <nsecs> <calls>]*", or error
+   if Hatari was built without ENABLE_PERF_TIMERS */
+static int RemoteDebug_infoperf(int nArgc, char *psArgs[], RemoteDebugState* state)
+{
+#if ENABLE_PERF_TIMERS
+	send_str(state, "OK");
+	send_sep(state);
+	send_perf_fields(state);
+	return 0;
+#else
+	return 1;
+#endif
+}
+
+// -----------------------------------------------------------------------------
+/* "profile <int>" Enables/disables CPU profiling. */
+/* returns "OK <val>" if successful */
+static int RemoteDebug_profile(int nArgc, char *psArgs[], RemoteDebugState* state)
+{
+	int enable;
+	if (nArgc == 2)
+	{
+		enable = atoi(psArgs[1]);
+		Profile_CpuEnable(enable);
+
+		send_str(state, "OK");
+		send_sep(state);
+		send_hex(state, enable);
+		return 0;
+	}
+	return 1;
 }
 
 // -----------------------------------------------------------------------------
@@ -940,96 +1512,538 @@ static int RemoteDebug_ffwd(int nArgc, char *psArgs[], RemoteDebugState* state)
 }
 
 // -----------------------------------------------------------------------------
-/* "memfind <start> <count> <stringdata>" Search memory for string */
-/* returns "OK <addr>" where addr is the next address found if successful */
-static int RemoteDebug_memfind(int nArgc, char *psArgs[], RemoteDebugState* state)
+// Memory search, used by "memfind" and "memfindall".
+// Memory is scanned a chunk at a time through host pointers to the banks,
+// and each pattern uses memchr() on one of its unmasked bytes to skip to
+// candidate positions.
+
+/* A search pattern: "size" pairs of <mask><value> bytes */
+typedef struct
 {
-	Uint32 find_addr = 0;
-	Uint32 find_count = 0;
-	Uint32 find_end = 0;
-	int offset = 0;
-	const char* err_str = NULL;
-	int readPos = 0;
-	RemoteDebugBuffer searchBuffer;
-	size_t stringSize;
-	Uint8 valHi;
-	Uint8 valLo;
-	int arg;
+	const Uint8* maskval;
+	Uint32 size;
+	int anchor;				/* index of a byte with full mask, or -1 */
+} RemoteDebugPattern;
 
-	/* For remote debug, only "address" "count" is supported */
-	arg = 1;
-	if (nArgc >= arg + 2)
-	{
-		err_str = Eval_Expression(psArgs[arg], &find_addr, &offset, false);
-		if (err_str)
-			return 1;
+typedef struct
+{
+	Uint32 addr;
+	Uint32 pattern;
+} RemoteDebugHit;
 
-		++arg;
-		err_str = Eval_Expression(psArgs[arg], &find_count, &offset, false);
-		if (err_str)
-			return 1;
-		++arg;
-	}
-	else
-	{
-		// Not enough args
-		return 1;
-	}
+/* Parse the hex <mask><value> string. Returns false if invalid. */
+static bool memfind_parse_pattern(const char* str, RemoteDebugBuffer* buf, RemoteDebugPattern* pattern)
+{
+	Uint8 valHi, valLo;
+	Uint32 i;
+	int readPos = 0;
 
-	// Read (hex) search string into a buffer.
-	// The string is a set of <mask><value> byte pairs (so we can support case-insensitive)
-	RemoteDebugBuffer_Init(&searchBuffer, 30);
+	buf->write_pos = 0;
 	while (1)
 	{
-		if (!read_hex_char(psArgs[arg][readPos], &valHi))
+		if (!read_hex_char(str[readPos], &valHi))
 			break;
 		++readPos;
-		if (!read_hex_char(psArgs[arg][readPos], &valLo))
+		if (!read_hex_char(str[readPos], &valLo))
 			break;
 		++readPos;
 		char stringVal = (valHi << 4) | valLo;
-		RemoteDebugBuffer_Add(&searchBuffer, &stringVal, sizeof(stringVal));
+		RemoteDebugBuffer_Add(buf, &stringVal, sizeof(stringVal));
 	}
 	// Check that we have an even number of bytes in the search string
-	if (searchBuffer.write_pos & 1)
-		return 2;
+	if ((buf->write_pos & 1) || buf->write_pos == 0)
+		return false;
 
-	send_str(state, "OK");
+	pattern->size = buf->write_pos / 2;
+	pattern->anchor = -1;
+	for (i = 0; i < pattern->size; ++i)
+	{
+		Uint8 mask = (Uint8)buf->data[i * 2];
+		Uint8 val = (Uint8)buf->data[i * 2 + 1];
+		if (mask != 0xff)
+			continue;
+		/* Prefer a non-zero value, since memory has lots of zeroes */
+		if (pattern->anchor < 0 || (val != 0 &&
+		    buf->data[pattern->anchor * 2 + 1] == 0))
+			pattern->anchor = i;
+	}
+	return true;
+}
+
+static inline bool memfind_match(const Uint8* mem, const RemoteDebugPattern* pattern)
+{
+	const Uint8* mv = pattern->maskval;
+	Uint32 i;
+	for (i = 0; i < pattern->size; ++i)
+	{
+		if ((mem[i] & mv[i * 2]) != mv[i * 2 + 1])
+			return false;
+	}
+	return true;
+}
+
+/* Search 'mem' (host copy of memory at 'addr') for pattern starts in
+ * [0, numStarts). 'mem' must have numStarts + size - 1 readable bytes.
+ * Adds at most 'maxHits' entries to 'hits', returns the number added.
+ */
+static Uint32 memfind_scan(const Uint8* mem, Uint32 addr, Uint32 numStarts,
+                           const RemoteDebugPattern* pattern, Uint32 patternIndex,
+                           RemoteDebugHit* hits, Uint32 maxHits)
+{
+	Uint32 count = 0;
 
-	// Then do the search
-	stringSize = searchBuffer.write_pos / 2;
-	find_end = find_addr + find_count - stringSize;
-	while (find_addr < find_end)
+	if (pattern->anchor >= 0)
 	{
-		// Primitive string compare.
-		// We could do something with a rolling buffer for speed,
-		// but it's really not worth it yet.
-		bool found = true;
-		for (size_t i = 0; i < stringSize; ++i)
+		const Uint8* anchorStart = mem + pattern->anchor;
+		const Uint8* anchorEnd = anchorStart + numStarts;
+		const Uint8* p = anchorStart;
+		Uint8 val = pattern->maskval[pattern->anchor * 2 + 1];
+
+		while (count < maxHits &&
+		       (p = memchr(p, val, anchorEnd - p)) != NULL)
 		{
-			Uint8 mem = STMemory_ReadByte(find_addr + i);
-			Uint8 mask = searchBuffer.data[i * 2];
-			Uint8 val = searchBuffer.data[i * 2 + 1];
+			Uint32 pos = p - anchorStart;
+			if (memfind_match(mem + pos, pattern))
+			{
+				hits[count].addr = addr + pos;
+				hits[count].pattern = patternIndex;
+				++count;
+			}
+			++p;
+		}
+	}
+	else
+	{
+		Uint8 mask = pattern->maskval[0];
+		Uint8 val = pattern->maskval[1];
+		Uint32 pos;
 
-			if ((mem & mask) != val)
+		for (pos = 0; pos < numStarts && count < maxHits; ++pos)
+		{
+			if ((mem[pos] & mask) != val)
+				continue;
+			if (memfind_match(mem + pos, pattern))
 			{
-				found = false;
-				break;
+				hits[count].addr = addr + pos;
+				hits[count].pattern = patternIndex;
+				++count;
 			}
 		}
+	}
+	return count;
+}
 
-		if (found)
+static int memfind_compare_hits(const void* a, const void* b)
+{
+	const RemoteDebugHit* hitA = a;
+	const RemoteDebugHit* hitB = b;
+	if (hitA->addr != hitB->addr)
+		return hitA->addr < hitB->addr ? -1 : 1;
+	if (hitA->pattern != hitB->pattern)
+		return hitA->pattern < hitB->pattern ? -1 : 1;
+	return 0;
+}
+
+/* Find up to 'maxHits' matches of any of the patterns in [addr, addr+count),
+ * in address order. 'hits' must have room for maxHits * (numPatterns + 1)
+ * entries. Returns the number of hits.
+ */
+static Uint32 memfind_search(Uint32 addr, Uint32 count,
+                             const RemoteDebugPattern* patterns, int numPatterns,
+                             RemoteDebugHit* hits, Uint32 maxHits)
+{
+	static Uint8 scratch[RDB_MEMFIND_CHUNK + RDB_MEMFIND_MAX_SIZE];
+	Uint32 numHits = 0;
+	Uint32 maxSize = 0;
+	Uint32 end;
+	int i;
+
+	for (i = 0; i < numPatterns; ++i)
+		if (patterns[i].size > maxSize)
+			maxSize = patterns[i].size;
+
+	/* Clamp to the end of the address space */
+	if (count > 0xffffffff - addr)
+		count = 0xffffffff - addr;
+	end = addr + count;
+
+	while (addr < end && numHits < maxHits)
+	{
+		Uint32 chunk = RDB_MEMFIND_CHUNK - (addr & (RDB_MEMFIND_CHUNK - 1));
+		Uint32 avail, need, run;
+		Uint32 chunkHits = 0;
+		const Uint8* mem;
+
+		if (chunk > end - addr)
+			chunk = end - addr;
+		/* Patterns may run into the next chunk */
+		avail = end - addr;
+		need = chunk + maxSize - 1;
+		if (need > avail)
+			need = avail;
+
+		mem = STMemory_GetRunPointer(addr, need, &run);
+		if (!mem || run < need)
 		{
-			send_sep(state);
-			send_hex(state, find_addr);
-			break;
+			STMemory_ReadBlock(addr, scratch, need);
+			mem = scratch;
+		}
+
+		for (i = 0; i < numPatterns; ++i)
+		{
+			Uint32 numStarts;
+			if (avail < patterns[i].size)
+				continue;
+			numStarts = avail - patterns[i].size + 1;
+			if (numStarts > chunk)
+				numStarts = chunk;
+			/* Only the first maxHits of the chunk can be needed */
+			chunkHits += memfind_scan(mem, addr, numStarts, &patterns[i], i,
+			                          hits + numHits + chunkHits,
+			                          maxHits - numHits);
 		}
-		++find_addr;
+
+		if (numPatterns > 1 && chunkHits > 1)
+			qsort(hits + numHits, chunkHits, sizeof(RemoteDebugHit), memfind_compare_hits);
+		numHits += chunkHits;
+		if (numHits > maxHits)
+			numHits = maxHits;
+		addr += chunk;
+	}
+	return numHits;
+}
+
+/* Parses "<start> <count>" args and the patterns following them into
+ * 'patterns'/'bufs'. Returns the number of patterns, or -1 for an error.
+ */
+static int memfind_parse_args(int nArgc, char *psArgs[], int patternArg,
+                              Uint32* pAddr, Uint32* pCount,
+                              RemoteDebugPattern* patterns, RemoteDebugBuffer* bufs)
+{
+	int offset = 0;
+	int numPatterns = 0;
+	int arg;
+
+	if (nArgc <= patternArg)
+		return -1;
+	if (Eval_Expression(psArgs[1], pAddr, &offset, false))
+		return -1;
+	if (Eval_Expression(psArgs[2], pCount, &offset, false))
+		return -1;
+
+	for (arg = patternArg; arg < nArgc; ++arg)
+	{
+		if (numPatterns == RDB_MEMFIND_MAX_PATTERNS)
+			return -1;
+		RemoteDebugBuffer_Init(&bufs[numPatterns], 30);
+		if (!memfind_parse_pattern(psArgs[arg], &bufs[numPatterns], &patterns[numPatterns]) ||
+		    patterns[numPatterns].size > RDB_MEMFIND_MAX_SIZE)
+		{
+			RemoteDebugBuffer_UnInit(&bufs[numPatterns]);
+			while (numPatterns--)
+				RemoteDebugBuffer_UnInit(&bufs[numPatterns]);
+			return -1;
+		}
+		patterns[numPatterns].maskval = (const Uint8*)bufs[numPatterns].data;
+		++numPatterns;
+	}
+	return numPatterns;
+}
+
+// -----------------------------------------------------------------------------
+/* "memfind <start> <count> <stringdata>" Search memory for string */
+/* returns "OK <addr>" where addr is the next address found if successful */
+static int RemoteDebug_memfind(int nArgc, char *psArgs[], RemoteDebugState* state)
+{
+	RemoteDebugPattern pattern;
+	RemoteDebugBuffer searchBuffer;
+	RemoteDebugHit hits[2];
+	Uint32 find_addr = 0;
+	Uint32 find_count = 0;
+	int arg = 1;
+
+	/* For remote debug, only "address" "count" is supported */
+	if (nArgc < arg + 2)
+		return 1;
+	/* Arguments after the search string are ignored */
+	if (nArgc > arg + 3)
+		nArgc = arg + 3;
+	if (memfind_parse_args(nArgc, psArgs, arg + 2, &find_addr, &find_count,
+	                       &pattern, &searchBuffer) != 1)
+		return 2;
+
+	send_str(state, "OK");
+	if (memfind_search(find_addr, find_count, &pattern, 1, hits, 1))
+	{
+		send_sep(state);
+		send_hex(state, hits[0].addr);
 	}
 	RemoteDebugBuffer_UnInit(&searchBuffer);
 	return 0;
 }
 
+// -----------------------------------------------------------------------------
+/* "memfindall <start> <count> <max hits> <stringdata> [<stringdata>...]" */
+/* Search memory for up to RDB_MEMFIND_MAX_PATTERNS strings at once */
+/* returns "OK [<addr> <string index>]*" for the first <max hits> matches, */
+/* in address order, or NG if the search can't be done */
+static int RemoteDebug_memfindall(int nArgc, char *psArgs[], RemoteDebugState* state)
+{
+	RemoteDebugPattern patterns[RDB_MEMFIND_MAX_PATTERNS];
+	RemoteDebugBuffer bufs[RDB_MEMFIND_MAX_PATTERNS];
+	RemoteDebugHit* hits;
+	Uint32 find_addr = 0;
+	Uint32 find_count = 0;
+	Uint32 maxHits = 0;
+	Uint32 numHits, i;
+	int offset = 0;
+	int numPatterns;
+
+	if (nArgc < 5)
+		return 1;
+	if (Eval_Expression(psArgs[3], &maxHits, &offset, false))
+		return 1;
+	if (maxHits == 0 || maxHits > RDB_MEMFIND_MAX_HITS)
+		maxHits = RDB_MEMFIND_MAX_HITS;
+
+	numPatterns = memfind_parse_args(nArgc, psArgs, 4, &find_addr, &find_count,
+	                                 patterns, bufs);
+	if (numPatterns <= 0)
+		return 2;
+
+	hits = malloc(sizeof(RemoteDebugHit) * maxHits * (numPatterns + 1));
+	if (!hits)
+	{
+		// Out of memory is not "no matches", so reply NG
+		for (i = 0; i < (Uint32)numPatterns; ++i)
+			RemoteDebugBuffer_UnInit(&bufs[i]);
+		return 1;
+	}
+	numHits = memfind_search(find_addr, find_count, patterns, numPatterns, hits, maxHits);
+
+	send_str(state, "OK");
+	for (i = 0; i < numHits; ++i)
+	{
+		send_sep(state);
+		send_hex(state, hits[i].addr);
+		send_sep(state);
+		send_hex(state, hits[i].pattern);
+	}
+
+	free(hits);
+	for (i = 0; i < (Uint32)numPatterns; ++i)
+		RemoteDebugBuffer_UnInit(&bufs[i]);
+	return 0;
+}
+
+// -----------------------------------------------------------------------------
+typedef struct
+{
+	RemoteDebugState* state;
+	bool regs;
+} RemoteDebugHistory;
+
+static void send_history_record(const history_record_t* rec, void* arg)
+{
+	RemoteDebugHistory* hist = (RemoteDebugHistory*)arg;
+	int i;
+
+	send_sep(hist->state);
+	send_hex(hist->state, rec->for_dsp ? 1 : 0);
+	send_sep(hist->state);
+	send_hex(hist->state, rec->pc);
+	send_sep(hist->state);
+	send_hex(hist->state, rec->cycles > 0xffffffff ? 0xffffffff : (Uint32)rec->cycles);
+	send_sep(hist->state);
+	send_hex(hist->state, rec->sr);
+	if (!hist->regs)
+		return;
+	for (i = 0; i < 16; ++i)
+	{
+		send_sep(hist->state);
+		send_hex(hist->state, rec->regs[i]);
+	}
+}
+
+/* "history <count> [regs]" Get (at max) <count> last instruction history records */
+/* returns "OK <count> <regs flag> [<dsp flag> <pc> <cycles> <sr> [<d0>...<a7>]]*" */
+/* oldest first. Cycles are since the previous record. Registers are sent only
+   when requested and tracked ("history cpu regs" in the console) */
+static int RemoteDebug_history(int nArgc, char *psArgs[], RemoteDebugState* state)
+{
+	RemoteDebugHistory hist;
+	Uint32 count;
+
+	if (nArgc < 2 || !Eval_Number(psArgs[1], &count))
+		return 1;
+	if (count > History_Count())
+		count = History_Count();
+
+	hist.state = state;
+	hist.regs = nArgc > 2 && strcmp(psArgs[2], "regs") == 0 && History_HasRegs();
+
+	send_str(state, "OK");
+	send_sep(state);
+	send_hex(state, count);
+	send_sep(state);
+	send_bool(state, hist.regs);
+	History_Walk(count, send_history_record, &hist);
+	return 0;
+}
+
+// -----------------------------------------------------------------------------
+/* "historyfind <reg> <value>" Find last CPU history record with given value */
+/* <reg> is 0-15 for D0-A7 (needs tracked registers), 16 for PC or 17 for SR */
+/* returns "OK <records back from the last one>", or NG if not found */
+static int RemoteDebug_historyfind(int nArgc, char *psArgs[], RemoteDebugState* state)
+{
+	Uint32 reg, value, back;
+
+	if (nArgc != 3)
+		return 1;
+	if (!Eval_Number(psArgs[1], &reg) || reg > HISTORY_FIND_SR)
+		return 1;
+	if (!Eval_Number(psArgs[2], &value))
+		return 1;
+	if (!History_Find(reg, value, &back))
+		return 1;
+
+	send_str(state, "OK");
+	send_sep(state);
+	send_hex(state, back);
+	return 0;
+}
+
+// -----------------------------------------------------------------------------
+/* "binary <0|1>" Switch responses to/from length-prefixed binary frames. */
+/* returns "OK <val>" in the old mode; the new mode applies from the next
+   response or notification onwards */
+static int RemoteDebug_binary(int nArgc, char *psArgs[], RemoteDebugState* state)
+{
+	int enable;
+	if (nArgc == 2)
+	{
+		enable = atoi(psArgs[1]);
+		state->binaryModeNext = ( enable ? true : false );
+
+		send_str(state, "OK");
+		send_sep(state);
+		send_hex(state, enable);
+		return 0;
+	}
+	return 1;
+}
+
+// -----------------------------------------------------------------------------
+/* "subscribe <vbl interval> <flags> [<slot> <addr> <size>]*" */
+/* While running, push the requested state every <vbl interval> VBLs:
+   "!regs" if flags bit 0 is set, "!video" if bit 1 is set, "!perf" if
+   bit 2 is set (and Hatari is built with ENABLE_PERF_TIMERS), and
+   "!memdelta" for each memory range that changed.
+   An interval of 0 cancels the subscription. Returns "OK" */
+static int RemoteDebug_subscribe(int nArgc, char *psArgs[], RemoteDebugState* state)
+{
+	RemoteDebugSubRange ranges[RDB_SUBSCRIBE_MAX_RANGES];
+	Uint32 interval = 0;
+	Uint32 flags = 0;
+	int offset = 0;
+	int arg, numRanges;
+
+	if (nArgc < 3 || (nArgc - 3) % 3 != 0)
+		return 1;
+	if (Eval_Expression(psArgs[1], &interval, &offset, false))
+		return 1;
+	if (Eval_Expression(psArgs[2], &flags, &offset, false))
+		return 1;
+
+	numRanges = 0;
+	for (arg = 3; arg < nArgc; arg += 3)
+	{
+		RemoteDebugSubRange* range = &ranges[numRanges];
+		if (numRanges == RDB_SUBSCRIBE_MAX_RANGES)
+			return 1;
+		range->slot = atoi(psArgs[arg]);
+		if (range->slot < 0 || range->slot >= RDB_MEMDELTA_SLOTS)
+			return 1;
+		if (Eval_Expression(psArgs[arg + 1], &range->addr, &offset, false))
+			return 1;
+		if (Eval_Expression(psArgs[arg + 2], &range->size, &offset, false))
+			return 1;
+		if (range->size > RDB_MEMDELTA_MAX_SIZE)
+			return 1;
+		++numRanges;
+	}
+
+	state->subInterval = interval;
+	state->subFlags = flags;
+	state->subNumRanges = interval ? numRanges : 0;
+	memcpy(state->subRanges, ranges, sizeof(ranges[0]) * numRanges);
+	// Push on the next VBL
+	state->subLastVbl = nVBLs - interval;
+
+	send_str(state, "OK");
+	return 0;
+}
+
+// -----------------------------------------------------------------------------
+/* Push the "subscribe" notifications, if they are due */
+/* "!regs <regs as in "regs">" */
+/* "!video <vbl count> <screen base>" */
+/* "!perf <fields as in "infoperf">" */
+/* "!memdelta <slot> <fields as in "memdelta">" */
+static void RemoteDebug_NotifySubscription(RemoteDebugState* state)
+{
+	bool full;
+	int i;
+
+	if (state->subInterval == 0 ||
+	    (Uint32)(nVBLs - state->subLastVbl) < state->subInterval)
+		return;
+	state->subLastVbl = nVBLs;
+
+	if (state->subFlags & RDB_SUBSCRIBE_REGS)
+	{
+		send_str(state, "!regs");
+		send_sep(state);
+		send_regs_fields(state);
+		send_term(state);
+	}
+	if (state->subFlags & RDB_SUBSCRIBE_VIDEO)
+	{
+		send_str(state, "!video");
+		send_sep(state);
+		send_hex(state, nVBLs);
+		send_sep(state);
+		send_hex(state, Video_GetScreenBaseAddr());
+		send_term(state);
+	}
+#if ENABLE_PERF_TIMERS
+	if (state->subFlags & RDB_SUBSCRIBE_PERF)
+	{
+		send_str(state, "!perf");
+		send_sep(state);
+		send_perf_fields(state);
+		send_term(state);
+	}
+#endif
+	for (i = 0; i < state->subNumRanges; ++i)
+	{
+		const RemoteDebugSubRange* range = &state->subRanges[i];
+
+		// Nothing is sent if the client already has this memory,
+		// or if there's no memory to compare it
+		if (memdelta_read(state, range->slot, range->addr, range->size, false, &full) <= 0)
+			continue;
+		send_str(state, "!memdelta");
+		send_sep(state);
+		send_hex(state, range->slot);
+		send_sep(state);
+		send_memdelta_runs(state, range->slot, range->addr, range->size, full);
+		send_term(state);
+	}
+	flush_data(state);
+}
+
 // -----------------------------------------------------------------------------
 /* DebugUI command structure */
 typedef struct
@@ -1056,11 +2070,21 @@ static const rdbcommand_t remoteDebugCommandList[] = {
 	{ RemoteDebug_console,	"console"	, false		},
 	{ RemoteDebug_setstd,	"setstd"	, true		},
 	{ RemoteDebug_infoym,	"infoym"	, false		},
+	{ RemoteDebug_infoperf,	"infoperf"	, true		},
 	{ RemoteDebug_profile,	"profile"	, true		},
 	{ RemoteDebug_resetwarm,"resetwarm"	, true		},
 	{ RemoteDebug_resetcold,"resetcold"	, true		},
 	{ RemoteDebug_ffwd,		"ffwd"		, true		},
 	{ RemoteDebug_memfind,	"memfind"	, true		},
+	{ RemoteDebug_memfindall,	"memfindall"	, true		},
+	{ RemoteDebug_binary,	"binary"	, true		},
+	{ RemoteDebug_memdelta,	"memdelta"	, true		},
+	{ RemoteDebug_subscribe,	"subscribe"	, true		},
+	{ RemoteDebug_history,	"history"	, true		},
+	{ RemoteDebug_historyfind,	"historyfind"	, true		},
+	{ RemoteDebug_rewind,	"rewind"	, true		},
+	{ RemoteDebug_stepback,	"stepback"	, true		},
+	{ RemoteDebug_runback,	"runback"	, true		},
 
 	/* Terminator */
 	{ NULL, NULL }
@@ -1141,6 +2165,14 @@ static void SetNonBlocking(SOCKET socket, u_long nonblock)
 	u_long mode = nonblock;  // 0 to enable blocking socket
 	ioctlsocket(socket, FIONBIO, &mode);
 }
+
+// Responses are already collected into one block per batch of commands,
+// so send them immediately
+static void SetNoDelay(SOCKET socket)
+{
+	BOOL val = TRUE;
+	setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&val, sizeof(val));
+}
 #define GET_SOCKET_ERROR		WSAGetLastError()
 #define RDB_CLOSE				closesocket
 
@@ -1165,12 +2197,42 @@ static void SetReuseAddr(int fd)
 	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &val, sizeof(val));
 }
 
+// Responses are already collected into one block per batch of commands,
+// so send them immediately
+static void SetNoDelay(int fd)
+{
+	int val = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &val, sizeof(val));
+}
+
 #define GET_SOCKET_ERROR		errno
 #define RDB_CLOSE				close
 #endif
 
 static RemoteDebugState g_rdbState;
 
+/* Close the accepted connection, and drop any commands
+   and responses still pending for it */
+static void RemoteDebugState_Disconnect(RemoteDebugState* state)
+{
+	RDB_CLOSE(state->AcceptedFD);
+	state->AcceptedFD = -1;
+	state->input_buf.write_pos = 0;
+	state->frame_buf.write_pos = 0;
+}
+
+/* Forget all memory sent by "memdelta", e.g. for a new connection */
+static void RemoteDebugState_ResetShadows(RemoteDebugState* state)
+{
+	for (int i = 0; i < RDB_MEMDELTA_SLOTS; ++i)
+	{
+		free(state->shadows[i].data);
+		state->shadows[i].data = NULL;
+		state->shadows[i].addr = 0;
+		state->shadows[i].size = 0;
+	}
+}
+
 static void RemoteDebugState_Init(RemoteDebugState* state)
 {
 	state->SocketFD = -1;
@@ -1186,6 +2248,17 @@ static void RemoteDebugState_Init(RemoteDebugState* state)
 	state->consoleOutputFile = NULL;
 #endif
 	state->sendBufferPos = 0;
+	state->binaryMode = false;
+	state->binaryModeNext = false;
+	state->binaryFrameSent = false;
+	RemoteDebugBuffer_Init(&state->frame_buf, RDB_CMD_BUFFER_START_SIZE);
+	memset(state->shadows, 0, sizeof(state->shadows));
+	state->deltaScratch = NULL;
+	state->deltaScratchSize = 0;
+	state->subInterval = 0;
+	state->subFlags = 0;
+	state->subNumRanges = 0;
+	state->subLastVbl = 0;
 }
 
 static void RemoteDebugState_UnInit(RemoteDebugState* state)
@@ -1203,26 +2276,58 @@ static void RemoteDebugState_UnInit(RemoteDebugState* state)
 	state->AcceptedFD = -1;
 	state->SocketFD = -1;
 	RemoteDebugBuffer_UnInit(&state->input_buf);
+	RemoteDebugBuffer_UnInit(&state->frame_buf);
+	RemoteDebugState_ResetShadows(state);
+	free(state->deltaScratch);
+	state->deltaScratch = NULL;
+	state->deltaScratchSize = 0;
 }
 
-static int RemoteDebugState_TryAccept(RemoteDebugState* state, bool blocking)
+/**
+ * Wait in the break loop until "fd" has input or RDB_POLL_TIMEOUT_MSEC
+ * passes. Everything else that the break loop services (SDL events,
+ * quit requests) is only noticed by the event handler, which is run
+ * on the timeout, so UI response time is bound by the timeout.
+ * Returns 1 if "fd" is readable (or has been closed), 0 if the event
+ * handler should run, -1 on error.
+ */
+static int RemoteDebugState_Wait(int fd)
 {
+#if HAVE_UNIX_DOMAIN_SOCKETS
+	struct pollfd pfd;
+	int rv;
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+
+	rv = poll(&pfd, 1, RDB_POLL_TIMEOUT_MSEC);
+	if (rv < 0)
+		return errno == EINTR ? 0 : -1;
+	return (pfd.revents & (POLLIN | POLLHUP | POLLERR)) ? 1 : 0;
+#else
 	fd_set set;
 	struct timeval timeout;
+	int rv;
+
+	FD_ZERO(&set);
+	FD_SET(fd, &set);
+	timeout.tv_sec = 0;
+	timeout.tv_usec = RDB_POLL_TIMEOUT_MSEC * 1000;
 
+	rv = select(fd + 1, &set, NULL, NULL, &timeout);
+	if (rv < 0)
+		return -1;
+	return rv > 0 ? 1 : 0;
+#endif
+}
+
+static int RemoteDebugState_TryAccept(RemoteDebugState* state, bool blocking)
+{
 	if (blocking)
 	{
-		// Connection active
-		// Check socket with timeout
-		FD_ZERO(&set);
-		FD_SET(state->SocketFD, &set);
-
-		// On Linux, need to reset the timeout on each loop
-		// see "select(2)"
-		timeout.tv_sec = 0;
-		timeout.tv_usec = RDB_SELECT_TIMEOUT_USEC;
-		int rv = select(state->SocketFD + 1, &set, NULL, NULL, &timeout);
-		if (rv <= 0)
+		// Wait for a connection, or for events to handle
+		if (RemoteDebugState_Wait(state->SocketFD) <= 0)
 			return state->AcceptedFD;
 	}
 
@@ -1230,8 +2335,21 @@ static int RemoteDebugState_TryAccept(RemoteDebugState* state, bool blocking)
 	if (state->AcceptedFD != -1)
 	{
 		printf("Remote Debug connection accepted\n");
+		// Input is always read without blocking, see RemoteDebugState_Receive()
+		SetNonBlocking(state->AcceptedFD, 1);
+		SetNoDelay(state->AcceptedFD);
 		// reset send buffer
 		state->sendBufferPos = 0;
+		// New connections always start in ASCII mode
+		state->binaryMode = false;
+		state->binaryModeNext = false;
+		state->binaryFrameSent = false;
+		state->frame_buf.write_pos = 0;
+		// The new client has none of our memory
+		RemoteDebugState_ResetShadows(state);
+		// ...and hasn't subscribed to anything
+		state->subInterval = 0;
+		state->subNumRanges = 0;
 		// Send connected handshake, so client can
 		// drop any subsequent commands
 		send_str(state, "!connected");
@@ -1255,7 +2373,7 @@ static void RemoteDebug_ProcessBuffer(RemoteDebugState* state)
 {
 	int cmd_ret;
 	int num_commands = 0;
-	while (1)
+	while (state->AcceptedFD != -1)
 	{
 		// Scan for a complete command by looking for the terminator
 		char* endptr = memchr(state->input_buf.data, 0, state->input_buf.write_pos);
@@ -1269,11 +2387,20 @@ static void RemoteDebug_ProcessBuffer(RemoteDebugState* state)
 
 		if (cmd_ret != 0)
 		{
+			// Drop any partial binary response before the error
+			state->frame_buf.write_pos = 0;
 			// return an error if something failed
 			send_str(state, "NG");
 		}
 		send_term(state);
 
+		// Sending dropped the connection, and its pending input
+		if (state->AcceptedFD == -1)
+			break;
+
+		// Apply any mode switch requested by the "binary" command
+		state->binaryMode = state->binaryModeNext;
+
 		// Copy extra bytes to the start
 		RemoteDebugBuffer_RemoveStart(&state->input_buf, cmd_length);
 		++num_commands;
@@ -1283,68 +2410,48 @@ static void RemoteDebug_ProcessBuffer(RemoteDebugState* state)
 		flush_data(state);
 }
 
-/*	Handle activity from the accepted connection.
-	Disconnect if socket lost or other errors.
-*/
-static void RemoteDebugState_UpdateAccepted(RemoteDebugState* state)
+/**
+ * Read all input waiting on the accepted connection, without blocking,
+ * then run the completed commands.
+ * Closes the connection on EOF or a lost connection.
+ */
+static void RemoteDebugState_Receive(RemoteDebugState* state)
 {
-	int remaining;
-	fd_set set;
-	struct timeval timeout;
+	int bytes;
 #if HAVE_WINSOCK_SOCKETS
 	int winerr;
 #endif
 
-	// Connection active
-	// Check socket with timeout
-	FD_ZERO(&set);
-	FD_SET(state->AcceptedFD, &set);
-
-	// On Linux, need to reset the timeout on each loop
-	// see "select(2)"
-	timeout.tv_sec = 0;
-	timeout.tv_usec = RDB_SELECT_TIMEOUT_USEC;
-
-	int rv = select(state->AcceptedFD + 1, &set, NULL, NULL, &timeout);
-	if (rv < 0)
-	{
-		// select error, Lost connection?
-		return;
-	}
-	else if (rv == 0)
+	while (state->AcceptedFD != -1)
 	{
-		// timeout, socket does not have anything to read.
-		// Run event handler while we know nothing changes
-		Main_EventHandler(true);
-		return;
-	}
+#if HAVE_UNIX_DOMAIN_SOCKETS
+		bytes = recv(state->AcceptedFD,
+			state->cmd_buf,
+			sizeof(state->cmd_buf),
+			MSG_DONTWAIT);
+#endif
+#if HAVE_WINSOCK_SOCKETS
+		bytes = recv(state->AcceptedFD,
+			state->cmd_buf,
+			sizeof(state->cmd_buf),
+			0);
+#endif
+		if (bytes > 0)
+		{
+			// New data.
+			// Add to the resizeable buffer, and keep reading
+			RemoteDebugBuffer_Add(&state->input_buf, state->cmd_buf, bytes);
+			continue;
+		}
 
-	// Read input and accumulate a command (blocking)
-	remaining = sizeof(state->cmd_buf);
-	int bytes = recv(state->AcceptedFD, 
-		state->cmd_buf,
-		remaining,
-		0);
-	if (bytes > 0)
-	{
-		// New data.
-		// Add to the resizeable buffer
-		RemoteDebugBuffer_Add(&state->input_buf, state->cmd_buf, bytes);
-		// Check for completed commands
-		RemoteDebug_ProcessBuffer(state);
-	}
-	else if (bytes == 0)
-	{
-		// This represents an orderly EOF, even in Winsock
-		printf("Remote Debug connection closed\n");
-		RDB_CLOSE(state->AcceptedFD);
-		state->AcceptedFD = -1;
+		if (bytes == 0)
+		{
+			// This represents an orderly EOF, even in Winsock
+			printf("Remote Debug connection closed\n");
+			RemoteDebugState_Disconnect(state);
+			return;
+		}
 
-		// Bail out of the loop here so we don't just spin
-		return;
-	}
-	else
-	{
 		// On Windows -1 simply means a general error and might be OK.
 		// So we check for known errors that should cause us to exit.
 #if HAVE_WINSOCK_SOCKETS
@@ -1352,12 +2459,49 @@ static void RemoteDebugState_UpdateAccepted(RemoteDebugState* state)
 		if (winerr == WSAECONNRESET)
 		{
 			printf("Remote Debug connection reset\n");
-			RDB_CLOSE(state->AcceptedFD);
-			state->AcceptedFD = -1;
+			RemoteDebugState_Disconnect(state);
+			return;
+		}
+#else
+		if (errno == EINTR)
+			continue;
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+		{
+			printf("Remote Debug connection lost (%d)\n", errno);
+			RemoteDebugState_Disconnect(state);
+			return;
 		}
-		printf("Unknown cmd %d\n", WSAGetLastError());
 #endif
+		// Nothing more to read
+		break;
 	}
+
+	// Check for completed commands
+	RemoteDebug_ProcessBuffer(state);
+}
+
+/*	Handle activity from the accepted connection.
+	Disconnect if socket lost or other errors.
+*/
+static void RemoteDebugState_UpdateAccepted(RemoteDebugState* state)
+{
+	// Connection active
+	// Sleep until there is input, or events to handle
+	int rv = RemoteDebugState_Wait(state->AcceptedFD);
+	if (rv < 0)
+	{
+		// poll/select error, Lost connection?
+		return;
+	}
+	else if (rv == 0)
+	{
+		// Socket does not have anything to read.
+		// Run event handler while we know nothing changes
+		Main_EventHandler(true);
+		return;
+	}
+
+	RemoteDebugState_Receive(state);
 }
 
 /* Update with a suitable message, when we are in the break loop */
@@ -1367,6 +2511,7 @@ static void SetStatusbarMessage(const RemoteDebugState* state)
 		Statusbar_AddMessage("hrdb connected -- debugging", 100);
 	else
 		Statusbar_AddMessage("break -- waiting for hrdb", 100);
+	Screen_RenderWait();
 	Statusbar_Update(sdlscrn, true);
 }
 
@@ -1402,10 +2547,6 @@ static bool RemoteDebug_BreakLoop(void)
 
 	SetStatusbarMessage(state);
 
-	// Set the socket to blocking on the connection now, so we
-	// sleep until data is available.
-	SetNonBlocking(state->AcceptedFD, 0);
-
 	while (bRemoteBreakIsActive)
 	{
 		// Handle main exit states
@@ -1421,12 +2562,7 @@ static bool RemoteDebug_BreakLoop(void)
 			// Try to reconnect (with select())
 			RemoteDebugState_TryAccept(state, true);
 			if (state->AcceptedFD != -1)
-			{
-				// Set the socket to blocking on the connection now, so we
-				// sleep until data is available.
-				SetNonBlocking(state->AcceptedFD, 0);
 				SetStatusbarMessage(state);
-			}
 			else
 			{
 				// No connection so update events
@@ -1448,14 +2584,11 @@ static bool RemoteDebug_BreakLoop(void)
 	// Clear any break request that might have been set
 	bRemoteBreakRequest = false;
 
-	// Switch back to non-blocking for the update loop
 	if (state->AcceptedFD != -1)
 	{
 		RemoteDebug_NotifyConfig(state);
 		RemoteDebug_NotifyState(state);
 		flush_data(state);
-
-		SetNonBlocking(state->AcceptedFD, 1);
 	}
 
 	// TODO: this return code no longer used
@@ -1518,52 +2651,23 @@ static void RemoteDebugState_Update(RemoteDebugState* state)
 		return;
 	}
 
-	int remaining;
 	if (state->AcceptedFD != -1)
 	{
 		// Connection is active
-		// Read input and accumulate a command
-		remaining = sizeof(state->cmd_buf);
-		
-#if HAVE_UNIX_DOMAIN_SOCKETS
-		int bytes = recv(state->AcceptedFD, 
-			state->cmd_buf,
-			remaining,
-			MSG_DONTWAIT);
-#endif
-#if HAVE_WINSOCK_SOCKETS
-		int bytes = recv(state->AcceptedFD, 
-			state->cmd_buf,
-			remaining,
-			0);
-#endif
-
-		if (bytes > 0)
-		{
-			// New data.
-			// Add to the resizeable buffer
-			RemoteDebugBuffer_Add(&state->input_buf, state->cmd_buf, bytes);
-			// Check for completed commands
-			RemoteDebug_ProcessBuffer(state);
-		}
-		else if (bytes == 0)
-		{
-			// This represents an orderly EOF
-			printf("Remote Debug connection closed\n");
-			RDB_CLOSE(state->AcceptedFD);
-			state->AcceptedFD = -1;
+		// Read all waiting input, so commands sent since the
+		// last VBL are all handled now
+		RemoteDebugState_Receive(state);
+		if (state->AcceptedFD == -1)
 			return;
-		}
+
+		// Processing could have stopped the CPU
+		if (!bRemoteBreakIsActive)
+			RemoteDebug_NotifySubscription(state);
 	}
 	else
 	{
-		if (RemoteDebugState_TryAccept(state, false) != -1)
-		{
-			// Set this connection to non-blocking since we are
-			// in "running" state and it will poll every VBL
-			SetNonBlocking(state->AcceptedFD, 1);
-			return;
-		}
+		// Connections are set to non-blocking on accept
+		RemoteDebugState_TryAccept(state, false);
 	}
 }
 
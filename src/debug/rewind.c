@@ -0,0 +1,661 @@
+/*
+  Hatari - rewind.c
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+
+  rewind.c - reverse stepping for the debugger.  While enabled, emulation
+  state is saved to a ring of in-memory snapshots every few VBLs and host
+  input given to the IKBD is logged.  Stepping back restores the newest
+  snapshot before the target instruction, and replays emulation (with
+  the logged input) until the target instruction count is reached.
+  Running back to a breakpoint replays the snapshot intervals from the
+  newest to the oldest until one with breakpoint hits is found, and then
+  replays to the last hit in it.
+*/
+const char Rewind_fileid[] = "Hatari rewind.c";
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include "main.h"
+#include "configuration.h"
+#include "cycles.h"
+#include "ikbd.h"
+#include "m68000.h"
+#include "memorySnapShot.h"
+#include "screen.h"
+#include "video.h"
+
+#include "breakcond.h"
+#include "debug_priv.h"
+#include "debugcpu.h"
+#include "debugui.h"
+#include "evaluate.h"
+#include "rewind.h"
+
+/* defaults for VBLs between snapshots, and how many are kept */
+#define REWIND_INTERVAL	25
+#define REWIND_COUNT	20
+#define REWIND_COUNT_MAX	1000
+
+typedef enum {
+	REWIND_RECORD,	/* normal emulation, take snapshots and log input */
+	REWIND_REPLAY,	/* replaying to target instruction */
+	REWIND_SEARCH	/* replaying to find last breakpoint hit */
+} rewind_mode_t;
+
+/* logged host input types */
+enum {
+	INPUT_KEY,	/* id: ST scancode, bit 7 set on release */
+	INPUT_MOUSE,	/* x, y: mouse movement */
+	INPUT_BUTTONS,	/* x: mouse button bits, see Rewind_GetButtons() */
+	INPUT_JOY	/* id: joystick, x: its data */
+};
+
+typedef struct {
+	Uint64 clock;	/* CyclesGlobalClockCounter at input */
+	Uint8 type;
+	Uint8 id;
+	Sint16 x, y;
+} rewind_input_t;
+
+typedef struct {
+	MEMSNAP_BUFFER buffer;
+	Uint64 position;	/* instruction count when taken */
+	Uint64 input;	/* input log position when taken */
+} rewind_snapshot_t;
+
+bool RewindEnabled;
+
+static struct {
+	rewind_snapshot_t *snapshot;	/* ring-buffer */
+	int count;	/* ring-buffer size */
+	int used;	/* how many snapshots it has */
+	int head;	/* newest snapshot */
+	int interval;	/* VBLs between snapshots */
+	int next_vbl;	/* when next snapshot is due */
+
+	Uint64 position;	/* instructions since rewind was enabled */
+	Uint64 clock;	/* clock at last counted instruction */
+	rewind_mode_t mode;
+	bool restoring;	/* snapshot restore requested, but not yet done */
+	int current;	/* age of snapshot being replayed, 0 = newest */
+	Uint64 target;	/* instruction where replay stops */
+	Uint64 search_end;	/* instruction where breakpoint search stops */
+	Uint64 last_hit;	/* last breakpoint hit found by search, or 0 */
+	debug_reason_t reason;	/* debugger entry reason at replay end */
+
+	rewind_input_t *input;	/* input log */
+	Uint64 input_first;	/* log position of input[0] */
+	Uint32 inputs;	/* items in log */
+	Uint32 alloc;	/* items allocated */
+	Uint64 replay;	/* log position of next input to replay */
+	bool injecting;	/* replayed key is being given to IKBD */
+	int joy[2];	/* last logged/replayed joystick data, -1 = none */
+
+	/* input state before host events were handled */
+	int mouse_dx, mouse_dy;
+	int buttons;
+} Rewind;
+
+
+/**
+ * Return snapshot of given age, 0 being the newest
+ */
+static rewind_snapshot_t *Rewind_Snapshot(int age)
+{
+	return &Rewind.snapshot[(Rewind.head - age + Rewind.count) % Rewind.count];
+}
+
+/**
+ * Return number of the instruction at current PC
+ */
+static Uint64 Rewind_CurrentPosition(void)
+{
+	/* debugger may have been entered after last counted instruction
+	 * was already executed, instead of from DebugCpu_Check()
+	 */
+	if (CyclesGlobalClockCounter != Rewind.clock)
+		return Rewind.position + 1;
+	return Rewind.position;
+}
+
+/**
+ * Return current rewind position, i.e. how many instructions have
+ * been executed since rewind was enabled
+ */
+Uint64 Rewind_GetPosition(void)
+{
+	return Rewind_CurrentPosition();
+}
+
+/* ------------------ input logging & replay ------------------ */
+
+/**
+ * Add given item to input log
+ */
+static void Rewind_LogInput(Uint8 type, Uint8 id, int x, int y)
+{
+	rewind_input_t *input;
+
+	if (Rewind.inputs == Rewind.alloc) {
+		Rewind.alloc = Rewind.alloc ? 2 * Rewind.alloc : 1024;
+		input = realloc(Rewind.input, Rewind.alloc * sizeof(*input));
+		if (!input) {
+			fprintf(stderr, "ERROR: out of memory for rewind input log, disabling rewind!\n");
+			Rewind_Enable(false, 0, 0);
+			return;
+		}
+		Rewind.input = input;
+	}
+	input = &Rewind.input[Rewind.inputs++];
+	input->clock = CyclesGlobalClockCounter;
+	input->type = type;
+	input->id = id;
+	input->x = x;
+	input->y = y;
+}
+
+/**
+ * Remove input log items before given log position
+ */
+static void Rewind_PruneInput(Uint64 pos)
+{
+	Uint32 count = pos - Rewind.input_first;
+
+	if (!count || count > Rewind.inputs) {
+		return;
+	}
+	Rewind.inputs -= count;
+	memmove(Rewind.input, Rewind.input + count, Rewind.inputs * sizeof(*Rewind.input));
+	Rewind.input_first = pos;
+}
+
+/**
+ * Return next input to replay, if it's due
+ */
+static rewind_input_t *Rewind_NextInput(void)
+{
+	rewind_input_t *input;
+
+	if (Rewind.replay >= Rewind.input_first + Rewind.inputs) {
+		return NULL;
+	}
+	input = &Rewind.input[Rewind.replay - Rewind.input_first];
+	if (input->clock > CyclesGlobalClockCounter) {
+		return NULL;
+	}
+	return input;
+}
+
+/**
+ * Return host mouse button state bits: 1 = left, 2 = right,
+ * 4 = left double click in progress
+ */
+static int Rewind_GetButtons(void)
+{
+	return (Keyboard.bLButtonDown & BUTTON_MOUSE ? 1 : 0)
+		| (Keyboard.bRButtonDown & BUTTON_MOUSE ? 2 : 0)
+		| (Keyboard.LButtonDblClk ? 4 : 0);
+}
+
+/**
+ * Set host mouse button state from Rewind_GetButtons() bits.
+ * Double click is started only if bit 4 is set and it wasn't
+ * already in progress.
+ */
+static void Rewind_SetButtons(int buttons)
+{
+	if (buttons & 1)
+		Keyboard.bLButtonDown |= BUTTON_MOUSE;
+	else
+		Keyboard.bLButtonDown &= ~BUTTON_MOUSE;
+	if (buttons & 2)
+		Keyboard.bRButtonDown |= BUTTON_MOUSE;
+	else
+		Keyboard.bRButtonDown &= ~BUTTON_MOUSE;
+	if ((buttons & 4) && !Keyboard.LButtonDblClk)
+		Keyboard.LButtonDblClk = 1;
+}
+
+/**
+ * Called before host events are given to the IKBD
+ */
+void Rewind_InputBegin(void)
+{
+	if (!RewindEnabled) {
+		return;
+	}
+	Rewind.mouse_dx = KeyboardProcessor.Mouse.dx;
+	Rewind.mouse_dy = KeyboardProcessor.Mouse.dy;
+	Rewind.buttons = Rewind_GetButtons();
+}
+
+/**
+ * Called after host events have been given to the IKBD.
+ * Log their effect, or when replaying, undo it and give
+ * the logged input instead.
+ */
+void Rewind_InputEnd(void)
+{
+	rewind_input_t *input;
+	int dx, dy, buttons;
+
+	if (!RewindEnabled) {
+		return;
+	}
+	dx = KeyboardProcessor.Mouse.dx - Rewind.mouse_dx;
+	dy = KeyboardProcessor.Mouse.dy - Rewind.mouse_dy;
+	buttons = Rewind_GetButtons();
+
+	if (Rewind.mode == REWIND_RECORD) {
+		if (dx || dy) {
+			Rewind_LogInput(INPUT_MOUSE, 0, dx, dy);
+		}
+		/* double click bit matters only when it gets set */
+		if ((buttons & 3) != (Rewind.buttons & 3) || (buttons & ~Rewind.buttons & 4)) {
+			Rewind_LogInput(INPUT_BUTTONS, 0, (buttons & 3) | (buttons & ~Rewind.buttons & 4), 0);
+		}
+		return;
+	}
+
+	/* replaying, ignore host input */
+	KeyboardProcessor.Mouse.dx = Rewind.mouse_dx;
+	KeyboardProcessor.Mouse.dy = Rewind.mouse_dy;
+	if (!(Rewind.buttons & 4)) {
+		Keyboard.LButtonDblClk = 0;
+	}
+	Rewind_SetButtons(Rewind.buttons);
+
+	/* joystick input at this clock is replayed when it's read */
+	while ((input = Rewind_NextInput())) {
+		switch (input->type) {
+		case INPUT_KEY:
+			Rewind.injecting = true;
+			IKBD_PressSTKey(input->id & 0x7f, !(input->id & 0x80));
+			Rewind.injecting = false;
+			break;
+		case INPUT_MOUSE:
+			KeyboardProcessor.Mouse.dx += input->x;
+			KeyboardProcessor.Mouse.dy += input->y;
+			break;
+		case INPUT_BUTTONS:
+			Rewind_SetButtons(input->x);
+			break;
+		case INPUT_JOY:
+			if (input->clock == CyclesGlobalClockCounter) {
+				return;
+			}
+			Rewind.joy[input->id] = input->x;
+			break;
+		}
+		Rewind.replay++;
+	}
+}
+
+/**
+ * Called for host key events. Return false if key should be ignored
+ * (host input while replaying).
+ */
+bool Rewind_InputKey(Uint8 ScanCode, bool bPress)
+{
+	if (Rewind.injecting) {
+		return true;
+	}
+	if (Rewind.mode != REWIND_RECORD) {
+		return false;
+	}
+	Rewind_LogInput(INPUT_KEY, ScanCode | (bPress ? 0 : 0x80), 0, 0);
+	return true;
+}
+
+/**
+ * Called when IKBD reads host joystick data.  Return data to use.
+ */
+Uint8 Rewind_InputJoy(int nStJoyId, Uint8 nData)
+{
+	rewind_input_t *input;
+
+	if (!RewindEnabled || nStJoyId < 0 || nStJoyId > 1) {
+		return nData;
+	}
+	if (Rewind.mode == REWIND_RECORD) {
+		if (nData != Rewind.joy[nStJoyId]) {
+			Rewind_LogInput(INPUT_JOY, nStJoyId, nData, 0);
+			Rewind.joy[nStJoyId] = nData;
+		}
+		return nData;
+	}
+	input = Rewind_NextInput();
+	if (input && input->type == INPUT_JOY && input->id == nStJoyId) {
+		Rewind.joy[nStJoyId] = input->x;
+		Rewind.replay++;
+	}
+	if (Rewind.joy[nStJoyId] < 0) {
+		return nData;
+	}
+	return Rewind.joy[nStJoyId];
+}
+
+/* ------------------ snapshots & replay ------------------ */
+
+/**
+ * Save/restore rewind state with in-memory snapshots
+ */
+void Rewind_MemorySnapShot_Capture(bool bSave)
+{
+	Uint64 input = Rewind.input_first + Rewind.inputs;
+
+	MemorySnapShot_Store(&Rewind.position, sizeof(Rewind.position));
+	MemorySnapShot_Store(&input, sizeof(input));
+	MemorySnapShot_Store(Rewind.joy, sizeof(Rewind.joy));
+	if (!bSave) {
+		Rewind.replay = input;
+		Rewind.clock = 0;
+		Rewind.restoring = false;
+	}
+}
+
+/**
+ * Take a new snapshot, replacing the oldest one if ring is full
+ */
+static void Rewind_Capture(void)
+{
+	rewind_snapshot_t *snap;
+
+	Rewind.next_vbl = nVBLs + Rewind.interval;
+	if (Rewind.used == Rewind.count) {
+		Rewind.used--;
+		/* input before the (new) oldest snapshot isn't needed */
+		if (Rewind.used) {
+			Rewind_PruneInput(Rewind_Snapshot(Rewind.used - 1)->input);
+		}
+	}
+	snap = &Rewind.snapshot[(Rewind.head + 1) % Rewind.count];
+	snap->position = Rewind.position;
+	snap->input = Rewind.input_first + Rewind.inputs;
+	if (!MemorySnapShot_CaptureBuffer(&snap->buffer)) {
+		return;
+	}
+	Rewind.head = (Rewind.head + 1) % Rewind.count;
+	Rewind.used++;
+}
+
+/**
+ * Request restoring snapshot of given age
+ */
+static void Rewind_Restore(int age)
+{
+	Rewind.current = age;
+	Rewind.restoring = true;
+	MemorySnapShot_RestoreBuffer(&Rewind_Snapshot(age)->buffer);
+}
+
+/**
+ * Replay reached its target, drop snapshots and input that came
+ * after it, and enter debugger
+ */
+static void Rewind_Stop(void)
+{
+	Rewind.mode = REWIND_RECORD;
+	while (Rewind.used && Rewind_Snapshot(0)->position >= Rewind.position) {
+		Rewind.head = (Rewind.head - 1 + Rewind.count) % Rewind.count;
+		Rewind.used--;
+	}
+	Rewind.inputs = Rewind.replay - Rewind.input_first;
+	Rewind.next_vbl = nVBLs + Rewind.interval;
+	Rewind.clock = CyclesGlobalClockCounter;
+
+	fprintf(stderr, "Rewound to instruction %"PRIu64".\n", Rewind.position);
+	DebugUI(Rewind.reason);
+}
+
+/**
+ * Breakpoint search reached end of the snapshot interval
+ */
+static void Rewind_SearchDone(void)
+{
+	rewind_snapshot_t *snap = Rewind_Snapshot(Rewind.current);
+
+	if (Rewind.last_hit) {
+		/* replay to the last hit */
+		Rewind.mode = REWIND_REPLAY;
+		Rewind.target = Rewind.last_hit;
+		Rewind.reason = REASON_CPU_BREAKPOINT;
+		Rewind_Restore(Rewind.current);
+	} else if (Rewind.current + 1 < Rewind.used) {
+		/* search previous interval */
+		Rewind.search_end = snap->position + 1;
+		Rewind_Restore(Rewind.current + 1);
+	} else {
+		fprintf(stderr, "No breakpoint hits in rewind history, going to its start.\n");
+		Rewind.mode = REWIND_REPLAY;
+		Rewind.target = snap->position + 1;
+		Rewind.reason = REASON_CPU_STEPS;
+		Rewind_Restore(Rewind.current);
+	}
+}
+
+/**
+ * Called by DebugCpu_Check() before each instruction when rewind
+ * is enabled.  Return true if instruction is being replayed, and
+ * rest of debugger checks should be skipped for it.
+ */
+bool Rewind_Check(void)
+{
+	if (unlikely(Rewind.restoring)) {
+		/* instructions before restore don't count */
+		return true;
+	}
+	switch (Rewind.mode) {
+	case REWIND_RECORD:
+		if (unlikely(nVBLs >= Rewind.next_vbl || nVBLs < Rewind.next_vbl - Rewind.interval)) {
+			Rewind_Capture();
+		}
+		Rewind.position++;
+		Rewind.clock = CyclesGlobalClockCounter;
+		return false;
+
+	case REWIND_REPLAY:
+		if (++Rewind.position >= Rewind.target) {
+			Rewind_Stop();
+		}
+		return true;
+
+	case REWIND_SEARCH:
+		if (++Rewind.position >= Rewind.search_end) {
+			Rewind_SearchDone();
+		} else if (BreakCond_PeekCpu()) {
+			Rewind.last_hit = Rewind.position;
+		}
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Return true while emulation is being replayed, or instructions
+ * before a requested snapshot restore are being run
+ */
+bool Rewind_Replaying(void)
+{
+	return Rewind.restoring || Rewind.mode != REWIND_RECORD;
+}
+
+/**
+ * Return age of newest snapshot before given instruction, or -1
+ */
+static int Rewind_FindSnapshot(Uint64 position)
+{
+	int age;
+
+	for (age = 0; age < Rewind.used; age++) {
+		if (Rewind_Snapshot(age)->position < position) {
+			return age;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Step back given number of instructions.  Stepping happens when
+ * emulation is continued.  Return false if that's not possible.
+ */
+bool Rewind_StepBack(Uint32 count)
+{
+	Uint64 current = Rewind_CurrentPosition();
+	int age;
+
+	if (!RewindEnabled || Rewind.mode != REWIND_RECORD || Rewind.restoring) {
+		fprintf(stderr, "ERROR: rewind isn't enabled, or it's already in progress!\n");
+		return false;
+	}
+	age = count < current ? Rewind_FindSnapshot(current - count) : -1;
+	if (age < 0) {
+		fprintf(stderr, "ERROR: can't rewind %u instructions, rewind history has only %"PRIu64".\n",
+			count, Rewind.used ? current - Rewind_Snapshot(Rewind.used - 1)->position - 1 : 0);
+		return false;
+	}
+	Rewind.mode = REWIND_REPLAY;
+	Rewind.target = current - count;
+	Rewind.reason = REASON_CPU_STEPS;
+	Rewind_Restore(age);
+	return true;
+}
+
+/**
+ * Run back to the last instruction where a CPU breakpoint was hit.
+ * Search happens when emulation is continued.  Return false if
+ * that's not possible.
+ */
+bool Rewind_RunBack(void)
+{
+	Uint64 current = Rewind_CurrentPosition();
+	int age;
+
+	if (!RewindEnabled || Rewind.mode != REWIND_RECORD || Rewind.restoring) {
+		fprintf(stderr, "ERROR: rewind isn't enabled, or it's already in progress!\n");
+		return false;
+	}
+	age = Rewind_FindSnapshot(current - 1);
+	if (age < 0) {
+		fprintf(stderr, "ERROR: no rewind history to search breakpoints from!\n");
+		return false;
+	}
+	Rewind.mode = REWIND_SEARCH;
+	Rewind.search_end = current;
+	Rewind.last_hit = 0;
+	Rewind_Restore(age);
+	return true;
+}
+
+/**
+ * Enable or disable rewind.  Interval is VBLs between snapshots,
+ * count how many of them are kept.  Zero values use defaults.
+ * Return false on error.
+ */
+bool Rewind_Enable(bool enable, int interval, int count)
+{
+	int i;
+
+	if (Rewind.snapshot) {
+		for (i = 0; i < Rewind.count; i++) {
+			MemorySnapShot_FreeBuffer(&Rewind.snapshot[i].buffer);
+		}
+		free(Rewind.snapshot);
+	}
+	free(Rewind.input);
+	memset(&Rewind, 0, sizeof(Rewind));
+	RewindEnabled = false;
+	MemorySnapShot_SharePages(false);
+
+	if (!enable) {
+		return true;
+	}
+	if (count <= 0) {
+		count = REWIND_COUNT;
+	}
+	if (interval <= 0) {
+		interval = REWIND_INTERVAL;
+	}
+	if (count > REWIND_COUNT_MAX) {
+		fprintf(stderr, "ERROR: max rewind snapshot count is %d!\n", REWIND_COUNT_MAX);
+		return false;
+	}
+	Rewind.snapshot = calloc(count, sizeof(*Rewind.snapshot));
+	if (!Rewind.snapshot) {
+		return false;
+	}
+	Rewind.count = count;
+	Rewind.head = count - 1;
+	Rewind.interval = interval;
+	Rewind.next_vbl = nVBLs;
+	Rewind.joy[0] = Rewind.joy[1] = -1;
+	RewindEnabled = true;
+
+	/* snapshots share ST RAM pages not written between them */
+	MemorySnapShot_SharePages(true);
+
+	/* instructions need to be counted */
+	M68000_SetDebugger(true);
+	return true;
+}
+
+/* ------------------ debugger command ------------------ */
+
+const char Rewind_Description[] =
+	"[on [<interval> [<count>]] | off | back [<count>] | break]\n"
+	"\tWithout arguments, show rewind state.  'on' enables rewind:\n"
+	"\temulation state is saved to memory every <interval> VBLs\n"
+	"\t(default 25), and <count> last ones are kept (default 20),\n"
+	"\talong with host keyboard, mouse and joystick input since them.\n"
+	"\t'back' steps back given number of instructions (default 1),\n"
+	"\tand 'break' runs back to the last CPU breakpoint hit.  Both\n"
+	"\treplay emulation from a saved state, and leave the debugger.";
+
+/**
+ * Handle debugger 'rewind' command and its arguments
+ */
+int Rewind_Command(int nArgc, char *psArgs[])
+{
+	Uint32 count = 1;
+
+	if (nArgc < 2) {
+		if (!RewindEnabled) {
+			fprintf(stderr, "Rewind is disabled.\n");
+			return DEBUGGER_CMDDONE;
+		}
+		fprintf(stderr, "Rewind at instruction %"PRIu64", %d/%d snapshots (every %d VBLs)",
+			Rewind_CurrentPosition(), Rewind.used, Rewind.count, Rewind.interval);
+		if (Rewind.used) {
+			fprintf(stderr, ", oldest at instruction %"PRIu64,
+				Rewind_Snapshot(Rewind.used - 1)->position + 1);
+		}
+		fprintf(stderr, ", %u input events, %u KB of RAM pages.\n",
+			Rewind.inputs, MemorySnapShot_PagesSize());
+		return DEBUGGER_CMDDONE;
+	}
+	if (strcmp(psArgs[1], "on") == 0) {
+		if (Rewind_Enable(true, nArgc > 2 ? atoi(psArgs[2]) : 0,
+				  nArgc > 3 ? atoi(psArgs[3]) : 0)) {
+			fprintf(stderr, "Rewind enabled, %d snapshots every %d VBLs.\n",
+				Rewind.count, Rewind.interval);
+		}
+		return DEBUGGER_CMDDONE;
+	}
+	if (strcmp(psArgs[1], "off") == 0) {
+		Rewind_Enable(false, 0, 0);
+		fprintf(stderr, "Rewind disabled.\n");
+		return DEBUGGER_CMDDONE;
+	}
+	if (strcmp(psArgs[1], "back") == 0) {
+		if (nArgc > 2 && !Eval_Number(psArgs[2], &count)) {
+			return DEBUGGER_CMDDONE;
+		}
+		return Rewind_StepBack(count) ? DEBUGGER_END : DEBUGGER_CMDDONE;
+	}
+	if (strcmp(psArgs[1], "break") == 0) {
+		return Rewind_RunBack() ? DEBUGGER_END : DEBUGGER_CMDDONE;
+	}
+	return DebugUI_PrintCmdHelp(psArgs[0]);
+}
@@ -0,0 +1,41 @@
+/*
+  Hatari - rewind.h
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+*/
+
+#ifndef HATARI_REWIND_H
+#define HATARI_REWIND_H
+
+extern bool RewindEnabled;
+
+static inline bool Rewind_Enabled(void)
+{
+	return RewindEnabled;
+}
+
+/* for debugcpu.c */
+extern const char Rewind_Description[];
+extern int Rewind_Command(int nArgc, char *psArgs[]);
+extern bool Rewind_Check(void);
+
+/* for watchpoint.c */
+extern bool Rewind_Replaying(void);
+
+/* for remotedebug.c */
+extern bool Rewind_Enable(bool enable, int interval, int count);
+extern bool Rewind_StepBack(Uint32 count);
+extern bool Rewind_RunBack(void);
+extern Uint64 Rewind_GetPosition(void);
+
+/* for debugui.c */
+extern void Rewind_MemorySnapShot_Capture(bool bSave);
+
+/* for ikbd.c */
+extern void Rewind_InputBegin(void);
+extern void Rewind_InputEnd(void);
+extern bool Rewind_InputKey(Uint8 ScanCode, bool bPress);
+extern Uint8 Rewind_InputJoy(int nStJoyId, Uint8 nData);
+
+#endif
@@ -0,0 +1,269 @@
+/*
+  Hatari - watchpoint.c
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+
+  watchpoint.c - memory access watchpoints.  The 64 KB memory banks
+  containing watched addresses are swapped in cpu/memory.c for banks
+  whose access functions call Watchpoint_Check(), so accesses to other
+  banks run at full speed.  As DMA and blitter go through the same
+  banks, their accesses are caught too.  FDC/ACSI DMA and other
+  transfers writing with STMemory_SafeCopy() / STMemory_SafeClear()
+  bypass the banks, so those call Watchpoint_Check() directly.
+  Accesses done while rewind replays emulation were already seen when
+  they were first done, so they're ignored.
+*/
+const char Watchpoint_fileid[] = "Hatari watchpoint.c";
+
+#include <stdlib.h>
+#include "main.h"
+#include "configuration.h"
+#include "m68000.h"
+#include "memory.h"
+
+#include "debug_priv.h"
+#include "debugui.h"
+#include "evaluate.h"
+#include "history.h"
+#include "rewind.h"
+#include "watchpoint.h"
+
+#define MAX_WATCHPOINTS 16
+/* max number of watched 64 KB memory banks */
+#define MAX_WATCHED_BANKS 32
+
+typedef struct {
+	Uint32 start;
+	Uint32 end;	/* exclusive */
+	int mode;	/* WATCH_READ | WATCH_WRITE */
+	int hits;
+} watchpoint_t;
+
+static watchpoint_t Watchpoints[MAX_WATCHPOINTS];
+static int nWatchpoints;
+
+/* first hit since last check, shown when debugger is entered */
+static struct {
+	bool pending;
+	int index;
+	int mode;
+	int size;
+	Uint32 addr;
+} WatchHit;
+
+
+/**
+ * Return watchpoint address mask for current address space
+ */
+static Uint32 Watchpoint_AddrMask(void)
+{
+	if (ConfigureParams.System.bAddressSpace24)
+		return 0x00FFFFFF;
+	return 0xFFFFFFFF;
+}
+
+/**
+ * Tell memory.c which banks need to be watched after watchpoints change
+ */
+static void Watchpoint_UpdateBanks(void)
+{
+	Uint32 banks[MAX_WATCHED_BANKS];
+	Uint32 bank, last;
+	int i, j, count = 0;
+
+	for (i = 0; i < nWatchpoints; i++) {
+		last = (Watchpoints[i].end - 1) >> 16;
+		for (bank = Watchpoints[i].start >> 16; bank <= last; bank++) {
+			for (j = 0; j < count; j++) {
+				if (banks[j] == bank)
+					break;
+			}
+			if (j < count)
+				continue;
+			if (count == MAX_WATCHED_BANKS) {
+				fprintf(stderr, "WARNING: too many memory banks to watch, watching only %d!\n", count);
+				break;
+			}
+			banks[count++] = bank;
+		}
+	}
+	memory_set_watched_banks(banks, count);
+}
+
+/**
+ * Called by the watched banks on every access within them
+ */
+void Watchpoint_Check(Uint32 addr, int size, int mode)
+{
+	watchpoint_t *wp = Watchpoints;
+	int i;
+
+	if (unlikely(Rewind_Enabled()) && Rewind_Replaying())
+		return;
+
+	for (i = 0; i < nWatchpoints; wp++, i++) {
+		if (!(wp->mode & mode) || addr >= wp->end || addr + size <= wp->start)
+			continue;
+
+		wp->hits++;
+		if (!WatchHit.pending) {
+			WatchHit.pending = true;
+			WatchHit.index = i;
+			WatchHit.mode = mode;
+			WatchHit.size = size;
+			WatchHit.addr = addr;
+			/* get DebugCpu_Check() called after current instruction */
+			M68000_SetDebugger(true);
+		}
+	}
+}
+
+/**
+ * If a watchpoint was hit, show it and return true
+ */
+bool Watchpoint_CheckHit(void)
+{
+	watchpoint_t *wp;
+
+	if (likely(!WatchHit.pending))
+		return false;
+
+	WatchHit.pending = false;
+	/* watchpoint may have been removed meanwhile */
+	if (WatchHit.index >= nWatchpoints)
+		return false;
+
+	wp = &Watchpoints[WatchHit.index];
+	fprintf(stderr, "%d. watchpoint $%x-$%x hit %d times, %d byte %s at $%x.\n",
+		WatchHit.index + 1, wp->start, wp->end, wp->hits, WatchHit.size,
+		WatchHit.mode == WATCH_READ ? "read" : "write", WatchHit.addr);
+	History_Mark(REASON_CPU_WATCHPOINT);
+	return true;
+}
+
+/**
+ * List watchpoints
+ */
+static void Watchpoint_List(void)
+{
+	watchpoint_t *wp = Watchpoints;
+	int i;
+
+	if (!nWatchpoints) {
+		fprintf(stderr, "No watchpoints.\n");
+		return;
+	}
+	fprintf(stderr, "%d watchpoints:\n", nWatchpoints);
+	for (i = 0; i < nWatchpoints; wp++, i++) {
+		fprintf(stderr, "%4d: $%x-$%x %s%s, %d hits\n", i + 1, wp->start, wp->end,
+			wp->mode & WATCH_READ ? "r" : "", wp->mode & WATCH_WRITE ? "w" : "",
+			wp->hits);
+	}
+}
+
+/**
+ * Remove watchpoint at given position, starting from 1
+ */
+static bool Watchpoint_Remove(int position)
+{
+	if (position < 1 || position > nWatchpoints) {
+		fprintf(stderr, "ERROR: No such watchpoint.\n");
+		return false;
+	}
+	if (position < nWatchpoints) {
+		memmove(&Watchpoints[position - 1], &Watchpoints[position],
+			(nWatchpoints - position) * sizeof(watchpoint_t));
+	}
+	nWatchpoints--;
+	WatchHit.pending = false;
+	return true;
+}
+
+const char Watchpoint_Description[] =
+	"[<address>[-<end address>] [r|w|rw] | del <index> | all]\n"
+	"\tWithout arguments, list watchpoints.  With an address (range),\n"
+	"\tbreak when the emulated CPU, blitter or DMA sound reads (r)\n"
+	"\tand/or writes (w) memory within it, or FDC/ACSI DMA writes to\n"
+	"\tit (their reads aren't caught).  Default is to watch writes, and\n"
+	"\tthe end address isn't included in the range.  Watching costs\n"
+	"\tonly for accesses within the watched 64KB memory blocks.\n"
+	"\t'del' removes watchpoint with given index, 'all' removes all.";
+
+/**
+ * Handle debugger 'watch' command and its arguments
+ */
+int Watchpoint_Command(int nArgc, char *psArgs[])
+{
+	watchpoint_t *wp;
+	Uint32 lower, upper, mask;
+	int mode;
+
+	if (nArgc < 2) {
+		Watchpoint_List();
+		return DEBUGGER_CMDDONE;
+	}
+	if (strcmp(psArgs[1], "all") == 0) {
+		nWatchpoints = 0;
+		WatchHit.pending = false;
+		Watchpoint_UpdateBanks();
+		fprintf(stderr, "Watchpoints: 0\n");
+		return DEBUGGER_CMDDONE;
+	}
+	if (strcmp(psArgs[1], "del") == 0) {
+		if (nArgc != 3) {
+			DebugUI_PrintCmdHelp(psArgs[0]);
+			return DEBUGGER_CMDDONE;
+		}
+		if (Watchpoint_Remove(atoi(psArgs[2]))) {
+			Watchpoint_UpdateBanks();
+		}
+		return DEBUGGER_CMDDONE;
+	}
+
+	mode = WATCH_WRITE;
+	if (nArgc > 2) {
+		if (strcmp(psArgs[2], "r") == 0) {
+			mode = WATCH_READ;
+		} else if (strcmp(psArgs[2], "w") == 0) {
+			mode = WATCH_WRITE;
+		} else if (strcmp(psArgs[2], "rw") == 0) {
+			mode = WATCH_READ | WATCH_WRITE;
+		} else {
+			DebugUI_PrintCmdHelp(psArgs[0]);
+			return DEBUGGER_CMDDONE;
+		}
+	}
+	switch (Eval_Range(psArgs[1], &lower, &upper, false)) {
+	case -1:
+		/* invalid value(s) */
+		return DEBUGGER_CMDDONE;
+	case 0:
+		/* single byte */
+		upper = lower + 1;
+		break;
+	case 1:
+		if (upper == lower) {
+			upper = lower + 1;
+		}
+		break;
+	}
+	mask = Watchpoint_AddrMask();
+	if (lower > mask || upper - 1 > mask) {
+		fprintf(stderr, "ERROR: range $%x-$%x is outside of address space!\n", lower, upper);
+		return DEBUGGER_CMDDONE;
+	}
+	if (nWatchpoints == MAX_WATCHPOINTS) {
+		fprintf(stderr, "ERROR: no free watchpoints, max is %d!\n", MAX_WATCHPOINTS);
+		return DEBUGGER_CMDDONE;
+	}
+	wp = &Watchpoints[nWatchpoints++];
+	wp->start = lower;
+	wp->end = upper;
+	wp->mode = mode;
+	wp->hits = 0;
+	Watchpoint_UpdateBanks();
+
+	fprintf(stderr, "Watchpoint %d added for $%x-$%x.\n", nWatchpoints, lower, upper);
+	return DEBUGGER_CMDDONE;
+}
@@ -0,0 +1,23 @@
+/*
+  Hatari - watchpoint.h
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+*/
+
+#ifndef HATARI_WATCHPOINT_H
+#define HATARI_WATCHPOINT_H
+
+/* access types to watch */
+#define WATCH_READ	1
+#define WATCH_WRITE	2
+
+/* for debugcpu.c */
+extern const char Watchpoint_Description[];
+extern int Watchpoint_Command(int nArgc, char *psArgs[]);
+extern bool Watchpoint_CheckHit(void);
+
+/* for the watched banks in cpu/memory.c */
+extern void Watchpoint_Check(Uint32 addr, int size, int mode);
+
+#endif
@@ -33,6 +33,7 @@
 #include "cycles.h"
 #include "cycInt.h"
 #include "m68000.h"
+#include "perftimer.h"
 
 #if ENABLE_DSP_EMU
 #include "debugdsp.h"
@@ -247,6 +248,7 @@ void DSP_Run(int nHostCycles)
 	if (save_cycles <= 0)
 		return;
 
+	PerfTimer_Begin(PERF_TIMER_DSP);
 	if (unlikely(bDspDebugging))
 	{
 		while (save_cycles > 0)
@@ -265,6 +267,7 @@ void DSP_Run(int nHostCycles)
 			save_cycles -= dsp_core.instr_cycle;
 		}
 	}
+	PerfTimer_End();
 
 #endif
 }
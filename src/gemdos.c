@@ -30,6 +30,9 @@ const char Gemdos_fileid[] = "Hatari gemdos.c";
 #include <sys/statvfs.h>
 #endif
 #include <sys/types.h>
+#if HAVE_FSTATAT
+#include <fcntl.h>
+#endif
 #if HAVE_UTIME_H
 #include <utime.h>
 #elif HAVE_SYS_UTIME_H
@@ -40,6 +43,9 @@ const char Gemdos_fileid[] = "Hatari gemdos.c";
 #include <unistd.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <SDL_atomic.h>
+#include <SDL_thread.h>
+#include <SDL_timer.h>
 
 #include "main.h"
 #include "cart.h"
@@ -140,16 +146,70 @@ typedef struct
 	char szActualName[MAX_GEMDOS_PATH];        /* used by F_DATIME (0x57) */
 } FILE_HANDLE;
 
+/* DTA_STAT states */
+enum {
+	DTA_STAT_NONE,
+	DTA_STAT_BUSY,
+	DTA_STAT_DONE
+};
+
+/* stat() results for Fsfirst() matches */
+typedef struct
+{
+	SDL_atomic_t state;                 /* DTA_STAT_* */
+	int err;                            /* errno if stat() failed */
+	mode_t mode;
+	off_t size;
+	time_t mtime;
+} DTA_STAT;
+
 typedef struct
 {
 	bool bUsed;
 	Uint32 addr;                        /* ST-RAM DTA address for matching reused entries */
 	int  nentries;                      /* number of entries in fs directory */
 	int  centry;                        /* current entry # */
-	struct dirent **found;              /* legal files */
+	char **found;                       /* legal files */
+	DTA_STAT *stats;                    /* their stat() results */
 	char path[MAX_GEMDOS_PATH];                /* sfirst path */
 } INTERNAL_DTA;
 
+/* Fsfirst() matches are stat()ed in advance by a worker thread
+ * when there are more of them than this
+ */
+#define DTA_STAT_THREAD_MIN 16
+
+static struct {
+	SDL_Thread *thread;
+	SDL_atomic_t cancel;
+	char *path;
+	char **names;
+	DTA_STAT *stats;
+	int count;
+} StatWorker;
+
+/* Host directory contents cache, to avoid reading whole host directory
+ * for every path component of every GEMDOS file name being matched
+ */
+#define DIRCACHE_DIRS 16
+
+typedef struct
+{
+	char *path;                         /* host dir path, NULL if unused */
+	time_t mtime;                       /* dir modification time... */
+	time_t scantime;                    /* ...and when it was read */
+	Uint32 lastuse;                     /* for replacing least recently used */
+	int count;                          /* number of entries */
+	char **names;                       /* host names, in alphasort() order */
+	char **folded;                      /* names upper-cased for matching */
+	int *hashhead;                      /* first entry for each folded name hash */
+	int *hashnext;                      /* next entry with same hash, or -1 */
+	Uint32 hashmask;
+} DIR_CACHE;
+
+static DIR_CACHE DirCache[DIRCACHE_DIRS];
+static Uint32 DirCacheUse;
+
 static FILE_HANDLE  FileHandles[MAX_FILE_HANDLES];
 static INTERNAL_DTA *InternalDTAs;
 static int DTACount;        /* Current DTA cache size */
@@ -295,29 +355,140 @@ static Uint8 GemDOS_ConvertAttribute(mode_t mode)
 
 /*-----------------------------------------------------------------------*/
 /**
- * Populate the DTA buffer with file info.
- * @return   DTA_OK if entry is ok, DTA_SKIP if it should be skipped, DTA_ERR on errors
+ * stat() given file in given directory (file descriptor, if >= 0)
+ * into given DTA_STAT, unless another thread already claimed it.
  */
-static dta_ret_t PopulateDTA(char *path, struct dirent *file, DTA *pDTA, Uint32 DTA_Gemdos)
+static void GemDOS_StatEntry(DTA_STAT *ds, int dirfd, const char *path, const char *name)
 {
-	/* TODO: host file path can be longer than MAX_GEMDOS_PATH */
 	char tempstr[MAX_GEMDOS_PATH];
 	struct stat filestat;
+	int ret;
+
+	if (!SDL_AtomicCAS(&ds->state, DTA_STAT_NONE, DTA_STAT_BUSY))
+		return;
+
+#if HAVE_FSTATAT
+	if (dirfd >= 0)
+		ret = fstatat(dirfd, name, &filestat, 0);
+	else
+#endif
+	{
+		ret = snprintf(tempstr, sizeof(tempstr), "%s%c%s", path, PATHSEP, name);
+		if (ret < 0 || ret >= (int)sizeof(tempstr))
+		{
+			/* don't stat() a truncated path */
+			ret = -1;
+			errno = ENAMETOOLONG;
+		}
+		else
+			ret = stat(tempstr, &filestat);
+	}
+	if (ret == 0)
+	{
+		ds->err = 0;
+		ds->mode = filestat.st_mode;
+		ds->size = filestat.st_size;
+		ds->mtime = filestat.st_mtime;
+	}
+	else
+	{
+		ds->err = errno;
+	}
+	SDL_AtomicSet(&ds->state, DTA_STAT_DONE);
+}
+
+/**
+ * Worker thread stat()ing all Fsfirst() matches in advance,
+ * so that Fsnext() doesn't need to wait for host file system.
+ */
+static int GemDOS_StatWorker(void *data)
+{
+	int i, dirfd = -1;
+
+#if HAVE_FSTATAT
+	dirfd = open(StatWorker.path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+#endif
+	for (i = 0; i < StatWorker.count; i++)
+	{
+		if (SDL_AtomicGet(&StatWorker.cancel))
+			break;
+		GemDOS_StatEntry(&StatWorker.stats[i], dirfd, StatWorker.path, StatWorker.names[i]);
+	}
+	if (dirfd >= 0)
+		close(dirfd);
+	return 0;
+}
+
+/**
+ * Stop stat() worker thread, if it's running
+ */
+static void GemDOS_StopStatWorker(void)
+{
+	if (!StatWorker.thread)
+		return;
+	SDL_AtomicSet(&StatWorker.cancel, 1);
+	SDL_WaitThread(StatWorker.thread, NULL);
+	StatWorker.thread = NULL;
+	StatWorker.stats = NULL;
+	free(StatWorker.path);
+	StatWorker.path = NULL;
+}
+
+/**
+ * Start stat() worker thread for given DTA entries.  There's at most
+ * one worker, any remaining entries of an earlier one are stat()ed
+ * on demand by Fsnext().
+ */
+static void GemDOS_StartStatWorker(INTERNAL_DTA *pIntDTA)
+{
+	GemDOS_StopStatWorker();
+
+	StatWorker.path = strdup(pIntDTA->path);
+	if (!StatWorker.path)
+		return;
+	StatWorker.names = pIntDTA->found;
+	StatWorker.stats = pIntDTA->stats;
+	StatWorker.count = pIntDTA->nentries;
+	SDL_AtomicSet(&StatWorker.cancel, 0);
+	StatWorker.thread = SDL_CreateThread(GemDOS_StatWorker, "GemDOS_Stat", NULL);
+	if (!StatWorker.thread)
+	{
+		StatWorker.stats = NULL;
+		free(StatWorker.path);
+		StatWorker.path = NULL;
+	}
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Populate the DTA buffer with info of given file, stat()ing it
+ * unless the worker thread has already done that.
+ * @return   DTA_OK if entry is ok, DTA_SKIP if it should be skipped, DTA_ERR on errors
+ */
+static dta_ret_t PopulateDTA(const char *path, const char *name, DTA_STAT *ds,
+                             DTA *pDTA, Uint32 DTA_Gemdos)
+{
 	DATETIME DateTime;
 	int nFileAttr, nAttrMask;
 
-	if (snprintf(tempstr, sizeof(tempstr), "%s%c%s",
-	             path, PATHSEP, file->d_name) >= (int)sizeof(tempstr))
+	/* TODO: host file path can be longer than MAX_GEMDOS_PATH */
+	if (strlen(path) + 1 + strlen(name) >= MAX_GEMDOS_PATH)
 	{
 		Log_Printf(LOG_ERROR, "PopulateDTA: path is too long.\n");
 		return DTA_ERR;
 	}
 
-	if (stat(tempstr, &filestat) != 0)
+	GemDOS_StatEntry(ds, -1, path, name);
+	/* wait if worker thread is just doing it */
+	while (SDL_AtomicGet(&ds->state) != DTA_STAT_DONE)
+		SDL_Delay(0);
+
+	if (ds->err)
 	{
 		/* skip file if it doesn't exist, otherwise return an error */
-		dta_ret_t ret = (errno == ENOENT ? DTA_SKIP : DTA_ERR);
-		perror(tempstr);
+		dta_ret_t ret = (ds->err == ENOENT ? DTA_SKIP : DTA_ERR);
+		Log_Printf(LOG_WARN, "%s%c%s: %s\n", path, PATHSEP, name, strerror(ds->err));
 		return ret;
 	}
 
@@ -325,23 +496,26 @@ static dta_ret_t PopulateDTA(char *path, struct dirent *file, DTA *pDTA, Uint32
 		return DTA_ERR;   /* no DTA pointer set */
 
 	/* Check file attributes (check is done according to the Profibuch) */
-	nFileAttr = GemDOS_ConvertAttribute(filestat.st_mode);
+	nFileAttr = GemDOS_ConvertAttribute(ds->mode);
 	nAttrMask = nAttrSFirst|GEMDOS_FILE_ATTRIB_WRITECLOSE|GEMDOS_FILE_ATTRIB_READONLY;
 	if (nFileAttr != 0 && !(nAttrMask & nFileAttr))
 		return DTA_SKIP;
 
-	GemDOS_DateTime2Tos(filestat.st_mtime, &DateTime, tempstr);
+	GemDOS_DateTime2Tos(ds->mtime, &DateTime, name);
 
-	/* Atari memory modified directly through pDTA members -> flush the data cache */
+	/* Atari memory modified directly through pDTA members -> flush the data
+	 * cache, and mark it written for dirty page tracking
+	 */
 	M68000_Flush_Data_Cache(DTA_Gemdos, sizeof(DTA));
+	STMemory_DirtyPages_MarkPointer(pDTA, sizeof(DTA));
 
 	/* convert to atari-style uppercase */
-	Str_Filename2TOSname(file->d_name, pDTA->dta_name);
+	Str_Filename2TOSname(name, pDTA->dta_name);
 #if DEBUG_PATTERN_MATCH
 	fprintf(stderr, "DEBUG: GEMDOS: host: %s -> GEMDOS: %s\n",
-		file->d_name, pDTA->dta_name);
+		name, pDTA->dta_name);
 #endif
-	do_put_mem_long(pDTA->dta_size, filestat.st_size);
+	do_put_mem_long(pDTA->dta_size, ds->size);
 	do_put_mem_word(pDTA->dta_time, DateTime.timeword);
 	do_put_mem_word(pDTA->dta_date, DateTime.dateword);
 	pDTA->dta_attrib = nFileAttr;
@@ -358,6 +532,11 @@ static void ClearInternalDTA(int idx)
 {
 	int i;
 
+	if (StatWorker.stats && StatWorker.stats == InternalDTAs[idx].stats)
+		GemDOS_StopStatWorker();
+	free(InternalDTAs[idx].stats);
+	InternalDTAs[idx].stats = NULL;
+
 	/* clear the old DTA structure */
 	if (InternalDTAs[idx].found != NULL)
 	{
@@ -480,6 +659,232 @@ static const char* fsfirst_dirmask(const char *string)
 		return string;
 }
 
+/*-----------------------------------------------------------------------*/
+/**
+ * Return length of given host directory path without trailing separators
+ */
+static int dircache_pathlen(const char *path)
+{
+	int len = strlen(path);
+
+	while (len > 1 && path[len-1] == PATHSEP)
+		len--;
+	return len;
+}
+
+/**
+ * Hash given case-folded name
+ */
+static Uint32 dircache_hash(const char *name)
+{
+	Uint32 hash = 2166136261u;
+
+	while (*name)
+		hash = (hash ^ (Uint8)*name++) * 16777619u;
+	return hash;
+}
+
+/**
+ * Free given directory cache entry contents
+ */
+static void dircache_free(DIR_CACHE *dc)
+{
+	int i;
+
+	for (i = 0; i < dc->count; i++)
+	{
+		free(dc->names[i]);
+		free(dc->folded[i]);
+	}
+	free(dc->names);
+	free(dc->folded);
+	free(dc->hashnext);
+	free(dc->path);
+	memset(dc, 0, sizeof(*dc));
+}
+
+/**
+ * Drop all cached directories
+ */
+static void dircache_clear(void)
+{
+	int i;
+
+	for (i = 0; i < DIRCACHE_DIRS; i++)
+		dircache_free(&DirCache[i]);
+	DirCacheUse = 0;
+}
+
+/**
+ * Drop cached directory containing given host file or directory,
+ * called when Hatari itself modifies that directory.
+ */
+static void dircache_invalidate(const char *filepath)
+{
+	int i, len;
+
+	len = dircache_pathlen(filepath);
+	while (len > 0 && filepath[len-1] != PATHSEP)
+		len--;
+	if (!len)
+		return;
+	/* parent directory, or root */
+	if (len > 1)
+		len--;
+
+	for (i = 0; i < DIRCACHE_DIRS; i++)
+	{
+		if (DirCache[i].path && dircache_pathlen(DirCache[i].path) == len
+		    && strncmp(DirCache[i].path, filepath, len) == 0)
+			dircache_free(&DirCache[i]);
+	}
+}
+
+/**
+ * Read given host directory into given cache entry.
+ * Return false on failure.
+ */
+static bool dircache_scan(DIR_CACHE *dc, const char *path, int pathlen, time_t mtime)
+{
+	struct dirent **files;
+	Uint32 hash;
+	int i, count, size;
+	char *s;
+
+	/* directory could be modified during the scan within the same
+	 * second as its mtime, so get time before reading it
+	 */
+	dc->scantime = time(NULL);
+	count = scandir(path, &files, 0, alphasort);
+	if (count < 0)
+		return false;
+
+	dc->path = malloc(pathlen + 1);
+	dc->names = malloc(count * sizeof(char *) + 1);
+	dc->folded = malloc(count * sizeof(char *) + 1);
+	for (size = 1; size < count; size <<= 1);
+	dc->hashmask = size - 1;
+	dc->hashnext = malloc((size + count) * sizeof(int));
+	if (!(dc->path && dc->names && dc->folded && dc->hashnext))
+	{
+		for (i = 0; i < count; i++)
+			free(files[i]);
+		free(files);
+		dircache_free(dc);
+		return false;
+	}
+	memcpy(dc->path, path, pathlen);
+	dc->path[pathlen] = '\0';
+	dc->mtime = mtime;
+	dc->hashhead = dc->hashnext + count;
+	for (i = 0; i < size; i++)
+		dc->hashhead[i] = -1;
+
+	for (i = 0; i < count; i++)
+	{
+		char *d_name = files[i]->d_name;
+		Str_DecomposedToPrecomposedUtf8(d_name, d_name);   /* for OSX */
+		dc->names[i] = strdup(d_name);
+		/* case-fold same way as strcasecmp() */
+		for (s = d_name; *s; s++)
+			*s = toupper((unsigned char)*s);
+		dc->folded[i] = strdup(d_name);
+		free(files[i]);
+	}
+	free(files);
+	dc->count = count;
+
+	/* hash chains list entries in their (sorted) directory order */
+	for (i = count - 1; i >= 0; i--)
+	{
+		if (!(dc->names[i] && dc->folded[i]))
+		{
+			dircache_free(dc);
+			return false;
+		}
+		hash = dircache_hash(dc->folded[i]) & dc->hashmask;
+		dc->hashnext[i] = dc->hashhead[hash];
+		dc->hashhead[hash] = i;
+	}
+	return true;
+}
+
+/**
+ * Return cached contents of given host directory, (re-)reading it
+ * if it's not cached or has been modified since.  Return NULL if
+ * directory can't be read.
+ */
+static DIR_CACHE *dircache_get(const char *path)
+{
+	DIR_CACHE *dc, *oldest;
+	struct stat st;
+	int i, len;
+
+	len = dircache_pathlen(path);
+	oldest = dc = NULL;
+	for (i = 0; i < DIRCACHE_DIRS; i++)
+	{
+		if (DirCache[i].path && strncmp(DirCache[i].path, path, len) == 0
+		    && DirCache[i].path[len] == '\0')
+		{
+			dc = &DirCache[i];
+			break;
+		}
+		if (!oldest || DirCache[i].lastuse < oldest->lastuse)
+			oldest = &DirCache[i];
+	}
+
+	if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode))
+	{
+		if (dc)
+			dircache_free(dc);
+		return NULL;
+	}
+
+	if (dc)
+	{
+		/* mtime has only second granularity, so contents read
+		 * within the same second as mtime can't be trusted
+		 */
+		if (st.st_mtime == dc->mtime && dc->mtime < dc->scantime)
+		{
+			dc->lastuse = ++DirCacheUse;
+			return dc;
+		}
+		dircache_free(dc);
+	}
+	else
+	{
+		dc = oldest;
+		dircache_free(dc);
+	}
+
+	if (!dircache_scan(dc, path, len, st.st_mtime))
+		return NULL;
+	dc->lastuse = ++DirCacheUse;
+	return dc;
+}
+
+/**
+ * Return index of first entry in given cached directory matching
+ * given host name case-insensitively, or -1 if there's none.
+ */
+static int dircache_find(DIR_CACHE *dc, const char *name)
+{
+	char folded[FILENAME_MAX];
+	int i;
+
+	for (i = 0; name[i] && i < (int)sizeof(folded) - 1; i++)
+		folded[i] = toupper((unsigned char)name[i]);
+	folded[i] = '\0';
+
+	i = dc->hashhead[dircache_hash(folded) & dc->hashmask];
+	while (i >= 0 && strcmp(dc->folded[i], folded) != 0)
+		i = dc->hashnext[i];
+	return i;
+}
+
+
 /*-----------------------------------------------------------------------*/
 /**
  * Close given internal file handle if it's still in use
@@ -563,6 +968,7 @@ void GemDOS_Reset(void)
 {
 	GemDOS_Init();
 	GemDOS_InitCurPaths();
+	dircache_clear();
 
 	/* Reset */
 	act_pd = 0;
@@ -1132,16 +1538,16 @@ static int GemDOS_FileName2HardDriveID(char *pszFileName)
 static char* match_host_dir_entry(const char *path, const char *name, bool pattern)
 {
 #define MAX_UTF8_NAME_LEN (3*(8+1+3)+1) /* UTF-8 can have up to 3 bytes per character */
-	struct dirent *entry;
 	char *match = NULL;
-	DIR *dir;
+	DIR_CACHE *dc;
 	char nameHost[MAX_UTF8_NAME_LEN];
+	int i;
 
 	Str_AtariToHost(name, nameHost, MAX_UTF8_NAME_LEN, INVALID_CHAR);
 	name = nameHost;
 	
-	dir = opendir(path);
-	if (!dir)
+	dc = dircache_get(path);
+	if (!dc)
 		return NULL;
 
 #if DEBUG_PATTERN_MATCH
@@ -1149,31 +1555,21 @@ static char* match_host_dir_entry(const char *path, const char *name, bool patte
 #endif
 	if (pattern)
 	{
-		while ((entry = readdir(dir)))
+		for (i = 0; i < dc->count; i++)
 		{
-			char *d_name = entry->d_name;
-			Str_DecomposedToPrecomposedUtf8(d_name, d_name);   /* for OSX */
-			if (fsfirst_match(name, d_name))
+			if (fsfirst_match(name, dc->names[i]))
 			{
-				match = strdup(d_name);
+				match = strdup(dc->names[i]);
 				break;
 			}
 		}
 	}
 	else
 	{
-		while ((entry = readdir(dir)))
-		{
-			char *d_name = entry->d_name;
-			Str_DecomposedToPrecomposedUtf8(d_name, d_name);   /* for OSX */
-			if (strcasecmp(name, d_name) == 0)
-			{
-				match = strdup(d_name);
-				break;
-			}
-		}
+		i = dircache_find(dc, name);
+		if (i >= 0)
+			match = strdup(dc->names[i]);
 	}
-	closedir(dir);
 #if DEBUG_PATTERN_MATCH
 	fprintf(stderr, "-> '%s'\n", match);
 #endif
@@ -1765,6 +2161,7 @@ static bool GemDOS_MkDir(Uint32 Params)
 	GemDOS_CreateHardDriveFileName(Drive, pDirName, psDirPath, FILENAME_MAX);
 	
 	/* Attempt to make directory */
+	dircache_invalidate(psDirPath);
 	if (mkdir(psDirPath, 0755) == 0)
 		Regs[REG_D0] = GEMDOS_EOK;
 	else
@@ -1823,6 +2220,7 @@ static bool GemDOS_RmDir(Uint32 Params)
 	GemDOS_CreateHardDriveFileName(Drive, pDirName, psDirPath, FILENAME_MAX);
 
 	/* Attempt to remove directory */
+	dircache_invalidate(psDirPath);
 	if (rmdir(psDirPath) == 0)
 		Regs[REG_D0] = GEMDOS_EOK;
 	else
@@ -2007,6 +2405,7 @@ static bool GemDOS_Create(Uint32 Params)
 	}
 	
 	/* truncate and open for reading & writing */
+	dircache_invalidate(szActualFileName);
 	FileHandles[Index].FileHandle = fopen(szActualFileName, "wb+");
 
 	if (FileHandles[Index].FileHandle != NULL)
@@ -2333,6 +2732,7 @@ static bool GemDOS_Read(Uint32 Params)
 	/* And read data in */
 	pBuffer = (char *)STMemory_STAddrToPointer(Addr);
 	nBytesRead = fread(pBuffer, 1, Size, FileHandles[Handle].FileHandle);
+	STMemory_DirtyPages_MarkPointer(pBuffer, nBytesRead);
 	
 	if (ferror(FileHandles[Handle].FileHandle))
 	{
@@ -2472,6 +2872,7 @@ static bool GemDOS_FDelete(Uint32 Params)
 	GemDOS_CreateHardDriveFileName(Drive, pszFileName, psActualFileName, FILENAME_MAX);
 
 	/* Now delete file?? */
+	dircache_invalidate(psActualFileName);
 	if (unlink(psActualFileName) == 0)
 		Regs[REG_D0] = GEMDOS_EOK;          /* OK */
 	else
@@ -2869,8 +3270,8 @@ static int GemDOS_Pexec(Uint32 Params)
  */
 static bool GemDOS_SNext(void)
 {
-	struct dirent **temp;
-	int ret;
+	char **temp;
+	int i, ret;
 	DTA *pDTA;
 	Uint32 DTA_Gemdos;
 	Uint16 Index;
@@ -2922,14 +3323,17 @@ static bool GemDOS_SNext(void)
 		{
 			/* older TOS versions zero file name if there are no (further) matches */
 			if (TosVersion < 0x0400)
+			{
 				pDTA->dta_name[0] = 0;
+				STMemory_DirtyPages_MarkPointer(pDTA->dta_name, 1);
+			}
 			Regs[REG_D0] = GEMDOS_ENMFIL;    /* No more files */
 			return true;
 		}
 
-		ret = PopulateDTA(InternalDTAs[Index].path,
-				  temp[InternalDTAs[Index].centry++],
-				  pDTA, DTA_Gemdos);
+		i = InternalDTAs[Index].centry++;
+		ret = PopulateDTA(InternalDTAs[Index].path, temp[i],
+				  &InternalDTAs[Index].stats[i], pDTA, DTA_Gemdos);
 	} while (ret == DTA_SKIP);
 
 	if (ret == DTA_ERR)
@@ -2955,10 +3359,10 @@ static bool GemDOS_SFirst(Uint32 Params)
 	char szActualFileName[MAX_GEMDOS_PATH];
 	char *pszFileName;
 	const char *dirmask;
-	struct dirent **files;
+	DIR_CACHE *dc;
+	char **files;
 	int Drive;
-	DIR *fsdir;
-	int i, j, count;
+	int i, j;
 	DTA *pDTA;
 	Uint32 DTA_Gemdos;
 	Uint16 useidx;
@@ -3002,6 +3406,7 @@ static bool GemDOS_SFirst(Uint32 Params)
 	M68000_Flush_Data_Cache(DTA_Gemdos, sizeof(DTA));
 
 	pDTA = (DTA *)STMemory_STAddrToPointer(DTA_Gemdos);
+	STMemory_DirtyPages_MarkPointer(pDTA, sizeof(DTA));
 
 	/* re-use earlier Hatari DTA? */
 	if (do_get_mem_long(pDTA->magic) == DTA_MAGIC_NUMBER)
@@ -3041,21 +3446,17 @@ static bool GemDOS_SFirst(Uint32 Params)
 	 * TODO: host path may not fit into InternalDTA
 	 */
 	fsfirst_dirname(szActualFileName, InternalDTAs[useidx].path);
-	fsdir = opendir(InternalDTAs[useidx].path);
-
-	if (fsdir == NULL)
+	dc = dircache_get(InternalDTAs[useidx].path);
+	if (dc == NULL)
 	{
 		Regs[REG_D0] = GEMDOS_EPTHNF;        /* Path not found */
 		return true;
 	}
-	/* close directory */
-	closedir(fsdir);
 
-	count = scandir(InternalDTAs[useidx].path, &files, 0, alphasort);
-	/* File (directory actually) not found */
-	if (count < 0)
+	files = malloc(dc->count * sizeof(char *) + 1);
+	if (!files)
 	{
-		Regs[REG_D0] = GEMDOS_EFILNF;
+		Regs[REG_D0] = GEMDOS_ENSMEM;
 		return true;
 	}
 
@@ -3063,22 +3464,17 @@ static bool GemDOS_SFirst(Uint32 Params)
 	dirmask = fsfirst_dirmask(szActualFileName);/* directory mask part */
 	InternalDTAs[useidx].found = files;       /* get files */
 
-	/* count & copy the entries that match our mask and discard the rest */
+	/* copy the entries that match our mask */
 	j = 0;
-	for (i=0; i < count; i++)
+	for (i=0; i < dc->count; i++)
 	{
-		char *d_name = files[i]->d_name;
-		Str_DecomposedToPrecomposedUtf8(d_name, d_name);   /* for OSX */
-		if (fsfirst_match(dirmask, d_name))
+		if (fsfirst_match(dirmask, dc->names[i]))
 		{
-			InternalDTAs[useidx].found[j] = files[i];
+			files[j] = strdup(dc->names[i]);
+			if (!files[j])
+				break;
 			j++;
 		}
-		else
-		{
-			free(files[i]);
-			files[i] = NULL;
-		}
 	}
 	InternalDTAs[useidx].nentries = j; /* set number of legal entries */
 
@@ -3091,6 +3487,18 @@ static bool GemDOS_SFirst(Uint32 Params)
 		return true;
 	}
 
+	/* all stat()s done at once, in advance for larger directories */
+	InternalDTAs[useidx].stats = calloc(j, sizeof(DTA_STAT));
+	if (!InternalDTAs[useidx].stats)
+	{
+		ClearInternalDTA(useidx);
+		InternalDTAs[useidx].bUsed = true;
+		Regs[REG_D0] = GEMDOS_ENSMEM;
+		return true;
+	}
+	if (j > DTA_STAT_THREAD_MIN)
+		GemDOS_StartStatWorker(&InternalDTAs[useidx]);
+
 	/* Scan for first file (SNext uses no parameters) */
 	GemDOS_SNext();
 
@@ -3178,6 +3586,8 @@ static bool GemDOS_Rename(Uint32 Params)
 		              szOldActualFileName, sizeof(szOldActualFileName));
 
 	/* Rename files */
+	dircache_invalidate(szOldActualFileName);
+	dircache_invalidate(szNewActualFileName);
 	if (rename(szOldActualFileName,szNewActualFileName) == 0)
 		Regs[REG_D0] = GEMDOS_EOK;
 	else
@@ -3863,7 +4273,7 @@ void GemDOS_Info(FILE *fp, Uint32 bShowOpcodes)
 		for (j = 0; j < entries; j++)
 		{
 			fprintf(fp, "  - %d: %s%s\n",
-				j, InternalDTAs[i].found[j]->d_name,
+				j, InternalDTAs[i].found[j],
 				j == centry ? " *" : "");
 		}
 		fprintf(fp, "  Fsnext entry = %d.\n", centry);
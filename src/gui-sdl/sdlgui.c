@@ -155,6 +155,8 @@ int SDLGui_UnInit(void)
  */
 int SDLGui_SetScreen(SDL_Surface *pScrn)
 {
+	/* GUI draws directly to the screen surface */
+	Screen_RenderWait();
 	pSdlGuiScrn = pScrn;
 
 	/* Decide which font to use - small or big one: */
@@ -26,6 +26,10 @@ const char HDC_fileid[] = "Hatari hdc.c";
 #include "tos.h"
 #include "statusbar.h"
 
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
 
 /*
   ACSI emulation: 
@@ -148,6 +152,7 @@ static Uint8 *HDC_PrepRespBuf(SCSI_CTRLR *ctr, int size)
 		ctr->buffer = realloc(ctr->buffer, size);
 	}
 
+	ctr->data = ctr->buffer;
 	return ctr->buffer;
 }
 
@@ -186,8 +191,7 @@ static void HDC_Cmd_Seek(SCSI_CTRLR *ctr)
 	LOG_TRACE(TRACE_SCSI_CMD, "HDC: SEEK (%s), LBA=%i",
 	          HDC_CmdInfoStr(ctr), dev->nLastBlockAddr);
 
-	if (dev->nLastBlockAddr < dev->hdSize &&
-	    fseeko(dev->image_file, (off_t)dev->nLastBlockAddr * dev->blockSize, SEEK_SET) == 0)
+	if (dev->nLastBlockAddr < dev->hdSize)
 	{
 		LOG_TRACE(TRACE_SCSI_CMD, " -> OK\n");
 		ctr->status = HD_STATUS_OK;
@@ -521,9 +525,7 @@ static void HDC_Cmd_WriteSector(SCSI_CTRLR *ctr)
 	LOG_TRACE(TRACE_SCSI_CMD, "HDC: WRITE SECTOR (%s) with LBA 0x%x",
 	          HDC_CmdInfoStr(ctr), dev->nLastBlockAddr);
 
-	/* seek to the position */
-	if (dev->nLastBlockAddr >= dev->hdSize ||
-	    fseeko(dev->image_file, (off_t)dev->nLastBlockAddr * dev->blockSize, SEEK_SET) != 0)
+	if (dev->nLastBlockAddr >= dev->hdSize)
 	{
 		ctr->status = HD_STATUS_ERROR;
 		dev->nLastError = HD_REQSENS_INVADDR;
@@ -534,7 +536,8 @@ static void HDC_Cmd_WriteSector(SCSI_CTRLR *ctr)
 		if (ctr->data_len)
 		{
 			HDC_PrepRespBuf(ctr, ctr->data_len);
-			ctr->dmawrite_to_fh = dev->image_file;
+			ctr->dmawrite_to_img = &dev->image;
+			ctr->dmawrite_offset = (off_t)dev->nLastBlockAddr * dev->blockSize;
 			ctr->status = HD_STATUS_OK;
 			dev->nLastError = HD_REQSENS_OK;
 		}
@@ -558,26 +561,37 @@ static void HDC_Cmd_WriteSector(SCSI_CTRLR *ctr)
 static void HDC_Cmd_ReadSector(SCSI_CTRLR *ctr)
 {
 	SCSI_DEV *dev = &ctr->devs[ctr->target];
+	const Uint8 *data;
 	Uint8 *buf;
-	int n;
+	off_t offset;
+	int len;
 
 	dev->nLastBlockAddr = HDC_GetLBA(ctr);
 
 	LOG_TRACE(TRACE_SCSI_CMD, "HDC: READ SECTOR (%s) with LBA 0x%x",
 	          HDC_CmdInfoStr(ctr), dev->nLastBlockAddr);
 
-	/* seek to the position */
-	if (dev->nLastBlockAddr >= dev->hdSize ||
-	    fseeko(dev->image_file, (off_t)dev->nLastBlockAddr * dev->blockSize, SEEK_SET) != 0)
+	offset = (off_t)dev->nLastBlockAddr * dev->blockSize;
+	len = dev->blockSize * HDC_GetCount(ctr);
+
+	if (dev->nLastBlockAddr >= dev->hdSize)
 	{
 		ctr->status = HD_STATUS_ERROR;
 		dev->nLastError = HD_REQSENS_INVADDR;
 	}
+	else if ((data = HDC_ImageData(&dev->image, offset, len)))
+	{
+		/* transfer straight from the mapped image */
+		HDC_PrepRespBuf(ctr, 0);
+		ctr->data = data;
+		ctr->data_len = len;
+		ctr->status = HD_STATUS_OK;
+		dev->nLastError = HD_REQSENS_OK;
+	}
 	else
 	{
-		buf = HDC_PrepRespBuf(ctr, dev->blockSize * HDC_GetCount(ctr));
-		n = fread(buf, dev->blockSize, HDC_GetCount(ctr), dev->image_file);
-		if (n == HDC_GetCount(ctr))
+		buf = HDC_PrepRespBuf(ctr, len);
+		if (HDC_ImageRead(&dev->image, offset, buf, len, false))
 		{
 			ctr->status = HD_STATUS_OK;
 			dev->nLastError = HD_REQSENS_OK;
@@ -690,6 +704,193 @@ static void HDC_EmulateCommandPacket(SCSI_CTRLR *ctr)
 
 
 /*---------------------------------------------------------------------*/
+/**
+ * Copy given number of bytes, swapping the bytes in each 16-bit word.
+ * Source and destination can be the same.
+ */
+static void HDC_SwapCopy(Uint8 *dst, const Uint8 *src, Uint32 len)
+{
+	Uint64 v;
+	Uint32 i;
+	Uint8 b;
+
+	/* four words at a time, compilers vectorize this */
+	for (i = 0; i + 8 <= len; i += 8)
+	{
+		memcpy(&v, src + i, 8);
+		v = ((v & 0x00ff00ff00ff00ffULL) << 8) | ((v >> 8) & 0x00ff00ff00ff00ffULL);
+		memcpy(dst + i, &v, 8);
+	}
+	for (; i + 2 <= len; i += 2)
+	{
+		b = src[i];
+		dst[i] = src[i + 1];
+		dst[i + 1] = b;
+	}
+}
+
+/**
+ * Open HD image file of given size, and memory-map it if that's enabled.
+ * Return 0 on success, or negative errno value on error.
+ */
+int HDC_ImageOpen(HD_IMAGE *img, const char *hdtype, const char *filename, off_t size)
+{
+	memset(img, 0, sizeof(*img));
+	img->size = size;
+
+	if (!(img->fp = fopen(filename, "rb+")))
+	{
+		if (!(img->fp = fopen(filename, "rb")))
+		{
+			Log_AlertDlg(LOG_ERROR, "Cannot open %s HD file for reading\n'%s'!\n",
+				     hdtype, filename);
+			return -ENOENT;
+		}
+		Log_AlertDlg(LOG_WARN, "%s HD file is read-only, no writes will go through\n'%s'.\n",
+			     hdtype, filename);
+		img->bReadOnly = true;
+	}
+	else if (!File_Lock(img->fp))
+	{
+		Log_AlertDlg(LOG_ERROR, "Locking %s HD file for writing failed\n'%s'!\n",
+			     hdtype, filename);
+		fclose(img->fp);
+		img->fp = NULL;
+		return -ENOLCK;
+	}
+
+#if HAVE_MMAP
+	/* With a shared mapping, reads & writes don't need syscalls,
+	 * and host kernel writes changed pages back asynchronously */
+	if (ConfigureParams.HardDisk.bMmapImages && (off_t)(size_t)size == size)
+	{
+		void *map = mmap(NULL, size, img->bReadOnly ? PROT_READ : PROT_READ | PROT_WRITE,
+		                 MAP_SHARED, fileno(img->fp), 0);
+		if (map != MAP_FAILED)
+			img->map = map;
+		else
+			Log_Printf(LOG_WARN, "Memory-mapping %s HD image failed (%s), using file I/O.\n",
+			           hdtype, strerror(errno));
+	}
+#endif
+	return 0;
+}
+
+/**
+ * Close HD image file
+ */
+void HDC_ImageClose(HD_IMAGE *img)
+{
+#if HAVE_MMAP
+	if (img->map)
+		munmap(img->map, img->size);
+#endif
+	img->map = NULL;
+	if (img->fp)
+	{
+		File_UnLock(img->fp);
+		fclose(img->fp);
+		img->fp = NULL;
+	}
+}
+
+/**
+ * Return true if given range is within the image
+ */
+static bool HDC_ImageRange(HD_IMAGE *img, off_t offset, Uint32 len)
+{
+	return img->fp && offset >= 0 && offset + (off_t)len <= img->size;
+}
+
+/**
+ * Return pointer to given range of memory-mapped image contents,
+ * or NULL if image isn't mapped or range is invalid.  Contents can
+ * be read until next image write.
+ */
+const Uint8 *HDC_ImageData(HD_IMAGE *img, off_t offset, Uint32 len)
+{
+	if (!img->map || !HDC_ImageRange(img, offset, len))
+		return NULL;
+	return img->map + offset;
+}
+
+/**
+ * Read given number of bytes from image offset to buffer,
+ * byte-swapping 16-bit words if requested.  Return false on error.
+ */
+bool HDC_ImageRead(HD_IMAGE *img, off_t offset, Uint8 *buf, Uint32 len, bool bSwap)
+{
+	if (!HDC_ImageRange(img, offset, len))
+		return false;
+
+	if (img->map)
+	{
+		if (bSwap)
+			HDC_SwapCopy(buf, img->map + offset, len);
+		else
+			memcpy(buf, img->map + offset, len);
+		return true;
+	}
+
+	if (fseeko(img->fp, offset, SEEK_SET) != 0
+	    || fread(buf, 1, len, img->fp) != len)
+		return false;
+	if (bSwap)
+		HDC_SwapCopy(buf, buf, len);
+	return true;
+}
+
+/**
+ * Write given number of bytes from buffer to image offset,
+ * byte-swapping 16-bit words if requested.  Return false on error.
+ */
+bool HDC_ImageWrite(HD_IMAGE *img, off_t offset, const Uint8 *buf, Uint32 len, bool bSwap)
+{
+	Uint8 *swapped = NULL;
+	bool ok;
+
+	if (img->bReadOnly || !HDC_ImageRange(img, offset, len))
+		return false;
+
+	if (img->map)
+	{
+		if (bSwap)
+			HDC_SwapCopy(img->map + offset, buf, len);
+		else
+			memcpy(img->map + offset, buf, len);
+		return true;
+	}
+
+	if (bSwap)
+	{
+		swapped = malloc(len);
+		if (!swapped)
+			return false;
+		HDC_SwapCopy(swapped, buf, len);
+		buf = swapped;
+	}
+	ok = fseeko(img->fp, offset, SEEK_SET) == 0
+	     && fwrite(buf, 1, len, img->fp) == len;
+	free(swapped);
+	return ok;
+}
+
+/**
+ * Push written data to the host OS
+ */
+void HDC_ImageFlush(HD_IMAGE *img)
+{
+#if HAVE_MMAP
+	if (img->map)
+	{
+		msync(img->map, img->size, MS_ASYNC);
+		return;
+	}
+#endif
+	if (img->fp)
+		fflush(img->fp);
+}
+
 /**
  * Return given image file (primary) partition count.
  * With tracing enabled, print also partition table.
@@ -724,19 +925,16 @@ static void HDC_EmulateCommandPacket(SCSI_CTRLR *ctr)
  * Extended partition tables are described in AHDI release notes:
  *	https://www.dev-docs.org/docs/htm/search.php?find=AHDI
  */
-int HDC_PartitionCount(FILE *fp, const Uint64 tracelevel, int *pIsByteSwapped)
+int HDC_PartitionCount(HD_IMAGE *img, const Uint64 tracelevel, int *pIsByteSwapped)
 {
 	unsigned char *pinfo, bootsector[512];
 	Uint32 start, sectors, total = 0;
 	int i, parts = 0;
-	off_t offset;
 
-	if (!fp)
+	if (!img->fp)
 		return 0;
-	offset = ftello(fp);
 
-	if (fseeko(fp, 0, SEEK_SET) != 0
-	    || fread(bootsector, sizeof(bootsector), 1, fp) != 1)
+	if (!HDC_ImageRead(img, 0, bootsector, sizeof(bootsector), false))
 	{
 		perror("HDC_PartitionCount");
 		return 0;
@@ -757,14 +955,7 @@ int HDC_PartitionCount(FILE *fp, const Uint64 tracelevel, int *pIsByteSwapped)
 		    || (bootsector[0x1c6] == 'S' && bootsector[0x1c8] == 'P' && bootsector[0x1c9] == 'W');
 
 		if (*pIsByteSwapped)
-		{
-			for (i = 0; i < (int)sizeof(bootsector); i += 2)
-			{
-				uint8_t b = bootsector[i];
-				bootsector[i] = bootsector[i + 1];
-				bootsector[i + 1] = b;
-			}
-		}
+			HDC_SwapCopy(bootsector, bootsector, sizeof(bootsector));
 	}
 
 	if (bootsector[0x1FE] == 0x55 && bootsector[0x1FF] == 0xAA)
@@ -828,8 +1019,6 @@ int HDC_PartitionCount(FILE *fp, const Uint64 tracelevel, int *pIsByteSwapped)
 		LOG_TRACE(tracelevel, "- Total size: %.1f MB in %d partitions\n", total/2048.0, parts);
 	}
 
-	if (fseeko(fp, offset, SEEK_SET) != 0)
-		perror("HDC_PartitionCount");
 	return parts;
 }
 
@@ -881,7 +1070,7 @@ off_t HDC_CheckAndGetSize(const char *hdtype, const char *filename, unsigned lon
 int HDC_InitDevice(const char *hdtype, SCSI_DEV *dev, char *filename, unsigned long blockSize)
 {
 	off_t filesize;
-	FILE *fp;
+	int ret;
 
 	dev->enabled = false;
 	Log_Printf(LOG_INFO, "Mounting %s HD image '%s'\n", hdtype, filename);
@@ -891,28 +1080,12 @@ int HDC_InitDevice(const char *hdtype, SCSI_DEV *dev, char *filename, unsigned l
 	if (filesize < 0)
 		return filesize;
 
-	if (!(fp = fopen(filename, "rb+")))
-	{
-		if (!(fp = fopen(filename, "rb")))
-		{
-			Log_AlertDlg(LOG_ERROR, "Cannot open %s HD file for reading\n'%s'!\n",
-				     hdtype, filename);
-			return -ENOENT;
-		}
-		Log_AlertDlg(LOG_WARN, "%s HD file is read-only, no writes will go through\n'%s'.\n",
-			     hdtype, filename);
-	}
-	else if (!File_Lock(fp))
-	{
-		Log_AlertDlg(LOG_ERROR, "Locking %s HD file for writing failed\n'%s'!\n",
-			     hdtype, filename);
-		fclose(fp);
-		return -ENOLCK;
-	}
+	ret = HDC_ImageOpen(&dev->image, hdtype, filename, filesize);
+	if (ret < 0)
+		return ret;
 
 	dev->blockSize = blockSize;
 	dev->hdSize = filesize / dev->blockSize;
-	dev->image_file = fp;
 	dev->enabled = true;
 
 	return 0;
@@ -943,7 +1116,7 @@ bool HDC_Init(void)
 			continue;
 		if (HDC_InitDevice("ACSI", &AcsiBus.devs[i], ConfigureParams.Acsi[i].sDeviceFile, ConfigureParams.Acsi[i].nBlockSize) == 0)
 		{
-			nAcsiPartitions += HDC_PartitionCount(AcsiBus.devs[i].image_file, TRACE_SCSI_CMD, NULL);
+			nAcsiPartitions += HDC_PartitionCount(&AcsiBus.devs[i].image, TRACE_SCSI_CMD, NULL);
 			bAcsiEmuOn = true;
 		}
 		else
@@ -968,9 +1141,7 @@ void HDC_UnInit(void)
 	{
 		if (!AcsiBus.devs[i].enabled)
 			continue;
-		File_UnLock(AcsiBus.devs[i].image_file);
-		fclose(AcsiBus.devs[i].image_file);
-		AcsiBus.devs[i].image_file = NULL;
+		HDC_ImageClose(&AcsiBus.devs[i].image);
 		AcsiBus.devs[i].enabled = false;
 	}
 	free(AcsiBus.buffer);
@@ -1081,21 +1252,21 @@ static void Acsi_DmaTransfer(void)
 	if ((nDmaMode & 0xc0) != 0x00 || AcsiBus.data_len == 0)
 		return;
 
-	if ((AcsiBus.dmawrite_to_fh && (nDmaMode & 0x100) == 0)
-	    || (!AcsiBus.dmawrite_to_fh && (nDmaMode & 0x100) != 0))
+	if ((AcsiBus.dmawrite_to_img && (nDmaMode & 0x100) == 0)
+	    || (!AcsiBus.dmawrite_to_img && (nDmaMode & 0x100) != 0))
 	{
 		Log_Printf(LOG_WARN, "DMA direction does not match SCSI command!\n");
 		return;
 	}
 
-	if (AcsiBus.dmawrite_to_fh)
+	if (AcsiBus.dmawrite_to_img)
 	{
 		/* write - if allowed */
 		if (STMemory_CheckAreaType(nDmaAddr, AcsiBus.data_len, ABFLAG_RAM | ABFLAG_ROM))
 		{
 #ifndef DISALLOW_HDC_WRITE
-			int wlen = fwrite(&STRam[nDmaAddr], 1, AcsiBus.data_len, AcsiBus.dmawrite_to_fh);
-			if (wlen != AcsiBus.data_len)
+			if (!HDC_ImageWrite(AcsiBus.dmawrite_to_img, AcsiBus.dmawrite_offset,
+			                    &STRam[nDmaAddr], AcsiBus.data_len, false))
 			{
 				Log_Printf(LOG_ERROR, "Could not write all bytes to ACSI HD image.\n");
 				AcsiBus.status = HD_STATUS_ERROR;
@@ -1108,9 +1279,9 @@ static void Acsi_DmaTransfer(void)
 				   nDmaAddr, AcsiBus.data_len);
 			AcsiBus.bDmaError = true;
 		}
-		AcsiBus.dmawrite_to_fh = NULL;
+		AcsiBus.dmawrite_to_img = NULL;
 	}
-	else if (!STMemory_SafeCopy(nDmaAddr, AcsiBus.buffer, AcsiBus.data_len, "ACSI DMA"))
+	else if (!STMemory_SafeCopy(nDmaAddr, AcsiBus.data, AcsiBus.data_len, "ACSI DMA"))
 	{
 		AcsiBus.bDmaError = true;
 		AcsiBus.status = HD_STATUS_ERROR;
@@ -394,7 +394,7 @@ struct BlockDriverState {
     void (*change_cb)(void *opaque);
     void *change_opaque;
 
-    FILE *fhndl;
+    HD_IMAGE image;
     off_t file_size;
     int media_changed;
     int byteswap;
@@ -490,7 +490,7 @@ static void bdrv_set_change_cb(BlockDriverState *bs,
  */
 static int bdrv_is_inserted(BlockDriverState *bs)
 {
-	return (bs->fhndl != NULL);
+	return (bs->image.fp != NULL);
 }
 
 
@@ -512,39 +512,23 @@ static void bdrv_set_locked(BlockDriverState *bs, int locked)
 static int bdrv_read(BlockDriverState *bs, int64_t sector_num,
                      uint8_t *buf, int nb_sectors)
 {
-	int ret, len;
+	int len;
 
-	if (!bs->fhndl)
+	if (!bs->image.fp)
 		return -ENOMEDIUM;
 
 	len = nb_sectors * bs->sector_size;
 
-	if (fseeko(bs->fhndl, sector_num * bs->sector_size, SEEK_SET) != 0)
+	if (!HDC_ImageRead(&bs->image, sector_num * bs->sector_size, buf, len, bs->byteswap))
 	{
-		perror("bdrv_read");
-		return -errno;
-	}
-	ret = fread(buf, 1, len, bs->fhndl);
-	if (ret != len)
-	{
-		Log_Printf(LOG_ERROR, "IDE: bdrv_read error (%d != %d length) at sector %lu!\n",
-		           ret, len, (unsigned long)sector_num);
+		Log_Printf(LOG_ERROR, "IDE: bdrv_read error (%d bytes) at sector %lu!\n",
+		           len, (unsigned long)sector_num);
 		return -EINVAL;
 	}
 
 	bs->rd_bytes += (unsigned) len;
 	bs->rd_ops ++;
 
-	if (bs->byteswap)
-	{
-		uint16_t *buf16 = (uint16_t *)buf;
-		while (len > 0) {
-			*buf16 = SDL_Swap16(*buf16);
-			buf16++;
-			len -= 2;
-		}
-	}
-
 	return 0;
 }
 
@@ -558,42 +542,19 @@ static int bdrv_read(BlockDriverState *bs, int64_t sector_num,
 static int bdrv_write(BlockDriverState *bs, int64_t sector_num,
                       const uint8_t *buf, int nb_sectors)
 {
-	int ret, len, idx;
-	uint16_t *buf16;
+	int len;
 
-	if (!bs->fhndl)
+	if (!bs->image.fp)
 		return -ENOMEDIUM;
 	if (bs->read_only)
 		return -EACCES;
 
 	len = nb_sectors * bs->sector_size;
 
-	if (fseeko(bs->fhndl, sector_num * bs->sector_size, SEEK_SET) != 0)
+	if (!HDC_ImageWrite(&bs->image, sector_num * bs->sector_size, buf, len, bs->byteswap))
 	{
-		perror("bdrv_write");
-		return -errno;
-	}
-
-	if (!bs->byteswap)
-	{
-		ret = fwrite(buf, 1, len, bs->fhndl);
-	}
-	else
-	{
-		buf16 = malloc(len);
-		if (!buf16)
-			return -ENOMEM;
-		for (idx = 0; idx < len; idx += 2)
-		{
-			buf16[idx / 2] = SDL_Swap16(*(const uint16_t *)&buf[idx]);
-		}
-		ret = fwrite(buf16, 1, len, bs->fhndl);
-		free(buf16);
-	}
-	if (ret != len)
-	{
-		Log_Printf(LOG_ERROR, "IDE: bdrv_write error (%d != %d length) at sector %lu!\n",
-		           ret, len,  (unsigned long)sector_num);
+		Log_Printf(LOG_ERROR, "IDE: bdrv_write error (%d bytes) at sector %lu!\n",
+		           len, (unsigned long)sector_num);
 		return -EIO;
 	}
 
@@ -620,27 +581,9 @@ static int bdrv_open(BlockDriverState *bs, const char *filename, unsigned long b
 		return -1;
 	}
 
-	bs->fhndl = fopen(filename, "rb+");
-	if (!bs->fhndl) {
-		/* Maybe the file is read-only? */
-		bs->fhndl = fopen(filename, "rb");
-		if (!bs->fhndl)
-		{
-			perror("bdrv_open");
-			Log_AlertDlg(LOG_ERROR, "Cannot open IDE HD for reading\n'%s'.\n", filename);
-			return -1;
-		}
-		Log_AlertDlg(LOG_WARN, "IDE HD file is read-only, no writes will go through\n'%s'.\n",
-			     filename);
-		bs->read_only = 1;
-	}
-	else if (!File_Lock(bs->fhndl))
-	{
-		Log_AlertDlg(LOG_ERROR, "Locking IDE HD file for writing failed\n'%s'!\n", filename);
-		fclose(bs->fhndl);
-		bs->fhndl = NULL;
+	if (HDC_ImageOpen(&bs->image, "IDE", filename, bs->file_size) < 0)
 		return -1;
-	}
+	bs->read_only = bs->image.bReadOnly;
 
 	/* call the change callback */
 	bs->media_changed = 1;
@@ -652,14 +595,12 @@ static int bdrv_open(BlockDriverState *bs, const char *filename, unsigned long b
 
 static void bdrv_flush(BlockDriverState *bs)
 {
-	fflush(bs->fhndl);
+	HDC_ImageFlush(&bs->image);
 }
 
 static void bdrv_close(BlockDriverState *bs)
 {
-	File_UnLock(bs->fhndl);
-	fclose(bs->fhndl);
-	bs->fhndl = NULL;
+	HDC_ImageClose(&bs->image);
 }
 
 /**
@@ -2719,7 +2660,7 @@ void Ide_Init(void)
 				ConfigureParams.Ide[i].bUseDevice = false;
 				continue;
 			}
-			nIDEPartitions += HDC_PartitionCount(hd_table[i]->fhndl, TRACE_IDE, &is_byteswap);
+			nIDEPartitions += HDC_PartitionCount(&hd_table[i]->image, TRACE_IDE, &is_byteswap);
 			/* Our IDE implementation is little endian by default,
 			 * so we need to byteswap if the image is not swapped! */
 			if (ConfigureParams.Ide[i].nByteSwap == BYTESWAP_AUTO)
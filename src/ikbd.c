@@ -92,6 +92,7 @@ const char IKBD_fileid[] = "Hatari ikbd.c";
 #include "utils.h"
 #include "acia.h"
 #include "clocks_timings.h"
+#include "rewind.h"
 
 
 #define DBL_CLICK_HISTORY  0x07     /* Number of frames since last click to see if need to send one or two clicks */
@@ -176,6 +177,7 @@ static bool bMouseEnabledDuringReset;
 
 
 static void IKBD_RunKeyboardCommand(Uint8 aciabyte);
+static void IKBD_PressKey(Uint8 ScanCode, bool bPress);
 
 
 /* List of possible keyboard commands, others are seen as NOPs by keyboard processor */
@@ -1430,11 +1432,17 @@ static void IKBD_GetJoystickData(void)
 {
 	/* Joystick 1 */
 	KeyboardProcessor.Joy.JoyData[JOYID_JOYSTICK1] = Joy_GetStickData(JOYID_JOYSTICK1);
+	if (Rewind_Enabled())
+		KeyboardProcessor.Joy.JoyData[JOYID_JOYSTICK1] = Rewind_InputJoy(JOYID_JOYSTICK1, KeyboardProcessor.Joy.JoyData[JOYID_JOYSTICK1]);
 
 	/* If mouse is on, joystick 0 is not connected */
 	if (KeyboardProcessor.MouseMode==AUTOMODE_OFF
 	        || (bBothMouseAndJoy && KeyboardProcessor.MouseMode==AUTOMODE_MOUSEREL))
+	{
 		KeyboardProcessor.Joy.JoyData[JOYID_JOYSTICK0] = Joy_GetStickData(JOYID_JOYSTICK0);
+		if (Rewind_Enabled())
+			KeyboardProcessor.Joy.JoyData[JOYID_JOYSTICK0] = Rewind_InputJoy(JOYID_JOYSTICK0, KeyboardProcessor.Joy.JoyData[JOYID_JOYSTICK0]);
+	}
 	else
 		KeyboardProcessor.Joy.JoyData[JOYID_JOYSTICK0] = 0x00;
 }
@@ -1717,12 +1725,12 @@ static void IKBD_SendAutoKeyboardCommands(void)
 		/* As we simulating space bar? */
 		if (JoystickSpaceBar==JOYSTICK_SPACE_DOWN)
 		{
-			IKBD_PressSTKey(57, true);         /* Press */
+			IKBD_PressKey(57, true);           /* Press */
 			JoystickSpaceBar = JOYSTICK_SPACE_UP;
 		}
 		else   //if (JoystickSpaceBar==JOYSTICK_SPACE_UP) {
 		{
-			IKBD_PressSTKey(57, false);       /* Release */
+			IKBD_PressKey(57, false);         /* Release */
 			JoystickSpaceBar = false;         /* Complete */
 		}
 	}
@@ -1739,6 +1747,20 @@ static void IKBD_SendAutoKeyboardCommands(void)
  * When press/release key under host OS, execute this function.
  */
 void IKBD_PressSTKey(Uint8 ScanCode, bool bPress)
+{
+	/* Log host keys for debugger rewind, or ignore them while it replays */
+	if (Rewind_Enabled() && !Rewind_InputKey(ScanCode, bPress))
+		return;
+
+	IKBD_PressKey(ScanCode, bPress);
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Press/release given key in IKBD
+ */
+static void IKBD_PressKey(Uint8 ScanCode, bool bPress)
 {
 	/* If IKBD is monitoring only joysticks, don't report key */
 	if ( KeyboardProcessor.JoystickMode == AUTOMODE_JOYSTICK_MONITORING )
@@ -1788,7 +1810,9 @@ static int IKBD_CheckPressedKey(void)
 void IKBD_InterruptHandler_AutoSend(void)
 {
 	/* Handle user events and other messages, (like quit message) */
+	Rewind_InputBegin();
 	Main_EventHandler(false);
+	Rewind_InputEnd();
 
 	/* Remove this interrupt from list and re-order.
 	 * (needs to be done after UI event handling so
@@ -0,0 +1,15 @@
+/*
+  Hatari - benchmark.h
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+*/
+
+#ifndef HATARI_BENCHMARK_H
+#define HATARI_BENCHMARK_H
+
+/* for main.c */
+extern void Benchmark_VBL(void);
+extern void Benchmark_Report(void);
+
+#endif /* HATARI_BENCHMARK_H */
@@ -0,0 +1,31 @@
+/*
+  Hatari - bitplanes.h
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+*/
+
+#ifndef HATARI_BITPLANES_H
+#define HATARI_BITPLANES_H
+
+/* Bitplane to chunky conversion functions, each converting 16 pixels
+ * i.e. 'bpp' big endian bitplane words, for 1, 2, 4 and 8 bitplanes.
+ * ToChunky16/32 functions convert 'blocks' consecutive 16 pixel blocks
+ * and expand them with the given native palette.
+ */
+typedef struct {
+	const char *name;
+	void (*ToIndex)(const Uint16 *planes, int bpp, Uint8 *idx);
+	void (*ToChunky16)(const Uint16 *planes, int bpp, int blocks,
+	                   const Uint32 *pal, Uint16 *hvram);
+	void (*ToChunky32)(const Uint16 *planes, int bpp, int blocks,
+	                   const Uint32 *pal, Uint32 *hvram);
+} BITPLANE_KERNELS;
+
+/* fastest functions supported by host CPU */
+extern const BITPLANE_KERNELS *Bitplanes;
+
+extern void Bitplanes_Init(void);
+extern int Bitplanes_GetKernels(const BITPLANE_KERNELS **list, int max);
+
+#endif /* HATARI_BITPLANES_H */
@@ -236,6 +236,7 @@ typedef struct
   bool bFilenameConversion;
   bool bGemdosHostTime;
   bool bBootFromHardDisk;
+  bool bMmapImages;
   char szHardDiskDirectories[MAX_HARDDRIVES][FILENAME_MAX];
 } CNF_HARDDISK;
 
@@ -304,6 +305,7 @@ typedef struct
   bool bResizable;
   bool bUseVsync;
   bool bUseSdlRenderer;
+  bool bRenderThread;
   float nZoomFactor;
   int nSpec512Threshold;
   int nForceBpp;
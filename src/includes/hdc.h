@@ -49,12 +49,22 @@
 #define HD_REQSENS_INVARG   0x24              /* Invalid argument */
 #define HD_REQSENS_INVLUN   0x25              /* Invalid LUN */
 
+/**
+ * Hard disk image file, shared by ACSI/SCSI and IDE emulation
+ */
+typedef struct {
+	FILE *fp;
+	Uint8 *map;                 /* Memory-mapped image contents, or NULL */
+	off_t size;
+	bool bReadOnly;
+} HD_IMAGE;
+
 /**
  * Information about a ACSI/SCSI drive
  */
 typedef struct scsi_data {
 	bool enabled;
-	FILE *image_file;
+	HD_IMAGE image;
 	Uint32 nLastBlockAddr;      /* The specified sector number */
 	bool bSetLastBlockAddr;
 	Uint8 nLastError;
@@ -80,9 +90,11 @@ typedef struct {
 	short int status;           /* return code from the HDC operation */
 	Uint8 *buffer;              /* Response buffer */
 	int buffer_size;
+	const Uint8 *data;          /* Response data, in buffer or mapped image */
 	int data_len;
 	int offset;                 /* Current offset into data buffer */
-	FILE *dmawrite_to_fh;
+	HD_IMAGE *dmawrite_to_img;
+	off_t dmawrite_offset;
 	SCSI_DEV devs[8];
 } SCSI_CTRLR;
 
@@ -99,8 +111,14 @@ extern int HDC_InitDevice(const char *hdtype, SCSI_DEV *dev, char *filename, uns
 extern void HDC_ResetCommandStatus(void);
 extern short int HDC_ReadCommandByte(int addr);
 extern void HDC_WriteCommandByte(int addr, Uint8 byte);
-extern int HDC_PartitionCount(FILE *fp, const Uint64 tracelevel, int *pIsByteSwapped);
+extern int HDC_PartitionCount(HD_IMAGE *img, const Uint64 tracelevel, int *pIsByteSwapped);
 extern off_t HDC_CheckAndGetSize(const char *hdtype, const char *filename, unsigned long blockSize);
+extern int HDC_ImageOpen(HD_IMAGE *img, const char *hdtype, const char *filename, off_t size);
+extern void HDC_ImageClose(HD_IMAGE *img);
+extern bool HDC_ImageRead(HD_IMAGE *img, off_t offset, Uint8 *buf, Uint32 len, bool bSwap);
+extern bool HDC_ImageWrite(HD_IMAGE *img, off_t offset, const Uint8 *buf, Uint32 len, bool bSwap);
+extern const Uint8 *HDC_ImageData(HD_IMAGE *img, off_t offset, Uint32 len);
+extern void HDC_ImageFlush(HD_IMAGE *img);
 extern bool HDC_WriteCommandPacket(SCSI_CTRLR *ctr, Uint8 b);
 extern void HDC_DmaTransfer(void);
 
@@ -5,11 +5,33 @@
   or at your option any later version. Read the file gpl.txt for details.
 */
 
+/* reference counted memory page, shared between in-memory snapshots */
+typedef struct memsnap_page MEMSNAP_PAGE;
+
+/* in-memory snapshot, same contents as an uncompressed snapshot file,
+ * except that RAM & ROM contents are in pages shared with other snapshots
+ */
+typedef struct
+{
+	Uint8 *data;
+	Uint32 size;		/* bytes used */
+	Uint32 alloc;		/* bytes allocated */
+	MEMSNAP_PAGE **pages;
+	Uint32 nPages;		/* pages used */
+	Uint32 nPagesAlloc;	/* page pointers allocated */
+} MEMSNAP_BUFFER;
 
 extern void MemorySnapShot_Skip(int Nb);
 extern void MemorySnapShot_Store(void *pData, int Size);
+extern bool MemorySnapShot_StorePages(Uint8 *pMem, Uint32 Size, bool bTracked);
 extern void MemorySnapShot_Capture(const char *pszFileName, bool bConfirm);
 extern void MemorySnapShot_Capture_Immediate(const char *pszFileName, bool bConfirm);
 extern void MemorySnapShot_Capture_Do(void);
 extern void MemorySnapShot_Restore(const char *pszFileName, bool bConfirm);
 extern void MemorySnapShot_Restore_Do(void);
+extern bool MemorySnapShot_CaptureBuffer(MEMSNAP_BUFFER *pBuffer);
+extern void MemorySnapShot_RestoreBuffer(MEMSNAP_BUFFER *pBuffer);
+extern void MemorySnapShot_FreeBuffer(MEMSNAP_BUFFER *pBuffer);
+extern void MemorySnapShot_SharePages(bool bEnable);
+extern Uint32 MemorySnapShot_PagesSize(void);
+extern void MemorySnapShot_UnInit(void);
@@ -103,6 +103,7 @@ extern void Screen_EnterFullScreen(void);
 extern void Screen_ReturnFromFullScreen(void);
 extern void Screen_ModeChanged(bool bForceChange);
 extern bool Screen_Draw(void);
+extern void Screen_RenderWait(void);
 extern void Screen_SetTextureScale(int width, int height, int win_width,
                                    int win_height, bool bForceCreation);
 extern void Screen_SetGenConvSize(int width, int height, int bpp, bool bForceChange);
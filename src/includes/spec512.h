@@ -11,6 +11,7 @@
 extern bool Spec512_IsImage(void);
 extern void Spec512_StartVBL(void);
 extern void Spec512_StoreCyclePalette(Uint16 col, Uint32 addr);
+extern void Spec512_EndFrame(void);
 extern void Spec512_StartFrame(void);
 extern void Spec512_ScanWholeLine(void);
 extern void Spec512_StartScanLine(void);
@@ -41,11 +41,35 @@ extern Uint32	MMU_Bank0_Size;
 extern Uint32	MMU_Bank1_Size;
 
 
+/* Dirty page tracking for ST RAM : one bit per page of 256 bytes */
+#define	STMEMORY_DIRTY_PAGE_SHIFT	8
+#define	STMEMORY_DIRTY_PAGE_SIZE	( 1 << STMEMORY_DIRTY_PAGE_SHIFT )
+#define	STMEMORY_DIRTY_PAGES		( ( 16*1024*1024 ) >> STMEMORY_DIRTY_PAGE_SHIFT )
+#define	STMEMORY_DIRTY_WORDS		( STMEMORY_DIRTY_PAGES / 32 )
+
+extern Uint32	*STMemory_DirtyBitmap;		/* NULL when dirty page tracking is disabled */
+
+/**
+ * Mark the ST RAM pages covered by a write of 'size' bytes at physical
+ * address 'addr' as dirty. Callers must check STMemory_DirtyBitmap first.
+ */
+static inline void STMemory_DirtyPages_Mark ( Uint32 addr , Uint32 size )
+{
+	Uint32	page = addr >> STMEMORY_DIRTY_PAGE_SHIFT;
+	Uint32	last = ( addr + size - 1 ) >> STMEMORY_DIRTY_PAGE_SHIFT;
+
+	if ( last >= STMEMORY_DIRTY_PAGES )
+		last = STMEMORY_DIRTY_PAGES - 1;
+	for ( ; page <= last ; page++ )
+		STMemory_DirtyBitmap[ page >> 5 ] |= 1U << ( page & 31 );
+}
+
+
 extern void STMemory_Init ( int RAM_Size_Byte );
 extern void STMemory_Reset ( bool bCold );
 
 extern bool STMemory_SafeClear(Uint32 addr, unsigned int len);
-extern bool STMemory_SafeCopy(Uint32 addr, Uint8 *src, unsigned int len, const char *name);
+extern bool STMemory_SafeCopy(Uint32 addr, const Uint8 *src, unsigned int len, const char *name);
 extern void STMemory_MemorySnapShot_Capture(bool bSave);
 extern void STMemory_SetDefaultConfig(void);
 extern int  STMemory_CorrectSTRamSize(void);
@@ -62,12 +86,20 @@ extern Uint32	STMemory_Read ( Uint32 addr , int size );
 extern Uint32	STMemory_ReadLong ( Uint32 addr );
 extern Uint16	STMemory_ReadWord ( Uint32 addr );
 extern Uint8	STMemory_ReadByte ( Uint32 addr );
+extern Uint8	*STMemory_GetRunPointer ( Uint32 addr , Uint32 maxSize , Uint32 *pRunSize );
+extern void	STMemory_ReadBlock ( Uint32 addr , Uint8 *dest , Uint32 size );
 
 extern Uint16	STMemory_DMA_ReadWord ( Uint32 addr );
 extern void	STMemory_DMA_WriteWord ( Uint32 addr , Uint16 value );
 extern Uint8	STMemory_DMA_ReadByte ( Uint32 addr );
 extern void	STMemory_DMA_WriteByte ( Uint32 addr , Uint8 value );
 
+extern int	STMemory_DirtyPages_Register ( void );
+extern void	STMemory_DirtyPages_Unregister ( int user );
+extern bool	STMemory_DirtyPages_IsEnabled ( void );
+extern Uint32	STMemory_DirtyPages_Fetch ( int user , Uint32 *pBitmap );
+extern void	STMemory_DirtyPages_MarkPointer ( const void *p , Uint32 size );
+
 extern void	STMemory_MMU_Config_ReadByte ( void );
 extern void	STMemory_MMU_Config_WriteByte ( void );
 
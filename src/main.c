@@ -56,6 +56,7 @@ const char Main_fileid[] = "Hatari main.c";
 #include "tos.h"
 #include "video.h"
 #include "avi_record.h"
+#include "benchmark.h"
 #include "debugui.h"
 #include "remotedebug.h"
 #include "clocks_timings.h"
@@ -180,6 +181,9 @@ static void	Time_Delay ( Sint64 ticks_micro )
  */
 bool Main_PauseEmulation(bool visualize)
 {
+	/* show frame which may still be converted */
+	Screen_RenderWait();
+
 	if ( !bEmulationActive )
 		return false;
 
@@ -325,8 +329,12 @@ void Main_WaitOnVbl(void)
 	Sint64 nDelay;
 
 	nVBLCount++;
+	if (BenchmarkMode)
+		Benchmark_VBL();
 	if (nRunVBLs &&	nVBLCount >= nRunVBLs)
 	{
+		if (BenchmarkMode)
+			Benchmark_Report();
 		/* show VBLs/s */
 		Main_PauseEmulation(true);
 		exit(0);
@@ -624,6 +632,7 @@ void Main_EventHandler(bool remoteDebugging)
 
 		 case SDL_WINDOWEVENT:
 			Log_Printf(LOG_DEBUG, "SDL2 window event: 0x%x\n", event.window.event);
+			Screen_RenderWait();
 			switch(event.window.event) {
 			case SDL_WINDOWEVENT_EXPOSED:
 				if (!ConfigureParams.Screen.bUseSdlRenderer)
@@ -792,6 +801,7 @@ static void Main_Init(void)
  */
 static void Main_UnInit(void)
 {
+	MemorySnapShot_UnInit();
 	RemoteDebug_UnInit();
 	Screen_ReturnFromFullScreen();
 	Floppy_UnInit();
@@ -955,6 +965,13 @@ int main(int argc, char *argv[])
 
 	/* Needed for proper behavior of Caps Lock on some systems */
 	setenv("SDL_DISABLE_LOCK_KEYS", "1", 1);
+
+	/* Run benchmarks headless, unless user has selected SDL drivers */
+	if (BenchmarkMode)
+	{
+		setenv("SDL_VIDEODRIVER", "dummy", 0);
+		setenv("SDL_AUDIODRIVER", "dummy", 0);
+	}
 #endif
 
 	/* Init emulator system */
@@ -978,6 +995,7 @@ int main(int argc, char *argv[])
 	Main_UnPauseEmulation();
 	M68000_Start();                 /* Start emulation */
 
+	Screen_RenderWait();
 	Control_RemoveFifo();
 	if (bRecordingAvi)
 	{
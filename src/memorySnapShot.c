@@ -19,6 +19,7 @@
 const char MemorySnapShot_fileid[] = "Hatari memorySnapShot.c";
 
 #include <SDL_types.h>
+#include <SDL_thread.h>
 #include <errno.h>
 
 #include "main.h"
@@ -61,6 +62,7 @@ const char MemorySnapShot_fileid[] = "Hatari memorySnapShot.c";
 
 #define VERSION_STRING      "2.4.0"   /* Version number of compatible memory snapshots - Always 6 bytes (inc' NULL) */
 #define SNAPSHOT_MAGIC      0xDeadBeef
+#define CORE_VERSION        1
 
 #if HAVE_LIBZ
 #define COMPRESS_MEMORYSNAPSHOT       /* Compress snapshots to reduce disk space used */
@@ -72,20 +74,86 @@ const char MemorySnapShot_fileid[] = "Hatari memorySnapShot.c";
 #undef mkdir
 #include <zlib.h>
 typedef gzFile MSS_File;
+#define MSS_WRITE_MODE "wb1"	/* fastest compression level */
 
 #else
 
 typedef FILE* MSS_File;
+#define MSS_WRITE_MODE "wb"
 
 #endif
 
+/* files are read & written in this size blocks */
+#define MSS_FILE_BLOCK (1024*1024)
+
+/* in-memory snapshot pages, and dirty tracking bits for one such page */
+#define MEMSNAP_PAGE_SHIFT 12
+#define MEMSNAP_PAGE_SIZE  (1 << MEMSNAP_PAGE_SHIFT)
+#define MEMSNAP_DIRTY_BITS (1 << (MEMSNAP_PAGE_SHIFT - STMEMORY_DIRTY_PAGE_SHIFT))
+/* max memory areas stored with pages */
+#define MEMSNAP_REGIONS    4
+
+struct memsnap_page
+{
+	Uint32 refs;
+	Uint8 data[MEMSNAP_PAGE_SIZE];
+};
+
+typedef struct
+{
+	Uint8 *pMem;
+	Uint32 Size;
+} MEMSNAP_REGION;
+
 
-static MSS_File CaptureFile;
 static bool bCaptureSave, bCaptureError;
 
+/* snapshot being saved/restored.  Snapshots are always captured
+ * to memory, file snapshots are compressed only when the whole
+ * buffer is written out (in a separate thread), and read back
+ * to memory before they're restored.
+ */
+static MEMSNAP_BUFFER *pCaptureBuffer;
+static Uint32 nCaptureOffset;
+
+/* memory areas stored so far to in-memory snapshot, page index
+ * of the next one, and whether they match the ones in LastPages
+ */
+static MEMSNAP_REGION CaptureRegion[MEMSNAP_REGIONS];
+static int nCaptureRegions;
+static Uint32 nCapturePage;
+static bool bCaptureLast;
+
+/* Pages of the last in-memory snapshot captured or restored.  Memory
+ * contents match them, except for pages written after that, so next
+ * snapshot can share the unchanged ones.  With dirty page tracking,
+ * ST RAM pages don't need to be compared to find the changed ones.
+ */
+static struct
+{
+	MEMSNAP_PAGE **pages;
+	Uint32 nPages;
+	Uint32 nAlloc;
+	MEMSNAP_REGION region[MEMSNAP_REGIONS];
+	int regions;
+	bool bTracked;		/* dirty tracking was on since they were stored */
+} LastPages;
+
+static bool bSharePages;	/* dirty page tracking enabled for snapshots */
+static int nDirtyUser = -1;	/* STMemory_DirtyPages_Register() ID for above */
+static Uint32 nLivePages;
+static Uint32 DirtyPages[STMEMORY_DIRTY_WORDS];
+
+/* buffer for file snapshots, owned by WriteThread while it runs */
+static MEMSNAP_BUFFER FileBuffer;
+static SDL_Thread *WriteThread;
+static char Write_FileName[FILENAME_MAX];
+
 
 static char Temp_FileName[FILENAME_MAX];
 static bool Temp_Confirm;
+static MEMSNAP_BUFFER *Temp_Buffer;
+static CNF_PARAMS Temp_Config;
 
 
 /*-----------------------------------------------------------------------*/
@@ -146,36 +214,308 @@ static int MemorySnapShot_fwrite(MSS_File fhndl, const char *buf, int len)
 
 /*-----------------------------------------------------------------------*/
 /**
- * Seek into file from current position
+ * Write FileBuffer contents to Write_FileName and free the buffer.
+ * Run in its own thread, so that compressing the snapshot doesn't
+ * stall the emulation.  Return zero on success.
  */
-static int MemorySnapShot_fseek(MSS_File fhndl, int pos)
+static int MemorySnapShot_WriteFile(void *pConfirm)
 {
-#ifdef COMPRESS_MEMORYSNAPSHOT
-	return (int)gzseek(fhndl, pos, SEEK_CUR);	/* return -1 if error, new position >=0 if OK */
-#else
-	return fseek(fhndl, pos, SEEK_CUR);		/* return -1 if error, 0 if OK */
-#endif
+	MSS_File fhndl;
+	Uint32 offset, len;
+	int ret = 0;
+
+	fhndl = MemorySnapShot_fopen(Write_FileName, MSS_WRITE_MODE);
+	if (!fhndl)
+	{
+		Log_Printf(LOG_WARN, "Save file open error: %s", strerror(errno));
+		ret = -1;
+	}
+	else
+	{
+		for (offset = 0; offset < FileBuffer.size; offset += len)
+		{
+			len = FileBuffer.size - offset;
+			if (len > MSS_FILE_BLOCK)
+				len = MSS_FILE_BLOCK;
+			if (MemorySnapShot_fwrite(fhndl, (char *)FileBuffer.data + offset, len) != (int)len)
+			{
+				ret = -1;
+				break;
+			}
+		}
+		MemorySnapShot_fclose(fhndl);
+	}
+	MemorySnapShot_FreeBuffer(&FileBuffer);
+
+	/* caller reports the result when confirmation was requested */
+	if (!pConfirm)
+	{
+		if (ret)
+			Log_Printf(LOG_ERROR, "Unable to save memory state to file: %s", Write_FileName);
+		else
+			Log_Printf(LOG_INFO, "Memory state file saved: %s", Write_FileName);
+	}
+	return ret;
 }
 
 
 /*-----------------------------------------------------------------------*/
 /**
- * Open/Create snapshot file, and set flag so 'MemorySnapShot_Store' knows
- * how to handle data.
+ * Wait for snapshot file write still in progress.
+ * Return false if it failed.
  */
-static bool MemorySnapShot_OpenFile(const char *pszFileName, bool bSave, bool bConfirm)
+static bool MemorySnapShot_WaitWrite(void)
+{
+	int ret = 0;
+
+	if (WriteThread)
+	{
+		SDL_WaitThread(WriteThread, &ret);
+		WriteThread = NULL;
+	}
+	return ret == 0;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Start writing FileBuffer contents to given file.  With confirmation,
+ * wait for the write to finish and return whether it succeeded,
+ * otherwise write result is logged when the write is done.
+ */
+static bool MemorySnapShot_StartWrite(const char *pszFileName, bool bConfirm)
+{
+	void *pConfirm = bConfirm ? &Temp_Confirm : NULL;
+
+	strlcpy(Write_FileName, pszFileName, sizeof(Write_FileName));
+	WriteThread = SDL_CreateThread(MemorySnapShot_WriteFile, "MemorySnapShot", pConfirm);
+	if (!WriteThread)
+		return MemorySnapShot_WriteFile(pConfirm) == 0;
+	if (bConfirm)
+		return MemorySnapShot_WaitWrite();
+	return true;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Read whole given snapshot file to FileBuffer.  Return false on error.
+ */
+static bool MemorySnapShot_ReadFile(const char *pszFileName)
+{
+	MSS_File fhndl;
+	Uint8 *pData;
+	Uint32 nAlloc;
+	int len;
+
+	fhndl = MemorySnapShot_fopen(pszFileName, "rb");
+	if (!fhndl)
+	{
+		Log_Printf(LOG_WARN, "File open error: %s", strerror(errno));
+		return false;
+	}
+	FileBuffer.size = 0;
+	for (;;)
+	{
+		if (FileBuffer.size + MSS_FILE_BLOCK > FileBuffer.alloc)
+		{
+			nAlloc = FileBuffer.alloc ? 2 * FileBuffer.alloc : 4 * MSS_FILE_BLOCK;
+			pData = realloc(FileBuffer.data, nAlloc);
+			if (!pData)
+			{
+				len = -1;
+				break;
+			}
+			FileBuffer.data = pData;
+			FileBuffer.alloc = nAlloc;
+		}
+		len = MemorySnapShot_fread(fhndl, (char *)FileBuffer.data + FileBuffer.size, MSS_FILE_BLOCK);
+		if (len <= 0)
+			break;
+		FileBuffer.size += len;
+	}
+	MemorySnapShot_fclose(fhndl);
+
+	if (len < 0)
+	{
+		Log_Printf(LOG_WARN, "File read error: %s", pszFileName);
+		MemorySnapShot_FreeBuffer(&FileBuffer);
+		return false;
+	}
+	return true;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Release given page reference, free page if it was the last one
+ */
+static void MemorySnapShot_UnrefPage(MEMSNAP_PAGE *pPage)
+{
+	if (--pPage->refs == 0)
+	{
+		free(pPage);
+		nLivePages--;
+	}
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Release memory pages referred by given buffer
+ */
+static void MemorySnapShot_ReleasePages(MEMSNAP_BUFFER *pBuffer)
+{
+	Uint32 i;
+
+	for (i = 0; i < pBuffer->nPages; i++)
+		MemorySnapShot_UnrefPage(pBuffer->pages[i]);
+	pBuffer->nPages = 0;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Add given page reference to buffer.  Return false if allocation fails.
+ */
+static bool MemorySnapShot_AddPage(MEMSNAP_BUFFER *pBuffer, MEMSNAP_PAGE *pPage)
+{
+	MEMSNAP_PAGE **pages;
+	Uint32 nAlloc;
+
+	if (pBuffer->nPages == pBuffer->nPagesAlloc)
+	{
+		nAlloc = pBuffer->nPagesAlloc ? 2 * pBuffer->nPagesAlloc : 1024;
+		pages = realloc(pBuffer->pages, nAlloc * sizeof(*pages));
+		if (!pages)
+			return false;
+		pBuffer->pages = pages;
+		pBuffer->nPagesAlloc = nAlloc;
+	}
+	pBuffer->pages[pBuffer->nPages++] = pPage;
+	return true;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Forget pages of the last in-memory snapshot
+ */
+static void MemorySnapShot_DropLastPages(void)
+{
+	Uint32 i;
+
+	for (i = 0; i < LastPages.nPages; i++)
+		MemorySnapShot_UnrefPage(LastPages.pages[i]);
+	LastPages.nPages = 0;
+	LastPages.regions = 0;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Remember pages of given (just saved/restored) in-memory snapshot
+ */
+static void MemorySnapShot_SetLastPages(MEMSNAP_BUFFER *pBuffer)
+{
+	MEMSNAP_PAGE **pages;
+	Uint32 i;
+
+	/* reference new pages before old ones, as they're mostly the same */
+	for (i = 0; i < pBuffer->nPages; i++)
+		pBuffer->pages[i]->refs++;
+	MemorySnapShot_DropLastPages();
+
+	if (pBuffer->nPages > LastPages.nAlloc)
+	{
+		pages = realloc(LastPages.pages, pBuffer->nPages * sizeof(*pages));
+		if (!pages)
+		{
+			for (i = 0; i < pBuffer->nPages; i++)
+				MemorySnapShot_UnrefPage(pBuffer->pages[i]);
+			return;
+		}
+		LastPages.pages = pages;
+		LastPages.nAlloc = pBuffer->nPages;
+	}
+	memcpy(LastPages.pages, pBuffer->pages, pBuffer->nPages * sizeof(*pages));
+	LastPages.nPages = pBuffer->nPages;
+	memcpy(LastPages.region, CaptureRegion, nCaptureRegions * sizeof(*CaptureRegion));
+	LastPages.regions = nCaptureRegions;
+	LastPages.bTracked = bSharePages;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Start saving/restoring snapshot to/from memory buffer.  Buffer
+ * contents are the same as in (uncompressed) snapshot files.
+ */
+static bool MemorySnapShot_OpenBuffer(MEMSNAP_BUFFER *pBuffer, bool bSave)
 {
 	char VersionString[] = VERSION_STRING;
+	Uint8 CpuCore = CORE_VERSION;
 
-#define CORE_VERSION 1
+	bCaptureError = false;
+	bCaptureSave = bSave;
+	pCaptureBuffer = pBuffer;
+	nCaptureOffset = 0;
+	nCaptureRegions = 0;
+	nCapturePage = 0;
+	bCaptureLast = true;
+	if (bSave)
+		MemorySnapShot_ReleasePages(pBuffer);
+
+	MemorySnapShot_Store(VersionString, sizeof(VersionString));
+	MemorySnapShot_Store(&CpuCore, sizeof(CpuCore));
+	if (!bSave && (strcmp(VersionString, VERSION_STRING) || CpuCore != CORE_VERSION))
+		bCaptureError = true;
+
+	if (bCaptureError)
+		pCaptureBuffer = NULL;
+	return !bCaptureError;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Close snapshot file or buffer.
+ */
+static void MemorySnapShot_CloseFile(void)
+{
+	if (bCaptureSave)
+		pCaptureBuffer->size = nCaptureOffset;
+	else if (pCaptureBuffer == &FileBuffer)
+		MemorySnapShot_FreeBuffer(&FileBuffer);
+
+	if (pCaptureBuffer != &FileBuffer)
+	{
+		if (bCaptureError)
+			MemorySnapShot_DropLastPages();
+		else
+			MemorySnapShot_SetLastPages(pCaptureBuffer);
+	}
+	pCaptureBuffer = NULL;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Start capturing snapshot for a file, or read snapshot file for
+ * restoring, and set flag so 'MemorySnapShot_Store' knows how to
+ * handle data.
+ */
+static bool MemorySnapShot_OpenFile(const char *pszFileName, bool bSave, bool bConfirm)
+{
+	char VersionString[] = VERSION_STRING;
 	Uint8 CpuCore;
 
 	/* Set error */
 	bCaptureError = false;
 
-	/* after opening file, set bCaptureSave to indicate whether
-	 * 'MemorySnapShot_Store' should load from or save to a file
-	 */
+	/* previous save may be writing the same file */
+	MemorySnapShot_WaitWrite();
+
 	if (bSave)
 	{
 		if (bConfirm && !File_QueryOverwrite(pszFileName))
@@ -184,56 +524,45 @@ static bool MemorySnapShot_OpenFile(const char *pszFileName, bool bSave, bool bC
 			Log_Printf(LOG_INFO, "Save canceled.");
 			return false;
 		}
-		/* Save */
-		CaptureFile = MemorySnapShot_fopen(pszFileName, "wb");
-		if (!CaptureFile)
-		{
-			Log_Printf(LOG_WARN, "Save file open error: %s",strerror(errno));
-			bCaptureError = true;
-			return false;
-		}
-		bCaptureSave = true;
-		/* Store version string */
-		MemorySnapShot_Store(VersionString, sizeof(VersionString));
-		/* Store CPU core version */
-		CpuCore = CORE_VERSION;
-		MemorySnapShot_Store(&CpuCore, sizeof(CpuCore));
+		/* Save, stores also version string and CPU core version */
+		return MemorySnapShot_OpenBuffer(&FileBuffer, true);
 	}
-	else
+
+	/* Restore */
+	if (!MemorySnapShot_ReadFile(pszFileName))
 	{
-		/* Restore */
-		CaptureFile = MemorySnapShot_fopen(pszFileName, "rb");
-		if (!CaptureFile)
-		{
-			Log_Printf(LOG_WARN, "File open error: %s", strerror(errno));
-			bCaptureError = true;
-			return false;
-		}
-		bCaptureSave = false;
-		/* Restore version string */
-		MemorySnapShot_Store(VersionString, sizeof(VersionString));
-		/* Does match current version? */
-		if (strcmp(VersionString, VERSION_STRING))
-		{
-			/* No, inform user and error */
-			Log_AlertDlg(LOG_ERROR,
-				     "Unable to restore Hatari memory state.\n"
-				     "Given state file is compatible only with\n"
-				     "Hatari version %s", VersionString);
-			bCaptureError = true;
-			return false;
-		}
-		/* Check CPU core version */
-		MemorySnapShot_Store(&CpuCore, sizeof(CpuCore));
-		if (CpuCore != CORE_VERSION)
-		{
-			Log_AlertDlg(LOG_ERROR,
-				     "Unable to restore Hatari memory state.\n"
-				     "Given state file is for different Hatari\n"
-				     "CPU core version.");
-			bCaptureError = true;
-			return false;
-		}
+		bCaptureError = true;
+		return false;
+	}
+	bCaptureSave = false;
+	pCaptureBuffer = &FileBuffer;
+	nCaptureOffset = 0;
+
+	/* Restore version string */
+	MemorySnapShot_Store(VersionString, sizeof(VersionString));
+	/* Does match current version? */
+	if (strcmp(VersionString, VERSION_STRING))
+	{
+		/* No, inform user and error */
+		MemorySnapShot_CloseFile();
+		Log_AlertDlg(LOG_ERROR,
+			     "Unable to restore Hatari memory state.\n"
+			     "Given state file is compatible only with\n"
+			     "Hatari version %s", VersionString);
+		bCaptureError = true;
+		return false;
+	}
+	/* Check CPU core version */
+	MemorySnapShot_Store(&CpuCore, sizeof(CpuCore));
+	if (CpuCore != CORE_VERSION)
+	{
+		MemorySnapShot_CloseFile();
+		Log_AlertDlg(LOG_ERROR,
+			     "Unable to restore Hatari memory state.\n"
+			     "Given state file is for different Hatari\n"
+			     "CPU core version.");
+		bCaptureError = true;
+		return false;
 	}
 
 	/* All OK */
@@ -243,55 +572,193 @@ static bool MemorySnapShot_OpenFile(const char *pszFileName, bool bSave, bool bC
 
 /*-----------------------------------------------------------------------*/
 /**
- * Close snapshot file.
+ * Make sure that there's space for given number of bytes in the buffer
+ * being saved, and return pointer to it.  Return NULL if there isn't
+ * enough data in buffer being restored, or allocation fails.
  */
-static void MemorySnapShot_CloseFile(void)
+static Uint8 *MemorySnapShot_BufferSpace(int Size)
 {
-	MemorySnapShot_fclose(CaptureFile);
+	MEMSNAP_BUFFER *pBuffer = pCaptureBuffer;
+	Uint32 nAlloc;
+	Uint8 *pData;
+
+	if (!bCaptureSave)
+	{
+		if (nCaptureOffset + Size > pBuffer->size)
+			return NULL;
+	}
+	else if (nCaptureOffset + Size > pBuffer->alloc)
+	{
+		nAlloc = pBuffer->alloc ? pBuffer->alloc : 64*1024;
+		while (nCaptureOffset + Size > nAlloc)
+			nAlloc *= 2;
+		pData = realloc(pBuffer->data, nAlloc);
+		if (!pData)
+			return NULL;
+		pBuffer->data = pData;
+		pBuffer->alloc = nAlloc;
+	}
+	pData = pBuffer->data + nCaptureOffset;
+	nCaptureOffset += Size;
+	return pData;
 }
 
 
 /*-----------------------------------------------------------------------*/
 /**
- * Skip Nb bytes when reading from/writing to file.
+ * Skip Nb bytes when reading from/writing to snapshot.
  */
 void MemorySnapShot_Skip(int Nb)
 {
-	int res;
+	Uint8 *pSpace;
 
-	/* Check no file errors */
-	if (CaptureFile != NULL)
-	{
-		res = MemorySnapShot_fseek(CaptureFile, Nb);
+	if (!pCaptureBuffer)
+		return;
 
-		/* Did seek OK? */
-		if (res < 0)
-			bCaptureError = true;
-	}
+	pSpace = MemorySnapShot_BufferSpace(Nb);
+	if (!pSpace)
+		bCaptureError = true;
+	else if (bCaptureSave)
+		memset(pSpace, 0, Nb);
 }
 
 
 /*-----------------------------------------------------------------------*/
 /**
- * Save/Restore data to/from file.
+ * Save/Restore data to/from snapshot.
  */
 void MemorySnapShot_Store(void *pData, int Size)
 {
-	long nBytes;
+	Uint8 *pSpace;
+
+	if (!pCaptureBuffer)
+		return;
+
+	/* Saving or Restoring? */
+	pSpace = MemorySnapShot_BufferSpace(Size);
+	if (!pSpace)
+		bCaptureError = true;
+	else if (bCaptureSave)
+		memcpy(pSpace, pData, Size);
+	else
+		memcpy(pData, pSpace, Size);
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Return true if given snapshot page has been written since dirty
+ * page bitmap was fetched to DirtyPages[]
+ */
+static bool MemorySnapShot_PageDirty(Uint32 page)
+{
+	Uint32 bit = page * MEMSNAP_DIRTY_BITS;
 
-	/* Check no file errors */
-	if (CaptureFile != NULL)
+	if (bit >= STMEMORY_DIRTY_PAGES)
+		return true;
+	return (DirtyPages[bit >> 5] >> (bit & 31)) & (Uint32)((1ULL << MEMSNAP_DIRTY_BITS) - 1);
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Save/Restore memory area to/from snapshot.  Files have the area
+ * contents as-is, in-memory snapshots have it in pages, shared with
+ * the previous snapshot when they're unchanged.  'bTracked' tells that
+ * the area is ST RAM, for which dirty page tracking tells the changed
+ * pages (without comparing them), if MemorySnapShot_SharePages() has
+ * enabled it.  That relies on every ST RAM write being tracked, see
+ * STMemory_DirtyPages_Register().
+ * Return true if restored area was tracked, and dirty pages are already
+ * cleared accordingly, i.e. whole area doesn't need to be marked dirty.
+ */
+bool MemorySnapShot_StorePages(Uint8 *pMem, Uint32 Size, bool bTracked)
+{
+	MEMSNAP_BUFFER *pBuffer = pCaptureBuffer;
+	MEMSNAP_PAGE *pPage, *pPrev;
+	Uint32 nSize = Size, first, count, len, i;
+	bool bUseDirty;
+	Uint8 *pData;
+
+	if (!pBuffer || pBuffer == &FileBuffer)
 	{
-		/* Saving or Restoring? */
-		if (bCaptureSave)
-			nBytes = MemorySnapShot_fwrite(CaptureFile, (char *)pData, Size);
-		else
-			nBytes = MemorySnapShot_fread(CaptureFile, (char *)pData, Size);
+		MemorySnapShot_Store(pMem, Size);
+		return false;
+	}
+
+	MemorySnapShot_Store(&nSize, sizeof(nSize));
+	if (nSize != Size || nCaptureRegions == MEMSNAP_REGIONS)
+		bCaptureError = true;
+	if (bCaptureError)
+		return false;
+
+	/* can pages be compared with the ones from last snapshot? */
+	if (nCaptureRegions >= LastPages.regions
+	    || LastPages.region[nCaptureRegions].pMem != pMem
+	    || LastPages.region[nCaptureRegions].Size != Size)
+		bCaptureLast = false;
+	CaptureRegion[nCaptureRegions].pMem = pMem;
+	CaptureRegion[nCaptureRegions].Size = Size;
+	nCaptureRegions++;
+
+	bTracked = bTracked && bSharePages;
+	if (bTracked)
+		STMemory_DirtyPages_Fetch(nDirtyUser, DirtyPages);
+	bUseDirty = bTracked && bCaptureLast && LastPages.bTracked;
+
+	first = nCapturePage;
+	count = (Size + MEMSNAP_PAGE_SIZE - 1) >> MEMSNAP_PAGE_SHIFT;
+	if (!bCaptureSave && first + count > pBuffer->nPages)
+	{
+		bCaptureError = true;
+		return false;
+	}
+	if (bCaptureLast && first + count > LastPages.nPages)
+		bCaptureLast = false;
+
+	for (i = 0; i < count; i++)
+	{
+		pData = pMem + (i << MEMSNAP_PAGE_SHIFT);
+		len = Size - (i << MEMSNAP_PAGE_SHIFT);
+		if (len > MEMSNAP_PAGE_SIZE)
+			len = MEMSNAP_PAGE_SIZE;
+		pPrev = bCaptureLast ? LastPages.pages[first + i] : NULL;
+
+		if (!bCaptureSave)
+		{
+			pPage = pBuffer->pages[first + i];
+			if (!bUseDirty || pPage != pPrev || MemorySnapShot_PageDirty(i))
+				memcpy(pData, pPage->data, len);
+			continue;
+		}
 
-		/* Did save OK? */
-		if (nBytes != Size)
+		if (pPrev && (bUseDirty ? !MemorySnapShot_PageDirty(i)
+			      : !memcmp(pPrev->data, pData, len)))
+		{
+			pPage = pPrev;
+			pPage->refs++;
+		}
+		else
+		{
+			pPage = malloc(sizeof(*pPage));
+			if (!pPage)
+			{
+				bCaptureError = true;
+				return false;
+			}
+			pPage->refs = 1;
+			nLivePages++;
+			memcpy(pPage->data, pData, len);
+		}
+		if (!MemorySnapShot_AddPage(pBuffer, pPage))
+		{
+			MemorySnapShot_UnrefPage(pPage);
 			bCaptureError = true;
+			return false;
+		}
 	}
+	nCapturePage += count;
+	return bTracked && !bCaptureSave;
 }
 
 
@@ -336,7 +803,8 @@ void MemorySnapShot_Capture_Do(void)
 	Uint32 magic = SNAPSHOT_MAGIC;
 
 	/* Set to 'saving' */
-	if (MemorySnapShot_OpenFile(Temp_FileName, true, Temp_Confirm))
+	if (Temp_Buffer ? MemorySnapShot_OpenBuffer(Temp_Buffer, true)
+	    : MemorySnapShot_OpenFile(Temp_FileName, true, Temp_Confirm))
 	{
 		/* Capture each files details */
 		Configuration_MemorySnapShot_Capture(true);
@@ -362,7 +830,7 @@ void MemorySnapShot_Capture_Do(void)
 		Crossbar_MemorySnapShot_Capture(true);
 		VIDEL_MemorySnapShot_Capture(true);
 		DSP_MemorySnapShot_Capture(true);
-		DebugUI_MemorySnapShot_Capture(Temp_FileName, true);
+		DebugUI_MemorySnapShot_Capture(Temp_Buffer ? NULL : Temp_FileName, true);
 		IoMem_MemorySnapShot_Capture(true);
 		ScreenConv_MemorySnapShot_Capture(true);
 		SCC_MemorySnapShot_Capture(true);
@@ -377,13 +845,114 @@ void MemorySnapShot_Capture_Do(void)
 			return;
 	}
 
+	if (!Temp_Buffer)
+	{
+		if (bCaptureError)
+			MemorySnapShot_FreeBuffer(&FileBuffer);
+		else if (!MemorySnapShot_StartWrite(Temp_FileName, Temp_Confirm))
+			bCaptureError = true;
+		else if (!Temp_Confirm)
+			return;		/* write thread logs the result */
+	}
+
+	if (Temp_Buffer)
+	{
+		Temp_Buffer = NULL;
+		if (bCaptureError)
+			Log_Printf(LOG_WARN, "Unable to save memory state to memory.");
+		return;
+	}
+
 	/* Did error */
 	if (bCaptureError)
 		Log_AlertDlg(LOG_ERROR, "Unable to save memory state to file: %s", Temp_FileName);
 	else if (Temp_Confirm)
 		Log_AlertDlg(LOG_INFO, "Memory state file saved: %s", Temp_FileName);
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Save 'snapshot' of memory/chips/emulation variables immediately
+ * to given memory buffer, growing it as needed (used by the debugger
+ * rewind).  Return false on error.
+ */
+bool MemorySnapShot_CaptureBuffer(MEMSNAP_BUFFER *pBuffer)
+{
+	Temp_Buffer = pBuffer;
+	Temp_Confirm = false;
+
+	MemorySnapShot_Capture_Do ();
+	return !bCaptureError;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Restore 'snapshot' of memory/chips/emulation variables from given
+ * memory buffer.  Like with files, restore happens after the current
+ * instruction, so buffer needs to stay valid until that.
+ */
+void MemorySnapShot_RestoreBuffer(MEMSNAP_BUFFER *pBuffer)
+{
+	Temp_Buffer = pBuffer;
+	Temp_Confirm = false;
+
+	UAE_Set_State_Restore ();
+	UAE_Set_Quit_Reset ( false );
+	set_special(SPCFLAG_MODE_CHANGE);
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Free memory buffer contents
+ */
+void MemorySnapShot_FreeBuffer(MEMSNAP_BUFFER *pBuffer)
+{
+	MemorySnapShot_ReleasePages(pBuffer);
+	free(pBuffer->pages);
+	free(pBuffer->data);
+	pBuffer->pages = NULL;
+	pBuffer->data = NULL;
+	pBuffer->size = pBuffer->alloc = 0;
+	pBuffer->nPagesAlloc = 0;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Enable/disable dirty page tracking for ST RAM in in-memory snapshots.
+ * Without it, changed pages are found by comparing them to the ones
+ * in the previous snapshot.
+ */
+void MemorySnapShot_SharePages(bool bEnable)
+{
+	MemorySnapShot_DropLastPages();
+	if (bEnable == bSharePages)
+		return;
+	if (bEnable)
+	{
+		nDirtyUser = STMemory_DirtyPages_Register();
+		if (nDirtyUser < 0)
+			return;
+	}
 	else
-		Log_Printf(LOG_INFO, "Memory state file saved: %s", Temp_FileName);
+	{
+		STMemory_DirtyPages_Unregister(nDirtyUser);
+		nDirtyUser = -1;
+	}
+	bSharePages = bEnable;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Return how much memory (in KB) the in-memory snapshot pages take
+ */
+Uint32 MemorySnapShot_PagesSize(void)
+{
+	return nLivePages * (MEMSNAP_PAGE_SIZE / 1024);
 }
 
 
@@ -416,8 +985,12 @@ void MemorySnapShot_Restore_Do(void)
 
 //fprintf ( stderr , "MemorySnapShot_Restore_Do in\n" );
 	/* Set to 'restore' */
-	if (MemorySnapShot_OpenFile(Temp_FileName, false, Temp_Confirm))
+	if (Temp_Buffer ? MemorySnapShot_OpenBuffer(Temp_Buffer, false)
+	    : MemorySnapShot_OpenFile(Temp_FileName, false, Temp_Confirm))
 	{
+		/* for checking whether emulated machine changes */
+		memcpy(&Temp_Config, &ConfigureParams, sizeof(Temp_Config));
+
 		Configuration_MemorySnapShot_Capture(false);
 		TOS_MemorySnapShot_Capture(false);
 
@@ -429,9 +1002,22 @@ void MemorySnapShot_Restore_Do(void)
 		/* This should be split in different functions / order to avoid this loop */
 		currprefs.address_space_24 = ConfigureParams.System.bAddressSpace24;
 
-		/* Reset emulator to get things running */
-		IoMem_UnInit();  IoMem_Init();
-		Reset_Cold();
+		/* Reset emulator to get things running.  In-memory snapshots
+		 * for the same machine (e.g. rewind) need only warm reset,
+		 * as RAM, ROM and IO memory contents come from the snapshot.
+		 * This skips reloading TOS & re-initializing IO memory.
+		 */
+		if (Temp_Buffer && !memcmp(&Temp_Config, &ConfigureParams, sizeof(Temp_Config)))
+		{
+			Reset_Warm();
+		}
+		else
+		{
+			/* memory may have been re-allocated / cleared */
+			MemorySnapShot_DropLastPages();
+			IoMem_UnInit();  IoMem_Init();
+			Reset_Cold();
+		}
 
 		/* Capture each files details */
 		STMemory_MemorySnapShot_Capture(false);
@@ -455,7 +1041,7 @@ void MemorySnapShot_Restore_Do(void)
 		Crossbar_MemorySnapShot_Capture(false);
 		VIDEL_MemorySnapShot_Capture(false);
 		DSP_MemorySnapShot_Capture(false);
-		DebugUI_MemorySnapShot_Capture(Temp_FileName, false);
+		DebugUI_MemorySnapShot_Capture(Temp_Buffer ? NULL : Temp_FileName, false);
 		IoMem_MemorySnapShot_Capture(false);
 		ScreenConv_MemorySnapShot_Capture(false);
 		SCC_MemorySnapShot_Capture(false);
@@ -476,6 +1062,7 @@ void MemorySnapShot_Restore_Do(void)
 
 		if (bCaptureError)
 		{
+			Temp_Buffer = NULL;
 			Log_AlertDlg(LOG_ERROR, "Full memory state restore failed!\nPlease reboot emulation.");
 			return;
 		}
@@ -483,6 +1070,14 @@ void MemorySnapShot_Restore_Do(void)
 
 //fprintf ( stderr , "MemorySnapShot_Restore_Do out\n" );
 
+	if (Temp_Buffer)
+	{
+		Temp_Buffer = NULL;
+		if (bCaptureError)
+			Log_AlertDlg(LOG_ERROR, "Unable to restore memory state from memory.");
+		return;
+	}
+
 	/* Did error? */
 	if (bCaptureError)
 		Log_AlertDlg(LOG_ERROR, "Unable to restore memory state from file: %s", Temp_FileName);
@@ -493,6 +1088,21 @@ void MemorySnapShot_Restore_Do(void)
 }
 
 
+/*-----------------------------------------------------------------------*/
+/**
+ * Finish snapshot file write still in progress (e.g. auto-save on exit),
+ * and free pages of the last in-memory snapshot
+ */
+void MemorySnapShot_UnInit(void)
+{
+	MemorySnapShot_WaitWrite();
+	MemorySnapShot_DropLastPages();
+	free(LastPages.pages);
+	LastPages.pages = NULL;
+	LastPages.nAlloc = 0;
+}
+
+
 /*-----------------------------------------------------------------------*/
 /*
  * Save and restore functions required by the UAE CPU core...
@@ -189,7 +189,7 @@ static int scsi_receive_data(struct scsi_data *sd, uae_u8 *b, bool next)
 		fprintf(stderr, "scsi_receive_data without length!\n");
 		return -1;
 	}
-	*b = ScsiBus.buffer[ScsiBus.offset];
+	*b = ScsiBus.data[ScsiBus.offset];
 	// fprintf(stderr,"scsi_receive_data %i <-> %i (%i)\n",
 	//         ScsiBus.offset, ScsiBus.data_len, next);
 	if (next) {
@@ -573,17 +573,16 @@ static void raw_scsi_write_data(struct raw_scsi *rs, uae_u8 data)
 #if RAW_SCSI_DEBUG
 			write_log(_T("raw_scsi: data out finished, %d bytes\n"), ScsiBus.data_len);
 #endif
-			if (ScsiBus.dmawrite_to_fh)
+			if (ScsiBus.dmawrite_to_img)
 			{
-				int r;
-				r = fwrite(ScsiBus.buffer, 1, ScsiBus.data_len, ScsiBus.dmawrite_to_fh);
-				if (r != ScsiBus.data_len)
+				if (!HDC_ImageWrite(ScsiBus.dmawrite_to_img, ScsiBus.dmawrite_offset,
+				                    ScsiBus.buffer, ScsiBus.data_len, false))
 				{
-					Log_Printf(LOG_ERROR, "Could not write bytes to HD image (%d/%d).\n",
-					           r, ScsiBus.data_len);
+					Log_Printf(LOG_ERROR, "Could not write %d bytes to HD image.\n",
+					           ScsiBus.data_len);
 					ScsiBus.status = HD_STATUS_ERROR;
 				}
-				ScsiBus.dmawrite_to_fh = NULL;
+				ScsiBus.dmawrite_to_img = NULL;
 			}
 
 			rs->bus_phase = SCSI_SIGNAL_PHASE_STATUS;
@@ -740,7 +739,7 @@ static void dma_check(struct soft_scsi *ncr)
 			}
 		}
 	}
-	else if (ncr_soft_scsi.dma_direction > 0 && ScsiBus.dmawrite_to_fh)
+	else if (ncr_soft_scsi.dma_direction > 0 && ScsiBus.dmawrite_to_img)
 	{
 		/* write - if allowed */
 		if (STMemory_CheckAreaType(nDmaAddr, nDataLen, ABFLAG_RAM | ABFLAG_ROM))
@@ -1039,7 +1038,7 @@ bool Ncr5380_Init(void)
 			continue;
 		if (HDC_InitDevice("SCSI", &ScsiBus.devs[i], ConfigureParams.Scsi[i].sDeviceFile, ConfigureParams.Scsi[i].nBlockSize) == 0)
 		{
-			nScsiPartitions += HDC_PartitionCount(ScsiBus.devs[i].image_file, TRACE_SCSI_CMD, NULL);
+			nScsiPartitions += HDC_PartitionCount(&ScsiBus.devs[i].image, TRACE_SCSI_CMD, NULL);
 			bScsiEmuOn = true;
 		}
 		else
@@ -1063,9 +1062,7 @@ void Ncr5380_UnInit(void)
 	{
 		if (!ScsiBus.devs[i].enabled)
 			continue;
-		File_UnLock(ScsiBus.devs[i].image_file);
-		fclose(ScsiBus.devs[i].image_file);
-		ScsiBus.devs[i].image_file = NULL;
+		HDC_ImageClose(&ScsiBus.devs[i].image);
 		ScsiBus.devs[i].enabled = false;
 	}
 	free(ScsiBus.buffer);
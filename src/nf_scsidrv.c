@@ -190,6 +190,7 @@ static int scsidrv_interface_features(Uint32 stack)
 
 	strncpy(busName, BUS_NAME, 20);
 	M68000_Flush_Data_Cache(st_bus_name, 20);
+	STMemory_DirtyPages_MarkPointer(busName, 20);
 	write_word(features, BUS_FEATURES);
 	write_long(transferLen, BUS_TRANSFER_LEN);
 
@@ -351,6 +352,7 @@ static int scsidrv_inout(Uint32 stack)
 			sense_buffer[2] = 0x05;
 			sense_buffer[12] = 0x25;
 			M68000_Flush_Data_Cache(st_sense_buffer, 18);
+			STMemory_DirtyPages_MarkPointer(sense_buffer, 18);
 
 			LOG_TRACE(TRACE_SCSIDRV,
 			          "\n               Sense Key=$%02X, ASC=$%02X, ASCQ=$00",
@@ -436,9 +438,14 @@ static int scsidrv_inout(Uint32 stack)
 	}
 
 	M68000_Flush_Data_Cache(st_sense_buffer, 18);
+	if (sense_buffer)
+	{
+		STMemory_DirtyPages_MarkPointer(sense_buffer, 18);
+	}
 	if (!dir)
 	{
 		M68000_Flush_All_Caches(st_buffer, transfer_len);
+		STMemory_DirtyPages_MarkPointer(buffer, transfer_len);
 	}
 
 	return status;
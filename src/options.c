@@ -53,6 +53,7 @@ bool bLoadMemorySave;      /* Load memory snapshot provided via option at startu
 bool AviRecordOnStartup;   /* Start avi recording at startup */
 bool BenchmarkMode;	   /* Start in benchmark mode (try to run at maximum emulation */
 			   /* speed allowed by the CPU). Disable audio/video for best results */
+char BenchmarkJsonFile[FILENAME_MAX];  /* Benchmark results file (--bench-json) */
 
 static bool bBiosIntercept;
 
@@ -92,6 +93,7 @@ enum {
 	OPT_BORDERS,		/* ST/STE display options */
 	OPT_SPEC512,
 	OPT_VIDEO_TIMING,
+	OPT_RENDER_THREAD,
 
 	OPT_RESOLUTION,		/* TT/Falcon display options */
 	OPT_FORCE_MAX,
@@ -150,6 +152,7 @@ enum {
 	OPT_IDEMASTERHDIMAGE,
 	OPT_IDESLAVEHDIMAGE,
 	OPT_IDEBYTESWAP,
+	OPT_HDMMAP,
 
 	OPT_MEMSIZE,		/* memory options */
 	OPT_TT_RAM,
@@ -203,6 +206,7 @@ enum {
 	OPT_ALERTLEVEL,
 	OPT_RUNVBLS,
 	OPT_BENCHMARK,
+	OPT_BENCHJSON,
 	OPT_ERROR,
 	OPT_CONTINUE
 };
@@ -283,6 +287,8 @@ static const opt_t HatariOptions[] = {
 	  "<x>", "Spec512 palette threshold (0 <= x <= 512, 0=disable)" },
 	{ OPT_VIDEO_TIMING,   NULL, "--video-timing",
 	  "<x>", "Wakeup State for MMU/GLUE (x=ws1/ws2/ws3/ws4/random, default ws3)" },
+	{ OPT_RENDER_THREAD, NULL, "--render-thread",
+	  "<bool>", "Convert screen in a separate thread" },
 
 	{ OPT_HEADER, NULL, NULL, NULL, "TT/Falcon specific display" },
 	{ OPT_RESOLUTION, NULL, "--desktop",
@@ -401,6 +407,8 @@ static const opt_t HatariOptions[] = {
 	  "<file>", "Emulate an IDE 1 (slave) harddrive with an image <file>" },
 	{ OPT_IDEBYTESWAP,   NULL, "--ide-swap",
 	  "<id>=<x>", "Set IDE (0/1) byte-swap option (off/on/auto)" },
+	{ OPT_HDMMAP,   NULL, "--hd-mmap",
+	  "<bool>", "Memory-map ACSI/SCSI/IDE harddrive image files" },
 
 	{ OPT_HEADER, NULL, NULL, NULL, "Memory" },
 	{ OPT_MEMSIZE,   "-s", "--memsize",
@@ -506,6 +514,8 @@ static const opt_t HatariOptions[] = {
 	  "<x>", "Exit after x VBLs" },
 	{ OPT_BENCHMARK, NULL, "--benchmark",
 	  NULL, "Start in benchmark mode (use with --run-vbls)" },
+	{ OPT_BENCHJSON, NULL, "--bench-json",
+	  "<file>", "Save benchmark results as JSON to <file> (-=stdout)" },
 
 	{ OPT_ERROR, NULL, NULL, NULL, NULL }
 };
@@ -1271,6 +1281,10 @@ bool Opt_ParseParameters(int argc, const char * const argv[])
 				return Opt_ShowError(OPT_VIDEO_TIMING, argv[i], "Unknown video timing mode");
 			break;
 
+		case OPT_RENDER_THREAD:
+			ok = Opt_Bool(argv[++i], OPT_RENDER_THREAD, &ConfigureParams.Screen.bRenderThread);
+			break;
+
 			/* Falcon/TT display options */
 		case OPT_RESOLUTION:
 			ok = Opt_Bool(argv[++i], OPT_RESOLUTION, &ConfigureParams.Screen.bKeepResolution);
@@ -1720,6 +1734,10 @@ bool Opt_ParseParameters(int argc, const char * const argv[])
 				return Opt_ShowError(OPT_IDEBYTESWAP, argv[i], "Invalid byte-swap setting");
 			break;
 
+		case OPT_HDMMAP:
+			ok = Opt_Bool(argv[++i], OPT_HDMMAP, &ConfigureParams.HardDisk.bMmapImages);
+			break;
+
 			/* Memory options */
 		case OPT_MEMSIZE:
 			memsize = atoi(argv[++i]);
@@ -2246,6 +2264,12 @@ bool Opt_ParseParameters(int argc, const char * const argv[])
 			BenchmarkMode = true;
 			break;
 
+		case OPT_BENCHJSON:
+			i += 1;
+			ok = Opt_StrCpy(OPT_BENCHJSON, false, BenchmarkJsonFile,
+					argv[i], sizeof(BenchmarkJsonFile), NULL);
+			break;
+
 		case OPT_ERROR:
 			/* unknown option or missing option parameter */
 			return false;
@@ -33,6 +33,7 @@ const char Screen_fileid[] = "Hatari screen.c";
 #include "main.h"
 #include "configuration.h"
 #include "avi_record.h"
+#include "bitplanes.h"
 #include "file.h"
 #include "log.h"
 #include "paths.h"
@@ -77,6 +78,7 @@ Uint8 *pSTScreen;
 FRAMEBUFFER *pFrameBuffer;    /* Pointer into current 'FrameBuffer' */
 
 static FRAMEBUFFER FrameBuffer;     /* Store frame buffer details to tell how to update */
+static Uint8 *pSTScreenConv;        /* ST screen being converted */
 static Uint8 *pSTScreenCopy;        /* Keep track of current and previous ST screen data */
 static Uint8 *pPCScreenDest;        /* Destination PC buffer */
 static int STScreenEndHorizLine;    /* End lines to be converted */
@@ -101,6 +103,8 @@ static int genconv_width_req, genconv_height_req, genconv_bpp;
 
 
 static bool Screen_DrawFrame(bool bForceFlip);
+static void Screen_StartRenderThread(void);
+static void Screen_StopRenderThread(void);
 
 SDL_Window *sdlWindow;
 static SDL_Renderer *sdlRenderer;
@@ -108,6 +112,28 @@ static SDL_Texture *sdlTexture;
 static bool bUseSdlRenderer;            /* true when using SDL2 renderer */
 static bool bIsSoftwareRenderer;
 
+/* Optional render thread, converting the ST screen while emulation
+ * continues with the next frame.  Updating the SDL texture and presenting
+ * it is still done on the emulation thread, as SDL renderer functions
+ * may be called only from the thread which created the renderer.
+ */
+enum
+{
+	RENDER_IDLE,
+	RENDER_BUSY,
+	RENDER_DONE,
+	RENDER_QUIT
+};
+static struct
+{
+	SDL_Thread *thread;
+	SDL_mutex *lock;
+	SDL_cond *cond;
+	int state;
+	void (*pConvert)(void);     /* Conversion function for handed over frame */
+	Uint8 *pSTScreenFree;       /* Third ST screen buffer, see Screen_RenderStart() */
+} Render;
+
 void SDL_UpdateRects(SDL_Surface *screen, int numrects, SDL_Rect *rects)
 {
 	if (bUseSdlRenderer)
@@ -191,7 +217,7 @@ static void Screen_ConvertHighRes(void)
 {
 	int linewidth = 640 / 16;
 
-	Screen_GenConvert(VideoBase, pSTScreen, 640, 400, 1, linewidth, 0, 0, 0, 0, 0);
+	Screen_GenConvert(VideoBase, pSTScreenConv, 640, 400, 1, linewidth, 0, 0, 0, 0, 0);
 	bScreenContentsChanged = true;
 }
 
@@ -681,6 +707,9 @@ static void Screen_ChangeResolution(bool bForceChange)
 {
 	int hbpp = ConfigureParams.Screen.nForceBpp;
 
+	/* SDL screen surface may be re-created */
+	Screen_RenderWait();
+
 	if (bUseVDIRes)
 	{
 		Screen_SetGenConvSize(VDIWidth, VDIHeight, hbpp, bForceChange);
@@ -729,6 +758,9 @@ void Screen_Init(void)
 	SDL_Surface *pIconSurf;
 	char sIconFileName[FILENAME_MAX];
 
+	/* Select bitplane conversion functions for host CPU */
+	Bitplanes_Init();
+
 	/* Clear frame buffer structures and set current pointer */
 	memset(&FrameBuffer, 0, sizeof(FRAMEBUFFER));
 
@@ -742,6 +774,9 @@ void Screen_Init(void)
 	}
 	pFrameBuffer = &FrameBuffer;  /* TODO: Replace pFrameBuffer with FrameBuffer everywhere */
 
+	if (ConfigureParams.Screen.bRenderThread)
+		Screen_StartRenderThread();
+
 	/* Set initial window resolution */
 	bInFullScreen = ConfigureParams.Screen.bFullScreen;
 	Screen_ChangeResolution(false);
@@ -771,6 +806,8 @@ void Screen_Init(void)
  */
 void Screen_UnInit(void)
 {
+	Screen_StopRenderThread();
+
 	/* Free memory used for copies */
 	free(FrameBuffer.pSTScreen);
 	free(FrameBuffer.pSTScreenCopy);
@@ -1120,7 +1157,7 @@ static void Screen_SetFullUpdateMask(void)
 	int y;
 
 	for (y = 0; y < NUM_VISIBLE_LINES; y++)
-		HBLPaletteMasks[y] |= PALETTEMASK_UPDATEFULL;
+		pFrameBuffer->HBLPaletteMasks[y] |= PALETTEMASK_UPDATEFULL;
 }
 
 
@@ -1130,7 +1167,7 @@ static void Screen_SetFullUpdateMask(void)
  */
 static void Screen_SetConvertDetails(void)
 {
-	pSTScreen = pFrameBuffer->pSTScreen;          /* Source in ST memory */
+	pSTScreenConv = pFrameBuffer->pSTScreen;      /* Source in ST memory */
 	pSTScreenCopy = pFrameBuffer->pSTScreenCopy;  /* Previous ST screen */
 	pPCScreenDest = sdlscrn->pixels;              /* Destination PC screen */
 
@@ -1139,7 +1176,6 @@ static void Screen_SetConvertDetails(void)
 	/* Center to available framebuffer */
 	pPCScreenDest += PCScreenOffsetY * PCScreenBytesPerLine + PCScreenOffsetX * (sdlscrn->format->BitsPerPixel/8);
 
-	pHBLPalettes = pFrameBuffer->HBLPalettes;     /* HBL palettes pointer */
 	/* Not in TV-Mode? Then double up on Y: */
 	bScrDoubleY = !(ConfigureParams.Screen.nMonitorType == MONITOR_TYPE_TV);
 
@@ -1207,7 +1243,6 @@ void Screen_UnLock(void)
  */
 static void Screen_Blit(SDL_Rect *sbar_rect)
 {
-	unsigned char *pTmpScreen;
 	int count = 1;
 	SDL_Rect rects[2];
 
@@ -1218,11 +1253,177 @@ static void Screen_Blit(SDL_Rect *sbar_rect)
 		count = 2;
 	}
 	SDL_UpdateRects(sdlscrn, count, rects);
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Finish drawing of converted ST screen: unlock it, update statusbar
+ * and show the result to the user.
+ * @param  bForceFlip  Force screen update, even if contents did not change
+ * @return  true if screen was updated
+ */
+static bool Screen_ShowFrame(bool bForceFlip)
+{
+	SDL_Rect *sbar_rect;
+
+	/* Unlock screen */
+	Screen_UnLock();
+
+	/* draw overlay led(s) or statusbar after unlock */
+	Statusbar_OverlayBackup(sdlscrn);
+	sbar_rect = Statusbar_Update(sdlscrn, false);
+
+	/* And show to user */
+	if (bScreenContentsChanged || bForceFlip || sbar_rect)
+	{
+		Screen_Blit(sbar_rect);
+		return true;
+	}
+	return false;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Render thread main loop: convert frames handed over by Screen_RenderStart()
+ */
+static int Screen_RenderThread(void *data)
+{
+	SDL_LockMutex(Render.lock);
+	for (;;)
+	{
+		while (Render.state == RENDER_IDLE || Render.state == RENDER_DONE)
+			SDL_CondWait(Render.cond, Render.lock);
+		if (Render.state == RENDER_QUIT)
+			break;
+		SDL_UnlockMutex(Render.lock);
+
+		CALL_VAR(Render.pConvert);
+
+		SDL_LockMutex(Render.lock);
+		Render.state = RENDER_DONE;
+		SDL_CondBroadcast(Render.cond);
+	}
+	SDL_UnlockMutex(Render.lock);
+	return 0;
+}
+
+
+/**
+ * Free render thread resources
+ */
+static void Screen_FreeRenderThread(void)
+{
+	if (Render.cond)
+		SDL_DestroyCond(Render.cond);
+	if (Render.lock)
+		SDL_DestroyMutex(Render.lock);
+	free(Render.pSTScreenFree);
+	memset(&Render, 0, sizeof(Render));
+}
+
+
+/**
+ * Create render thread and the additional ST screen buffer it needs.
+ * On failure, screen is converted on the emulation thread as usual.
+ */
+static void Screen_StartRenderThread(void)
+{
+	Render.pSTScreenFree = malloc(MAX_VDI_BYTES);
+	Render.lock = SDL_CreateMutex();
+	Render.cond = SDL_CreateCond();
+	Render.state = RENDER_IDLE;
+	if (Render.pSTScreenFree && Render.lock && Render.cond)
+	{
+		Render.thread = SDL_CreateThread(Screen_RenderThread, "Screen_Render", NULL);
+	}
+	if (!Render.thread)
+	{
+		Log_Printf(LOG_WARN, "Failed to create render thread: %s\n", SDL_GetError());
+		Screen_FreeRenderThread();
+	}
+}
+
+
+/**
+ * Stop render thread after it has finished its current frame
+ */
+static void Screen_StopRenderThread(void)
+{
+	if (!Render.thread)
+		return;
+
+	SDL_LockMutex(Render.lock);
+	while (Render.state == RENDER_BUSY)
+		SDL_CondWait(Render.cond, Render.lock);
+	Render.state = RENDER_QUIT;
+	SDL_CondBroadcast(Render.cond);
+	SDL_UnlockMutex(Render.lock);
+
+	SDL_WaitThread(Render.thread, NULL);
+	Screen_FreeRenderThread();
+}
+
+
+/**
+ * Return true if render thread is still converting previous frame
+ */
+static bool Screen_RenderBusy(void)
+{
+	bool bBusy;
+
+	SDL_LockMutex(Render.lock);
+	bBusy = (Render.state == RENDER_BUSY);
+	SDL_UnlockMutex(Render.lock);
+
+	return bBusy;
+}
+
+
+/**
+ * Hand frame over to the render thread for conversion.  Conversion
+ * needs both the finished ST screen and the previous one it is compared
+ * against, so video.c continues with the third screen buffer.
+ */
+static void Screen_RenderStart(void (*pConvert)(void))
+{
+	Uint8 *pTmpScreen;
 
-	/* Swap copy/raster buffers in screen. */
 	pTmpScreen = pFrameBuffer->pSTScreenCopy;
 	pFrameBuffer->pSTScreenCopy = pFrameBuffer->pSTScreen;
-	pFrameBuffer->pSTScreen = pTmpScreen;
+	pFrameBuffer->pSTScreen = Render.pSTScreenFree;
+	Render.pSTScreenFree = pTmpScreen;
+
+	SDL_LockMutex(Render.lock);
+	Render.pConvert = pConvert;
+	Render.state = RENDER_BUSY;
+	SDL_CondBroadcast(Render.cond);
+	SDL_UnlockMutex(Render.lock);
+}
+
+
+/**
+ * Wait until render thread has converted the frame handed to it,
+ * and show that.  This needs to be called before the SDL screen
+ * surface is accessed elsewhere while emulation is running.
+ */
+void Screen_RenderWait(void)
+{
+	bool bDone;
+
+	if (!Render.thread)
+		return;
+
+	SDL_LockMutex(Render.lock);
+	while (Render.state == RENDER_BUSY)
+		SDL_CondWait(Render.cond, Render.lock);
+	bDone = (Render.state == RENDER_DONE);
+	Render.state = RENDER_IDLE;
+	SDL_UnlockMutex(Render.lock);
+
+	if (bDone)
+		Screen_ShowFrame(false);
 }
 
 
@@ -1230,17 +1431,29 @@ static void Screen_Blit(SDL_Rect *sbar_rect)
 /**
  * Draw ST screen to window/full-screen framebuffer
  * @param  bForceFlip  Force screen update, even if contents did not change
- * @return  true if screen contents changed
+ * @return  true if screen contents changed (with render thread, true if
+ *          frame was handed over for conversion)
  */
 static bool Screen_DrawFrame(bool bForceFlip)
 {
 	int new_res;
 	void (*pDrawFunction)(void);
 	static bool bPrevFrameWasSpec512 = false;
-	SDL_Rect *sbar_rect;
+	Uint8 *pTmpScreen;
 
 	assert(!bUseVDIRes);
 
+	if (Render.thread)
+	{
+		/* In fast forward mode, rather skip the frame than wait
+		 * for render thread to finish previous one.  Video will
+		 * then just overwrite the same ST screen buffer.
+		 */
+		if (ConfigureParams.System.bFastForward && !bForceFlip && Screen_RenderBusy())
+			return false;
+		Screen_RenderWait();
+	}
+
 	/* Scan palette/resolution masks for each line and build up palette/difference tables */
 	new_res = Screen_ComparePaletteMask(STRes);
 	/* Did we change resolution this frame - allocate new screen if did so */
@@ -1288,6 +1501,8 @@ static bool Screen_DrawFrame(bool bForceFlip)
 			pDrawFunction = ConvertMediumRes_640x32Bit_Spec;
 		else if (pDrawFunction==ConvertMediumRes_640x16Bit)
 			pDrawFunction = ConvertMediumRes_640x16Bit_Spec;
+		/* Take palette writes of this frame for conversion */
+		Spec512_EndFrame();
 	}
 	else if (bPrevFrameWasSpec512)
 	{
@@ -1298,24 +1513,30 @@ static bool Screen_DrawFrame(bool bForceFlip)
 		bPrevFrameWasSpec512 = false;
 	}
 
-	if (pDrawFunction)
-		CALL_VAR(pDrawFunction);
-
-	/* Unlock screen */
-	Screen_UnLock();
-
-	/* draw overlay led(s) or statusbar after unlock */
-	Statusbar_OverlayBackup(sdlscrn);
-	sbar_rect = Statusbar_Update(sdlscrn, false);
-
 	/* Clear flags, remember type of overscan as if change need screen full update */
 	pFrameBuffer->bFullUpdate = false;
 	pFrameBuffer->VerticalOverscanCopy = VerticalOverscan;
 
-	/* And show to user */
-	if (bScreenContentsChanged || bForceFlip || sbar_rect)
+	/* Convert on render thread, except for forced redraws (which are
+	 * done also while emulation is paused) and monochrome screen
+	 * (Screen_GenConvert() uses the shared generic conversion state)
+	 */
+	if (Render.thread && !bForceFlip && pDrawFunction
+	    && pDrawFunction != Screen_ConvertHighRes)
 	{
-		Screen_Blit(sbar_rect);
+		Screen_RenderStart(pDrawFunction);
+		return true;
+	}
+
+	if (pDrawFunction)
+		CALL_VAR(pDrawFunction);
+
+	if (Screen_ShowFrame(bForceFlip))
+	{
+		/* Swap copy/raster buffers in screen. */
+		pTmpScreen = pFrameBuffer->pSTScreenCopy;
+		pFrameBuffer->pSTScreenCopy = pFrameBuffer->pSTScreen;
+		pFrameBuffer->pSTScreen = pTmpScreen;
 	}
 
 	return bScreenContentsChanged;
@@ -1505,7 +1726,7 @@ static int AdjustLinePaletteRemap(int y)
 	int i;
 
 	/* Copy palette and convert to RGB in display format */
-	actHBLPal = pHBLPalettes + (y<<4);    /* offset in palette */
+	actHBLPal = pFrameBuffer->HBLPalettes + (y<<4);    /* offset in palette */
 	for (i=0; i<16; i++)
 	{
 #if SDL_BYTEORDER == SDL_BIG_ENDIAN
@@ -1514,7 +1735,7 @@ static int AdjustLinePaletteRemap(int y)
 		STRGBPalette[i] = ST2RGB[*actHBLPal++];
 #endif
 	}
-	ScrUpdateFlag = HBLPaletteMasks[y];
+	ScrUpdateFlag = pFrameBuffer->HBLPaletteMasks[y];
 	return ScrUpdateFlag;
 }
 
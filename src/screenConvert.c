@@ -7,6 +7,7 @@
 
 #include <SDL_endian.h>
 #include "main.h"
+#include "bitplanes.h"
 #include "configuration.h"
 #include "log.h"
 #include "ioMem.h"
@@ -96,194 +97,52 @@ static inline Uint32 idx2pal(Uint8 idx)
 
 /**
  * Performs conversion from the TOS's bitplane word order (big endian) data
- * into the native 16-bit chunky pixels.
+ * into the native 16-bit chunky pixels, for given number of 16 pixel blocks.
  */
-static void Screen_BitplaneToChunky16(Uint16 *atariBitplaneData, Uint16 bpp,
-                                      Uint16 *hvram)
+static inline void Screen_BitplaneToChunky16(Uint16 *atariBitplaneData, Uint16 bpp,
+                                             int blocks, Uint16 *hvram)
 {
-	Uint32 a, b, c, d, x;
-
-	/* Obviously the different cases can be broken out in various
-	 * ways to lessen the amount of work needed for <8 bit modes.
-	 * It's doubtful if the usage of those modes warrants it, though.
-	 * The branches below should be ~100% correctly predicted and
-	 * thus be more or less for free.
-	 */
-	if (bpp >= 4) {
-		d = *(Uint32 *)&atariBitplaneData[0];
-		c = *(Uint32 *)&atariBitplaneData[2];
-		if (bpp == 4) {
-			a = b = 0;
-		} else {
-			b = *(Uint32 *)&atariBitplaneData[4];
-			a = *(Uint32 *)&atariBitplaneData[6];
-		}
+	Uint8 idx[16];
+	int i;
 
-		x = a;
-		a =  (a & 0xf0f0f0f0)       | ((c & 0xf0f0f0f0) >> 4);
-		c = ((x & 0x0f0f0f0f) << 4) |  (c & 0x0f0f0f0f);
-	} else {
-		a = b = c = 0;
-		if (bpp == 2) {
-			d = *(Uint32 *)&atariBitplaneData[0];
-		} else {
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-			d = atariBitplaneData[0]<<16;
-#else
-			d = atariBitplaneData[0];
-#endif
-		}
+	if (likely(!bTTSampleHold))
+	{
+		Bitplanes->ToChunky16(atariBitplaneData, bpp, blocks,
+		                      palette.native, hvram);
+		return;
+	}
+	/* sample & hold needs previous pixels */
+	for (; blocks > 0; blocks--, atariBitplaneData += bpp)
+	{
+		Bitplanes->ToIndex(atariBitplaneData, bpp, idx);
+		for (i = 0; i < 16; i++)
+			*hvram++ = idx2pal(idx[i]);
 	}
-
-	x = b;
-	b =  (b & 0xf0f0f0f0)       | ((d & 0xf0f0f0f0) >> 4);
-	d = ((x & 0x0f0f0f0f) << 4) |  (d & 0x0f0f0f0f);
-
-	x = a;
-	a =  (a & 0xcccccccc)       | ((b & 0xcccccccc) >> 2);
-	b = ((x & 0x33333333) << 2) |  (b & 0x33333333);
-	x = c;
-	c =  (c & 0xcccccccc)       | ((d & 0xcccccccc) >> 2);
-	d = ((x & 0x33333333) << 2) |  (d & 0x33333333);
-
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-	a = (a & 0x5555aaaa) | ((a & 0x00005555) << 17) | ((a & 0xaaaa0000) >> 17);
-	b = (b & 0x5555aaaa) | ((b & 0x00005555) << 17) | ((b & 0xaaaa0000) >> 17);
-	c = (c & 0x5555aaaa) | ((c & 0x00005555) << 17) | ((c & 0xaaaa0000) >> 17);
-	d = (d & 0x5555aaaa) | ((d & 0x00005555) << 17) | ((d & 0xaaaa0000) >> 17);
-
-	*hvram++ = idx2pal(a >> 8);
-	*hvram++ = idx2pal(a >> 24);
-	*hvram++ = idx2pal(b >> 8);
-	*hvram++ = idx2pal(b >> 24);
-	*hvram++ = idx2pal(c >> 8);
-	*hvram++ = idx2pal(c >> 24);
-	*hvram++ = idx2pal(d >> 8);
-	*hvram++ = idx2pal(d >> 24);
-	*hvram++ = idx2pal(a);
-	*hvram++ = idx2pal(a >> 16);
-	*hvram++ = idx2pal(b);
-	*hvram++ = idx2pal(b >> 16);
-	*hvram++ = idx2pal(c);
-	*hvram++ = idx2pal(c >> 16);
-	*hvram++ = idx2pal(d);
-	*hvram++ = idx2pal(d >> 16);
-#else
-	a = (a & 0xaaaa5555) | ((a & 0x0000aaaa) << 15) | ((a & 0x55550000) >> 15);
-	b = (b & 0xaaaa5555) | ((b & 0x0000aaaa) << 15) | ((b & 0x55550000) >> 15);
-	c = (c & 0xaaaa5555) | ((c & 0x0000aaaa) << 15) | ((c & 0x55550000) >> 15);
-	d = (d & 0xaaaa5555) | ((d & 0x0000aaaa) << 15) | ((d & 0x55550000) >> 15);
-
-	*hvram++ = idx2pal(a >> 16);
-	*hvram++ = idx2pal(a);
-	*hvram++ = idx2pal(b >> 16);
-	*hvram++ = idx2pal(b);
-	*hvram++ = idx2pal(c >> 16);
-	*hvram++ = idx2pal(c);
-	*hvram++ = idx2pal(d >> 16);
-	*hvram++ = idx2pal(d);
-	*hvram++ = idx2pal(a >> 24);
-	*hvram++ = idx2pal(a >> 8);
-	*hvram++ = idx2pal(b >> 24);
-	*hvram++ = idx2pal(b >> 8);
-	*hvram++ = idx2pal(c >> 24);
-	*hvram++ = idx2pal(c >> 8);
-	*hvram++ = idx2pal(d >> 24);
-	*hvram++ = idx2pal(d >> 8);
-#endif
 }
 
 /**
  * Performs conversion from the TOS's bitplane word order (big endian) data
- * into the native 32-bit chunky pixels.
+ * into the native 32-bit chunky pixels, for given number of 16 pixel blocks.
  */
-static void Screen_BitplaneToChunky32(Uint16 *atariBitplaneData, Uint16 bpp,
-                                      Uint32 *hvram)
+static inline void Screen_BitplaneToChunky32(Uint16 *atariBitplaneData, Uint16 bpp,
+                                             int blocks, Uint32 *hvram)
 {
-	Uint32 a, b, c, d, x;
-
-	if (bpp >= 4) {
-		d = *(Uint32 *)&atariBitplaneData[0];
-		c = *(Uint32 *)&atariBitplaneData[2];
-		if (bpp == 4) {
-			a = b = 0;
-		} else {
-			b = *(Uint32 *)&atariBitplaneData[4];
-			a = *(Uint32 *)&atariBitplaneData[6];
-		}
+	Uint8 idx[16];
+	int i;
 
-		x = a;
-		a =  (a & 0xf0f0f0f0)       | ((c & 0xf0f0f0f0) >> 4);
-		c = ((x & 0x0f0f0f0f) << 4) |  (c & 0x0f0f0f0f);
-	} else {
-		a = b = c = 0;
-		if (bpp == 2) {
-			d = *(Uint32 *)&atariBitplaneData[0];
-		} else {
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-			d = atariBitplaneData[0]<<16;
-#else
-			d = atariBitplaneData[0];
-#endif
-		}
+	if (likely(!bTTSampleHold))
+	{
+		Bitplanes->ToChunky32(atariBitplaneData, bpp, blocks,
+		                      palette.native, hvram);
+		return;
+	}
+	/* sample & hold needs previous pixels */
+	for (; blocks > 0; blocks--, atariBitplaneData += bpp)
+	{
+		Bitplanes->ToIndex(atariBitplaneData, bpp, idx);
+		for (i = 0; i < 16; i++)
+			*hvram++ = idx2pal(idx[i]);
 	}
-
-	x = b;
-	b =  (b & 0xf0f0f0f0)       | ((d & 0xf0f0f0f0) >> 4);
-	d = ((x & 0x0f0f0f0f) << 4) |  (d & 0x0f0f0f0f);
-
-	x = a;
-	a =  (a & 0xcccccccc)       | ((b & 0xcccccccc) >> 2);
-	b = ((x & 0x33333333) << 2) |  (b & 0x33333333);
-	x = c;
-	c =  (c & 0xcccccccc)       | ((d & 0xcccccccc) >> 2);
-	d = ((x & 0x33333333) << 2) |  (d & 0x33333333);
-
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-	a = (a & 0x5555aaaa) | ((a & 0x00005555) << 17) | ((a & 0xaaaa0000) >> 17);
-	b = (b & 0x5555aaaa) | ((b & 0x00005555) << 17) | ((b & 0xaaaa0000) >> 17);
-	c = (c & 0x5555aaaa) | ((c & 0x00005555) << 17) | ((c & 0xaaaa0000) >> 17);
-	d = (d & 0x5555aaaa) | ((d & 0x00005555) << 17) | ((d & 0xaaaa0000) >> 17);
-
-	*hvram++ = idx2pal(a >> 8);
-	*hvram++ = idx2pal(a >> 24);
-	*hvram++ = idx2pal(b >> 8);
-	*hvram++ = idx2pal(b >> 24);
-	*hvram++ = idx2pal(c >> 8);
-	*hvram++ = idx2pal(c >> 24);
-	*hvram++ = idx2pal(d >> 8);
-	*hvram++ = idx2pal(d >> 24);
-	*hvram++ = idx2pal(a);
-	*hvram++ = idx2pal(a >> 16);
-	*hvram++ = idx2pal(b);
-	*hvram++ = idx2pal(b >> 16);
-	*hvram++ = idx2pal(c);
-	*hvram++ = idx2pal(c >> 16);
-	*hvram++ = idx2pal(d);
-	*hvram++ = idx2pal(d >> 16);
-#else
-	a = (a & 0xaaaa5555) | ((a & 0x0000aaaa) << 15) | ((a & 0x55550000) >> 15);
-	b = (b & 0xaaaa5555) | ((b & 0x0000aaaa) << 15) | ((b & 0x55550000) >> 15);
-	c = (c & 0xaaaa5555) | ((c & 0x0000aaaa) << 15) | ((c & 0x55550000) >> 15);
-	d = (d & 0xaaaa5555) | ((d & 0x0000aaaa) << 15) | ((d & 0x55550000) >> 15);
-
-	*hvram++ = idx2pal(a >> 16);
-	*hvram++ = idx2pal(a);
-	*hvram++ = idx2pal(b >> 16);
-	*hvram++ = idx2pal(b);
-	*hvram++ = idx2pal(c >> 16);
-	*hvram++ = idx2pal(c);
-	*hvram++ = idx2pal(d >> 16);
-	*hvram++ = idx2pal(d);
-	*hvram++ = idx2pal(a >> 24);
-	*hvram++ = idx2pal(a >> 8);
-	*hvram++ = idx2pal(b >> 24);
-	*hvram++ = idx2pal(b >> 8);
-	*hvram++ = idx2pal(c >> 24);
-	*hvram++ = idx2pal(c >> 8);
-	*hvram++ = idx2pal(d >> 24);
-	*hvram++ = idx2pal(d >> 8);
-#endif
 }
 
 static inline Uint16 *ScreenConv_BitplaneLineTo16bpp(Uint16 *fvram_column,
@@ -291,10 +150,10 @@ static inline Uint16 *ScreenConv_BitplaneLineTo16bpp(Uint16 *fvram_column,
                                                      int vbpp, int hscrolloffset)
 {
 	Uint16 hvram_buf[16];
-	int i;
+	int i, blocks;
 
 	/* First 16 pixels */
-	Screen_BitplaneToChunky16(fvram_column, vbpp, hvram_buf);
+	Screen_BitplaneToChunky16(fvram_column, vbpp, 1, hvram_buf);
 	for (i = hscrolloffset; i < 16; i++)
 	{
 		*hvram_column++ = hvram_buf[i];
@@ -302,17 +161,18 @@ static inline Uint16 *ScreenConv_BitplaneLineTo16bpp(Uint16 *fvram_column,
 	fvram_column += vbpp;
 
 	/* Now the main part of the line */
-	for (i = 1; i < (vw + 15) >> 4; i++)
+	blocks = ((vw + 15) >> 4) - 1;
+	if (blocks > 0)
 	{
-		Screen_BitplaneToChunky16(fvram_column, vbpp, hvram_column);
-		hvram_column += 16;
-		fvram_column += vbpp;
+		Screen_BitplaneToChunky16(fvram_column, vbpp, blocks, hvram_column);
+		hvram_column += 16 * blocks;
+		fvram_column += vbpp * blocks;
 	}
 
 	/* Last pixels of the line for fine scrolling */
 	if (hscrolloffset)
 	{
-		Screen_BitplaneToChunky16(fvram_column, vbpp, hvram_buf);
+		Screen_BitplaneToChunky16(fvram_column, vbpp, 1, hvram_buf);
 		for (i = 0; i < hscrolloffset; i++)
 		{
 			*hvram_column++ = hvram_buf[i];
@@ -327,10 +187,10 @@ static inline Uint32 *ScreenConv_BitplaneLineTo32bpp(Uint16 *fvram_column,
                                                      int vbpp, int hscrolloffset)
 {
 	Uint32 hvram_buf[16];
-	int i;
+	int i, blocks;
 
 	/* First 16 pixels */
-	Screen_BitplaneToChunky32(fvram_column, vbpp, hvram_buf);
+	Screen_BitplaneToChunky32(fvram_column, vbpp, 1, hvram_buf);
 	for (i = hscrolloffset; i < 16; i++)
 	{
 		*hvram_column++ = hvram_buf[i];
@@ -338,17 +198,18 @@ static inline Uint32 *ScreenConv_BitplaneLineTo32bpp(Uint16 *fvram_column,
 	fvram_column += vbpp;
 
 	/* Now the main part of the line */
-	for (i = 1; i < (vw + 15) >> 4; i++)
+	blocks = ((vw + 15) >> 4) - 1;
+	if (blocks > 0)
 	{
-		Screen_BitplaneToChunky32(fvram_column, vbpp, hvram_column);
-		hvram_column += 16;
-		fvram_column += vbpp;
+		Screen_BitplaneToChunky32(fvram_column, vbpp, blocks, hvram_column);
+		hvram_column += 16 * blocks;
+		fvram_column += vbpp * blocks;
 	}
 
 	/* Last pixels of the line for fine scrolling */
 	if (hscrolloffset)
 	{
-		Screen_BitplaneToChunky32(fvram_column, vbpp, hvram_buf);
+		Screen_BitplaneToChunky32(fvram_column, vbpp, 1, hvram_buf);
 		for (i = 0; i < hscrolloffset; i++)
 		{
 			*hvram_column++ = hvram_buf[i];
@@ -235,6 +235,7 @@ void ScreenSnapShot_SaveScreen(void)
 
 	if (!szFileName)  return;
 
+	Screen_RenderWait();
 	ScreenSnapShot_GetNum();
 	/* Create our filename */
 	nScreenShots++;
@@ -269,6 +270,7 @@ void ScreenSnapShot_SaveToFile(const char *szFileName)
 		fprintf(stderr, "ERROR: no screen dump file name specified\n");
 		return;
 	}
+	Screen_RenderWait();
 #if HAVE_LIBPNG
 	if (File_DoesFileExtensionMatch(szFileName, ".png"))
 	{
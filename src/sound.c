@@ -139,6 +139,7 @@ const char Sound_fileid[] = "Hatari sound.c";
 #include "file.h"
 #include "cycInt.h"
 #include "log.h"
+#include "perftimer.h"
 #include "memorySnapShot.h"
 #include "psg.h"
 #include "sound.h"
@@ -269,6 +270,7 @@ static ymu16	Noise_per , Noise_count , Noise_val;
 static ymu16	Env_per , Env_count;
 static ymu32	Env_pos;
 static int	Env_shape;
+static ymu16	Freq_div_2;				/* noise counter runs at half the 250 kHz rate */
 
 static ymu32	mixerTA , mixerTB , mixerTC;
 static ymu32	mixerNA , mixerNB , mixerNC;
@@ -336,6 +338,9 @@ static CLOCKS_CYCLES_STRUCT	YM2149_ConvertCycles_250;
 /* Local functions prototypes					*/
 /*--------------------------------------------------------------*/
 
+static yms32	LPF_y0 , LPF_x1;			/* LowPassFilter() state */
+static yms32	PWM_y0 , PWM_x1;			/* PWMaliasFilter() state */
+
 static ymsample	LowPassFilter		(ymsample x0);
 static ymsample	PWMaliasFilter		(ymsample x0);
 
@@ -445,17 +450,15 @@ ymsample	Subsonic_IIR_HPF_Right(ymsample x0)
  */
 static ymsample	LowPassFilter(ymsample x0)
 {
-	static	yms32 y0 = 0, x1 = 0;
-
-	if (x0 >= y0)
+	if (x0 >= LPF_y0)
 	/* YM Pull up:   fc = 7586.1 Hz (44.1 KHz), fc = 8257.0 Hz (48 KHz) */
-		y0 = (3*(x0 + x1) + (y0<<1)) >> 3;
+		LPF_y0 = (3*(x0 + LPF_x1) + (LPF_y0<<1)) >> 3;
 	else
 	/* R8 Pull down: fc = 1992.0 Hz (44.1 KHz), fc = 2168.0 Hz (48 KHz) */
-		y0 = ((x0 + x1) + (6*y0)) >> 3;
+		LPF_y0 = ((x0 + LPF_x1) + (6*LPF_y0)) >> 3;
 
-	x1 = x0;
-	return y0;
+	LPF_x1 = x0;
+	return LPF_y0;
 }
 
 /**
@@ -473,17 +476,15 @@ static ymsample	LowPassFilter(ymsample x0)
  */
 static ymsample	PWMaliasFilter(ymsample x0)
 {
-	static	yms32 y0 = 0, x1 = 0;
-
-	if (x0 >= y0)
+	if (x0 >= PWM_y0)
 	/* YM Pull up   */
-		y0 = x0;
+		PWM_y0 = x0;
 	else
 	/* R8 Pull down */
-		y0 = (3*(x0 + x1) + (y0<<1)) >> 3;
+		PWM_y0 = (3*(x0 + PWM_x1) + (PWM_y0<<1)) >> 3;
 
-	x1 = x0;
-	return y0;
+	PWM_x1 = x0;
+	return PWM_y0;
 }
 
 
@@ -1005,7 +1006,98 @@ static ymu16	YM2149_EnvPer(ymu8 rHigh , ymu8 rLow)
 
 /*-----------------------------------------------------------------------*/
 /**
- * Main function : compute the value of the next sample.
+ * Compute the current output of the YM2149 from the values of tone/noise/volume/env
+ */
+static inline ymsample	YM2149_Output_250 ( void )
+{
+	ymu32		bt;
+	ymu16		Env3Voices;			/* 0x00CCBBAA */
+	ymu16		Tone3Voices;			/* 0x00CCBBAA */
+
+	/* Get the 5 bits volume corresponding to the current envelope's position */
+	Env3Voices = YmEnvWaves[ Env_shape ][ Env_pos ];
+	Env3Voices &= EnvMask3Voices;			/* only keep volumes for voices using envelope */
+
+	/* Tone3Voices will contain the output state of each voice : 0 or 0x1f */
+	bt = (ToneA_val | mixerTA) & (Noise_val | mixerNA);	/* 0 or 0xffff */
+	Tone3Voices = bt & YM_MASK_1VOICE;		/* 0 or 0x1f */
+
+	bt = (ToneB_val | mixerTB) & (Noise_val | mixerNB);
+	Tone3Voices |= ( bt & YM_MASK_1VOICE ) << 5;
+
+	bt = (ToneC_val | mixerTC) & (Noise_val | mixerNC);
+	Tone3Voices |= ( bt & YM_MASK_1VOICE ) << 10;
+
+	/* Combine fixed volumes and envelope volumes and keep the resulting */
+	/* volumes depending on the output state of each voice (0 or 0x1f) */
+	Tone3Voices &= ( Env3Voices | Vol3Voices );
+
+	return ymout5[ Tone3Voices ];			/* 16 bits signed value */
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Store 'count' samples into YM_Buffer_250 at position 'pos' for a run
+ * where the YM2149 output stays at 'x0', applying the low pass filter
+ * if needed. As the filters only depend on their previous state, their
+ * output can't change anymore once it's the same for 2 samples in a row,
+ * so the rest of the run is just filled with that value.
+ * Returns the position after the stored samples.
+ */
+static int	YM2149_StoreRun_250 ( ymsample x0 , int count , int pos )
+{
+	ymsample	sample, next;
+	ymsample	(*filter)(ymsample);
+
+	if ( YM2149_LPF_Filter == YM2149_LPF_FILTER_LPF_STF )
+		filter = LowPassFilter;
+	else if ( YM2149_LPF_Filter == YM2149_LPF_FILTER_PWM )
+		filter = PWMaliasFilter;
+	else
+		filter = NULL;
+
+	sample = x0;
+	if ( filter )
+	{
+		sample = filter ( x0 );
+		YM_Buffer_250[ pos ] = sample;
+		pos = ( pos + 1 ) & YM_BUFFER_250_SIZE_MASK;
+		count--;
+
+		while ( count > 0 )
+		{
+			next = filter ( x0 );
+			YM_Buffer_250[ pos ] = next;
+			pos = ( pos + 1 ) & YM_BUFFER_250_SIZE_MASK;
+			count--;
+			if ( next == sample )
+				break;				/* filter is stable */
+			sample = next;
+		}
+	}
+
+	/* Fill the rest of the run (split in 2 parts if the ring buffer wraps) */
+	while ( count > 0 )
+	{
+		int	i, n;
+
+		n = YM_BUFFER_250_SIZE - pos;
+		if ( n > count )
+			n = count;
+		for ( i = 0 ; i < n ; i++ )
+			YM_Buffer_250[ pos + i ] = sample;
+		pos = ( pos + n ) & YM_BUFFER_250_SIZE_MASK;
+		count -= n;
+	}
+
+	return pos;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Main function : compute the value of the next samples.
  * Mixes all 3 voices with tone+noise+env and apply low pass
  * filter if needed.
  * For maximum accuracy, this function emulates all single cycles at 250 kHz
@@ -1013,16 +1105,24 @@ static ymu16	YM2149_EnvPer(ymu8 rHigh , ymu8 rLow)
  * to the chosen output frequency (eg 44.1 kHz)
  * Creating a complete 250 kHz signal allow to emulate effects that require
  * precise cycle accuracy (such as "syncsquare" used in maxYMiser v1.53)
+ *
+ * Registers don't change during one call, so instead of stepping all the
+ * counters on each cycle, we compute how many cycles remain until the next
+ * counter reaches its period (tone edge, noise or envelope step) and output
+ * the same sample value for all the cycles before that. The result is the
+ * same as when doing one cycle at a time :
+ *  - counters are incremented first, then compared to per, so per==0
+ *    gives the same result as per==1, and a counter already above its
+ *    period (after a register write) wraps on the next cycle
+ *  - noise counter is increased at 125 KHz, not 250 KHz, but it's
+ *    compared to its period on every cycle
  */
 static void	YM2149_DoSamples_250 ( int SamplesToGenerate_250 )
 {
 	ymsample	sample;
-	ymu32		bt;
-	ymu16		Env3Voices;			/* 0x00CCBBAA */
-	ymu16		Tone3Voices;			/* 0x00CCBBAA */
-	static ymu16	Freq_div_2 = 0;
 	int		pos;
-	int		n;
+	int		n, steps;
+	int		stepsA, stepsB, stepsC, stepsN, stepsE;
 
 
 //fprintf ( stderr , "ym2149_dosamples_250 in nb=%d ym_pos_wr=%d\n",SamplesToGenerate_250 , YM_Buffer_250_pos_write );
@@ -1033,50 +1133,84 @@ static void	YM2149_DoSamples_250 ( int SamplesToGenerate_250 )
 	/* that are not read yet */
 	pos = YM_Buffer_250_pos_write;
 
+	sample = YM2149_Output_250();
+
 	/* Emulate as many internal YM cycles as needed to generate samples */
-	for ( n=0 ; n<SamplesToGenerate_250 ; n++ )
+	n = SamplesToGenerate_250;
+	while ( n > 0 )
 	{
-		/* Emulate 1 internal YM2149 cycle : increase all counters */
-		/* As measured on a real YM2149, result for per==0 is the same as for per==1 */
-		/* To obtain this in our code, counters are incremented first, then compared to per, */
-		/* which gives the same result when per=1 and when per=0 */
-
-		/* Special case for noise counter, it's increased at 125 KHz, not 250 KHz */
-		Freq_div_2 ^= 1;
-		if ( Freq_div_2 == 0 )
-			Noise_count++;
+		/* Number of cycles until each counter reaches its period */
+		stepsA = ToneA_per - ToneA_count;
+		if ( stepsA < 1 )
+			stepsA = 1;
+		stepsB = ToneB_per - ToneB_count;
+		if ( stepsB < 1 )
+			stepsB = 1;
+		stepsC = ToneC_per - ToneC_count;
+		if ( stepsC < 1 )
+			stepsC = 1;
+		stepsE = Env_per - Env_count;
+		if ( stepsE < 1 )
+			stepsE = 1;
 		if ( Noise_count >= Noise_per )
+			stepsN = 1;
+		else
+			stepsN = 2 * ( Noise_per - Noise_count ) - Freq_div_2;
+
+		steps = stepsA;
+		if ( stepsB < steps )	steps = stepsB;
+		if ( stepsC < steps )	steps = stepsC;
+		if ( stepsE < steps )	steps = stepsE;
+		if ( stepsN < steps )	steps = stepsN;
+
+		if ( steps > n )
+		{
+			/* No counter reaches its period during the remaining cycles */
+			ToneA_count += n;
+			ToneB_count += n;
+			ToneC_count += n;
+			Env_count += n;
+			Noise_count += ( n + Freq_div_2 ) / 2;
+			Freq_div_2 ^= n & 1;
+			pos = YM2149_StoreRun_250 ( sample , n , pos );
+			break;
+		}
+
+		/* Output doesn't change until the last cycle of this run */
+		if ( steps > 1 )
+			pos = YM2149_StoreRun_250 ( sample , steps - 1 , pos );
+
+		Noise_count += ( steps + Freq_div_2 ) / 2;
+		Freq_div_2 ^= steps & 1;
+		if ( stepsN == steps )
 		{
 			Noise_count = 0;
 			Noise_val = YM2149_RndCompute();/* 0 or 0xffff */
 		}
 
-//fprintf ( stderr , "ym2149_dosamples_250 max=%d n=%d ToneA_count=%d ToneA_per=%d val=%x pos=%d\n",SamplesToGenerate_250,n,ToneA_count,ToneA_per,ToneA_val,pos );
-		/* Other counters are increased on every call, at 250 KHz */
-		ToneA_count++;
-		if ( ToneA_count >= ToneA_per )
+		ToneA_count += steps;
+		if ( stepsA == steps )
 		{
-//fprintf ( stderr , "ym2149_dosamples_250 max=%d n=%d ToneA_count=%d ToneA_per=%d val=%x pos=%d toggle\n",SamplesToGenerate_250,n,ToneA_count,ToneA_per,ToneA_val,pos );
 			ToneA_count = 0;
 			ToneA_val ^= YM_SQUARE_UP;	/* 0 or 0x1f */
 		}
 
-		ToneB_count++;
-		if ( ToneB_count >= ToneB_per )
+		ToneB_count += steps;
+		if ( stepsB == steps )
 		{
 			ToneB_count = 0;
 			ToneB_val ^= YM_SQUARE_UP;	/* 0 or 0x1f */
 		}
 
-		ToneC_count++;
-		if ( ToneC_count >= ToneC_per )
+		ToneC_count += steps;
+		if ( stepsC == steps )
 		{
 			ToneC_count = 0;
 			ToneC_val ^= YM_SQUARE_UP;	/* 0 or 0x1f */
 		}
 
-		Env_count += 1;
-		if ( Env_count >= Env_per )
+		Env_count += steps;
+		if ( stepsE == steps )
 		{
 			Env_count = 0;
 			Env_pos += 1;
@@ -1084,37 +1218,9 @@ static void	YM2149_DoSamples_250 ( int SamplesToGenerate_250 )
 				Env_pos -= 2*32;	/* replay/loop blocks 1 and 2 (Env_pos 32 to 95) */
 		}
 
-		/* Build 'sample' value with the values of tone/noise/volume/env */
-
-		/* Get the 5 bits volume corresponding to the current envelope's position */
-		Env3Voices = YmEnvWaves[ Env_shape ][ Env_pos ];
-		Env3Voices &= EnvMask3Voices;			/* only keep volumes for voices using envelope */
-
-		/* Tone3Voices will contain the output state of each voice : 0 or 0x1f */
-		bt = (ToneA_val | mixerTA) & (Noise_val | mixerNA);	/* 0 or 0xffff */
-		Tone3Voices = bt & YM_MASK_1VOICE;		/* 0 or 0x1f */
-
-		bt = (ToneB_val | mixerTB) & (Noise_val | mixerNB);
-		Tone3Voices |= ( bt & YM_MASK_1VOICE ) << 5;
-
-		bt = (ToneC_val | mixerTC) & (Noise_val | mixerNC);
-		Tone3Voices |= ( bt & YM_MASK_1VOICE ) << 10;
-
-		/* Combine fixed volumes and envelope volumes and keep the resulting */
-		/* volumes depending on the output state of each voice (0 or 0x1f) */
-		Tone3Voices &= ( Env3Voices | Vol3Voices );
-
-		sample = ymout5[ Tone3Voices ];			/* 16 bits signed value */
-
-		/* Apply low pass filter ? */
-		if ( YM2149_LPF_Filter == YM2149_LPF_FILTER_LPF_STF )
-			sample = LowPassFilter ( sample );
-		else if ( YM2149_LPF_Filter == YM2149_LPF_FILTER_PWM )
-			sample = PWMaliasFilter ( sample );
-
-		/* Store sample */
-		YM_Buffer_250[ pos ] = sample;
-		pos = ( pos + 1 ) & YM_BUFFER_250_SIZE_MASK;
+		sample = YM2149_Output_250();
+		pos = YM2149_StoreRun_250 ( sample , 1 , pos );
+		n -= steps;
 	}
 
 
@@ -1762,6 +1868,8 @@ void Sound_Update( Uint64 CPU_Clock)
 	int Samples_Nbr;
 	int nGeneratedSamples_before;
 
+	PerfTimer_Begin(PERF_TIMER_SOUND);
+
 	/* Make sure that we don't interfere with the audio callback function */
 	Audio_Lock();
 
@@ -1797,6 +1905,8 @@ void Sound_Update( Uint64 CPU_Clock)
 	/* Save to WAV file, if open */
 	if (bRecordingWav)
 		WAVFormat_Update(AudioMixBuffer, pos_write_prev, Samples_Nbr);
+
+	PerfTimer_End();
 }
 
 
@@ -93,10 +93,19 @@ typedef struct
 }
 CYCLEPALETTE;
 
-/* 314k; 1024-bytes per line */
-static CYCLEPALETTE CyclePalettes[(MAX_SCANLINES_PER_FRAME+1)*MAX_CYCLEPALETTES_PERLINE];
+/* 314k each; 1024-bytes per line.  There are two tables, so that palette
+ * writes of the next frame can be stored while the previous frame is still
+ * being converted (possibly on the render thread) */
+static CYCLEPALETTE CyclePaletteTables[2][(MAX_SCANLINES_PER_FRAME+1)*MAX_CYCLEPALETTES_PERLINE];
+static int nCyclePaletteTables[2][(MAX_SCANLINES_PER_FRAME+1)];  /* Number of entries in above tables for each scanline */
+static CYCLEPALETTE *CyclePalettes = CyclePaletteTables[0];     /* Table for storing palette writes */
+static int *nCyclePalettes = nCyclePaletteTables[0];
+static CYCLEPALETTE *ConvCyclePalettes = CyclePaletteTables[1]; /* Table used in screen conversion */
+static int *nConvCyclePalettes = nCyclePaletteTables[1];
 static CYCLEPALETTE *pCyclePalette;
-static int nCyclePalettes[(MAX_SCANLINES_PER_FRAME+1)];  /* Number of entries in above table for each scanline */
+/* Video timings of the frame being converted */
+static int nConvScanlinesPerFrame, nConvCyclesPerLine, nConvCpuFreqShift;
+static int nConvStartHBL, nConvVerticalOverscan;
 static int nPalettesAccesses;   /* Number of times accessed palette registers */
 static Uint16 CycleColour;
 static int CycleColourIndex;
@@ -134,7 +143,7 @@ bool Spec512_IsImage(void)
 void Spec512_StartVBL(void)
 {
 	/* Clear number of cycle palettes on each frame */
-	memset(nCyclePalettes, 0x0, sizeof(nCyclePalettes));
+	memset(nCyclePalettes, 0x0, sizeof(nCyclePaletteTables[0]));
 
 	/* Clear number of times accessed on entry in palette (used to check if
 	 * it is true Spectrum 512 image) */
@@ -227,6 +236,33 @@ void Spec512_StoreCyclePalette(Uint16 col, Uint32 addr)
 }
 
 
+/*-----------------------------------------------------------------------*/
+/**
+ * Hand over palette writes and video timings of the finished frame to the
+ * screen conversion, so that the next frame can be stored meanwhile.
+ * Called on VBL before the frame is converted.
+ */
+void Spec512_EndFrame(void)
+{
+	CYCLEPALETTE *pTmpCyclePalettes;
+	int *pTmpCount;
+
+	pTmpCyclePalettes = ConvCyclePalettes;
+	ConvCyclePalettes = CyclePalettes;
+	CyclePalettes = pTmpCyclePalettes;
+
+	pTmpCount = nConvCyclePalettes;
+	nConvCyclePalettes = nCyclePalettes;
+	nCyclePalettes = pTmpCount;
+
+	nConvScanlinesPerFrame = nScanlinesPerFrame;
+	nConvCyclesPerLine = nCyclesPerLine;
+	nConvCpuFreqShift = nCpuFreqShift;
+	nConvStartHBL = nStartHBL;
+	nConvVerticalOverscan = VerticalOverscan;
+}
+
+
 /*-----------------------------------------------------------------------*/
 /**
  * Begin palette calculation for Spectrum 512 style images,
@@ -235,13 +271,10 @@ void Spec512_StartFrame(void)
 {
 	int i;
 
-	/* Set so screen gets full-update when returns from Spectrum 512 display */
-	Screen_SetFullUpdate();
-
 	/* Set terminators on each line, so when scan during conversion we know when to stop */
-	for (i = 0; i < (nScanlinesPerFrame+1); i++)
+	for (i = 0; i < (nConvScanlinesPerFrame+1); i++)
 	{
-		pCyclePalette = &CyclePalettes[ (i*MAX_CYCLEPALETTES_PERLINE) + nCyclePalettes[i] ];
+		pCyclePalette = &ConvCyclePalettes[ (i*MAX_CYCLEPALETTES_PERLINE) + nConvCyclePalettes[i] ];
 		pCyclePalette->LineCycles = -1;          /* Term */
 	}
 
@@ -249,19 +282,19 @@ void Spec512_StartFrame(void)
        for (i = 0; i < 16; i++)
        {
 #if SDL_BYTEORDER == SDL_BIG_ENDIAN
-               STRGBPalette[STRGBPalEndianTable[i]] = ST2RGB[pHBLPalettes[i]];
+               STRGBPalette[STRGBPalEndianTable[i]] = ST2RGB[pFrameBuffer->HBLPalettes[i]];
 #else
-               STRGBPalette[i] = ST2RGB[pHBLPalettes[i]];
+               STRGBPalette[i] = ST2RGB[pFrameBuffer->HBLPalettes[i]];
 #endif
        }
 
 	/* Ready for first call to 'Spec512_ScanLine' */
 	nScanLine = 0;
-	if (VerticalOverscan & V_OVERSCAN_NO_TOP)
+	if (nConvVerticalOverscan & V_OVERSCAN_NO_TOP)
 		nScanLine += OVERSCAN_TOP;
 
 	/* Skip to first line(where start to draw screen from) */
-	for (i = 0; i < (STScreenStartHorizLine+(nStartHBL-OVERSCAN_TOP)); i++)
+	for (i = 0; i < (STScreenStartHorizLine+(nConvStartHBL-OVERSCAN_TOP)); i++)
 		Spec512_ScanWholeLine();
 }
 
@@ -274,7 +307,7 @@ void Spec512_StartFrame(void)
 void Spec512_ScanWholeLine(void)
 {
 	/* Store pointer to line of palette cycle writes */
-	pCyclePalette = &CyclePalettes[nScanLine*MAX_CYCLEPALETTES_PERLINE];
+	pCyclePalette = &ConvCyclePalettes[nScanLine*MAX_CYCLEPALETTES_PERLINE];
 	/* Ready for next scan line */
 	nScanLine++;
 
@@ -294,11 +327,11 @@ void Spec512_StartScanLine(void)
 	int LineStartCycle;
 
 	/* Store pointer to line of palette cycle writes */
-	pCyclePalette = &CyclePalettes[nScanLine*MAX_CYCLEPALETTES_PERLINE];
+	pCyclePalette = &ConvCyclePalettes[nScanLine*MAX_CYCLEPALETTES_PERLINE];
 	/* Ready for next scan line */
 	nScanLine++;
 
-	if ( nScanlinesPerFrame == SCANLINES_PER_FRAME_50HZ )
+	if ( nConvScanlinesPerFrame == SCANLINES_PER_FRAME_50HZ )
 		LineStartCycle = LINE_START_CYCLE_50;			/* The screen was 50 Hz */
 	else
 		LineStartCycle = LINE_START_CYCLE_60;			/* The screen was 60 Hz */
@@ -320,9 +353,9 @@ void Spec512_StartScanLine(void)
  */
 void Spec512_EndScanLine(void)
 {
-	int	CycleEnd = nCyclesPerLine;
+	int	CycleEnd = nConvCyclesPerLine;
 
-	CycleEnd >>= nCpuFreqShift;			/* Convert cycle position to 8 MHz equivalent */
+	CycleEnd >>= nConvCpuFreqShift;		/* Convert cycle position to 8 MHz equivalent */
 	/* Continue to reads palette until complete so have correct version for next line */
 	while (ScanLineCycleCount < CycleEnd)
 		Spec512_UpdatePaletteSpan();
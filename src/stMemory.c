@@ -21,6 +21,7 @@ const char STMemory_fileid[] = "Hatari stMemory.c";
 #include "m68000.h"
 #include "screen.h"
 #include "video.h"
+#include "watchpoint.h"
 
 /* STRam points to our ST Ram. Unless the user enabled SMALL_MEM where we have
  * to save memory, this includes all TOS ROM and IO hardware areas for ease
@@ -45,6 +46,16 @@ Uint32	MMU_Bank1_Size;		/* Logical MMU RAM size for bank1 (in bytes) : 128, 512
 
 Uint8	MMU_Conf_Expected;	/* Expected value for $FF8001 corresponding to ST RAM size if <= 4MB */
 
+Uint32	*STMemory_DirtyBitmap;	/* Points to DirtyBitmap[] when dirty page tracking is enabled */
+static Uint32	DirtyBitmap[ STMEMORY_DIRTY_WORDS ];	/* Pages written since the last fetch by any user */
+
+#define	STMEMORY_DIRTY_USERS	4
+static struct {
+	bool	bActive;
+	Uint32	Bitmap[ STMEMORY_DIRTY_WORDS ];		/* Pages written since this user's last fetch */
+} DirtyUsers[ STMEMORY_DIRTY_USERS ];
+static int	nDirtyUsers;		/* Number of active STMemory_DirtyPages_Register() users */
+
 
 static void	STMemory_MMU_ConfToBank ( Uint8 MMU_conf , Uint32 *pBank0 , Uint32 *pBank1 );
 static int	STMemory_MMU_Size ( Uint8 MMU_conf );
@@ -122,9 +133,14 @@ bool STMemory_SafeClear(Uint32 addr, unsigned int len)
 
 	if (STMemory_CheckAreaType(addr, len, ABFLAG_RAM))
 	{
+		/* bypasses the memory banks, so check watchpoints here */
+		if (len)
+			Watchpoint_Check(addr, len, WATCH_WRITE);
 		if (addr + len < 0x1000000)
 		{
 			memset(&STRam[addr], 0, len);
+			if (STMemory_DirtyBitmap && len)
+				STMemory_DirtyPages_Mark(addr, len);
 		}
 		else
 		{
@@ -155,15 +171,20 @@ bool STMemory_SafeClear(Uint32 addr, unsigned int len)
  * 
  * Return true if whole copy was safe / valid.
  */
-bool STMemory_SafeCopy(Uint32 addr, Uint8 *src, unsigned int len, const char *name)
+bool STMemory_SafeCopy(Uint32 addr, const Uint8 *src, unsigned int len, const char *name)
 {
 	Uint32 end;
 
 	if ( STMemory_CheckAreaType ( addr, len, ABFLAG_RAM ) )
 	{
+		/* bypasses the memory banks, so check watchpoints here */
+		if (len)
+			Watchpoint_Check(addr, len, WATCH_WRITE);
 		if (addr + len < 0x1000000)
 		{
 			memcpy(&STRam[addr], src, len);
+			if (STMemory_DirtyBitmap && len)
+				STMemory_DirtyPages_Mark(addr, len);
 		}
 		else
 		{
@@ -189,6 +210,8 @@ bool STMemory_SafeCopy(Uint32 addr, Uint8 *src, unsigned int len, const char *na
  */
 void STMemory_MemorySnapShot_Capture(bool bSave)
 {
+	bool bTracked;
+
 	MemorySnapShot_Store(&STRamEnd, sizeof(STRamEnd));
 
 	/* After restoring RAM/MMU bank sizes we must call memory_map_Standard_RAM() */
@@ -199,17 +222,22 @@ void STMemory_MemorySnapShot_Capture(bool bSave)
 	MemorySnapShot_Store(&MMU_Conf_Expected, sizeof(MMU_Conf_Expected));
 
 	/* Only save/restore area of memory machine is set to, eg 1Mb */
-	MemorySnapShot_Store(STRam, STRamEnd);
+	bTracked = MemorySnapShot_StorePages(STRam, STRamEnd, true);
 
 	/* And Cart/TOS/Hardware area */
-	MemorySnapShot_Store(&RomMem[0xE00000], 0x200000);
+	MemorySnapShot_StorePages(&RomMem[0xE00000], 0x200000, false);
 
 	/* Save/restore content of TT RAM if TTRamSize_KB != 0 */
 	if ( ConfigureParams.Memory.TTRamSize_KB > 0 )
-		MemorySnapShot_Store ( TTmemory , ConfigureParams.Memory.TTRamSize_KB*1024 );
+		MemorySnapShot_StorePages ( TTmemory , ConfigureParams.Memory.TTRamSize_KB*1024 , false );
 
 	if ( !bSave )
+	{
 		memory_map_Standard_RAM ( MMU_Bank0_Size , MMU_Bank1_Size );
+		/* Whole RAM was replaced, unless snapshot code kept track of it */
+		if ( !bTracked && STMemory_DirtyBitmap && STRamEnd )
+			STMemory_DirtyPages_Mark ( 0 , STRamEnd );
+	}
 }
 
 
@@ -621,6 +649,9 @@ void	STMemory_Write ( Uint32 addr , Uint32 val , int size )
 
 	/* We modify the memory, so we flush the instr/data caches if needed */
 	M68000_Flush_All_Caches ( addr , size );
+
+	if ( STMemory_DirtyBitmap && p >= STRam && p < STRam + STRamEnd )
+		STMemory_DirtyPages_Mark ( p - STRam , size );
 	
 	if ( size == 4 )
 		do_put_mem_long ( p , val );
@@ -689,10 +720,73 @@ Uint8	STMemory_ReadByte ( Uint32 addr )
 }
 
 
+/**
+ * Get a host pointer to the memory at 'addr', for bulk direct reads
+ * (same rules as above : no access handlers are called).
+ * '*pRunSize' is set to the number of bytes from 'addr' that are contiguous
+ * in host memory, limited to 'maxSize' and to the end of the current
+ * 64 KB entry in mem_banks[].
+ * Return NULL if there's no real memory at 'addr' (it reads as 0).
+ */
+Uint8	*STMemory_GetRunPointer ( Uint32 addr , Uint32 maxSize , Uint32 *pRunSize )
+{
+	addrbank	*pBank;
+	Uint32		offset , toEnd;
+	Uint32		run;
+
+	pBank = &get_mem_bank ( addr );
+
+	run = 0x10000 - ( addr & 0xffff );
+	if ( run > maxSize )
+		run = maxSize;
+
+	if ( pBank->baseaddr == NULL )
+	{
+		*pRunSize = run;
+		return NULL;
+	}
+
+	offset = ( addr - ( pBank->start & pBank->mask ) ) & pBank->mask;
+
+	/* Banks smaller than 64 KB are mirrored, so stop at the end of the mask */
+	toEnd = pBank->mask - offset;
+	if ( toEnd < run - 1 )
+		run = toEnd + 1;
+
+	*pRunSize = run;
+	return pBank->baseaddr + offset;
+}
+
+
+/**
+ * Copy 'size' bytes of memory starting at 'addr' into 'dest', looking up
+ * each memory bank only once per contiguous run.
+ */
+void	STMemory_ReadBlock ( Uint32 addr , Uint8 *dest , Uint32 size )
+{
+	Uint8	*p;
+	Uint32	run;
+
+	while ( size > 0 )
+	{
+		p = STMemory_GetRunPointer ( addr , size , &run );
+		if ( p )
+			memcpy ( dest , p , run );
+		else
+			memset ( dest , 0 , run );
+		addr += run;
+		dest += run;
+		size -= run;
+	}
+}
+
+
 
 /**
  * Access memory when using DMA
  * Contrary to the CPU, when DMA is used there should be no bus error
+ * Writes go through put_word/put_byte, so the RAM banks' put functions
+ * also take care of dirty page tracking (used by the blitter).
  */
 Uint16	STMemory_DMA_ReadWord ( Uint32 addr )
 {
@@ -744,6 +838,135 @@ void	STMemory_DMA_WriteByte ( Uint32 addr , Uint8 value )
 
 
 
+/**
+ * Move the pages written since the last fetch to the bitmaps of all
+ * active users, so that each user gets them from its own next fetch.
+ */
+static void	STMemory_DirtyPages_Distribute ( Uint32 nWords )
+{
+	Uint32	i , bits;
+	int	user;
+
+	for ( i = 0 ; i < nWords ; i++ )
+	{
+		bits = DirtyBitmap[ i ];
+		if ( !bits )
+			continue;
+		DirtyBitmap[ i ] = 0;
+		for ( user = 0 ; user < STMEMORY_DIRTY_USERS ; user++ )
+			if ( DirtyUsers[ user ].bActive )
+				DirtyUsers[ user ].Bitmap[ i ] |= bits;
+	}
+}
+
+
+/**
+ * Enable tracking of the ST RAM pages that are written to, for a new user.
+ * Writes through the memory banks (CPU, DMA sound / blitter...),
+ * STMemory_Write*() and STMemory_SafeCopy() / STMemory_SafeClear()
+ * (FDC/HDC transfers, program loading, debugger...) are tracked.
+ * Code writing through host pointers from STMemory_STAddrToPointer()
+ * (GEMDOS HD emulation, NatFeats, SCSI driver) has to call
+ * STMemory_DirtyPages_MarkPointer() itself, other such writes are missed.
+ * Each user has its own bitmap, so fetching it doesn't hide the written
+ * pages from the other users.
+ * Returns the user ID for STMemory_DirtyPages_Fetch(), or -1 if there
+ * are already too many users.
+ */
+int	STMemory_DirtyPages_Register ( void )
+{
+	int	user;
+
+	for ( user = 0 ; user < STMEMORY_DIRTY_USERS ; user++ )
+		if ( !DirtyUsers[ user ].bActive )
+			break;
+	if ( user == STMEMORY_DIRTY_USERS )
+		return -1;
+
+	if ( nDirtyUsers++ > 0 )
+	{
+		/* pages written before this, belong only to the earlier users */
+		STMemory_DirtyPages_Distribute ( STMEMORY_DIRTY_WORDS );
+	}
+	else
+	{
+		memset ( DirtyBitmap , 0 , sizeof ( DirtyBitmap ) );
+		STMemory_DirtyBitmap = DirtyBitmap;
+		memory_set_dirty_tracking ( true );
+	}
+	memset ( DirtyUsers[ user ].Bitmap , 0 , sizeof ( DirtyUsers[ user ].Bitmap ) );
+	DirtyUsers[ user ].bActive = true;
+	return user;
+}
+
+
+/**
+ * Stop tracking written pages for given user. When there are no users
+ * left, the RAM banks use their normal put functions and direct memory
+ * access, so tracking costs nothing.
+ */
+void	STMemory_DirtyPages_Unregister ( int user )
+{
+	if ( user < 0 || user >= STMEMORY_DIRTY_USERS || !DirtyUsers[ user ].bActive )
+		return;
+	DirtyUsers[ user ].bActive = false;
+	if ( --nDirtyUsers > 0 )
+		return;
+	STMemory_DirtyBitmap = NULL;
+	memory_set_dirty_tracking ( false );
+}
+
+
+bool	STMemory_DirtyPages_IsEnabled ( void )
+{
+	return STMemory_DirtyBitmap != NULL;
+}
+
+
+/**
+ * Copy the bitmap of pages written since given user's previous fetch
+ * to pBitmap (STMEMORY_DIRTY_WORDS entries, bit N of word W is set if
+ * page W*32+N was written) and clear it.
+ * Only the words covering STRamEnd are copied, the others are set to 0.
+ * Returns the number of ST RAM pages, or 0 if user isn't registered.
+ */
+Uint32	STMemory_DirtyPages_Fetch ( int user , Uint32 *pBitmap )
+{
+	Uint32	nPages , nWords;
+
+	memset ( pBitmap , 0 , STMEMORY_DIRTY_WORDS * sizeof ( Uint32 ) );
+	if ( user < 0 || user >= STMEMORY_DIRTY_USERS || !DirtyUsers[ user ].bActive )
+		return 0;
+
+	nPages = ( STRamEnd + STMEMORY_DIRTY_PAGE_SIZE - 1 ) >> STMEMORY_DIRTY_PAGE_SHIFT;
+	if ( nPages > STMEMORY_DIRTY_PAGES )
+		nPages = STMEMORY_DIRTY_PAGES;
+	nWords = ( nPages + 31 ) / 32;
+
+	STMemory_DirtyPages_Distribute ( nWords );
+	memcpy ( pBitmap , DirtyUsers[ user ].Bitmap , nWords * sizeof ( Uint32 ) );
+	memset ( DirtyUsers[ user ].Bitmap , 0 , nWords * sizeof ( Uint32 ) );
+	return nPages;
+}
+
+
+/**
+ * Mark 'size' bytes written directly through host pointer 'p' (from
+ * STMemory_STAddrToPointer()) as dirty, as such writes bypass the
+ * memory banks. Does nothing if tracking is disabled or 'p' is not
+ * in ST RAM.
+ */
+void	STMemory_DirtyPages_MarkPointer ( const void *p , Uint32 size )
+{
+	const Uint8	*p8 = p;
+
+	if ( STMemory_DirtyBitmap && size && p8 >= STRam && p8 < STRam + STRamEnd )
+		STMemory_DirtyPages_Mark ( p8 - STRam , size );
+}
+
+
+
+
 /*
 
 Description of the MMU used in STF/STE to address RAM :
@@ -458,6 +458,7 @@ const char Video_fileid[] = "Hatari video.c";
 #include "statusbar.h"
 #include "clocks_timings.h"
 #include "remotedebug.h"
+#include "perftimer.h"
 
 /* The border's mask allows to keep track of all the border tricks		*/
 /* applied to one video line. The masks for all lines are stored in the array	*/
@@ -3201,7 +3202,11 @@ static void Video_EndHBL(void)
 	{
 		/* Copy for hi-res (no overscan) */
 		if (nHBL >= nFirstVisibleHbl && nHBL < nLastVisibleHbl)
+		{
+			PerfTimer_Begin(PERF_TIMER_VIDEO_LINE);
 			Video_CopyScreenLineMono();
+			PerfTimer_End();
+		}
 	}
 	/* Are we in possible visible color display (including borders)? */
 	else if (nHBL >= nFirstVisibleHbl && nHBL < nLastVisibleHbl)
@@ -3212,7 +3217,9 @@ static void Video_EndHBL(void)
 		/* Copy line of screen to buffer to simulate TV raster trace
 		 * - required for mouse cursor display/game updates
 		 * Eg, Lemmings and The Killing Game Show are good examples */
+		PerfTimer_Begin(PERF_TIMER_VIDEO_LINE);
 		Video_CopyScreenLineColor();
+		PerfTimer_End();
 	}
 }
 
@@ -4574,7 +4581,9 @@ void Video_InterruptHandler_VBL ( void )
 	/* Clear any key presses which are due to be de-bounced (held for one ST frame) */
 	Keymap_DebounceAllKeys();
 
+	PerfTimer_Begin(PERF_TIMER_SCREEN);
 	Video_DrawScreen();
+	PerfTimer_End();
 
 	/* Check printer status */
 	Printer_CheckIdleStatus();
@@ -4647,7 +4656,11 @@ void Video_InterruptHandler_VBL ( void )
 	if ( quit_program == 0 )
 		M68000_Exception(EXCEPTION_NR_VBLANK, M68000_EXC_SRC_AUTOVEC);	/* Vertical blank interrupt, level 4 */
 
+	/* Collect subsystem timings of this frame, before syncing to real time */
+	PerfTimer_VBL();
+	PerfTimer_Begin(PERF_TIMER_IDLE);
 	Main_WaitOnVbl();
+	PerfTimer_End();
 }
 
 
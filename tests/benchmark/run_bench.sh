@@ -0,0 +1,106 @@
+#!/bin/sh
+#
+# Run Hatari headless in benchmark mode with a fixed set of workloads,
+# and collect the results into a JSON array.  If a baseline file (output
+# of an earlier run) is given, fail when some workload is slower than
+# that by more than the given tolerance percentage.
+
+if [ $# -lt 2 ] || [ "$1" = "-h" ] || [ "$1" = "--help" ]; then
+	echo "Usage: $0 <hatari> <results.json> [<baseline.json> [<tolerance %>]]"
+	exit 1
+fi
+
+hatari=$1
+if [ ! -x "$hatari" ]; then
+	echo "First parameter must point to valid hatari executable."
+	exit 1
+fi;
+
+results=$2
+baseline=$3
+tolerance=${4:-10}
+vbls=${BENCH_VBLS:-2000}
+
+basedir=$(dirname "$0")
+testdir=$(mktemp -d)
+
+remove_temp() {
+  rm -rf "$testdir"
+}
+trap remove_temp EXIT
+
+export HATARI_TEST=benchmark
+export SDL_VIDEODRIVER=dummy
+export SDL_AUDIODRIVER=dummy
+unset TERM
+
+# workload name, program, Hatari options
+run_workload() {
+	name=$1
+	prg=$2
+	shift 2
+	cp "$prg" "$testdir"
+	HOME="$testdir" $hatari --log-level fatal --benchmark \
+		--bench-json "$testdir/$name.json" --run-vbls "$vbls" \
+		--fast-forward on --frameskips 0 --statusbar off \
+		--drive-led off --tos none "$@" "$testdir/$(basename "$prg")" \
+		> "$testdir/$name.log" 2>&1
+	exitstat=$?
+	if [ $exitstat -ne 0 ] || [ ! -s "$testdir/$name.json" ]; then
+		echo "Benchmark '$name' FAILED, Hatari returned status ${exitstat}."
+		cat "$testdir/$name.log"
+		exit 1
+	fi
+	if [ -n "$first" ]; then
+		echo "," >> "$testdir/all.json"
+	fi
+	first=no
+	printf '{ "workload": "%s",\n  "result": ' "$name" >> "$testdir/all.json"
+	cat "$testdir/$name.json" >> "$testdir/all.json"
+	printf '}' >> "$testdir/all.json"
+	echo "$name: $(grep vbls_per_second "$testdir/$name.json")"
+}
+
+first=
+echo "[" > "$testdir/all.json"
+
+run_workload cycles-exact "$basedir/../cycles/cyccheck.prg" \
+	--machine st --compatible false --cpu-exact true
+run_workload cycles-compatible "$basedir/../cycles/cyccheck.prg" \
+	--machine st --compatible true --cpu-exact false
+run_workload blitter-ste "$basedir/../blitter/blitemu.ttp" --machine ste
+run_workload fullscreen-st "$basedir/../screen/flixfull.prg" \
+	--machine st -z 1 --max-width 416
+run_workload fullscreen-ste "$basedir/../screen/flixfull.prg" \
+	--machine ste -z 1 --max-width 416
+
+echo "" >> "$testdir/all.json"
+echo "]" >> "$testdir/all.json"
+cp "$testdir/all.json" "$results" || exit 1
+
+if [ -z "$baseline" ]; then
+	exit 0
+fi
+
+# print "<workload> <vbls_per_second>" lines from results file
+speeds() {
+	awk -F'"' '/"workload"/ { name = $4 }
+		/"vbls_per_second"/ { split($3, v, /[:, ]+/); print name, v[2] }' "$1"
+}
+
+speeds "$baseline" > "$testdir/base.txt"
+speeds "$results" > "$testdir/new.txt"
+
+awk -v tol="$tolerance" '
+	NR == FNR { base[$1] = $2; next }
+	($1 in base) && base[$1] > 0 {
+		diff = 100.0 * ($2 - base[$1]) / base[$1]
+		printf("%-20s %10.2f -> %10.2f VBLs/s (%+.1f%%)\n", $1, base[$1], $2, diff)
+		if (diff < -tol) slow++
+	}
+	END {
+		if (slow) {
+			printf("Benchmark FAILED, %d workload(s) over %s%% slower than baseline.\n", slow, tol)
+			exit 1
+		}
+	}' "$testdir/base.txt" "$testdir/new.txt"
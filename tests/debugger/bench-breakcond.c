@@ -0,0 +1,122 @@
+/*
+ * Micro-benchmark for Hatari conditional breakpoint matching
+ * in src/debug/breakcond.c
+ *
+ * Usage: bench-breakcond [iterations]
+ */
+#include <stdlib.h>
+#include <time.h>
+#include "main.h"
+#include "debugcpu.h"
+#include "breakcond.h"
+#include "stMemory.h"
+#include "newcpu.h"
+
+#define DEFAULT_ITERATIONS 1000000
+
+static bool SetCpuRegister(const char *regname, Uint32 value)
+{
+	Uint32 *addr;
+
+	switch (DebugCpu_GetRegisterAddress(regname, &addr)) {
+	case 32:
+		*addr = value;
+		break;
+	case 16:
+		*(Uint16*)addr = value;
+		break;
+	default:
+		fprintf(stderr, "SETUP ERROR: Register '%s' to set (to %x) is unrecognized!\n", regname, value);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Run matching for given number of instructions in a loop
+ * at $10000-$101fe. Return number of breakpoint hits.
+ */
+static int RunLoop(int iterations, double *nsecs)
+{
+	clock_t start;
+	int i, hits = 0;
+
+	start = clock();
+	for (i = 0; i < iterations; i++) {
+		regs.pc = 0x10000 + (i & 0xff) * 2;
+		if (BreakCond_MatchCpu()) {
+			hits++;
+		}
+	}
+	*nsecs = (double)(clock() - start) * 1.0e9 / CLOCKS_PER_SEC / iterations;
+	return hits;
+}
+
+int main(int argc, const char *argv[])
+{
+	const char *conditionals[] = {
+		/* hot loop conditions which fail on the cheap check */
+		"($400).w = $1234 && d0 = 5 && pc > $10000 :quiet",
+		"(a0).l = 0 && pc = $10100 && d1 ! d1 :quiet",
+		"$3 = d2 && ($200).b > 4 :quiet",
+		/* constant folding */
+		"1 = 2 && pc > 0 :quiet",
+		NULL
+	};
+	char cmd[32];
+	int iterations = DEFAULT_ITERATIONS;
+	int i, hits, errors = 0;
+	double nsecs;
+
+	if (argc > 1) {
+		iterations = atoi(argv[1]);
+		if (iterations <= 0) {
+			fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+			return 1;
+		}
+	}
+	memset(STRam, 0, STRamEnd);
+	SetCpuRegister("a0", 0x1000);
+	SetCpuRegister("d0", 4);
+	SetCpuRegister("d1", 0);
+	SetCpuRegister("d2", 0);
+
+	/* address breakpoints outside the loop */
+	for (i = 0; i < 64; i++) {
+		sprintf(cmd, "pc = $%x :quiet", 0x20000 + i * 6);
+		if (!BreakCond_Command(cmd, false)) {
+			errors++;
+		}
+	}
+	hits = RunLoop(iterations, &nsecs);
+	fprintf(stderr, "64 address breakpoints: %.1f ns per instruction, %d hits\n", nsecs, hits);
+	if (hits) {
+		errors++;
+	}
+
+	for (i = 0; conditionals[i]; i++) {
+		if (!BreakCond_Command(conditionals[i], false)) {
+			errors++;
+		}
+	}
+	hits = RunLoop(iterations, &nsecs);
+	fprintf(stderr, "+ %d conditional breakpoints: %.1f ns per instruction, %d hits\n", i, nsecs, hits);
+	if (hits) {
+		errors++;
+	}
+
+	/* make the first conditional one match once per loop round */
+	STMemory_WriteWord(0x400, 0x1234);
+	SetCpuRegister("d0", 5);
+	hits = RunLoop(256, &nsecs);
+	fprintf(stderr, "first conditional breakpoint enabled: %d hits in 256 instructions\n", hits);
+	if (hits != 255) {
+		errors++;
+	}
+
+	BreakCond_Command("all", false);
+	if (errors) {
+		fprintf(stderr, "\n***Detected %d ERRORs!***\n\n", errors);
+	}
+	return errors;
+}
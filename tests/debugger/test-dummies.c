@@ -79,6 +79,9 @@ bool STMemory_CheckAreaType(Uint32 addr, int size, int mem_type ) {
 	return true;
 }
 
+/* fake memory banks */
+void memory_set_watched_banks(const uae_u32 *banks, int count) { }
+
 /* fake CPU wrapper stuff */
 #include "m68000.h"
 Uint16 M68000_GetSR(void) { return 0x2700; }
@@ -165,6 +168,14 @@ void Profile_CpuUpdate(void) { }
 void Profile_CpuUpdateInactive(void) { }
 void Profile_CpuStop(void) { }
 
+/* fake rewind stuff */
+#include "rewind.h"
+bool RewindEnabled;
+const char Rewind_Description[] = "";
+int Rewind_Command(int nArgc, char *psArgs[]) { return DEBUGGER_CMDDONE; }
+bool Rewind_Check(void) { return false; }
+bool Rewind_Replaying(void) { return false; }
+
 /* fake Hatari video variables */
 #include "screen.h"
 #include "video.h"
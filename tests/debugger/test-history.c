@@ -0,0 +1,153 @@
+/*
+ * Code to test Hatari CPU history in src/debug/history.c
+ * (encoding and decoding of history records, also when the
+ * ring of history chunks wraps around)
+ */
+#include <stdio.h>
+#include <inttypes.h>
+#include <SDL_types.h>
+#include <stdbool.h>
+#include "main.h"
+#include "m68000.h"
+#include "debugui.h"
+#include "history.h"
+
+/* records added, so that history chunks wrap several times */
+#define RECORDS 400000
+/* how many last records are compared */
+#define CHECKED 65536
+/* every this many records is for DSP */
+#define DSP_INTERVAL 97
+/* PC searched from history */
+#define FIND_PC 0x123457
+
+typedef struct {
+	Uint64 cycles;
+	Uint32 pc;
+	Uint32 regs[16];
+	bool for_dsp;
+} expected_t;
+
+static expected_t Expected[CHECKED];
+
+static struct {
+	Uint64 record;
+	int errors;
+} Check;
+
+static Uint32 Seed = 1;
+
+static Uint32 Random(void)
+{
+	Seed = Seed * 1103515245 + 12345;
+	return Seed >> 8;
+}
+
+/* mostly small values, but also ones needing all the varint bytes */
+static Uint32 RandomDelta(void)
+{
+	switch (Random() % 4) {
+	case 0:
+		return Random() << 8 ^ Random();
+	case 1:
+		return -(Random() % 100);
+	default:
+		return Random() % 100;
+	}
+}
+
+static void CheckRecord(const history_record_t *rec, void *arg)
+{
+	const expected_t *exp = &Expected[rec->record % CHECKED];
+	int i;
+
+	if (rec->record != Check.record) {
+		fprintf(stderr, "*** Record %"PRIu64" instead of %"PRIu64" ***\n",
+			rec->record, Check.record);
+		Check.record = rec->record;
+		Check.errors++;
+	}
+	Check.record++;
+	if (rec->for_dsp != exp->for_dsp || rec->pc != exp->pc ||
+	    (!rec->for_dsp && rec->cycles != exp->cycles)) {
+		fprintf(stderr, "*** Record %"PRIu64": %s PC $%x, %"PRIu64" cycles, instead of %s PC $%x, %"PRIu64" cycles ***\n",
+			rec->record, rec->for_dsp ? "DSP" : "CPU", rec->pc, rec->cycles,
+			exp->for_dsp ? "DSP" : "CPU", exp->pc, exp->cycles);
+		Check.errors++;
+		return;
+	}
+	for (i = 0; i < 16; i++) {
+		if (rec->regs[i] != exp->regs[i]) {
+			fprintf(stderr, "*** Record %"PRIu64": register %d $%x instead of $%x ***\n",
+				rec->record, i, rec->regs[i], exp->regs[i]);
+			Check.errors++;
+			return;
+		}
+	}
+}
+
+int main(int argc, const char *argv[])
+{
+	char *cmd_enable[] = { "history", "cpu", "100000", "regs" };
+	Uint32 count, back, pc = 0;
+	expected_t *exp;
+	int i, j, errors = 0;
+
+	History_Parse(ARRAY_SIZE(cmd_enable), cmd_enable);
+	memset(Regs, 0, sizeof(Regs));
+	regs.pc_p = regs.pc_oldp = NULL;
+
+	for (i = 0; i < RECORDS; i++) {
+		exp = &Expected[i % CHECKED];
+		if (i % DSP_INTERVAL == 0) {
+			/* test dummies give zero DSP PC, and DSP
+			 * records get CPU registers of previous one
+			 */
+			exp->for_dsp = true;
+			exp->pc = 0;
+			memcpy(exp->regs, Regs, sizeof(exp->regs));
+			History_AddDsp();
+			continue;
+		}
+		/* only the PC searched below is odd */
+		pc += RandomDelta() & ~1;
+		regs.pc = (i == RECORDS - 100) ? FIND_PC : pc;
+		exp->cycles = (Random() % 8 == 0) ? Random() : Random() % 40;
+		CyclesGlobalClockCounter += exp->cycles;
+		for (j = Random() % 4; j > 0; j--) {
+			Regs[Random() % 16] += RandomDelta();
+		}
+		exp->for_dsp = false;
+		exp->pc = regs.pc;
+		memcpy(exp->regs, Regs, sizeof(exp->regs));
+		History_AddCpu();
+	}
+
+	count = History_Count();
+	fprintf(stderr, "%d records added, %u still in history.\n", RECORDS, count);
+	if (count >= RECORDS) {
+		fprintf(stderr, "*** History chunks didn't wrap ***\n");
+		errors++;
+	}
+	if (count > CHECKED) {
+		count = CHECKED;
+	}
+	Check.record = RECORDS - count;
+	if (History_Walk(count, CheckRecord, NULL) != count) {
+		fprintf(stderr, "*** Walk didn't give %u records ***\n", count);
+		errors++;
+	}
+	errors += Check.errors;
+
+	if (!History_Find(HISTORY_FIND_PC, FIND_PC, &back) || back != 99) {
+		fprintf(stderr, "*** PC $%x not found 99 records back ***\n", FIND_PC);
+		errors++;
+	}
+
+	if (errors) {
+		fprintf(stderr, "\n***Detected %d ERRORs in history tests!***\n\n", errors);
+	} else {
+		fprintf(stderr, "\nFinished without any errors!\n\n");
+	}
+	return errors;
+}
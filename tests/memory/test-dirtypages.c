@@ -0,0 +1,125 @@
+/*
+ * Code to test ST RAM dirty page tracking in src/stMemory.c
+ * (each tracking user needs to get all the pages written
+ * since its own previous fetch)
+ */
+#include <stdio.h>
+#include <SDL_types.h>
+#include <stdbool.h>
+#include "main.h"
+#include "stMemory.h"
+
+#define RAM_SIZE (4*1024*1024)
+
+extern int DirtyTrackingSwitches;
+
+static Uint32 Bitmap[STMEMORY_DIRTY_WORDS];
+
+/* fetch dirty pages for given user, and compare them to expected ones */
+static int TestFetch(const char *name, int user, int count, const Uint32 *pages)
+{
+	Uint32 page, nPages;
+	int i, errors = 0;
+
+	fprintf(stderr, "- %s\n", name);
+	nPages = STMemory_DirtyPages_Fetch(user, Bitmap);
+	if (nPages != RAM_SIZE / STMEMORY_DIRTY_PAGE_SIZE) {
+		fprintf(stderr, "  ***%u pages instead of %u***\n",
+			nPages, RAM_SIZE / STMEMORY_DIRTY_PAGE_SIZE);
+		return 1;
+	}
+	for (i = 0; i < count; i++) {
+		page = pages[i];
+		if (!(Bitmap[page >> 5] & (1U << (page & 31)))) {
+			fprintf(stderr, "  ***Written page %u not dirty***\n", page);
+			errors++;
+		}
+		Bitmap[page >> 5] &= ~(1U << (page & 31));
+	}
+	for (page = 0; page < STMEMORY_DIRTY_PAGES; page++) {
+		if (Bitmap[page >> 5] & (1U << (page & 31))) {
+			fprintf(stderr, "  ***Unwritten page %u dirty***\n", page);
+			errors++;
+		}
+	}
+	return errors;
+}
+
+int main(int argc, const char *argv[])
+{
+	const Uint32 pages_a1[] = { 1, 2 };
+	const Uint32 pages_a2[] = { 5, 16383 };
+	const Uint32 pages_b1[] = { 5, 7, 16383 };
+	const Uint32 pages_a3[] = { 7 };
+	int a, b, user, users[3];
+	int i, tests = 0, errors = 0;
+
+	STRamEnd = RAM_SIZE;
+
+	fprintf(stderr, "\nDirty pages fetched by users:\n");
+
+	a = STMemory_DirtyPages_Register();
+	/* one write covering two pages, one not in ST RAM */
+	STMemory_DirtyPages_MarkPointer(STRam + 0x1ff, 2);
+	STMemory_DirtyPages_MarkPointer(Bitmap, sizeof(Bitmap));
+	errors += TestFetch("first user", a, ARRAY_SIZE(pages_a1), pages_a1);
+	errors += TestFetch("first user again", a, 0, NULL);
+	tests += 2;
+
+	/* page written before second user registered */
+	STMemory_DirtyPages_MarkPointer(STRam + 0x500, 1);
+	b = STMemory_DirtyPages_Register();
+	STMemory_DirtyPages_MarkPointer(STRam + 0x520, 4);
+	/* write through memory banks, at the end of RAM */
+	STMemory_DirtyPages_Mark(RAM_SIZE - 1, 1);
+	errors += TestFetch("first user, with second one", a, ARRAY_SIZE(pages_a2), pages_a2);
+	STMemory_DirtyPages_MarkPointer(STRam + 0x700, 4);
+	errors += TestFetch("second user", b, ARRAY_SIZE(pages_b1), pages_b1);
+	errors += TestFetch("first user, after second one", a, ARRAY_SIZE(pages_a3), pages_a3);
+	tests += 3;
+
+	fprintf(stderr, "\nUser registration:\n");
+
+	STMemory_DirtyPages_Unregister(a);
+	if (STMemory_DirtyPages_Fetch(a, Bitmap) != 0) {
+		fprintf(stderr, "  ***Fetch succeeded for unregistered user***\n");
+		errors++;
+	}
+	if (!STMemory_DirtyPages_IsEnabled()) {
+		fprintf(stderr, "  ***Tracking disabled while second user is active***\n");
+		errors++;
+	}
+	STMemory_DirtyPages_Unregister(b);
+	if (STMemory_DirtyPages_IsEnabled() || DirtyTrackingSwitches != 2) {
+		fprintf(stderr, "  ***Tracking enabled without users, or switched %d times***\n",
+			DirtyTrackingSwitches);
+		errors++;
+	}
+	tests++;
+
+	for (i = 0; i < ARRAY_SIZE(users); i++) {
+		users[i] = STMemory_DirtyPages_Register();
+	}
+	user = STMemory_DirtyPages_Register();
+	if (user < 0) {
+		fprintf(stderr, "  ***Registering 4 users failed***\n");
+		errors++;
+	}
+	if (STMemory_DirtyPages_Register() >= 0) {
+		fprintf(stderr, "  ***Registering 5th user succeeded***\n");
+		errors++;
+	}
+	tests += 2;
+	STMemory_DirtyPages_Unregister(user);
+	for (i = 0; i < ARRAY_SIZE(users); i++) {
+		STMemory_DirtyPages_Unregister(users[i]);
+	}
+
+	if (errors) {
+		fprintf(stderr, "\n***Detected %d ERRORs in %d automated tests!***\n\n",
+			errors, tests);
+	} else {
+		fprintf(stderr, "\nFinished without any errors!\n\n");
+	}
+	return errors;
+}
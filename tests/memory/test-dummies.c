@@ -0,0 +1,73 @@
+/*
+ * Dummy stuff needed to compile ST memory test code
+ */
+#include <stdio.h>
+#include "main.h"
+
+/* fake tracing & logging */
+#include "log.h"
+Uint64 LogTraceFlags = 0;
+FILE *TraceFile;
+void Log_Printf(LOGTYPE nType, const char *psFormat, ...) { }
+
+/* fake Hatari configuration variables */
+#include "configuration.h"
+CNF_PARAMS ConfigureParams;
+
+/* fake TOS, VDI, floppy and GEMDOS HD variables */
+#include "tos.h"
+#include "vdi.h"
+#include "floppy.h"
+#include "gemdos.h"
+bool bIsEmuTOS, bRamTosImage;
+Uint16 TosVersion;
+Uint32 TosAddress, TosSize;
+unsigned int ConnectedDriveMask;
+bool bUseVDIRes;
+int VDIWidth, VDIHeight, VDIPlanes;
+int nBootDrive;
+EMULATEDDRIVE **emudrives;
+
+/* fake video.c */
+#include "screen.h"
+#include "video.h"
+int nVBLs;
+void Video_GetPosition(int *pFrameCycles, int *pHBL, int *pLineCycles)
+{
+	*pFrameCycles = *pHBL = *pLineCycles = 0;
+}
+
+/* fake ioMem.c */
+#include "ioMem.h"
+bool IoMem_CheckBusError(Uint32 addr) { return false; }
+
+/* fake memory snapshot functions */
+#include "memorySnapShot.h"
+void MemorySnapShot_Store(void *pData, int Size) { }
+bool MemorySnapShot_StorePages(Uint8 *pMem, Uint32 Size, bool bTracked) { return false; }
+
+/* fake debugger functions */
+#include "watchpoint.h"
+void Watchpoint_Check(Uint32 addr, int size, int mode) { }
+
+/* fake CPU core */
+#include "m68000.h"
+struct regstruct regs;
+void M68000_Flush_All_Caches(uaecptr addr, int size) { }
+
+/* fake CPU memory banks, the number of times dirty
+ * tracking was switched tells whether it costs anything */
+#include "stMemory.h"
+uae_u8 *TTmemory;
+uae_u32 TTmem_size;
+addrbank *mem_banks[MEMORY_BANKS];
+int DirtyTrackingSwitches;
+bool memory_region_bus_error(uaecptr addr) { return false; }
+bool memory_region_iomem(uaecptr addr) { return false; }
+void memory_map_Standard_RAM(Uint32 MMU_Bank0_Size, Uint32 MMU_Bank1_Size) { }
+void memory_set_dirty_tracking(bool enable) { DirtyTrackingSwitches++; }
+uae_u32 memory_get_word(uaecptr addr) { return 0; }
+uae_u32 memory_get_byte(uaecptr addr) { return 0; }
+void memory_put_word(uaecptr addr, uae_u32 w) { }
+void memory_put_byte(uaecptr addr, uae_u32 b) { }
+uae_u8 *memory_get_real_address(uaecptr addr) { return NULL; }
@@ -0,0 +1,93 @@
+; Test that rewinding the emulation to an in-memory snapshot restores
+; memory written by GEMDOS HD emulation Fread(), which writes ST RAM
+; directly instead of through the CPU.  Needs --bios-intercept for
+; invoking the debugger with Dbmsg().
+; Assemble this code with TurboAss.
+
+	movea.l 4(SP),A5        ; Get pointer to basepage
+	move.l  $0C(A5),D0      ; Text segment length
+	add.l   $14(A5),D0      ; Data segment length
+	add.l   $1C(A5),D0      ; BSS segment length
+	add.l   #$0800,D0       ; Space for the stack
+
+	move.l  D0,D1
+	add.l   A5,D1
+	and.l   #-2,D1
+
+	movea.l D1,SP
+	move.l  D0,-(SP)
+	move.l  A5,-(SP)
+	clr.w   -(SP)
+	move.w  #$4A,-(SP)
+	trap    #1              ; Mshrink
+	lea     12(SP),SP
+
+	; Invoke debugger, for enabling rewind
+	pea     msg_start(PC)
+	move.w  #$F000+msg_start_end-msg_start,-(SP)
+	move.w  #5,-(SP)
+	move.w  #11,-(SP)
+	trap    #14             ; Dbmsg
+	lea     10(SP),SP
+
+	; Read test file to the (cleared) BSS buffer
+	clr.w   -(SP)
+	pea     fname(PC)
+	move.w  #$3D,-(SP)
+	trap    #1              ; Fopen
+	addq.l  #8,SP
+	move.w  D0,D7
+
+	pea     buffer(PC)
+	move.l  #511,-(SP)
+	move.w  D7,-(SP)
+	move.w  #$3F,-(SP)
+	trap    #1              ; Fread
+	lea     12(SP),SP
+
+	; Busy loop over several VBLs, so that rewind takes snapshots
+	; after Fread()
+	move.l  #100000,D6
+wait:
+	subq.l  #1,D6
+	bne.s   wait
+
+	; Invoke debugger, for rewinding to a snapshot taken in the loop
+	pea     msg_loop(PC)
+	move.w  #$F000+msg_loop_end-msg_loop,-(SP)
+	move.w  #5,-(SP)
+	move.w  #11,-(SP)
+	trap    #14             ; Dbmsg
+	lea     10(SP),SP
+
+	; Print what the buffer contains after rewind
+	pea     buffer(PC)
+	move.w  #9,-(SP)
+	trap    #1              ; Cconws
+	addq.l  #6,SP
+
+	clr.w   -(SP)
+	trap    #1              ; Pterm0
+
+
+	DATA
+
+fname:
+	DC.B "REWIND.DAT",0
+
+msg_start:
+	DC.B "Enable rewind"
+msg_start_end:
+
+msg_loop:
+	DC.B "Rewind into the loop"
+msg_loop_end:
+
+	EVEN
+
+	BSS
+
+buffer:
+	DS.B 512
+
+	END
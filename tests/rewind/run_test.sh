@@ -0,0 +1,121 @@
+#!/bin/sh
+
+if [ $# -lt 2 ] || [ "$1" = "-h" ] || [ "$1" = "--help" ]; then
+	echo "Usage: $0 <hatari> <test> ..."
+	echo "Tests: watch, fread"
+	exit 1;
+fi
+
+hatari=$1
+shift
+if [ ! -x "$hatari" ]; then
+	echo "First parameter must point to valid hatari executable."
+	exit 1;
+fi;
+test=$1
+shift
+
+basedir=$(dirname "$0")
+testdir=$(mktemp -d)
+
+remove_temp() {
+  rm -rf "$testdir"
+}
+trap remove_temp EXIT
+
+# Debugger input for each test program, which invokes the debugger
+# with Dbmsg() first for enabling rewind, and then for rewinding
+case "$test" in
+	watch)
+		# Watchpoint for a variable written after the only rewind
+		# snapshot, and before the instruction rewound to.  Replaying
+		# the write must not count as a hit, nor cause a break after
+		# the replay (the program invokes the debugger again after
+		# it's continued)
+		prg=wprwnd.prg
+		cat > "$testdir/input.txt" << EOF
+rewind on 1000
+c
+watch a4
+rewind back 50
+watch
+c
+c
+EOF
+		;;
+	fread)
+		# Buffer read by Fread() before a busy loop is printed after
+		# rewinding to a snapshot taken during the loop, so it needs
+		# to have survived the rewind although GEMDOS HD emulation
+		# writes it directly instead of through the CPU
+		prg=frdrwnd.prg
+		printf "Rewind test data" > "$testdir/REWIND.DAT"
+		cat > "$testdir/input.txt" << EOF
+rewind on 1 50
+c
+rewind back 1000
+c
+c
+EOF
+		;;
+	*)
+		echo "Unknown test '$test'."
+		exit 1
+		;;
+esac
+
+# GEMDOS HD emulation uses the program directory, so files
+# read by the program need to be next to it
+cp "$basedir/$prg" "$testdir"
+
+export HATARI_TEST=rewind
+export SDL_VIDEODRIVER=dummy
+export SDL_AUDIODRIVER=dummy
+
+HOME="$testdir" $hatari --log-level fatal --sound off --tos none \
+	--run-vbls 500 --bios-intercept on "$@" "$testdir/$prg" \
+	> "$testdir/out.txt" 2>&1 < "$testdir/input.txt"
+exitstat=$?
+if [ $exitstat -ne 0 ]; then
+	echo "Running hatari failed. Status=${exitstat}."
+	cat "$testdir/out.txt"
+	exit 1
+fi
+
+# Now check for expected strings:
+
+if ! grep -q "Rewound to instruction" "$testdir/out.txt"; then
+	echo "Test FAILED, emulation wasn't rewound:"
+	cat "$testdir/out.txt"
+	exit 1
+fi
+
+case "$test" in
+	watch)
+		if ! grep -q "^ *1: .*, 0 hits" "$testdir/out.txt"; then
+			echo "Test FAILED, replayed accesses counted as watchpoint hits:"
+			cat "$testdir/out.txt"
+			exit 1
+		fi
+		if grep -q "watchpoint .* hit" "$testdir/out.txt"; then
+			echo "Test FAILED, replayed access caused a watchpoint break:"
+			cat "$testdir/out.txt"
+			exit 1
+		fi
+		if ! grep -q "Program done" "$testdir/out.txt"; then
+			echo "Test FAILED, program didn't finish:"
+			cat "$testdir/out.txt"
+			exit 1
+		fi
+		;;
+	fread)
+		if ! grep -q "Rewind test data" "$testdir/out.txt"; then
+			echo "Test FAILED, Fread() data missing after rewind:"
+			cat "$testdir/out.txt"
+			exit 1
+		fi
+		;;
+esac
+
+echo "Test PASSED."
+exit 0
@@ -0,0 +1,82 @@
+; Test that watchpoint hits aren't counted for memory accesses done
+; while rewind replays emulation, and that they don't cause a break
+; after replay ends.  Needs --bios-intercept for invoking the debugger
+; with Dbmsg().
+; Assemble this code with TurboAss.
+
+	movea.l 4(SP),A5        ; Get pointer to basepage
+	move.l  $0C(A5),D0      ; Text segment length
+	add.l   $14(A5),D0      ; Data segment length
+	add.l   $1C(A5),D0      ; BSS segment length
+	add.l   #$0800,D0       ; Space for the stack
+
+	move.l  D0,D1
+	add.l   A5,D1
+	and.l   #-2,D1
+
+	movea.l D1,SP
+	move.l  D0,-(SP)
+	move.l  A5,-(SP)
+	clr.w   -(SP)
+	move.w  #$4A,-(SP)
+	trap    #1              ; Mshrink
+	lea     12(SP),SP
+
+	; Invoke debugger, for enabling rewind
+	pea     msg_start(PC)
+	move.w  #$F000+msg_start_end-msg_start,-(SP)
+	move.w  #5,-(SP)
+	move.w  #11,-(SP)
+	trap    #14             ; Dbmsg
+	lea     10(SP),SP
+
+	; Write to the watched variable once, after rewind has
+	; taken its first snapshot
+	lea     value(PC),A4
+	move.l  #$12345678,(A4)
+
+	; Busy loop, so that rewind can step back to after the write
+	move.l  #100,D6
+wait:
+	subq.l  #1,D6
+	bne.s   wait
+
+	; Invoke debugger, for adding watchpoint for A4 and rewinding
+	; into the loop.  Program gets here again after the rewind
+	pea     msg_loop(PC)
+	move.w  #$F000+msg_loop_end-msg_loop,-(SP)
+	move.w  #5,-(SP)
+	move.w  #11,-(SP)
+	trap    #14             ; Dbmsg
+	lea     10(SP),SP
+
+	pea     msg_done(PC)
+	move.w  #9,-(SP)
+	trap    #1              ; Cconws
+	addq.l  #6,SP
+
+	clr.w   -(SP)
+	trap    #1              ; Pterm0
+
+
+	DATA
+
+msg_start:
+	DC.B "Enable rewind"
+msg_start_end:
+
+msg_loop:
+	DC.B "Watch and rewind"
+msg_loop_end:
+
+msg_done:
+	DC.B "Program done",13,10,0
+
+	EVEN
+
+	BSS
+
+value:
+	DS.L 1
+
+	END
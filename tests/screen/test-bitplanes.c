@@ -0,0 +1,133 @@
+/*
+ * Code to test that all the bitplane to chunky conversion functions
+ * in src/bitplanes.c supported by the host CPU give pixel-exact same
+ * results as a straightforward bit-by-bit conversion.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <SDL_types.h>
+#include <stdbool.h>
+#include "bitplanes.h"
+
+#define BLOCKS	41	/* odd count tests also the single block code paths */
+
+/* fixed pseudo random sequence, so that results are reproducible */
+static Uint32 rnd_seed = 1;
+static Uint32 rnd(void)
+{
+	rnd_seed = rnd_seed * 1103515245 + 12345;
+	return rnd_seed >> 8;
+}
+
+/**
+ * Reference conversion: take bit of each pixel from each bitplane word
+ */
+static void ref_index(const Uint8 *planes, int bpp, int blocks, Uint8 *idx)
+{
+	int block, x, p;
+	Uint16 word;
+
+	for (block = 0; block < blocks; block++, planes += 2*bpp) {
+		for (x = 0; x < 16; x++) {
+			*idx = 0;
+			for (p = 0; p < bpp; p++) {
+				word = planes[2*p] << 8 | planes[2*p+1];
+				if (word & (0x8000 >> x))
+					*idx |= 1 << p;
+			}
+			idx++;
+		}
+	}
+}
+
+static int test_kernels(const BITPLANE_KERNELS *k, int bpp, const Uint16 *planes,
+                        const Uint32 *pal, const Uint8 *expected)
+{
+	Uint32 hvram32[16*BLOCKS + 1];
+	Uint16 hvram16[16*BLOCKS + 1];
+	Uint8 idx[16];
+	int i, errors = 0;
+
+	for (i = 0; i < BLOCKS; i++) {
+		k->ToIndex(planes + i*bpp, bpp, idx);
+		if (memcmp(idx, expected + 16*i, 16) != 0) {
+			fprintf(stderr, "ERROR: %s ToIndex, %d planes, block %d differs\n",
+				k->name, bpp, i);
+			errors++;
+			break;
+		}
+	}
+
+	/* last item is guard for writes past the end */
+	hvram32[16*BLOCKS] = 0xdeadbeef;
+	hvram16[16*BLOCKS] = 0xdead;
+	k->ToChunky32(planes, bpp, BLOCKS, pal, hvram32);
+	k->ToChunky16(planes, bpp, BLOCKS, pal, hvram16);
+	for (i = 0; i < 16*BLOCKS; i++) {
+		if (hvram32[i] != pal[expected[i]]) {
+			fprintf(stderr, "ERROR: %s ToChunky32, %d planes, pixel %d: 0x%x != 0x%x\n",
+				k->name, bpp, i, hvram32[i], pal[expected[i]]);
+			errors++;
+			break;
+		}
+	}
+	for (i = 0; i < 16*BLOCKS; i++) {
+		if (hvram16[i] != (Uint16)pal[expected[i]]) {
+			fprintf(stderr, "ERROR: %s ToChunky16, %d planes, pixel %d: 0x%x != 0x%x\n",
+				k->name, bpp, i, hvram16[i], (Uint16)pal[expected[i]]);
+			errors++;
+			break;
+		}
+	}
+	if (hvram32[16*BLOCKS] != 0xdeadbeef || hvram16[16*BLOCKS] != 0xdead) {
+		fprintf(stderr, "ERROR: %s, %d planes, write past the end\n",
+			k->name, bpp);
+		errors++;
+	}
+	return errors;
+}
+
+int main(int argc, const char *argv[])
+{
+	const int bpps[] = { 1, 2, 4, 8 };
+	const BITPLANE_KERNELS *kernels[8];
+	/* random bitplane words, in Atari (big endian) byte order */
+	Uint16 planes[8*BLOCKS];
+	Uint8 expected[16*BLOCKS];
+	Uint32 pal[256];
+	int i, j, b, count, tests = 0, errors = 0;
+
+	count = Bitplanes_GetKernels(kernels, 8);
+	fprintf(stderr, "Testing conversion functions:");
+	for (i = 0; i < count; i++)
+		fprintf(stderr, " %s", kernels[i]->name);
+	fprintf(stderr, "\n");
+
+	for (j = 0; j < 100; j++) {
+		for (i = 0; i < 256; i++)
+			pal[i] = rnd() ^ rnd() << 16;
+		for (i = 0; i < 8*BLOCKS; i++) {
+			/* also all-set / all-clear words */
+			switch (rnd() % 8) {
+			case 0:  planes[i] = 0; break;
+			case 1:  planes[i] = 0xffff; break;
+			default: planes[i] = rnd(); break;
+			}
+		}
+		for (b = 0; b < 4; b++) {
+			ref_index((const Uint8 *)planes, bpps[b], BLOCKS, expected);
+			for (i = 0; i < count; i++) {
+				errors += test_kernels(kernels[i], bpps[b], planes, pal, expected);
+				tests++;
+			}
+		}
+	}
+
+	if (errors) {
+		fprintf(stderr, "\n***Detected %d ERRORs in %d automated tests!***\n\n",
+			errors, tests);
+	} else {
+		fprintf(stderr, "\nFinished %d tests without any errors!\n\n", tests);
+	}
+	return errors;
+}
@@ -0,0 +1,76 @@
+/*
+ * Dummy stuff needed to compile sound related test code
+ */
+#include <stdio.h>
+#include <string.h>
+#include "main.h"
+
+/* fake tracing & logging */
+#include "log.h"
+Uint64 LogTraceFlags = 0;
+FILE *TraceFile;
+void Log_Printf(LOGTYPE nType, const char *psFormat, ...) { }
+void Log_AlertDlg(LOGTYPE nType, const char *psFormat, ...) { }
+
+/* fake Hatari configuration variables */
+#include "configuration.h"
+CNF_PARAMS ConfigureParams;
+
+/* fake audio.c */
+#include "audio.h"
+int nAudioFrequency = 44100;
+int SoundBufferSize = 1024 / 4;
+void Audio_Lock(void) { }
+void Audio_Unlock(void) { }
+
+/* fake screen.c */
+#include "screen.h"
+int nScreenRefreshRate = 50;
+
+/* fake cycles stuff */
+#include "cycles.h"
+Uint64	CyclesGlobalClockCounter;
+void Cycles_SetCounter(int nId, int nValue) { }
+
+/* fake clocks_timings.c */
+#include "clocks_timings.h"
+CLOCKS_STRUCT	MachineClocks;
+Uint32 ClocksTimings_GetVBLPerSec(MACHINETYPE MachineType, int ScreenRefreshRate)
+{
+	return ScreenRefreshRate << CLOCKS_TIMINGS_SHIFT_VBL;
+}
+void ClocksTimings_ConvertCycles(Uint32 CyclesIn, Uint64 ClockFreqIn,
+				 CLOCKS_CYCLES_STRUCT *CyclesStructOut, Uint64 ClockFreqOut)
+{
+	memset(CyclesStructOut, 0, sizeof(*CyclesStructOut));
+}
+
+/* fake other sound sources */
+#include "dmaSnd.h"
+#include "crossbar.h"
+void DmaSnd_GenerateSamples(int nMixBufIdx, int nSamplesToGenerate) { }
+void Crossbar_GenerateSamples(int nMixBufIdx, int nSamplesToGenerate) { }
+
+/* fake sound recording */
+#include "avi_record.h"
+#include "wavFormat.h"
+#include "ymFormat.h"
+bool bRecordingAvi, bRecordingWav, bRecordingYM;
+bool Avi_RecordAudioStream(Sint16 pSamples[][2], int SampleIndex, int SampleLength) { return false; }
+bool WAVFormat_OpenFile(char *pszWavFileName) { return false; }
+void WAVFormat_CloseFile(void) { }
+void WAVFormat_Update(Sint16 pSamples[][2], int Index, int Length) { }
+bool YMFormat_BeginRecording(const char *pszYMFileName) { return false; }
+void YMFormat_EndRecording(void) { }
+
+/* fake perftimer.c */
+#include "perftimer.h"
+#if ENABLE_PERF_TIMERS
+perf_timers_t PerfTimers;
+#endif
+
+/* fake file.c & memorySnapShot.c */
+#include "file.h"
+#include "memorySnapShot.h"
+bool File_DoesFileExtensionMatch(const char *pszFileName, const char *pszExtension) { return false; }
+void MemorySnapShot_Store(void *pData, int Size) { }
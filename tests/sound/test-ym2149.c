@@ -0,0 +1,235 @@
+/*
+ * Code to test that the block based YM2149 sample generation in
+ * src/sound.c gives bit-exact same output and internal state as
+ * emulating the YM2149 one 250 kHz cycle at a time.
+ *
+ * sound.c is included directly to access its internal state.
+ */
+#include <inttypes.h>
+#include "sound.c"
+
+#define ITERATIONS	20000
+
+/* YM2149 internal state changed by sample generation */
+typedef struct {
+	ymu16	ToneA_count, ToneA_val;
+	ymu16	ToneB_count, ToneB_val;
+	ymu16	ToneC_count, ToneC_val;
+	ymu16	Noise_count, Noise_val;
+	ymu16	Env_count;
+	ymu32	Env_pos;
+	ymu16	Freq_div_2;
+	ymu32	RndRack;
+	yms32	LPF_y0, LPF_x1;
+	yms32	PWM_y0, PWM_x1;
+	int	pos_write;
+} ym_state_t;
+
+static void state_save(ym_state_t *s)
+{
+	s->ToneA_count = ToneA_count; s->ToneA_val = ToneA_val;
+	s->ToneB_count = ToneB_count; s->ToneB_val = ToneB_val;
+	s->ToneC_count = ToneC_count; s->ToneC_val = ToneC_val;
+	s->Noise_count = Noise_count; s->Noise_val = Noise_val;
+	s->Env_count = Env_count; s->Env_pos = Env_pos;
+	s->Freq_div_2 = Freq_div_2;
+	s->RndRack = RndRack;
+	s->LPF_y0 = LPF_y0; s->LPF_x1 = LPF_x1;
+	s->PWM_y0 = PWM_y0; s->PWM_x1 = PWM_x1;
+	s->pos_write = YM_Buffer_250_pos_write;
+}
+
+static void state_restore(const ym_state_t *s)
+{
+	ToneA_count = s->ToneA_count; ToneA_val = s->ToneA_val;
+	ToneB_count = s->ToneB_count; ToneB_val = s->ToneB_val;
+	ToneC_count = s->ToneC_count; ToneC_val = s->ToneC_val;
+	Noise_count = s->Noise_count; Noise_val = s->Noise_val;
+	Env_count = s->Env_count; Env_pos = s->Env_pos;
+	Freq_div_2 = s->Freq_div_2;
+	RndRack = s->RndRack;
+	LPF_y0 = s->LPF_y0; LPF_x1 = s->LPF_x1;
+	PWM_y0 = s->PWM_y0; PWM_x1 = s->PWM_x1;
+	YM_Buffer_250_pos_write = s->pos_write;
+}
+
+/* compared field by field, as padding between them isn't set */
+static bool state_equal(const ym_state_t *a, const ym_state_t *b)
+{
+	return a->ToneA_count == b->ToneA_count && a->ToneA_val == b->ToneA_val
+		&& a->ToneB_count == b->ToneB_count && a->ToneB_val == b->ToneB_val
+		&& a->ToneC_count == b->ToneC_count && a->ToneC_val == b->ToneC_val
+		&& a->Noise_count == b->Noise_count && a->Noise_val == b->Noise_val
+		&& a->Env_count == b->Env_count && a->Env_pos == b->Env_pos
+		&& a->Freq_div_2 == b->Freq_div_2
+		&& a->RndRack == b->RndRack
+		&& a->LPF_y0 == b->LPF_y0 && a->LPF_x1 == b->LPF_x1
+		&& a->PWM_y0 == b->PWM_y0 && a->PWM_x1 == b->PWM_x1
+		&& a->pos_write == b->pos_write;
+}
+
+/**
+ * Reference implementation, emulating one YM2149 cycle at a time
+ */
+static void YM2149_DoSamples_250_Cycle(int SamplesToGenerate_250)
+{
+	ymsample	sample;
+	int		pos;
+	int		n;
+
+	pos = YM_Buffer_250_pos_write;
+
+	for ( n=0 ; n<SamplesToGenerate_250 ; n++ )
+	{
+		Freq_div_2 ^= 1;
+		if ( Freq_div_2 == 0 )
+			Noise_count++;
+		if ( Noise_count >= Noise_per )
+		{
+			Noise_count = 0;
+			Noise_val = YM2149_RndCompute();
+		}
+
+		ToneA_count++;
+		if ( ToneA_count >= ToneA_per )
+		{
+			ToneA_count = 0;
+			ToneA_val ^= YM_SQUARE_UP;
+		}
+
+		ToneB_count++;
+		if ( ToneB_count >= ToneB_per )
+		{
+			ToneB_count = 0;
+			ToneB_val ^= YM_SQUARE_UP;
+		}
+
+		ToneC_count++;
+		if ( ToneC_count >= ToneC_per )
+		{
+			ToneC_count = 0;
+			ToneC_val ^= YM_SQUARE_UP;
+		}
+
+		Env_count += 1;
+		if ( Env_count >= Env_per )
+		{
+			Env_count = 0;
+			Env_pos += 1;
+			if ( Env_pos >= 3*32 )
+				Env_pos -= 2*32;
+		}
+
+		sample = YM2149_Output_250();
+
+		if ( YM2149_LPF_Filter == YM2149_LPF_FILTER_LPF_STF )
+			sample = LowPassFilter ( sample );
+		else if ( YM2149_LPF_Filter == YM2149_LPF_FILTER_PWM )
+			sample = PWMaliasFilter ( sample );
+
+		YM_Buffer_250[ pos ] = sample;
+		pos = ( pos + 1 ) & YM_BUFFER_250_SIZE_MASK;
+	}
+
+	YM_Buffer_250_pos_write = pos;
+}
+
+/* fixed pseudo random sequence, so that results are reproducible */
+static Uint32 rnd_seed = 1;
+static Uint32 rnd(Uint32 max)
+{
+	rnd_seed = rnd_seed * 1103515245 + 12345;
+	return (rnd_seed >> 8) % max;
+}
+
+/**
+ * Write random value to a random YM register, preferring
+ * short periods to get more edges within the test blocks
+ */
+static void write_random_reg(void)
+{
+	int reg = rnd(14);
+	Uint8 value = rnd(256);
+
+	switch (reg) {
+	case 1: case 3: case 5:
+		/* tone period high bits */
+		value = rnd(4) ? 0 : value;
+		break;
+	case 8: case 9: case 10:
+		/* volume / envelope */
+		value = rnd(3) ? (value & 0x1f) : 0x10;
+		break;
+	case 11:
+	case 12:
+		/* envelope period */
+		value = (reg == 12 && rnd(4)) ? 0 : value;
+		break;
+	}
+	Sound_WriteReg(reg, value);
+}
+
+int main(int argc, const char *argv[])
+{
+	static ymsample block[YM_BUFFER_250_SIZE], cycle[YM_BUFFER_250_SIZE];
+	const int filters[] = {
+		YM2149_LPF_FILTER_NONE,
+		YM2149_LPF_FILTER_LPF_STF,
+		YM2149_LPF_FILTER_PWM
+	};
+	ym_state_t start, end_block, end_cycle;
+	int i, j, count, pos, errors = 0;
+	Uint64 samples = 0;
+
+	Ym2149_Init();
+
+	for (i = 0; i < ITERATIONS && errors < 10; i++) {
+		/* filter type can change at any time from the options */
+		if (!rnd(100))
+			YM2149_LPF_Filter = filters[rnd(3)];
+		for (j = rnd(4); j > 0; j--)
+			write_random_reg();
+		if (rnd(2))
+			count = 1 + rnd(16);
+		else
+			count = 1 + rnd(YM_BUFFER_250_SIZE / 4);
+
+		state_save(&start);
+		pos = start.pos_write;
+
+		YM2149_DoSamples_250(count);
+		state_save(&end_block);
+		for (j = 0; j < count; j++)
+			block[j] = YM_Buffer_250[(pos + j) & YM_BUFFER_250_SIZE_MASK];
+
+		state_restore(&start);
+		YM2149_DoSamples_250_Cycle(count);
+		state_save(&end_cycle);
+		for (j = 0; j < count; j++)
+			cycle[j] = YM_Buffer_250[(pos + j) & YM_BUFFER_250_SIZE_MASK];
+
+		samples += count;
+		for (j = 0; j < count; j++) {
+			if (block[j] != cycle[j]) {
+				fprintf(stderr, "ERROR: iteration %d, sample %d/%d: %d != %d\n",
+					i, j, count, block[j], cycle[j]);
+				errors++;
+				break;
+			}
+		}
+		if (!state_equal(&end_block, &end_cycle)) {
+			fprintf(stderr, "ERROR: iteration %d: YM2149 state differs after %d samples\n",
+				i, count);
+			errors++;
+		}
+	}
+
+	if (errors) {
+		fprintf(stderr, "\n***Detected %d ERRORs after %d iterations!***\n\n",
+			errors, i);
+	} else {
+		fprintf(stderr, "\nCompared %"PRIu64" samples from %d iterations without any errors!\n\n",
+			samples, i);
+	}
+	return errors;
+}
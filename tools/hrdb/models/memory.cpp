@@ -22,6 +22,12 @@ void Memory::Clear()
     m_size = 0;
 }
 
+void Memory::Set(uint32_t offset, const uint8_t* pData, uint32_t size)
+{
+    assert(offset + size <= m_size);
+    memcpy(m_pData + offset, pData, size);
+}
+
 bool Memory::ReadAddressMulti(uint32_t address, uint32_t numBytes, uint32_t& value) const
 {
     value = 0U;
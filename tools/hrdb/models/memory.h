@@ -34,6 +34,15 @@ enum MemorySlot : int
     kMemorySlotCount
 };
 
+// A run of changed bytes from a "memdelta" response.
+// The data is only valid while the response is being processed.
+struct MemoryPatch
+{
+    uint32_t        offset;     // from start of the memory block
+    uint32_t        size;
+    const uint8_t*  pData;
+};
+
 // Check if 2 memory ranges overlap
 bool Overlaps(uint32_t addr1, uint32_t size1, uint32_t addr2, uint32_t size);
 
@@ -53,6 +62,9 @@ public:
         m_pData[offset] = val;
     }
 
+    // Copy a block of bytes into the memory at <offset>
+    void Set(uint32_t offset, const uint8_t* pData, uint32_t size);
+
     uint8_t Get(uint32_t offset) const
     {
         assert(offset < m_size);
@@ -1,30 +1,91 @@
 #include "profiledata.h"
+#include <algorithm>
+
+static bool CompDeltaAddr(const ProfileDelta& d1, const ProfileDelta& d2)
+{
+    return d1.addr < d2.addr;
+}
+
+static bool CompEntryAddr(const ProfileData::Entry& ent, uint32_t addr)
+{
+    return ent.addr < addr;
+}
+
+ProfileData::ProfileData() :
+    m_totalCycles(0),
+    m_generation(0)
+{
+}
 
 void ProfileData::Add(const ProfileDelta &delta)
 {
-    Map::iterator it = m_entries.find(delta.addr);
-    if (it != m_entries.end())
+    m_pending.push_back(delta);
+}
+
+void ProfileData::Commit()
+{
+    // Deltas normally arrive in address order already
+    if (!std::is_sorted(m_pending.begin(), m_pending.end(), CompDeltaAddr))
+        std::stable_sort(m_pending.begin(), m_pending.end(), CompDeltaAddr);
+
+    // Fold any repeated addresses together
+    size_t numDeltas = 0;
+    for (size_t i = 0; i < m_pending.size(); ++i)
     {
-        it->second.count += delta.count;
-        it->second.cycles += delta.cycles;
+        const ProfileDelta& delta = m_pending[i];
+        m_totalCycles += delta.cycles;
+        if (numDeltas && m_pending[numDeltas - 1].addr == delta.addr)
+        {
+            m_pending[numDeltas - 1].count += delta.count;
+            m_pending[numDeltas - 1].cycles += delta.cycles;
+        }
+        else
+            m_pending[numDeltas++] = delta;
     }
-    else
+    m_pending.resize(numDeltas);
+
+    // Merge the two sorted lists in one pass
+    std::vector<Entry> merged;
+    merged.reserve(m_entries.size() + m_pending.size());
+    size_t entIdx = 0;
+    for (size_t i = 0; i < m_pending.size(); ++i)
     {
-        Pair p;
-        p.first = delta.addr;
-        p.second.count = delta.count;
-        p.second.cycles = delta.cycles;
-        m_entries.insert(p);
+        const ProfileDelta& delta = m_pending[i];
+        while (entIdx < m_entries.size() && m_entries[entIdx].addr < delta.addr)
+            merged.push_back(m_entries[entIdx++]);
+
+        if (entIdx < m_entries.size() && m_entries[entIdx].addr == delta.addr)
+        {
+            Entry ent = m_entries[entIdx++];
+            ent.count += delta.count;
+            ent.cycles += delta.cycles;
+            merged.push_back(ent);
+        }
+        else
+        {
+            Entry ent;
+            ent.addr = delta.addr;
+            ent.count = delta.count;
+            ent.cycles = delta.cycles;
+            merged.push_back(ent);
+        }
     }
+    merged.insert(merged.end(), m_entries.begin() + static_cast<std::ptrdiff_t>(entIdx), m_entries.end());
+    m_entries.swap(merged);
+
+    m_lastDeltas.swap(m_pending);
+    m_pending.clear();
+    ++m_generation;
 }
 
-void ProfileData::Get(uint32_t addr, uint32_t& count, uint32_t& cycles)
+void ProfileData::Get(uint32_t addr, uint32_t& count, uint32_t& cycles) const
 {
-    Map::iterator it = m_entries.find(addr);
-    if (it != m_entries.end())
+    std::vector<Entry>::const_iterator it =
+            std::lower_bound(m_entries.begin(), m_entries.end(), addr, CompEntryAddr);
+    if (it != m_entries.end() && it->addr == addr)
     {
-        count = it->second.count;
-        cycles = it->second.cycles;
+        count = it->count;
+        cycles = it->cycles;
     }
     else
     {
@@ -35,4 +96,9 @@ void ProfileData::Get(uint32_t addr, uint32_t& count, uint32_t& cycles)
 void ProfileData::Reset()
 {
     m_entries.clear();
+    m_pending.clear();
+    m_lastDeltas.clear();
+    m_totalCycles = 0;
+    // Skip a generation, so that nothing treats this as a Commit()
+    m_generation += 2;
 }
@@ -2,7 +2,7 @@
 #define PROFILEDATA_H
 
 #include <stdint.h>
-#include <map>
+#include <vector>
 
 struct ProfileDelta
 {
@@ -11,23 +11,44 @@ struct ProfileDelta
     uint32_t cycles;
 };
 
+// Accumulated profile counts per address, held as a vector sorted by address.
+// Deltas are queued by Add() and merged in a single pass by Commit().
 class ProfileData
 {
 public:
     struct Entry
     {
+        uint32_t addr;
         uint32_t count;
         uint32_t cycles;
     };
 
+    ProfileData();
+
     void Add(const ProfileDelta& delta);
-    void Get(uint32_t addr, uint32_t& count, uint32_t& cycles);
+    // Merge the deltas passed to Add() since the last Commit()
+    void Commit();
+    void Get(uint32_t addr, uint32_t& count, uint32_t& cycles) const;
     void Reset();
 
-    typedef std::map<uint32_t, Entry> Map;
-    typedef std::pair<uint32_t, Entry> Pair;
+    const std::vector<Entry>& GetEntries() const { return m_entries; }
+
+    // Deltas merged by the last Commit(), sorted by address
+    const std::vector<ProfileDelta>& GetLastDeltas() const { return m_lastDeltas; }
+
+    uint64_t GetTotalCycles() const { return m_totalCycles; }
+
+    // Changes on every Commit() and Reset(). If a user's copy is exactly one
+    // behind, GetLastDeltas() is all that changed since it last looked.
+    // Reset() skips a generation so it always forces a full rebuild.
+    uint32_t GetGeneration() const { return m_generation; }
 
-    Map         m_entries;
+private:
+    std::vector<Entry>          m_entries;
+    std::vector<ProfileDelta>   m_pending;
+    std::vector<ProfileDelta>   m_lastDeltas;
+    uint64_t                    m_totalCycles;
+    uint32_t                    m_generation;
 };
 
 #endif // PROFILEDATA_H
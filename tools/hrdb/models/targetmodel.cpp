@@ -15,6 +15,17 @@ void YmState::Clear()
         m_regs[i] = 0;
 }
 
+PerfState::PerfState()
+{
+    Clear();
+}
+
+void PerfState::Clear()
+{
+    m_vblCount = 0;
+    m_timers.clear();
+}
+
 void TargetChangedFlags::Clear()
 {
     for (int i = 0; i < kChangedStateCount; ++i)
@@ -29,7 +40,9 @@ TargetModel::TargetModel() :
     m_bConnected(false),
     m_bRunning(true),
     m_bProfileEnabled(0),
-    m_ffwd(false)
+    m_ffwd(false),
+    m_liveVblCount(0),
+    m_liveScreenBase(0)
 {
     for (int i = 0; i < MemorySlot::kMemorySlotCount; ++i)
         m_pMemory[i] = nullptr;
@@ -127,7 +140,7 @@ void TargetModel::SetRegisters(const Registers& regs, uint64_t commandId)
     emit registersChangedSignal(commandId);
 }
 
-void TargetModel::SetMemory(MemorySlot slot, const Memory* pMem, uint64_t commandId)
+void TargetModel::SetMemory(MemorySlot slot, Memory* pMem, uint64_t commandId)
 {
     if (m_pMemory[slot])
         delete m_pMemory[slot];
@@ -137,6 +150,27 @@ void TargetModel::SetMemory(MemorySlot slot, const Memory* pMem, uint64_t comman
     emit memoryChangedSignal(slot, commandId);
 }
 
+bool TargetModel::PatchMemory(MemorySlot slot, uint32_t address, uint32_t size,
+                              const std::vector<MemoryPatch>& patches, uint64_t commandId)
+{
+    Memory* pMem = m_pMemory[slot];
+    if (!pMem || pMem->GetAddress() != address || pMem->GetSize() != size)
+        return false;
+
+    for (size_t i = 0; i < patches.size(); ++i)
+    {
+        const MemoryPatch& patch = patches[i];
+        if (patch.offset + patch.size > size)
+            return false;
+        pMem->Set(patch.offset, patch.pData, patch.size);
+    }
+
+    // Still signal when nothing changed, since views wait for the response
+    m_changedFlags.SetMemoryChanged(slot);
+    emit memoryChangedSignal(slot, commandId);
+    return true;
+}
+
 void TargetModel::SetBreakpoints(const Breakpoints& bps, uint64_t commandId)
 {
     m_breakpoints = bps;
@@ -176,6 +210,19 @@ void TargetModel::SetSearchResults(uint64_t commmandId, const SearchResults& res
     emit searchResultsChangedSignal(commmandId);
 }
 
+void TargetModel::SetLiveVideo(uint32_t vblCount, uint32_t screenBase)
+{
+    m_liveVblCount = vblCount;
+    m_liveScreenBase = screenBase;
+    emit liveVideoChangedSignal();
+}
+
+void TargetModel::SetPerf(const PerfState& state)
+{
+    m_perfState = state;
+    emit perfChangedSignal();
+}
+
 void TargetModel::AddProfileDelta(const ProfileDelta& delta)
 {
     m_pProfileData->Add(delta);
@@ -183,6 +230,7 @@ void TargetModel::AddProfileDelta(const ProfileDelta& delta)
 
 void TargetModel::ProfileDeltaComplete(int enabled)
 {
+    m_pProfileData->Commit();
     m_bProfileEnabled = enabled;
     emit profileChangedSignal();
 }
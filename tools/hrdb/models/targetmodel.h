@@ -2,6 +2,8 @@
 #define TARGET_MODEL_H
 
 #include <stdint.h>
+#include <string>
+#include <vector>
 #include <QObject>
 #include <QVector>
 
@@ -52,6 +54,26 @@ public:
     uint8_t m_regs[kNumRegs];
 };
 
+/*
+    Host time used by Hatari's emulation subsystems during one VBL
+    ("infoperf" / "!perf")
+*/
+class PerfState
+{
+public:
+    PerfState();
+    void Clear();
+
+    struct Timer
+    {
+        std::string name;
+        uint32_t    nsecs;
+        uint32_t    calls;
+    };
+    uint32_t            m_vblCount;
+    std::vector<Timer>  m_timers;
+};
+
 /* Simple container for search results
  *
 */
@@ -89,7 +111,14 @@ public:
     void SetRegisters(const Registers& regs, uint64_t commandId);
 
     // emits memoryChangedSignal()
-    void SetMemory(MemorySlot slot, const Memory* pMem, uint64_t commandId);
+    void SetMemory(MemorySlot slot, Memory* pMem, uint64_t commandId);
+
+    // Apply changed runs to the memory already held for the slot.
+    // Returns false (and changes nothing) if that memory doesn't cover the
+    // same address range.
+    // emits memoryChangedSignal()
+    bool PatchMemory(MemorySlot slot, uint32_t address, uint32_t size,
+                     const std::vector<MemoryPatch>& patches, uint64_t commandId);
 
     // emits breakpointsChangedSignal()
     void SetBreakpoints(const Breakpoints& bps, uint64_t commandId);
@@ -112,9 +141,18 @@ public:
     // emits searchResultsChangedSignal()
     void SetSearchResults(uint64_t commmandId, const SearchResults& results);
 
+    // Video state pushed by the target while running
+    // emits liveVideoChangedSignal()
+    void SetLiveVideo(uint32_t vblCount, uint32_t screenBase);
+
+    // Subsystem timings of the last VBL
+    // emits perfChangedSignal()
+    void SetPerf(const PerfState& state);
+
     // The following 2 commands are processed as a batch
     // Update profiling data. Does not emit signal
     void AddProfileDelta(const ProfileDelta& delta);
+    // Merges the added deltas into the profile data
     // emits profileChangedSignal()
     void ProfileDeltaComplete(int enabled);
 
@@ -155,6 +193,10 @@ public:
     const SearchResults& GetSearchResults() const { return m_searchResults; }
     const ExceptionMask& GetExceptionMask() const { return m_exceptionMask; }
     YmState GetYm() const { return m_ymState; }
+    // Last values from SetLiveVideo()
+    uint32_t GetLiveVblCount() const { return m_liveVblCount; }
+    uint32_t GetLiveScreenBase() const { return m_liveScreenBase; }
+    PerfState GetPerf() const { return m_perfState; }
 
     // Profiling access
     void GetProfileData(uint32_t addr, uint32_t& count, uint32_t& cycles) const;
@@ -204,6 +246,12 @@ signals:
     // Something edited memory
     void otherMemoryChangedSignal(uint32_t address, uint32_t size);
 
+    // New video base pushed while running. Use GetLiveScreenBase()
+    void liveVideoChangedSignal();
+
+    // New subsystem timings. Use GetPerf()
+    void perfChangedSignal();
+
     // Profile data changed
     void profileChangedSignal();
 private slots:
@@ -232,11 +280,14 @@ private:
     ExceptionMask   m_exceptionMask;
     YmState         m_ymState;
     ProfileData*    m_pProfileData;
+    uint32_t        m_liveVblCount; // from SetLiveVideo()
+    uint32_t        m_liveScreenBase;
+    PerfState       m_perfState;
 
     SearchResults   m_searchResults;
 
     // Actual current memory contents
-    const Memory*   m_pMemory[MemorySlot::kMemorySlotCount];
+    Memory*         m_pMemory[MemorySlot::kMemorySlotCount];
 
     // Timer running to trigger events after CPU has stopped for a while
     // (e.g. Graphics Inspector refresh)
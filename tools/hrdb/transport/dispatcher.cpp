@@ -8,12 +8,56 @@
 #include "../models/stringsplitter.h"
 #include "../models/stringparsers.h"
 #include "../models/profiledata.h"
+#include "responsereader.h"
 
 //#define DISPATCHER_DEBUG
 
 //-----------------------------------------------------------------------------
-// Character value for the separator in responses/notifications from the target
-static const char SEP_CHAR = 1;
+// First protocol version supporting the "binary" command
+static const uint32_t kProtocolBinaryFrames = 0x1006;
+// First protocol version supporting the "memdelta" command
+static const uint32_t kProtocolMemDelta = 0x1007;
+// First protocol version supporting the "memfindall" command
+static const uint32_t kProtocolMemFindAll = 0x1008;
+// First protocol version supporting the "subscribe" command
+static const uint32_t kProtocolSubscribe = 0x1009;
+
+// First protocol version sending "!profile" entries as varints in binary mode
+static const uint32_t kProtocolProfileVarint = 0x100A;
+// First protocol version supporting "infoperf" and "!perf"
+static const uint32_t kProtocolPerf = 0x100D;
+
+// How often the target pushes subscribed state, in VBLs
+static const uint32_t kSubscribeVblInterval = 1;
+
+//-----------------------------------------------------------------------------
+// Decode <size> bytes of uuencoded memory data, where each group of
+// 4 chars encodes 3 bytes
+static void UUDecode(const char* pText, uint32_t size, uint8_t* pDest)
+{
+    uint32_t numGroups = (size + 2) / 3;        // round up to next block
+    uint32_t writePos = 0;
+    for (uint32_t group = 0; group < numGroups; ++group)
+    {
+        uint32_t accum = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            accum <<= 6;
+            uint32_t value = static_cast<uint8_t>(*pText++);
+            assert(value >= 32 && value < 32+64);
+            accum |= (value - 32u);
+        }
+
+        // Now output 3 chars
+        for (int i = 0; i < 3; ++i)
+        {
+            if (writePos == size)
+                break;
+            pDest[writePos++] = (accum >> 16) & 0xff;
+            accum <<= 8;
+        }
+    }
+}
 
 //-----------------------------------------------------------------------------
 int RegNameToEnum(const char* name)
@@ -30,14 +74,70 @@ int RegNameToEnum(const char* name)
     return Registers::REG_COUNT;
 }
 
+//-----------------------------------------------------------------------------
+// Read "<name> <value>" pairs, as sent by "regs" and "!regs"
+static bool ParseRegisters(ResponseReader& splitResp, Registers& regs)
+{
+    while (true)
+    {
+        std::string reg = splitResp.ReadString();
+        if (reg.size() == 0)
+            break;
+        uint32_t value;
+        if (!splitResp.ReadHex(value))
+            return false;
+
+        // Write this value into register structure
+        // NOTE: this is tolerant to not matching the name
+        // since we use "Vars"
+        int reg_id = RegNameToEnum(reg.c_str());
+        if (reg_id != Registers::REG_COUNT)
+            regs.m_value[reg_id] = value;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Read "<vbl count> [<timer name> <nsecs> <calls>]*", as sent by
+// "infoperf" and "!perf"
+static bool ParsePerf(ResponseReader& splitResp, PerfState& perf)
+{
+    if (!splitResp.ReadHex(perf.m_vblCount))
+        return false;
+    while (true)
+    {
+        PerfState::Timer timer;
+        timer.name = splitResp.ReadString();
+        if (timer.name.size() == 0)
+            break;
+        if (!splitResp.ReadHex(timer.nsecs))
+            return false;
+        if (!splitResp.ReadHex(timer.calls))
+            return false;
+        perf.m_timers.push_back(timer);
+    }
+    return true;
+}
+
 //-----------------------------------------------------------------------------
 Dispatcher::Dispatcher(QTcpSocket* tcpSocket, TargetModel* pTargetModel) :
     m_pTcpSocket(tcpSocket),
     m_pTargetModel(pTargetModel),
     m_responseUid(100),
+    m_batchDepth(0),
     m_portConnected(false),
-    m_waitingConnectionAck(false)
+    m_waitingConnectionAck(false),
+    m_binaryMode(false),
+    m_useBinaryMode(true),
+    m_serverProtocolId(0),
+    m_subscribePerf(false)
 {
+    for (int i = 0; i < kMemorySlotCount; ++i)
+    {
+        m_forceFullMemory[i] = false;
+        m_subscriptions[i].active = false;
+    }
+
     connect(m_pTcpSocket, &QAbstractSocket::connected,    this, &Dispatcher::connected);
     connect(m_pTcpSocket, &QAbstractSocket::disconnected, this, &Dispatcher::disconnected);
     connect(m_pTcpSocket, &QAbstractSocket::readyRead,    this, &Dispatcher::readyRead);
@@ -60,8 +160,37 @@ uint64_t Dispatcher::InsertFlush()
     return pNewCmd->m_uid;
 }
 
+void Dispatcher::BeginBatch()
+{
+    ++m_batchDepth;
+}
+
+void Dispatcher::CommitBatch()
+{
+    Q_ASSERT(m_batchDepth > 0);
+    if (--m_batchDepth > 0)
+        return;
+
+    if (!m_batchBuffer.empty() && m_portConnected)
+        m_pTcpSocket->write(m_batchBuffer.data(), static_cast<qint64>(m_batchBuffer.size()));
+    m_batchBuffer.clear();
+}
+
 uint64_t Dispatcher::ReadMemory(MemorySlot slot, uint32_t address, uint32_t size)
 {
+    // Slots can use "memdelta", so that the server only sends what
+    // changed since the last request for the same slot
+    if (slot != MemorySlot::kNone && m_serverProtocolId >= kProtocolMemDelta)
+    {
+        std::string command = std::string("memdelta ") + std::to_string(slot) + " " +
+                std::to_string(address) + " " + std::to_string(size);
+        if (m_forceFullMemory[slot])
+        {
+            command += " 1";
+            m_forceFullMemory[slot] = false;
+        }
+        return SendCommandShared(slot, command);
+    }
     std::string command = std::string("mem ") + std::to_string(address) + " " + std::to_string(size);
     return SendCommandShared(slot, command);
 }
@@ -71,6 +200,11 @@ uint64_t Dispatcher::ReadInfoYm()
     return SendCommandPacket("infoym");
 }
 
+uint64_t Dispatcher::ReadInfoPerf()
+{
+    return SendCommandPacket("infoperf");
+}
+
 uint64_t Dispatcher::ReadBreakpoints()
 {
     return SendCommandPacket("bplist");
@@ -191,10 +325,14 @@ uint64_t Dispatcher::SendConsoleCommand(const std::string& cmd)
     return SendCommandPacket(packet.c_str());
 }
 
-uint64_t Dispatcher::SendMemFind(const QVector<uint8_t>& valuesAndMasks, uint32_t startAddress, uint32_t endAddress)
+uint64_t Dispatcher::SendMemFind(const QVector<uint8_t>& valuesAndMasks, uint32_t startAddress, uint32_t endAddress,
+                                 uint32_t maxResults)
 {
-    std::string packet = "memfind ";
-    QString command = QString::asprintf("memfind %u %d ", startAddress, endAddress - startAddress);
+    QString command;
+    if (maxResults > 1 && m_serverProtocolId >= kProtocolMemFindAll)
+        command = QString::asprintf("memfindall %u %d %u ", startAddress, endAddress - startAddress, maxResults);
+    else
+        command = QString::asprintf("memfind %u %d ", startAddress, endAddress - startAddress);
 
     for (int i = 0; i <  valuesAndMasks.size(); ++i)
         command += QString::asprintf("%02x", valuesAndMasks[i]);
@@ -202,15 +340,86 @@ uint64_t Dispatcher::SendMemFind(const QVector<uint8_t>& valuesAndMasks, uint32_
     return SendCommandPacket(command.toStdString().c_str());
 }
 
+bool Dispatcher::SupportsSubscription() const
+{
+    return m_serverProtocolId >= kProtocolSubscribe;
+}
+
+void Dispatcher::SubscribeMemory(MemorySlot slot, uint32_t address, uint32_t size, uint32_t flags)
+{
+    Subscription& sub = m_subscriptions[slot];
+    sub.active = true;
+    sub.address = address;
+    sub.size = size;
+    sub.flags = flags;
+    UpdateSubscription();
+}
+
+void Dispatcher::UnsubscribeMemory(MemorySlot slot)
+{
+    if (!m_subscriptions[slot].active)
+        return;
+    m_subscriptions[slot].active = false;
+    UpdateSubscription();
+}
+
+bool Dispatcher::IsSubscribed(MemorySlot slot) const
+{
+    return m_subscriptions[slot].active;
+}
+
+bool Dispatcher::SupportsPerf() const
+{
+    return m_serverProtocolId >= kProtocolPerf;
+}
+
+void Dispatcher::SubscribePerf(bool enable)
+{
+    m_subscribePerf = enable;
+    UpdateSubscription();
+}
+
+void Dispatcher::UpdateSubscription()
+{
+    if (!m_portConnected || m_waitingConnectionAck || !SupportsSubscription())
+        return;
+
+    uint32_t flags = 0;
+    if (m_subscribePerf && SupportsPerf())
+        flags |= kSubscribePerf;
+    std::string ranges;
+    for (int i = 0; i < kMemorySlotCount; ++i)
+    {
+        const Subscription& sub = m_subscriptions[i];
+        if (!sub.active)
+            continue;
+        flags |= sub.flags;
+        ranges += std::string(" ") + std::to_string(i) + " " +
+                std::to_string(sub.address) + " " + std::to_string(sub.size);
+    }
+
+    std::string command;
+    if (ranges.empty() && flags == 0)
+        command = "subscribe 0 0";
+    else
+        command = std::string("subscribe ") + std::to_string(kSubscribeVblInterval) + " " +
+                std::to_string(flags) + ranges;
+
+    // Views call this often, so only send real changes
+    if (command == m_lastSubscription)
+        return;
+    m_lastSubscription = command;
+    SendCommandPacket(command.c_str());
+}
+
 uint64_t Dispatcher::DebugSendRawPacket(const char *command)
 {
     return SendCommandPacket(command);
 }
 
-void Dispatcher::ReceivePacket(const char* response)
+void Dispatcher::ReceivePacket(const std::string& new_resp)
 {
     // THIS HAPPENS ON THE EVENT LOOP
-    std::string new_resp(response);
 
     // Any flushes to handle?
     while (1)
@@ -295,6 +504,8 @@ void Dispatcher::DeletePending()
         ++it;
     }
     m_sentCommands.clear();
+    // Their packets must not be sent either
+    m_batchBuffer.clear();
 }
 
 void Dispatcher::connected()
@@ -302,11 +513,18 @@ void Dispatcher::connected()
     // Flag that we are awaiting the "connected" notification
     m_waitingConnectionAck = true;
 
+    // Every connection starts in ASCII mode
+    m_binaryMode = false;
+    m_rxBuffer.clear();
+
     // Clear any accidental button clicks that sent messages while disconnected
     DeletePending();
 
     m_portConnected = true;
 
+    // Commands are already batched into packets, so don't delay them
+    m_pTcpSocket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
     // THIS HAPPENS ON THE EVENT LOOP
     std::cout << "Host connected, awaiting ack" << std::endl;
 }
@@ -317,6 +535,8 @@ void Dispatcher::disconnected()
 
     // Clear pending commands so that incoming responses are not confused with the first connection
     DeletePending();
+    m_binaryMode = false;
+    m_rxBuffer.clear();
 
     // THIS HAPPENS ON THE EVENT LOOP
     std::cout << "Host disconnected" << std::endl;
@@ -327,25 +547,48 @@ void Dispatcher::readyRead()
 {
     // THIS HAPPENS ON THE EVENT LOOP
     qint64 byteCount = m_pTcpSocket->bytesAvailable();
-    char* data = new char[byteCount];
-
-    m_pTcpSocket->read(data, byteCount);
-
-    // Read completed commands from this and process in turn
-    for (int i = 0; i < byteCount; ++i)
+    size_t oldSize = m_rxBuffer.size();
+    m_rxBuffer.resize(oldSize + byteCount);
+    m_pTcpSocket->read(&m_rxBuffer[oldSize], byteCount);
+
+    // Views request new data when they see responses and notifications,
+    // so send all of those requests together
+    BeginBatch();
+
+    // Read completed packets from this and process in turn.
+    // The mode is checked per packet, since a "binary" response
+    // switches the framing of everything after it.
+    size_t readPos = 0;
+    while (readPos < m_rxBuffer.size())
     {
-        if (data[i] == 0)
+        std::string packet;
+        if (m_binaryMode)
         {
-            // End of response
-            this->ReceivePacket(m_active_resp.c_str());
-            m_active_resp = std::string();
+            // "<u32 LE size> <payload>"
+            if (m_rxBuffer.size() - readPos < 4)
+                break;
+            const uint8_t* pHeader = reinterpret_cast<const uint8_t*>(m_rxBuffer.data() + readPos);
+            uint32_t size = pHeader[0] | (pHeader[1] << 8) | (pHeader[2] << 16) | (static_cast<uint32_t>(pHeader[3]) << 24);
+            if (m_rxBuffer.size() - readPos - 4 < size)
+                break;
+            packet = m_rxBuffer.substr(readPos + 4, size);
+            readPos += 4 + size;
         }
         else
         {
-            m_active_resp += data[i];
+            // Null-terminated
+            size_t endPos = m_rxBuffer.find('\0', readPos);
+            if (endPos == std::string::npos)
+                break;
+            packet = m_rxBuffer.substr(readPos, endPos - readPos);
+            readPos = endPos + 1;
         }
+        this->ReceivePacket(packet);
     }
-    delete[] data;
+    // Keep any incomplete packet for next time
+    m_rxBuffer.erase(0, readPos);
+
+    CommitBatch();
 }
 
 uint64_t Dispatcher::SendCommandPacket(const char *command)
@@ -367,7 +610,10 @@ uint64_t Dispatcher::SendCommandShared(MemorySlot slot, std::string command)
     pNewCmd->m_memorySlot = slot;
     pNewCmd->m_uid = m_responseUid++;
     m_sentCommands.push_front(pNewCmd);
-    m_pTcpSocket->write(command.c_str(), command.size() + 1);
+    if (m_batchDepth > 0)
+        m_batchBuffer.append(command.c_str(), command.size() + 1);   // includes terminator
+    else
+        m_pTcpSocket->write(command.c_str(), command.size() + 1);
 #ifdef DISPATCHER_DEBUG
     std::cout << "COMMAND:" << pNewCmd->m_cmd << std::endl;
 #endif
@@ -384,8 +630,8 @@ void Dispatcher::ReceiveResponsePacket(const RemoteCommand& cmd)
     // e.g. "break"
     StringSplitter splitCmd(cmd.m_cmd);
     std::string type = splitCmd.Split(' '); // commands use space for separators
-    StringSplitter splitResp(cmd.m_response);
-    std::string cmd_status = splitResp.Split(SEP_CHAR);
+    ResponseReader splitResp(cmd.m_response, m_binaryMode);
+    std::string cmd_status = splitResp.ReadString();
     if (cmd_status != std::string("OK"))
     {
         std::cout << "Repsonse dropped: " << cmd.m_response << std::endl;
@@ -396,74 +642,53 @@ void Dispatcher::ReceiveResponsePacket(const RemoteCommand& cmd)
     if (type == "regs")
     {
         Registers regs;
-        while (true)
-        {
-            std::string reg = splitResp.Split(SEP_CHAR);
-            if (reg.size() == 0)
-                break;
-            std::string valueStr = splitResp.Split(SEP_CHAR);
-            uint32_t value;
-            if (!StringParsers::ParseHexString(valueStr.c_str(), value))
-                return;
-
-            // Write this value into register structure
-            // NOTE: this is tolerant to not matching the name
-            // since we use "Vars"
-            int reg_id = RegNameToEnum(reg.c_str());
-            if (reg_id != Registers::REG_COUNT)
-                regs.m_value[reg_id] = value;
-        }
+        if (!ParseRegisters(splitResp, regs))
+            return;
         m_pTargetModel->SetRegisters(regs, cmd.m_uid);
     }
     else if (type == "mem")
     {
-        std::string addrStr = splitResp.Split(SEP_CHAR);
-        std::string sizeStr = splitResp.Split(SEP_CHAR);
         uint32_t addr;
-        if (!StringParsers::ParseHexString(addrStr.c_str(), addr))
+        if (!splitResp.ReadHex(addr))
             return;
         uint32_t size;
-        if (!StringParsers::ParseHexString(sizeStr.c_str(), size))
+        if (!splitResp.ReadHex(size))
             return;
 
-        // Create a new memory block to pass to the data model
-        Memory* pMem = new Memory(addr, size);
+        if (splitResp.IsBinary())
+        {
+            // Raw bytes follow directly
+            uint32_t readPos = splitResp.GetPos();
+            if (cmd.m_response.size() < readPos + size)
+                return;
+            Memory* pMem = new Memory(addr, size);
+            pMem->Set(0, reinterpret_cast<const uint8_t*>(cmd.m_response.data() + readPos), size);
+            m_pTargetModel->SetMemory(cmd.m_memorySlot, pMem, cmd.m_uid);
+            return;
+        }
 
         // Now parse the uuencoded data
-        // Each "group" encodes 3 bytes
-        uint32_t numGroups = (size + 2) / 3;        // round up to next block
-
-        uint32_t writePos = 0;
         uint32_t readPos = splitResp.GetPos();
-        for (uint32_t group = 0; group < numGroups; ++group)
-        {
-            uint32_t accum = 0;
-            for (int i = 0; i < 4; ++i)
-            {
-                accum <<= 6;
-                uint32_t value = cmd.m_response[readPos++];
-                assert(value >= 32 && value < 32+64);
-                accum |= (value - 32u);
-            }
+        if (cmd.m_response.size() < readPos + (size + 2) / 3 * 4)
+            return;
 
-            // Now output 3 chars
-            for (int i = 0; i < 3; ++i)
-            {
-                if (writePos == size)
-                    break;
-                pMem->Set(writePos++, (accum >> 16) & 0xff);
-                accum <<= 8;
-            }
-        }
+        // Create a new memory block to pass to the data model
+        Memory* pMem = new Memory(addr, size);
+        std::vector<uint8_t> data(size);
+        UUDecode(cmd.m_response.data() + readPos, size, data.data());
+        pMem->Set(0, data.data(), size);
 
         m_pTargetModel->SetMemory(cmd.m_memorySlot, pMem, cmd.m_uid);
     }
+    else if (type == "memdelta")
+    {
+        ReceiveMemDelta(cmd.m_memorySlot, cmd.m_uid, splitResp);
+    }
     else if (type == "bplist")
     {
         // Breakpoints
-        std::string countStr = splitResp.Split(SEP_CHAR);
         uint32_t count;
-        if (!StringParsers::ParseHexString(countStr.c_str(), count))
+        if (!splitResp.ReadHex(count))
             return;
 
         Breakpoints bps;
@@ -471,21 +696,16 @@ void Dispatcher::ReceiveResponsePacket(const RemoteCommand& cmd)
         {
             Breakpoint bp;
             bp.m_id = i + 1;        // IDs in Hatari start at 1 :(
-            bp.SetExpression(splitResp.Split(SEP_CHAR));
-            std::string ccountStr = splitResp.Split(SEP_CHAR);
-            std::string hitsStr = splitResp.Split(SEP_CHAR);
-            std::string onceStr = splitResp.Split(SEP_CHAR);
-            std::string quietStr = splitResp.Split(SEP_CHAR);
-            std::string traceStr = splitResp.Split(SEP_CHAR);
-            if (!StringParsers::ParseHexString(ccountStr.c_str(), bp.m_conditionCount))
+            bp.SetExpression(splitResp.ReadString());
+            if (!splitResp.ReadHex(bp.m_conditionCount))
                 return;
-            if (!StringParsers::ParseHexString(hitsStr.c_str(), bp.m_hitCount))
+            if (!splitResp.ReadHex(bp.m_hitCount))
                 return;
-            if (!StringParsers::ParseHexString(onceStr.c_str(), bp.m_once))
+            if (!splitResp.ReadBool(bp.m_once))
                 return;
-            if (!StringParsers::ParseHexString(quietStr.c_str(), bp.m_quiet))
+            if (!splitResp.ReadBool(bp.m_quiet))
                 return;
-            if (!StringParsers::ParseHexString(traceStr.c_str(), bp.m_trace))
+            if (!splitResp.ReadBool(bp.m_trace))
                 return;
             bps.m_breakpoints.push_back(bp);
         }
@@ -495,21 +715,19 @@ void Dispatcher::ReceiveResponsePacket(const RemoteCommand& cmd)
     else if (type == "symlist")
     {
         // Symbols
-        std::string countStr = splitResp.Split(SEP_CHAR);
         uint32_t count;
-        if (!StringParsers::ParseHexString(countStr.c_str(), count))
+        if (!splitResp.ReadHex(count))
             return;
 
         const std::string absType("A");
         SymbolSubTable syms;
         for (uint32_t i = 0; i < count; ++i)
         {
-            std::string name = splitResp.Split(SEP_CHAR);
-            std::string addrStr = splitResp.Split(SEP_CHAR);
+            std::string name = splitResp.ReadString();
             uint32_t address;
-            if (!StringParsers::ParseHexString(addrStr.c_str(), address))
+            if (!splitResp.ReadHex(address))
                 return;
-            std::string type = splitResp.Split(SEP_CHAR);
+            std::string type = splitResp.ReadString();
             if (type == absType)
                 continue;
             uint32_t size = 0;
@@ -519,9 +737,8 @@ void Dispatcher::ReceiveResponsePacket(const RemoteCommand& cmd)
     }
     else if (type == "exmask")
     {
-        std::string maskStr = splitResp.Split(SEP_CHAR);
         uint32_t mask;
-        if (!StringParsers::ParseHexString(maskStr.c_str(), mask))
+        if (!splitResp.ReadHex(mask))
             return;
 
         ExceptionMask maskObj;
@@ -531,13 +748,11 @@ void Dispatcher::ReceiveResponsePacket(const RemoteCommand& cmd)
     else if (type == "memset")
     {
         // check the affected range
-        std::string addrStr = splitResp.Split(SEP_CHAR);
-        std::string sizeStr = splitResp.Split(SEP_CHAR);
         uint32_t addr;
-        if (!StringParsers::ParseHexString(addrStr.c_str(), addr))
+        if (!splitResp.ReadHex(addr))
             return;
         uint32_t size;
-        if (!StringParsers::ParseHexString(sizeStr.c_str(), size))
+        if (!splitResp.ReadHex(size))
             return;
 
         m_pTargetModel->NotifyMemoryChanged(addr, size);
@@ -556,21 +771,24 @@ void Dispatcher::ReceiveResponsePacket(const RemoteCommand& cmd)
         YmState state;
         for (int i = 0; i < YmState::kNumRegs; ++i)
         {
-            std::string valueStr = splitResp.Split(SEP_CHAR);
-            if (valueStr.size() == 0)
-                return;
             uint32_t value;
-            if (!StringParsers::ParseHexString(valueStr.c_str(), value))
+            if (!splitResp.ReadHex(value))
                 return;
             state.m_regs[i] = static_cast<uint8_t>(value);
         }
         m_pTargetModel->SetYm(state);
     }
+    else if (type == "infoperf")
+    {
+        PerfState state;
+        if (!ParsePerf(splitResp, state))
+            return;
+        m_pTargetModel->SetPerf(state);
+    }
     else if (type == "profile")
     {
         uint32_t enabled = 0;
-        std::string enabledStr = splitResp.Split(SEP_CHAR);
-        if (!StringParsers::ParseHexString(enabledStr.c_str(), enabled))
+        if (!splitResp.ReadHex(enabled))
             return;
         m_pTargetModel->ProfileDeltaComplete(static_cast<int>(enabled));
     }
@@ -585,16 +803,37 @@ void Dispatcher::ReceiveResponsePacket(const RemoteCommand& cmd)
         SearchResults results;
         while (true)
         {
-            std::string addrStr = splitResp.Split(SEP_CHAR);
-            if (addrStr.size() == 0)
+            uint32_t value;
+            if (!splitResp.ReadHex(value))
                 break;
+            results.addresses.push_back(value);
+        }
+        m_pTargetModel->SetSearchResults(cmd.m_uid, results);
+    }
+    else if (type == "memfindall")
+    {
+        // Pairs of address and pattern index
+        SearchResults results;
+        while (true)
+        {
             uint32_t value;
-            if (!StringParsers::ParseHexString(addrStr.c_str(), value))
+            uint32_t pattern;
+            if (!splitResp.ReadHex(value))
+                break;
+            if (!splitResp.ReadHex(pattern))
                 break;
             results.addresses.push_back(value);
         }
         m_pTargetModel->SetSearchResults(cmd.m_uid, results);
     }
+    else if (type == "binary")
+    {
+        // Everything after this response uses the new framing
+        uint32_t enabled = 0;
+        if (!splitResp.ReadHex(enabled))
+            return;
+        m_binaryMode = (enabled != 0);
+    }
     else
     {
         // For debugging
@@ -602,27 +841,88 @@ void Dispatcher::ReceiveResponsePacket(const RemoteCommand& cmd)
     }
 }
 
+void Dispatcher::ReceiveMemDelta(MemorySlot slot, uint64_t commandId, ResponseReader& splitResp)
+{
+    uint32_t addr;
+    uint32_t size;
+    uint32_t full;
+    if (!splitResp.ReadHex(addr))
+        return;
+    if (!splitResp.ReadHex(size))
+        return;
+    if (!splitResp.ReadBool(full))
+        return;
+
+    // Decoded ASCII data for each patch, kept until the patches are applied
+    std::vector<std::vector<uint8_t> > decoded;
+    std::vector<MemoryPatch> patches;
+    while (!splitResp.AtEnd())
+    {
+        MemoryPatch patch;
+        if (!splitResp.ReadHex(patch.offset))
+            return;
+        if (!splitResp.ReadHex(patch.size))
+            return;
+        if (patch.offset > size || patch.size > size - patch.offset)
+            return;
+
+        if (splitResp.IsBinary())
+        {
+            if (!splitResp.ReadBytes(patch.size, patch.pData))
+                return;
+        }
+        else
+        {
+            std::string text = splitResp.ReadString();
+            if (text.size() != (patch.size + 2) / 3 * 4)
+                return;
+            decoded.push_back(std::vector<uint8_t>(patch.size));
+            UUDecode(text.c_str(), patch.size, decoded.back().data());
+            patch.pData = decoded.back().data();
+        }
+        patches.push_back(patch);
+    }
+
+    if (full)
+    {
+        Memory* pMem = new Memory(addr, size);
+        for (size_t i = 0; i < patches.size(); ++i)
+            pMem->Set(patches[i].offset, patches[i].pData, patches[i].size);
+        m_pTargetModel->SetMemory(slot, pMem, commandId);
+        return;
+    }
+
+    if (!m_pTargetModel->PatchMemory(slot, addr, size, patches, commandId))
+    {
+        // Our copy is out of step with the server, so ask for
+        // everything again next time.
+        std::cout << "Memory delta could not be applied to slot " << slot << std::endl;
+        m_forceFullMemory[slot] = true;
+
+        // Pushed updates would keep failing, so resync now
+        if (commandId == 0)
+            ReadMemory(slot, addr, size);
+    }
+}
+
 void Dispatcher::ReceiveNotification(const RemoteNotification& cmd)
 {
 #ifdef DISPATCHER_DEBUG
     std::cout << "NOTIFICATION:" << cmd.m_payload << std::endl;
 #endif
-    StringSplitter s(cmd.m_payload);
+    ResponseReader s(cmd.m_payload, m_binaryMode);
 
-    std::string type = s.Split(SEP_CHAR);
+    std::string type = s.ReadString();
     if (type == "!status")
     {
-        std::string runningStr = s.Split(SEP_CHAR);
-        std::string pcStr = s.Split(SEP_CHAR);
-        std::string ffwdStr = s.Split(SEP_CHAR);
         uint32_t running;
         uint32_t pc;
         uint32_t ffwd;
-        if (!StringParsers::ParseHexString(runningStr.c_str(), running))
+        if (!s.ReadHex(running))
             return;
-        if (!StringParsers::ParseHexString(pcStr.c_str(), pc))
+        if (!s.ReadHex(pc))
             return;
-        if (!StringParsers::ParseHexString(ffwdStr.c_str(), ffwd))
+        if (!s.ReadHex(ffwd))
             return;
 
         // This call goes off and lots of views insert requests here, so add a flush into the queue
@@ -631,17 +931,14 @@ void Dispatcher::ReceiveNotification(const RemoteNotification& cmd)
     }
     if (type == "!config")
     {
-        std::string machineTypeStr = s.Split(SEP_CHAR);
-        std::string cpuLevelStr = s.Split(SEP_CHAR);
-        std::string stRamSizeStr = s.Split(SEP_CHAR);
         uint32_t machineType;
         uint32_t cpuLevel;
         uint32_t stRamSize;
-        if (!StringParsers::ParseHexString(machineTypeStr.c_str(), machineType))
+        if (!s.ReadHex(machineType))
             return;
-        if (!StringParsers::ParseHexString(cpuLevelStr.c_str(), cpuLevel))
+        if (!s.ReadHex(cpuLevel))
             return;
-        if (!StringParsers::ParseHexString(stRamSizeStr.c_str(), stRamSize))
+        if (!s.ReadHex(stRamSize))
             return;
         m_pTargetModel->SetConfig(machineType, cpuLevel, stRamSize);
         this->InsertFlush();
@@ -651,35 +948,69 @@ void Dispatcher::ReceiveNotification(const RemoteNotification& cmd)
         // Allow new command responses to be processed.
         m_waitingConnectionAck = false;
         std::cout << "Connection acknowleged by server" << std::endl;
+
+        // Switch to binary responses if the server supports them.
+        // This is sent before any UI requests so everything else uses it.
+        uint32_t protocolId = 0;
+        s.ReadHex(protocolId);
+        m_serverProtocolId = protocolId;
+        for (int i = 0; i < kMemorySlotCount; ++i)
+        {
+            m_forceFullMemory[i] = false;
+            m_subscriptions[i].active = false;
+        }
+        m_subscribePerf = false;
+        m_lastSubscription.clear();
+        if (m_useBinaryMode && protocolId >= kProtocolBinaryFrames)
+            SendCommandPacket("binary 1");
         // Flag for the UI to request the data it wants
         m_pTargetModel->SetConnected(1);
     }
     else if (type == "!profile")
     {
         uint32_t enabled = 0;
-        std::string enabledStr = s.Split(SEP_CHAR);
-        if (!StringParsers::ParseHexString(enabledStr.c_str(), enabled))
+        if (!s.ReadHex(enabled))
             return;
 
         uint32_t lastaddr = 0;
         int numDeltas = 0;
-        while (true)
+        if (s.IsBinary() && m_serverProtocolId >= kProtocolProfileVarint)
         {
-            std::string addrDeltaStr = s.Split(SEP_CHAR);
-            if (addrDeltaStr.size() == 0)
-                break;
-            std::string countStr = s.Split(SEP_CHAR);
-            std::string cyclesStr = s.Split(SEP_CHAR);
+            // "<count>" then varint triples
+            uint32_t numEntries = 0;
+            if (!s.ReadHex(numEntries))
+                return;
+            for (uint32_t i = 0; i < numEntries; ++i)
+            {
+                ProfileDelta delta;
+                uint32_t addrDelta = 0;
+                if (!s.ReadVarint(addrDelta))
+                    return;
+                if (!s.ReadVarint(delta.count))
+                    return;
+                if (!s.ReadVarint(delta.cycles))
+                    return;
+
+                delta.addr = lastaddr + addrDelta;
+                m_pTargetModel->AddProfileDelta(delta);
+                lastaddr = delta.addr;
+                ++numDeltas;
+            }
+            m_pTargetModel->ProfileDeltaComplete(static_cast<int>(enabled));
+            return;
+        }
 
+        while (!s.AtEnd())
+        {
             uint32_t addrDelta = 0;
             uint32_t count = 0;
             uint32_t cycles = 0;
 
-            if (!StringParsers::ParseHexString(addrDeltaStr.c_str(), addrDelta))
+            if (!s.ReadHex(addrDelta))
                 return;
-            if (!StringParsers::ParseHexString(countStr.c_str(), count))
+            if (!s.ReadHex(count))
                 return;
-            if (!StringParsers::ParseHexString(cyclesStr.c_str(), cycles))
+            if (!s.ReadHex(cycles))
                 return;
 
             uint32_t newaddr = lastaddr + addrDelta;
@@ -693,5 +1024,38 @@ void Dispatcher::ReceiveNotification(const RemoteNotification& cmd)
         }
         m_pTargetModel->ProfileDeltaComplete(static_cast<int>(enabled));
     }
+    else if (type == "!regs")
+    {
+        Registers regs;
+        if (!ParseRegisters(s, regs))
+            return;
+        m_pTargetModel->SetRegisters(regs, 0);
+    }
+    else if (type == "!video")
+    {
+        uint32_t vbl;
+        uint32_t base;
+        if (!s.ReadHex(vbl))
+            return;
+        if (!s.ReadHex(base))
+            return;
+        m_pTargetModel->SetLiveVideo(vbl, base);
+    }
+    else if (type == "!perf")
+    {
+        PerfState state;
+        if (!ParsePerf(s, state))
+            return;
+        m_pTargetModel->SetPerf(state);
+    }
+    else if (type == "!memdelta")
+    {
+        uint32_t slot;
+        if (!s.ReadHex(slot))
+            return;
+        if (slot == MemorySlot::kNone || slot >= MemorySlot::kMemorySlotCount)
+            return;
+        ReceiveMemDelta(static_cast<MemorySlot>(slot), 0, s);
+    }
 }
 
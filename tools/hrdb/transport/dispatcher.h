@@ -8,6 +8,7 @@
 
 class QTcpSocket;
 class TargetModel;
+class ResponseReader;
 
 // Keeps track of messages between target and host, and matches up commands to responses,
 // then passes them to the model.
@@ -19,11 +20,18 @@ public:
 
     uint64_t InsertFlush();
 
+    // Collect all commands sent until the matching CommitBatch() and send
+    // them with a single socket write. Calls can be nested; the commands are
+    // sent when the outermost batch is committed.
+    void BeginBatch();
+    void CommitBatch();
+
     // Request a specific memory block.
     // Allows strings so expressions can evaluate
     uint64_t ReadMemory(MemorySlot slot, uint32_t address, uint32_t size);
     uint64_t ReadRegisters();
     uint64_t ReadInfoYm();
+    uint64_t ReadInfoPerf();
     uint64_t ReadBreakpoints();
     uint64_t ReadExceptionMask();
     uint64_t ReadSymbols();
@@ -56,7 +64,32 @@ public:
     uint64_t SetProfileEnable(bool enable);
     uint64_t SetFastForward(bool enable);
     uint64_t SendConsoleCommand(const std::string& cmd);
-    uint64_t SendMemFind(const QVector<uint8_t>& valuesAndMasks, uint32_t startAddress, uint32_t endAddress);
+    // Returns up to maxResults matches if the target supports it, otherwise only the first
+    uint64_t SendMemFind(const QVector<uint8_t>& valuesAndMasks, uint32_t startAddress, uint32_t endAddress,
+                         uint32_t maxResults = 1);
+
+    // Live updates pushed by the target every VBL while it runs, rather than
+    // polled ("subscribe", protocol 0x1009+). Pushed memory arrives through
+    // TargetModel::SetMemory/PatchMemory with a commandId of 0.
+    enum SubscribeFlags
+    {
+        kSubscribeNone = 0,
+
+        kSubscribeRegs = 1 << 0,        // push registers via SetRegisters()
+        kSubscribeVideo = 1 << 1,       // push the video base via SetLiveVideo()
+        kSubscribePerf = 1 << 2         // push subsystem timings via SetPerf()
+    };
+
+    bool SupportsSubscription() const;
+    // Flags are combined with those of the other subscribed slots
+    void SubscribeMemory(MemorySlot slot, uint32_t address, uint32_t size, uint32_t flags = kSubscribeNone);
+    void UnsubscribeMemory(MemorySlot slot);
+    bool IsSubscribed(MemorySlot slot) const;
+
+    // Subsystem timings ("infoperf" and kSubscribePerf, protocol 0x100D+).
+    // The target sends them only if built with ENABLE_PERF_TIMERS.
+    bool SupportsPerf() const;
+    void SubscribePerf(bool enable);
 
     // Don't use this except for testing
     uint64_t DebugSendRawPacket(const char* command);
@@ -75,21 +108,53 @@ private:
 
     void ReceiveResponsePacket(const RemoteCommand& command);
     void ReceiveNotification(const RemoteNotification& notification);
-    void ReceivePacket(const char* response);
+    void ReceivePacket(const std::string& response);
 
     void DeletePending();
 
+    // Parse "memdelta" data and apply it to the target model
+    void ReceiveMemDelta(MemorySlot slot, uint64_t commandId, ResponseReader& splitResp);
+
+    // Send the combined subscriptions, if they changed since last sent
+    void UpdateSubscription();
+
     std::deque<RemoteCommand*>      m_sentCommands;
     QTcpSocket*                     m_pTcpSocket;
     TargetModel*                    m_pTargetModel;
 
-    std::string                     m_active_resp;
+    std::string                     m_rxBuffer;     // received data not yet split into packets
     uint64_t                        m_responseUid;
+    std::string                     m_batchBuffer;  // commands waiting for CommitBatch()
+    int                             m_batchDepth;
 
     /* If true, drop incoming packets since they are assumed to be
      * from a previous connection. */
     bool                            m_portConnected;
     bool                            m_waitingConnectionAck;
+
+    /* Responses arrive as length-prefixed binary frames rather than text */
+    bool                            m_binaryMode;
+    /* Request binary mode when the server supports it */
+    bool                            m_useBinaryMode;
+
+    /* REMOTEDEBUG_PROTOCOL_ID reported by the server on connection */
+    uint32_t                        m_serverProtocolId;
+
+    /* Set when a "memdelta" response could not be applied, so the
+     * next request for the slot must resend everything */
+    bool                            m_forceFullMemory[kMemorySlotCount];
+
+    /* Active "subscribe" ranges, one per slot */
+    struct Subscription
+    {
+        bool        active;
+        uint32_t    address;
+        uint32_t    size;
+        uint32_t    flags;
+    };
+    Subscription                    m_subscriptions[kMemorySlotCount];
+    bool                            m_subscribePerf;
+    std::string                     m_lastSubscription;   // last "subscribe" command sent
 };
 
 #endif // DISPATCHER_H
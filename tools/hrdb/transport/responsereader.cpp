@@ -0,0 +1,101 @@
+#include "responsereader.h"
+#include "../models/stringparsers.h"
+
+//-----------------------------------------------------------------------------
+// Character value for the separator in ASCII responses/notifications
+static const char SEP_CHAR = 1;
+
+std::string ResponseReader::ReadString()
+{
+    if (!m_binary)
+        return Split();
+
+    if (m_pos >= m_str.size())
+        return "";
+
+    std::size_t start = m_pos;
+    std::size_t endpos = m_str.find('\0', m_pos);
+    if (endpos == std::string::npos)
+        m_pos = endpos = m_str.size();
+    else
+        m_pos = endpos + 1;     // skip the terminator
+
+    return m_str.substr(start, endpos - start);
+}
+
+bool ResponseReader::ReadHex(uint32_t& value)
+{
+    value = 0;
+    if (!m_binary)
+        return StringParsers::ParseHexString(Split().c_str(), value);
+
+    if (m_pos + 4 > m_str.size())
+        return false;
+
+    const uint8_t* pData = reinterpret_cast<const uint8_t*>(m_str.data() + m_pos);
+    value = pData[0] | (pData[1] << 8) | (pData[2] << 16) | (static_cast<uint32_t>(pData[3]) << 24);
+    m_pos += 4;
+    return true;
+}
+
+bool ResponseReader::ReadBool(uint32_t& value)
+{
+    value = 0;
+    if (!m_binary)
+        return StringParsers::ParseHexString(Split().c_str(), value);
+
+    if (m_pos + 1 > m_str.size())
+        return false;
+    value = static_cast<uint8_t>(m_str[m_pos]) ? 1 : 0;
+    m_pos += 1;
+    return true;
+}
+
+bool ResponseReader::ReadBytes(uint32_t size, const uint8_t*& pData)
+{
+    pData = nullptr;
+    if (!m_binary || m_pos + size > m_str.size())
+        return false;
+
+    pData = reinterpret_cast<const uint8_t*>(m_str.data() + m_pos);
+    m_pos += size;
+    return true;
+}
+
+bool ResponseReader::ReadVarint(uint32_t& value)
+{
+    value = 0;
+    if (!m_binary)
+        return false;
+
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (m_pos >= m_str.size())
+            return false;
+        uint8_t byte = static_cast<uint8_t>(m_str[m_pos++]);
+        value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+std::string ResponseReader::Split()
+{
+    if (m_pos >= m_str.size())
+        return "";
+
+    std::size_t start = m_pos;
+    m_pos = m_str.find(SEP_CHAR, m_pos);
+    std::size_t endpos = m_pos;
+
+    if (m_pos == std::string::npos)
+        m_pos = endpos = m_str.size();
+    else
+    {
+        // Skip any extra occurences of the char
+        while (m_pos < m_str.size() && m_str[m_pos] == SEP_CHAR)
+            ++m_pos;
+    }
+    return m_str.substr(start, endpos - start);
+}
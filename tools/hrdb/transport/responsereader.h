@@ -0,0 +1,52 @@
+#ifndef RESPONSEREADER_H
+#define RESPONSEREADER_H
+
+#include <cstdint>
+#include <string>
+
+//-----------------------------------------------------------------------------
+// Reads fields from a response or notification payload.
+// In ASCII mode, fields are hex text separated by SEP_CHAR.
+// In binary mode, values are 4 little-endian bytes, bools are single bytes
+// and strings are null-terminated.
+class ResponseReader
+{
+public:
+    ResponseReader(const std::string& str, bool binary) :
+        m_str(str),
+        m_pos(0),
+        m_binary(binary)
+    {
+    }
+
+    // Read a string field. Returns an empty string at the end of the data.
+    std::string ReadString();
+
+    // Read a numeric field. Returns false if invalid or at the end.
+    bool ReadHex(uint32_t& value);
+
+    // Read a 0/1 flag field. Returns false if invalid or at the end.
+    bool ReadBool(uint32_t& value);
+
+    // Binary mode only: get a pointer to the next <size> raw bytes.
+    // Returns false if there is not enough data.
+    bool ReadBytes(uint32_t size, const uint8_t*& pData);
+
+    // Binary mode only: read a value stored 7 bits per byte, lowest first,
+    // with the top bit set on all but the last byte.
+    bool ReadVarint(uint32_t& value);
+
+    bool IsBinary() const { return m_binary; }
+    uint32_t GetPos() const { return (uint32_t) m_pos; }
+    bool AtEnd() const { return m_pos >= m_str.size(); }
+
+private:
+    // ASCII mode field split
+    std::string Split();
+
+    const std::string&  m_str;
+    std::size_t         m_pos;
+    bool                m_binary;
+};
+
+#endif // RESPONSEREADER_H
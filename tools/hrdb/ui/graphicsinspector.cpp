@@ -49,6 +49,10 @@
 
     Finally when all requests are done we can call UpdateImage which creates
     the bitmap and final palette.
+
+    While running with live refresh, the 3 blocks are subscribed instead, so
+    the target pushes any changes every VBL (with a commandId of 0) and we
+    call UpdateImage as each arrives.
 */
 
 static void CreateBitplanePalette(QVector<uint32_t>& palette,
@@ -85,6 +89,7 @@ GraphicsInspectorWidget::GraphicsInspectorWidget(QWidget *parent,
     m_height(200),
     m_padding(0),
     m_paletteMode(kRegisters),
+    m_streaming(false),
     m_annotateRegisters(false)
 {
     m_paletteAddress = Regs::VID_PAL_0;
@@ -240,6 +245,7 @@ GraphicsInspectorWidget::GraphicsInspectorWidget(QWidget *parent,
     connect(m_pTargetModel,  &TargetModel::memoryChangedSignal,           this, &GraphicsInspectorWidget::memoryChanged);
     connect(m_pTargetModel,  &TargetModel::otherMemoryChangedSignal,      this, &GraphicsInspectorWidget::otherMemoryChanged);
     connect(m_pTargetModel,  &TargetModel::runningRefreshTimerSignal,     this, &GraphicsInspectorWidget::runningRefreshTimer);
+    connect(m_pTargetModel,  &TargetModel::liveVideoChangedSignal,        this, &GraphicsInspectorWidget::liveVideoChanged);
 
     connect(m_pBitmapAddressLineEdit,       &QLineEdit::returnPressed,    this, &GraphicsInspectorWidget::bitmapAddressChanged);
     connect(m_pPaletteAddressLineEdit,      &QLineEdit::returnPressed,    this, &GraphicsInspectorWidget::paletteAddressChanged);
@@ -398,7 +404,8 @@ void GraphicsInspectorWidget::connectChanged()
 
 void GraphicsInspectorWidget::startStopChanged()
 {
-    // Nothing happens here except an initial redraw
+    // Start or stop the live stream, then an initial redraw
+    UpdateSubscription();
     update();
 }
 
@@ -419,8 +426,28 @@ void GraphicsInspectorWidget::startStopDelayedChanged()
     }
 }
 
-void GraphicsInspectorWidget::memoryChanged(int /*memorySlot*/, uint64_t commandId)
+void GraphicsInspectorWidget::memoryChanged(int memorySlot, uint64_t commandId)
 {
+    if (commandId == 0)
+    {
+        // Pushed by the target
+        if (!m_streaming)
+            return;
+        if (memorySlot == MemorySlot::kGraphicsInspectorVideoRegs)
+        {
+            // Resolution could have changed the bitmap size
+            UpdateFormatFromUI();
+            UpdateSubscription();
+            UpdateImage();
+        }
+        else if (memorySlot == MemorySlot::kGraphicsInspectorPalette ||
+                 memorySlot == MemorySlot::kGraphicsInspector)
+        {
+            UpdateImage();
+        }
+        return;
+    }
+
     if (commandId == m_requestRegs.requestId)
     {
         m_requestRegs.Clear();
@@ -583,6 +610,11 @@ void GraphicsInspectorWidget::otherMemoryChanged(uint32_t address, uint32_t size
 
 void GraphicsInspectorWidget::runningRefreshTimer()
 {
+    // Picks up changes to the live refresh setting
+    UpdateSubscription();
+    if (m_streaming)
+        return;
+
     if (m_pTargetModel->IsConnected() && m_pSession->GetSettings().m_liveRefresh)
     {
         m_requestPalette.Dirty();
@@ -592,6 +624,19 @@ void GraphicsInspectorWidget::runningRefreshTimer()
     }
 }
 
+void GraphicsInspectorWidget::liveVideoChanged()
+{
+    if (!m_streaming || !m_pLockAddressToVideoCheckBox->isChecked())
+        return;
+
+    uint32_t address = m_pTargetModel->GetLiveScreenBase();
+    if (address == m_bitmapAddress)
+        return;
+    m_bitmapAddress = address;
+    DisplayAddress();
+    UpdateSubscription();
+}
+
 void GraphicsInspectorWidget::widthChangedSlot(int value)
 {
     m_width = value;
@@ -699,6 +744,10 @@ void GraphicsInspectorWidget::UpdateMemoryRequests()
     if (!m_pTargetModel->IsConnected())
         return;
 
+    // Settings might have changed what we need pushed
+    if (m_streaming)
+        UpdateSubscription();
+
     if (!m_requestRegs.isDirty && !m_requestPalette.isDirty && !m_requestBitmap.isDirty)
     {
         // Everything is ready!
@@ -740,6 +789,41 @@ void GraphicsInspectorWidget::UpdateMemoryRequests()
     assert(0);
 }
 
+void GraphicsInspectorWidget::UpdateSubscription()
+{
+    bool stream = m_pTargetModel->IsConnected() && m_pTargetModel->IsRunning() &&
+            m_pSession->GetSettings().m_liveRefresh && m_pDispatcher->SupportsSubscription() &&
+            isVisible();
+    if (!stream)
+    {
+        if (m_streaming)
+        {
+            m_pDispatcher->UnsubscribeMemory(MemorySlot::kGraphicsInspectorVideoRegs);
+            m_pDispatcher->UnsubscribeMemory(MemorySlot::kGraphicsInspectorPalette);
+            m_pDispatcher->UnsubscribeMemory(MemorySlot::kGraphicsInspector);
+        }
+        m_streaming = false;
+        return;
+    }
+
+    // The video base is pushed directly when following it
+    uint32_t regsFlags = m_pLockAddressToVideoCheckBox->isChecked() ?
+                Dispatcher::kSubscribeVideo : Dispatcher::kSubscribeNone;
+    m_pDispatcher->SubscribeMemory(MemorySlot::kGraphicsInspectorVideoRegs, Regs::VID_REG_BASE, 0x70, regsFlags);
+
+    if (m_paletteMode == kRegisters)
+        m_pDispatcher->SubscribeMemory(MemorySlot::kGraphicsInspectorPalette, Regs::VID_PAL_0, 0x20);
+    else if (m_paletteMode == kUserMemory)
+        m_pDispatcher->SubscribeMemory(MemorySlot::kGraphicsInspectorPalette, m_paletteAddress, 0x20);
+    else
+        m_pDispatcher->UnsubscribeMemory(MemorySlot::kGraphicsInspectorPalette);
+
+    EffectiveData data;
+    GetEffectiveData(data);
+    m_pDispatcher->SubscribeMemory(MemorySlot::kGraphicsInspector, m_bitmapAddress, data.requiredSize);
+    m_streaming = true;
+}
+
 bool GraphicsInspectorWidget::SetBitmapAddressFromVideoRegs()
 {
     // Update to current video regs
@@ -40,6 +40,7 @@ private:
     void memoryChanged(int memorySlot, uint64_t commandId);
     void otherMemoryChanged(uint32_t address, uint32_t size);
     void runningRefreshTimer();
+    void liveVideoChanged();
     void bitmapAddressChanged();
     void paletteAddressChanged();
     void lockAddressToVideoChanged();
@@ -92,6 +93,9 @@ private:
     // Looks at dirty requests, and issues them in the correct orders
     void UpdateMemoryRequests();
 
+    // Start, update or stop memory being pushed by the target while running
+    void UpdateSubscription();
+
     // Turn boxes on/off depending on mode, palette etc
     void UpdateUIElements();
 
@@ -187,6 +191,9 @@ private:
     Request                         m_requestPalette;
     Request                         m_requestBitmap;
 
+    // True when the target pushes our memory, rather than us polling
+    bool                            m_streaming;
+
     // Mouseover data
     NonAntiAliasImage::MouseInfo    m_mouseInfo;            // data from MouseOver in bitmap
     uint32_t                        m_addressUnderMouse;    // ~0U for "invalid"
@@ -24,6 +24,7 @@
 #include "registerwidget.h"
 #include "consolewindow.h"
 #include "hardwarewindow.h"
+#include "perfwindow.h"
 #include "profilewindow.h"
 #include "addbreakpointdialog.h"
 #include "exceptiondialog.h"
@@ -101,6 +102,8 @@ MainWindow::MainWindow(Session& session, QWidget *parent)
     m_pHardwareWindow = new HardwareWindow(this, &m_session);
     m_pHardwareWindow->setWindowTitle("Hardware (Alt+H)");
     m_pProfileWindow = new ProfileWindow(this, &m_session);
+    m_pPerfWindow = new PerfWindow(this, &m_session);
+    m_pPerfWindow->setWindowTitle("Performance (Alt+T)");
 
     m_pExceptionDialog = new ExceptionDialog(this, m_pTargetModel, m_pDispatcher);
     m_pRunDialog = new RunDialog(this, &m_session);
@@ -143,6 +146,7 @@ MainWindow::MainWindow(Session& session, QWidget *parent)
     this->addDockWidget(Qt::BottomDockWidgetArea, m_pConsoleWindow);
     this->addDockWidget(Qt::RightDockWidgetArea, m_pHardwareWindow);
     this->addDockWidget(Qt::RightDockWidgetArea, m_pProfileWindow);
+    this->addDockWidget(Qt::RightDockWidgetArea, m_pPerfWindow);
 
     loadSettings();
 
@@ -473,6 +477,7 @@ void MainWindow::updateWindowMenu()
     m_pConsoleWindowAct->setChecked(m_pConsoleWindow->isVisible());
     m_pHardwareWindowAct->setChecked(m_pHardwareWindow->isVisible());
     m_pProfileWindowAct->setChecked(m_pProfileWindow->isVisible());
+    m_pPerfWindowAct->setChecked(m_pPerfWindow->isVisible());
 }
 
 void MainWindow::updateButtonEnable()
@@ -515,6 +520,7 @@ void MainWindow::loadSettings()
         m_pConsoleWindow->setVisible(false);
         m_pHardwareWindow->setVisible(false);
         m_pProfileWindow->setVisible(false);
+        m_pPerfWindow->setVisible(false);
     }
     else
     {
@@ -522,7 +528,7 @@ void MainWindow::loadSettings()
         {
             m_pBreakpointsWidget, m_pGraphicsInspector,
             m_pConsoleWindow, m_pHardwareWindow,
-            m_pProfileWindow,
+            m_pProfileWindow, m_pPerfWindow,
             nullptr
         };
         QDockWidget** pCurr = wlist;
@@ -567,6 +573,7 @@ void MainWindow::saveSettings()
     m_pConsoleWindow->saveSettings();
     m_pHardwareWindow->saveSettings();
     m_pProfileWindow->saveSettings();
+    m_pPerfWindow->saveSettings();
 }
 
 void MainWindow::menuConnect()
@@ -617,7 +624,8 @@ void MainWindow::messageSet(const QString &msg)
 
 void MainWindow::requestMainState(uint32_t pc)
 {
-    // Do all the "essentials" straight away.
+    // Do all the "essentials" straight away, in one network packet.
+    m_pDispatcher->BeginBatch();
     m_pDispatcher->ReadRegisters();
 
     // This is the memory for the current instruction.
@@ -635,6 +643,7 @@ void MainWindow::requestMainState(uint32_t pc)
         m_pDispatcher->ReadSymbols();
 
     m_mainStateUpdateRequest = m_pDispatcher->InsertFlush();
+    m_pDispatcher->CommitBatch();
 }
 
 void MainWindow::createActions()
@@ -733,6 +742,11 @@ void MainWindow::createActions()
     m_pProfileWindowAct->setStatusTip(tr("Show the Profile window"));
     m_pProfileWindowAct->setCheckable(true);
 
+    m_pPerfWindowAct = new QAction(tr("P&erformance"), this);
+    m_pPerfWindowAct->setShortcut(QKeySequence("Alt+T"));
+    m_pPerfWindowAct->setStatusTip(tr("Show the Performance window"));
+    m_pPerfWindowAct->setCheckable(true);
+
     for (int i = 0; i < kNumDisasmViews; ++i)
         connect(m_pDisasmWindowActs[i], &QAction::triggered, this,     [=] () { this->enableVis(m_pDisasmWidgets[i]); m_pDisasmWidgets[i]->keyFocus(); } );
 
@@ -744,6 +758,7 @@ void MainWindow::createActions()
     connect(m_pConsoleWindowAct,     &QAction::triggered, this, [=] () { this->enableVis(m_pConsoleWindow); m_pConsoleWindow->keyFocus(); } );
     connect(m_pHardwareWindowAct,    &QAction::triggered, this, [=] () { this->enableVis(m_pHardwareWindow); m_pHardwareWindow->keyFocus(); } );
     connect(m_pProfileWindowAct,     &QAction::triggered, this, [=] () { this->enableVis(m_pProfileWindow); m_pProfileWindow->keyFocus(); } );
+    connect(m_pPerfWindowAct,        &QAction::triggered, this, [=] () { this->enableVis(m_pPerfWindow); m_pPerfWindow->keyFocus(); } );
 
     // "About"
     m_pAboutAct = new QAction(tr("&About"), this);
@@ -803,6 +818,7 @@ void MainWindow::createMenus()
     m_pWindowMenu->addAction(m_pConsoleWindowAct);
     m_pWindowMenu->addAction(m_pHardwareWindowAct);
     m_pWindowMenu->addAction(m_pProfileWindowAct);
+    m_pWindowMenu->addAction(m_pPerfWindowAct);
 
     m_pHelpMenu = menuBar()->addMenu(tr("Help"));
     m_pHelpMenu->addAction(m_pAboutAct);
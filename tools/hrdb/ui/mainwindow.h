@@ -29,6 +29,7 @@ class BreakpointsWindow;
 class ConsoleWindow;
 class HardwareWindow;
 class ProfileWindow;
+class PerfWindow;
 class RegisterWidget;
 class ExceptionDialog;
 class RunDialog;
@@ -133,6 +134,7 @@ private:
     ConsoleWindow*              m_pConsoleWindow;
     HardwareWindow*             m_pHardwareWindow;
     ProfileWindow*              m_pProfileWindow;
+    PerfWindow*                 m_pPerfWindow;
 
     // Low-level data
     Session&                    m_session;
@@ -182,6 +184,7 @@ private:
     QAction* m_pConsoleWindowAct;
     QAction* m_pHardwareWindowAct;
     QAction* m_pProfileWindowAct;
+    QAction* m_pPerfWindowAct;
 
     QAction* m_pAboutAct;
     QAction* m_pAboutQtAct;
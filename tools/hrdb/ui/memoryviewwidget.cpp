@@ -1,5 +1,6 @@
 #include "memoryviewwidget.h"
 
+#include <algorithm>
 #include <iostream>
 #include <QGroupBox>
 #include <QLineEdit>
@@ -29,6 +30,10 @@
 #include "searchdialog.h"
 #include "symboltext.h"
 
+// Number of matches returned by one search request, so that
+// repeated "next" commands don't need to ask the target each time
+static const uint32_t kSearchResultsMax = 256;
+
 /*
  * Memory handling in the views
  *
@@ -365,6 +370,7 @@ bool MemoryWidget::EditKey(char key)
     data[0] = cursorByte;
     QString cmd = QString::asprintf("memset $%x 1 %02x", address, cursorByte);
     m_pDispatcher->WriteMemory(address, data);
+    emit memoryWrittenSignal(address, 1);
 
     // Replace the value so that editing still works
     RequestMemory(kNoMoveCursor);
@@ -591,6 +597,8 @@ void MemoryWidget::RecalcText()
 
 void MemoryWidget::startStopChanged()
 {
+    UpdateSubscription();
+
     // Request new memory for the view
     if (!m_pTargetModel->IsRunning())
     {
@@ -617,8 +625,25 @@ void MemoryWidget::connectChanged()
     update();
 }
 
-void MemoryWidget::registersChanged()
+void MemoryWidget::registersChanged(uint64_t commandId)
 {
+    if (commandId == 0 && m_pTargetModel->IsRunning())
+    {
+        // Pushed while running. Memory is pushed too, so only
+        // re-request if a locked expression moved the view.
+        if (!m_isLocked || !m_pDispatcher->IsSubscribed(m_memSlot))
+            return;
+        uint32_t addr;
+        if (StringParsers::ParseExpression(m_addressExpression.c_str(), addr,
+                                            m_pTargetModel->GetSymbolTable(),
+                                            m_pTargetModel->GetRegs()) &&
+                addr != m_address)
+        {
+            SetAddress(addr, kNoMoveCursor);
+        }
+        return;
+    }
+
     // New registers can affect expression parsing
     RecalcLockedExpression();
 
@@ -887,6 +912,24 @@ void MemoryWidget::RequestMemory(MemoryWidget::CursorMode moveCursor)
         m_requestId = m_pDispatcher->ReadMemory(m_memSlot, m_address, size);
         m_requestCursorMode = moveCursor;
     }
+    UpdateSubscription();
+}
+
+void MemoryWidget::UpdateSubscription()
+{
+    if (m_pTargetModel->IsConnected() && m_pTargetModel->IsRunning() &&
+            m_pSession->GetSettings().m_liveRefresh && m_pDispatcher->SupportsSubscription() &&
+            isVisible())
+    {
+        // Locked expressions need the registers to follow them
+        uint32_t size = static_cast<uint32_t>(m_rowCount * m_bytesPerRow);
+        m_pDispatcher->SubscribeMemory(m_memSlot, m_address, size,
+                                       m_isLocked ? Dispatcher::kSubscribeRegs : Dispatcher::kSubscribeNone);
+    }
+    else if (m_pTargetModel->IsConnected() && m_pDispatcher->IsSubscribed(m_memSlot))
+    {
+        m_pDispatcher->UnsubscribeMemory(m_memSlot);
+    }
 }
 
 void MemoryWidget::RecalcLockedExpression()
@@ -1109,7 +1152,11 @@ MemoryWindow::MemoryWindow(QWidget *parent, Session* pSession, int windowIndex)
     m_pTargetModel(pSession->m_pTargetModel),
     m_pDispatcher(pSession->m_pDispatcher),
     m_windowIndex(windowIndex),
-    m_searchRequestId(0)
+    m_searchRequestId(0),
+    m_searchCacheStart(0),
+    m_searchCacheRequestStart(0),
+    m_searchCacheValid(false),
+    m_searchCacheComplete(false)
 {
     this->setWindowTitle(QString::asprintf("Memory %d", windowIndex + 1));
     QString key = QString::asprintf("MemoryView%d", m_windowIndex);
@@ -1179,6 +1226,9 @@ MemoryWindow::MemoryWindow(QWidget *parent, Session* pSession, int windowIndex)
     connect(m_pSession,      &Session::addressRequested,       this, &MemoryWindow::requestAddress);
     connect(m_pMemoryWidget, &MemoryWidget::cursorChangedSignal,     this, &MemoryWindow::cursorChangedSlot);
     connect(m_pTargetModel,  &TargetModel::searchResultsChangedSignal, this, &MemoryWindow::searchResultsSlot);
+    connect(m_pTargetModel,  &TargetModel::startStopChangedSignal,     this, &MemoryWindow::startStopChangedSlot);
+    connect(m_pTargetModel,  &TargetModel::otherMemoryChangedSignal,   this, &MemoryWindow::memoryChangedSlot);
+    connect(m_pMemoryWidget, &MemoryWidget::memoryWrittenSignal,       this, &MemoryWindow::memoryChangedSlot);
 
     connect(m_pSizeModeComboBox,     SIGNAL(currentIndexChanged(int)), SLOT(sizeModeComboBoxChangedSlot(int)));
     connect(m_pWidthComboBox,        SIGNAL(currentIndexChanged(int)), SLOT(widthComboBoxChangedSlot(int)));
@@ -1313,9 +1363,12 @@ void MemoryWindow::findClickedSlot()
     if (code == QDialog::DialogCode::Accepted &&
         m_pTargetModel->IsConnected())
     {
+        m_searchCacheValid = false;
+        m_searchCacheRequestStart = m_searchSettings.m_startAddress;
         m_searchRequestId = m_pDispatcher->SendMemFind(m_searchSettings.m_masksAndValues,
                                  m_searchSettings.m_startAddress,
-                                 m_searchSettings.m_endAddress);
+                                 m_searchSettings.m_endAddress,
+                                 kSearchResultsMax);
         m_pSession->SetMessage(QString("Searching: " + m_searchSettings.m_originalText));
     }
 }
@@ -1332,11 +1385,15 @@ void MemoryWindow::nextClickedSlot()
     if (m_searchSettings.m_masksAndValues.size() != 0)
     {
         // Start address should already have been filled
-        {
-            m_searchRequestId = m_pDispatcher->SendMemFind(m_searchSettings.m_masksAndValues,
-                                     info.m_address + 1,
-                                     m_searchSettings.m_endAddress);
-        }
+        if (findCachedResult(info.m_address + 1))
+            return;
+
+        m_searchCacheValid = false;
+        m_searchCacheRequestStart = info.m_address + 1;
+        m_searchRequestId = m_pDispatcher->SendMemFind(m_searchSettings.m_masksAndValues,
+                                 info.m_address + 1,
+                                 m_searchSettings.m_endAddress,
+                                 kSearchResultsMax);
     }
 }
 
@@ -1355,20 +1412,15 @@ void MemoryWindow::searchResultsSlot(uint64_t responseId)
     if (responseId == m_searchRequestId)
     {
         const SearchResults& results = m_pTargetModel->GetSearchResults();
+
+        // Keep the results so that "next" doesn't need to ask the target
+        m_searchCache = results.addresses;
+        m_searchCacheStart = m_searchCacheRequestStart;
+        m_searchCacheComplete = results.addresses.size() < static_cast<int>(kSearchResultsMax);
+        m_searchCacheValid = !m_pTargetModel->IsRunning();
+
         if (results.addresses.size() > 0)
-        {
-            uint32_t addr = results.addresses[0];
-            m_pMemoryWidget->SetLock(false);
-            m_pLockCheckBox->setChecked(false);
-            m_pMemoryWidget->SetSearchResultAddress(addr);
-
-            // Allow the "next" operation to work
-            m_searchSettings.m_startAddress = addr + 1;
-            m_pMemoryWidget->setFocus();
-            m_pSession->SetMessage(QString("String '%1' found at %2").
-                                   arg(m_searchSettings.m_originalText).
-                                   arg(Format::to_hex32(addr)));
-        }
+            showSearchResult(results.addresses[0]);
         else
         {
             m_pSession->SetMessage(QString("String '%1' not found").
@@ -1377,3 +1429,50 @@ void MemoryWindow::searchResultsSlot(uint64_t responseId)
         m_searchRequestId = 0;
     }
 }
+
+void MemoryWindow::startStopChangedSlot()
+{
+    // Memory contents might change
+    if (m_pTargetModel->IsRunning())
+        m_searchCacheValid = false;
+}
+
+void MemoryWindow::memoryChangedSlot(uint32_t /*address*/, uint32_t /*size*/)
+{
+    // memset or console command, the cached hits might not match any more
+    m_searchCacheValid = false;
+}
+
+bool MemoryWindow::findCachedResult(uint32_t address)
+{
+    if (!m_searchCacheValid || address < m_searchCacheStart)
+        return false;
+
+    auto it = std::lower_bound(m_searchCache.begin(), m_searchCache.end(), address);
+    if (it != m_searchCache.end())
+    {
+        showSearchResult(*it);
+        return true;
+    }
+    if (m_searchCacheComplete)
+    {
+        m_pSession->SetMessage(QString("String '%1' not found").
+                               arg(m_searchSettings.m_originalText));
+        return true;
+    }
+    return false;
+}
+
+void MemoryWindow::showSearchResult(uint32_t addr)
+{
+    m_pMemoryWidget->SetLock(false);
+    m_pLockCheckBox->setChecked(false);
+    m_pMemoryWidget->SetSearchResultAddress(addr);
+
+    // Allow the "next" operation to work
+    m_searchSettings.m_startAddress = addr + 1;
+    m_pMemoryWidget->setFocus();
+    m_pSession->SetMessage(QString("String '%1' found at %2").
+                           arg(m_searchSettings.m_originalText).
+                           arg(Format::to_hex32(addr)));
+}
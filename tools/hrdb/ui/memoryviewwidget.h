@@ -71,6 +71,8 @@ public:
 signals:
     // Flagged when cursor position or memory under cursor changes
     void cursorChangedSignal();
+    // Flagged when an edit writes memory on the target
+    void memoryWrittenSignal(uint32_t address, uint32_t size);
 protected:
     virtual void paintEvent(QPaintEvent*) override;
     virtual void keyPressEvent(QKeyEvent*) override;
@@ -92,7 +94,7 @@ private:
     void memoryChanged(int memorySlot, uint64_t commandId);
     void startStopChanged();
     void connectChanged();
-    void registersChanged();
+    void registersChanged(uint64_t commandId);
     void otherMemoryChanged(uint32_t address, uint32_t size);
     void symbolTableChanged();
     void settingsChanged();
@@ -122,6 +124,8 @@ private:
 
     void SetAddress(uint32_t address, CursorMode moveCursor);
     void RequestMemory(CursorMode moveCursor);
+    // Have the target push our memory while running with live refresh
+    void UpdateSubscription();
 
     // Is we are locked to an expression recalc m_address
     void RecalcLockedExpression();
@@ -260,8 +264,15 @@ public slots:
     void gotoClickedSlot();
     void lockClickedSlot();
     void searchResultsSlot(uint64_t responseId);
+    void startStopChangedSlot();
+    void memoryChangedSlot(uint32_t address, uint32_t size);
 
 private:
+    // Use the results of the last search for "next" if possible.
+    // Returns false if the target needs to be searched again.
+    bool findCachedResult(uint32_t address);
+    void showSearchResult(uint32_t address);
+
     QLineEdit*          m_pAddressEdit;
     QComboBox*          m_pSizeModeComboBox;
     QComboBox*          m_pWidthComboBox;
@@ -277,6 +288,13 @@ private:
 
     SearchSettings      m_searchSettings;
     uint64_t            m_searchRequestId;
+
+    // Results of the last search, valid while the target is stopped
+    QVector<uint32_t>   m_searchCache;
+    uint32_t            m_searchCacheStart;
+    uint32_t            m_searchCacheRequestStart;   // start address of pending request
+    bool                m_searchCacheValid;
+    bool                m_searchCacheComplete;      // no more hits after the last one
 };
 
 #endif // MEMORYVIEWWIDGET_H
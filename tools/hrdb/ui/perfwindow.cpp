@@ -0,0 +1,289 @@
+#include "perfwindow.h"
+
+#include <algorithm>
+#include <QLabel>
+#include <QPainter>
+#include <QPushButton>
+#include <QSettings>
+#include <QVBoxLayout>
+
+#include "../transport/dispatcher.h"
+#include "../models/targetmodel.h"
+#include "../models/session.h"
+#include "quicklayout.h"
+
+//-----------------------------------------------------------------------------
+PerfChartWidget::PerfChartWidget(QWidget* parent, Session* pSession) :
+    QWidget(parent),
+    m_pSession(pSession)
+{
+    setMinimumSize(200, 100);
+    connect(m_pSession, &Session::settingsChanged, this, [=] () { update(); } );
+}
+
+//-----------------------------------------------------------------------------
+PerfChartWidget::~PerfChartWidget()
+{
+}
+
+//-----------------------------------------------------------------------------
+bool PerfChartWidget::AddSample(const PerfState& state)
+{
+    // The same VBL can arrive both pushed and from "infoperf" on stop
+    if (!m_samples.empty() && m_samples.back().vblCount == state.m_vblCount)
+        return false;
+
+    Sample sample;
+    sample.vblCount = state.m_vblCount;
+    for (const PerfState::Timer& timer : state.m_timers)
+    {
+        int index = FindTimer(timer.name);
+        if (sample.nsecs.size() <= index)
+            sample.nsecs.resize(index + 1);
+        sample.nsecs[index] = timer.nsecs;
+    }
+    m_samples.push_back(sample);
+    while (m_samples.size() > kMaxSamples)
+        m_samples.pop_front();
+    update();
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void PerfChartWidget::Clear()
+{
+    m_samples.clear();
+    m_names.clear();
+    update();
+}
+
+//-----------------------------------------------------------------------------
+int PerfChartWidget::FindTimer(const std::string& name)
+{
+    QString qname = QString::fromStdString(name);
+    int index = m_names.indexOf(qname);
+    if (index >= 0)
+        return index;
+    m_names.push_back(qname);
+    return m_names.size() - 1;
+}
+
+//-----------------------------------------------------------------------------
+QColor PerfChartWidget::GetColour(int timerIndex) const
+{
+    // Spare time is not interesting, so keep it in the background
+    if (m_names[timerIndex] == "idle")
+        return QColor(Qt::lightGray);
+    return QColor::fromHsv((timerIndex * 67) % 360, 160, 220);
+}
+
+//-----------------------------------------------------------------------------
+void PerfChartWidget::paintEvent(QPaintEvent* ev)
+{
+    QPainter painter(this);
+    painter.setFont(m_pSession->GetSettings().m_font);
+    QFontMetrics info(painter.fontMetrics());
+    const QRect& r = rect();
+    const int charHeight = info.height();
+
+    painter.fillRect(r, palette().color(QPalette::Base));
+    QWidget::paintEvent(ev);
+    if (m_samples.empty())
+        return;
+
+    // Legend of the latest sample, largest first
+    const Sample& last = m_samples.back();
+    QVector<int> order;
+    for (int i = 0; i < last.nsecs.size(); ++i)
+        if (last.nsecs[i])
+            order.push_back(i);
+    std::sort(order.begin(), order.end(), [&last] (int a, int b) { return last.nsecs[a] > last.nsecs[b]; } );
+
+    int legendWidth = 0;
+    for (int i = 0; i < order.size(); ++i)
+    {
+        QString text = QString::asprintf("%s %.1fus", m_names[order[i]].toStdString().c_str(),
+                                         last.nsecs[order[i]] / 1000.0);
+        legendWidth = std::max(legendWidth, info.horizontalAdvance(text));
+    }
+    legendWidth += charHeight + 8;
+
+    int y = 2;
+    for (int i = 0; i < order.size() && y + charHeight <= r.height(); ++i)
+    {
+        int index = order[i];
+        painter.fillRect(2, y + 2, charHeight - 4, charHeight - 4, GetColour(index));
+        painter.setPen(palette().color(QPalette::Text));
+        painter.drawText(charHeight + 2, y + info.ascent(),
+                         QString::asprintf("%s %.1fus", m_names[index].toStdString().c_str(),
+                                           last.nsecs[index] / 1000.0));
+        y += charHeight;
+    }
+
+    // Scale the bars to the longest VBL shown
+    uint64_t maxTotal = 1;
+    for (const Sample& sample : m_samples)
+    {
+        uint64_t total = 0;
+        for (uint32_t nsecs : sample.nsecs)
+            total += nsecs;
+        maxTotal = std::max(maxTotal, total);
+    }
+
+    const int chartLeft = legendWidth;
+    const int chartHeight = r.height() - charHeight - 4;
+    const int chartWidth = r.width() - chartLeft - 2;
+    if (chartWidth <= 0 || chartHeight <= 0)
+        return;
+    const int barWidth = std::max(1, chartWidth / kMaxSamples);
+
+    int x = r.width() - 2 - barWidth;
+    for (auto it = m_samples.rbegin(); it != m_samples.rend() && x >= chartLeft; ++it)
+    {
+        int bottom = charHeight + 4 + chartHeight;
+        uint64_t sum = 0;
+        for (int i = 0; i < it->nsecs.size(); ++i)
+        {
+            if (!it->nsecs[i])
+                continue;
+            sum += it->nsecs[i];
+            int top = charHeight + 4 + chartHeight - static_cast<int>(sum * chartHeight / maxTotal);
+            painter.fillRect(x, top, barWidth, bottom - top, GetColour(i));
+            bottom = top;
+        }
+        x -= barWidth;
+    }
+
+    painter.setPen(palette().color(QPalette::Text));
+    painter.drawText(chartLeft, info.ascent() + 2,
+                     QString::asprintf("Max %.2fms per VBL", maxTotal / 1000000.0));
+}
+
+//-----------------------------------------------------------------------------
+PerfWindow::PerfWindow(QWidget *parent, Session* pSession) :
+    QDockWidget(parent),
+    m_pSession(pSession),
+    m_pTargetModel(pSession->m_pTargetModel),
+    m_pDispatcher(pSession->m_pDispatcher)
+{
+    this->setWindowTitle("Performance");
+    setObjectName("Performance");
+
+    // Layouts
+    QVBoxLayout* pMainLayout = new QVBoxLayout;
+    QHBoxLayout* pTopLayout = new QHBoxLayout;
+    auto pMainRegion = new QWidget(this);   // whole panel
+    auto pTopRegion = new QWidget(this);    // top buttons/labels
+
+    m_pClearButton = new QPushButton("Clear", this);
+    m_pInfoLabel = new QLabel(this);
+    m_pChart = new PerfChartWidget(this, m_pSession);
+
+    pTopLayout->addWidget(m_pClearButton);
+    pTopLayout->addWidget(m_pInfoLabel);
+    pTopLayout->addStretch();
+
+    pMainLayout->addWidget(pTopRegion);
+    pMainLayout->addWidget(m_pChart, 1);
+
+    SetMargins(pTopLayout);
+    SetMargins(pMainLayout);
+
+    pTopRegion->setLayout(pTopLayout);
+    pMainRegion->setLayout(pMainLayout);
+    setWidget(pMainRegion);
+
+    loadSettings();
+
+    connect(m_pTargetModel,     &TargetModel::connectChangedSignal,     this, &PerfWindow::connectChanged);
+    connect(m_pTargetModel,     &TargetModel::startStopChangedSignal,   this, &PerfWindow::startStopChanged);
+    connect(m_pTargetModel,     &TargetModel::perfChangedSignal,        this, &PerfWindow::perfChanged);
+    connect(this,               &QDockWidget::visibilityChanged,        this, &PerfWindow::visibilityChangedSlot);
+    connect(m_pClearButton,     &QAbstractButton::clicked,              this, &PerfWindow::clearClicked);
+
+    // Refresh enable state
+    connectChanged();
+}
+
+PerfWindow::~PerfWindow()
+{
+}
+
+void PerfWindow::keyFocus()
+{
+    activateWindow();
+}
+
+void PerfWindow::loadSettings()
+{
+    QSettings settings;
+    settings.beginGroup("Performance");
+
+    restoreGeometry(settings.value("geometry").toByteArray());
+    settings.endGroup();
+}
+
+void PerfWindow::saveSettings()
+{
+    QSettings settings;
+    settings.beginGroup("Performance");
+
+    settings.setValue("geometry", saveGeometry());
+    settings.endGroup();
+}
+
+void PerfWindow::connectChanged()
+{
+    m_pClearButton->setEnabled(m_pTargetModel->IsConnected());
+    if (!m_pTargetModel->IsConnected())
+        m_pInfoLabel->setText("Not connected");
+    else if (!m_pDispatcher->SupportsPerf())
+        m_pInfoLabel->setText("Timings need a newer Hatari");
+    else
+        m_pInfoLabel->setText("No timings yet (Hatari needs ENABLE_PERF_TIMERS)");
+    updateSubscription();
+}
+
+void PerfWindow::startStopChanged()
+{
+    // Show the last VBL before the stop
+    if (isVisible() && m_pTargetModel->IsConnected() && !m_pTargetModel->IsRunning() &&
+            m_pDispatcher->SupportsPerf())
+        m_pDispatcher->ReadInfoPerf();
+}
+
+void PerfWindow::perfChanged()
+{
+    PerfState state = m_pTargetModel->GetPerf();
+    if (!m_pChart->AddSample(state))
+        return;
+
+    uint64_t total = 0;
+    uint64_t idle = 0;
+    for (const PerfState::Timer& timer : state.m_timers)
+    {
+        total += timer.nsecs;
+        if (timer.name == "idle")
+            idle = timer.nsecs;
+    }
+    m_pInfoLabel->setText(QString::asprintf("VBL %u: %.2fms, %.2fms busy",
+                                            state.m_vblCount, total / 1000000.0,
+                                            (total - idle) / 1000000.0));
+}
+
+void PerfWindow::visibilityChangedSlot(bool /*visible*/)
+{
+    updateSubscription();
+}
+
+void PerfWindow::clearClicked()
+{
+    m_pChart->Clear();
+}
+
+void PerfWindow::updateSubscription()
+{
+    if (!m_pTargetModel->IsConnected())
+        return;
+    m_pDispatcher->SubscribePerf(isVisible());
+}
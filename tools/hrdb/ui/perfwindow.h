@@ -0,0 +1,84 @@
+#ifndef PERFWINDOW_H
+#define PERFWINDOW_H
+
+#include <deque>
+#include <string>
+#include <QDockWidget>
+#include <QVector>
+
+class TargetModel;
+class Dispatcher;
+class Session;
+class PerfState;
+class QColor;
+class QLabel;
+class QPushButton;
+
+//-----------------------------------------------------------------------------
+// Stacked bar chart of the subsystem timings of recent VBLs, newest on the right
+class PerfChartWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    PerfChartWidget(QWidget* parent, Session* pSession);
+    virtual ~PerfChartWidget() override;
+
+    // Returns false if the sample was already added
+    bool AddSample(const PerfState& state);
+    void Clear();
+
+protected:
+    virtual void paintEvent(QPaintEvent*) override;
+
+private:
+    static const int kMaxSamples = 200;
+
+    struct Sample
+    {
+        uint32_t            vblCount;
+        QVector<uint32_t>   nsecs;      // indexed like m_names
+    };
+
+    // Returns index of the timer in m_names, adding it if new
+    int FindTimer(const std::string& name);
+    QColor GetColour(int timerIndex) const;
+
+    Session*                m_pSession;
+    QVector<QString>        m_names;    // timer names in the order first seen
+    std::deque<Sample>      m_samples;
+};
+
+//-----------------------------------------------------------------------------
+class PerfWindow : public QDockWidget
+{
+    Q_OBJECT
+public:
+    PerfWindow(QWidget *parent, Session* pSession);
+    virtual ~PerfWindow() override;
+
+    // Grab focus and point to the main widget
+    void keyFocus();
+
+    void loadSettings();
+    void saveSettings();
+
+private:
+    void connectChanged();
+    void startStopChanged();
+    void perfChanged();
+    void visibilityChangedSlot(bool visible);
+    void clearClicked();
+
+    // Only ask for timings while the window is visible
+    void updateSubscription();
+
+    Session*            m_pSession;
+    TargetModel*        m_pTargetModel;
+    Dispatcher*         m_pDispatcher;
+
+    QPushButton*        m_pClearButton;
+    QLabel*             m_pInfoLabel;
+    PerfChartWidget*    m_pChart;
+};
+
+#endif // PERFWINDOW_H
@@ -17,45 +17,67 @@
 #include "../models/profiledata.h"
 #include "quicklayout.h"
 
+// Marks addresses without a symbol in the symbol index
+static const uint32_t kNoSymbol = 0xffffffff;
+
 //-----------------------------------------------------------------------------
 //      Sorting comparators
 //-----------------------------------------------------------------------------
-bool CompCyclesAsc(ProfileTableModel::Entry& m1, ProfileTableModel::Entry& m2)
+bool CompCyclesAsc(const ProfileTableModel::Entry& m1, const ProfileTableModel::Entry& m2)
 {
     return m1.cycleCount < m2.cycleCount;
 }
-bool CompCyclesDesc(ProfileTableModel::Entry& m1, ProfileTableModel::Entry& m2)
+bool CompCyclesDesc(const ProfileTableModel::Entry& m1, const ProfileTableModel::Entry& m2)
 {
     return m1.cycleCount > m2.cycleCount;
 }
 
-bool CompCyclePercentAsc(ProfileTableModel::Entry& m1, ProfileTableModel::Entry& m2)
+bool CompCyclePercentAsc(const ProfileTableModel::Entry& m1, const ProfileTableModel::Entry& m2)
 {
     return m1.cyclePercent < m2.cyclePercent;
 }
-bool CompCyclePercentDesc(ProfileTableModel::Entry& m1, ProfileTableModel::Entry& m2)
+bool CompCyclePercentDesc(const ProfileTableModel::Entry& m1, const ProfileTableModel::Entry& m2)
 {
     return m1.cyclePercent > m2.cyclePercent;
 }
 
-bool CompCountAsc(ProfileTableModel::Entry& m1, ProfileTableModel::Entry& m2)
+bool CompCountAsc(const ProfileTableModel::Entry& m1, const ProfileTableModel::Entry& m2)
 {
     return m1.instructionCount < m2.instructionCount;
 }
-bool CompCountDesc(ProfileTableModel::Entry& m1, ProfileTableModel::Entry& m2)
+bool CompCountDesc(const ProfileTableModel::Entry& m1, const ProfileTableModel::Entry& m2)
 {
     return m1.instructionCount > m2.instructionCount;
 }
 
-bool CompAddressAsc(ProfileTableModel::Entry& m1, ProfileTableModel::Entry& m2)
+bool CompAddressAsc(const ProfileTableModel::Entry& m1, const ProfileTableModel::Entry& m2)
 {
     return m1.text < m2.text;
 }
-bool CompAddressDesc(ProfileTableModel::Entry& m1, ProfileTableModel::Entry& m2)
+bool CompAddressDesc(const ProfileTableModel::Entry& m1, const ProfileTableModel::Entry& m2)
 {
     return m1.text > m2.text;
 }
 
+typedef bool (*EntryComparator)(const ProfileTableModel::Entry&, const ProfileTableModel::Entry&);
+
+static EntryComparator GetComparator(int column, Qt::SortOrder order)
+{
+    bool asc = (order == Qt::SortOrder::AscendingOrder);
+    switch (column)
+    {
+    case ProfileTableModel::kColInstructionCount:
+        return asc ? CompCountAsc : CompCountDesc;
+    case ProfileTableModel::kColAddress:
+        return asc ? CompAddressAsc : CompAddressDesc;
+    case ProfileTableModel::kColCyclePercent:
+        return asc ? CompCyclePercentAsc : CompCyclePercentDesc;
+    case ProfileTableModel::kColCycles:
+    default:
+        return asc ? CompCyclesAsc : CompCyclesDesc;
+    }
+}
+
 //-----------------------------------------------------------------------------
 ProfileTableModel::ProfileTableModel(QObject *parent, TargetModel *pTargetModel, Dispatcher* pDispatcher) :
     QAbstractTableModel(parent),
@@ -63,13 +85,22 @@ ProfileTableModel::ProfileTableModel(QObject *parent, TargetModel *pTargetModel,
     m_pDispatcher(pDispatcher),
     m_sortColumn(kColCycles),
     m_sortOrder(Qt::DescendingOrder),
-    m_grouping(kGroupingSymbol)
+    m_grouping(kGroupingSymbol),
+    m_groupsValid(false),
+    m_dataGeneration(0),
+    m_cycleTotal(1)
 {
+    connect(m_pTargetModel, &TargetModel::symbolTableChangedSignal, this, &ProfileTableModel::symbolTableChanged);
 }
 
 void ProfileTableModel::recalc()
 {
-    rebuildEntries();
+    uint32_t generation = m_pTargetModel->GetRawProfileData().GetGeneration();
+
+    if (m_groupsValid && generation == m_dataGeneration + 1)
+        updateEntries();
+    else if (!m_groupsValid || generation != m_dataGeneration)
+        rebuildEntries(true);   // profile data was reset
 }
 
 //-----------------------------------------------------------------------------
@@ -144,44 +175,182 @@ QVariant ProfileTableModel::headerData(int section, Qt::Orientation orientation,
 //-----------------------------------------------------------------------------
 void ProfileTableModel::sort(int column, Qt::SortOrder order)
 {
-    switch (column)
-    {
-    case kColCycles:
-        std::sort(entries.begin(), entries.end(), order == Qt::SortOrder::AscendingOrder ? CompCyclesAsc : CompCyclesDesc);
-        break;
-    case kColInstructionCount:
-        std::sort(entries.begin(), entries.end(), order == Qt::SortOrder::AscendingOrder ? CompCyclesAsc : CompCyclesDesc);
-        break;
-    case kColAddress:
-        std::sort(entries.begin(), entries.end(), order == Qt::SortOrder::AscendingOrder ? CompAddressAsc : CompAddressDesc);
-        break;
-    case kColCyclePercent:
-        std::sort(entries.begin(), entries.end(), order == Qt::SortOrder::AscendingOrder ? CompCyclePercentAsc : CompCyclePercentDesc);
-        break;
-    }
     m_sortColumn = column;
     m_sortOrder = order;
-    populateFromEntries();
+
+    // Keep selection and current row on the same groups
+    emit layoutAboutToBeChanged();
+    QModelIndexList oldIndexes = persistentIndexList();
+    QVector<uint32_t> oldAddresses;
+    oldAddresses.reserve(oldIndexes.size());
+    for (const QModelIndex& idx : oldIndexes)
+        oldAddresses.push_back(entries[idx.row()].address);
+
+    std::stable_sort(entries.begin(), entries.end(), GetComparator(m_sortColumn, m_sortOrder));
+    reindexRows(0, entries.size() - 1);
+
+    for (int i = 0; i < oldIndexes.size(); ++i)
+        changePersistentIndex(oldIndexes[i], index(m_rows.value(oldAddresses[i]), oldIndexes[i].column()));
+    emit layoutChanged();
 }
 
 //-----------------------------------------------------------------------------
-void ProfileTableModel::rebuildEntries()
+void ProfileTableModel::rebuildEntries(bool reset)
 {
+    const ProfileData& data = m_pTargetModel->GetRawProfileData();
+    uint32_t groupAddr;
+
     map.clear();
-    QString text;
+    for (const ProfileData::Entry& ent : data.GetEntries())
+        addToGroup(ent.addr, ent.count, ent.cycles, groupAddr);
+    m_groupsValid = true;
+    m_dataGeneration = data.GetGeneration();
+
+    if (reset || entries.isEmpty() || map.isEmpty())
+    {
+        // Groups are all different, so start from scratch
+        beginResetModel();
+        m_cycleTotal = data.GetTotalCycles() ? data.GetTotalCycles() : 1;
+        entries.clear();
+        entries.reserve(map.size());
+        for (Entry ent : map)
+        {
+            ent.cyclePercent = cyclePercent(ent.cycleCount);
+            entries.push_back(ent);
+        }
+        std::stable_sort(entries.begin(), entries.end(), GetComparator(m_sortColumn, m_sortOrder));
+        m_rows.clear();
+        reindexRows(0, entries.size() - 1);
+        endResetModel();
+        return;
+    }
+
+    // Merge the regrouped totals into the current rows, including
+    // the groups which don't exist any more
+    QVector<uint32_t> touched;
+    touched.reserve(entries.size() + map.size());
+    for (const Entry& ent : entries)
+        touched.push_back(ent.address);
+    for (auto it = map.constBegin(); it != map.constEnd(); ++it)
+    {
+        if (!m_rows.contains(it.key()))
+            touched.push_back(it.key());
+    }
+
+    updatePercentages(data.GetTotalCycles());
+    for (uint32_t addr : touched)
+        mergeGroup(addr);
+}
+
+//-----------------------------------------------------------------------------
+void ProfileTableModel::updateEntries()
+{
     const ProfileData& data = m_pTargetModel->GetRawProfileData();
-    const SymbolTable& symbols = m_pTargetModel->GetSymbolTable();
-    Symbol result;
+    QVector<uint32_t> changed;
+    uint32_t groupAddr;
+
+    // Only the last update changed, so just add that to the groups.
+    // Deltas are in address order, so their groups are too.
+    for (const ProfileDelta& delta : data.GetLastDeltas())
+    {
+        if (addToGroup(delta.addr, delta.count, delta.cycles, groupAddr) &&
+            (changed.isEmpty() || changed.back() != groupAddr))
+            changed.push_back(groupAddr);
+    }
+    m_dataGeneration = data.GetGeneration();
+
+    updatePercentages(data.GetTotalCycles());
+    for (uint32_t addr : changed)
+        mergeGroup(addr);
+}
 
-    // Generate total cycles
-    uint64_t cycleTotal = 0;
-    for (const ProfileData::Pair ent : data.m_entries)
-        cycleTotal += ent.second.cycles;
+//-----------------------------------------------------------------------------
+float ProfileTableModel::cyclePercent(uint64_t cycleCount) const
+{
+    uint64_t scaledPercent = cycleCount * 1000 / m_cycleTotal;
+    return static_cast<float>(scaledPercent) / 10.f;
+}
 
+//-----------------------------------------------------------------------------
+void ProfileTableModel::updatePercentages(uint64_t cycleTotal)
+{
     // Protect against zero-divide
     if (cycleTotal == 0)
         cycleTotal = 1;
+    if (cycleTotal == m_cycleTotal)
+        return;
+
+    m_cycleTotal = cycleTotal;
+    for (Entry& ent : entries)
+        ent.cyclePercent = cyclePercent(ent.cycleCount);
+    if (!entries.isEmpty())
+        emit dataChanged(index(0, kColCyclePercent), index(entries.size() - 1, kColCyclePercent));
+}
 
+//-----------------------------------------------------------------------------
+void ProfileTableModel::mergeGroup(uint32_t groupAddr)
+{
+    EntryComparator comp = GetComparator(m_sortColumn, m_sortOrder);
+    QMap<uint32_t, Entry>::const_iterator mapIt = map.constFind(groupAddr);
+    QHash<uint32_t, int>::iterator rowIt = m_rows.find(groupAddr);
+
+    if (mapIt == map.constEnd())
+    {
+        // Group is gone
+        if (rowIt == m_rows.end())
+            return;
+        int row = rowIt.value();
+        beginRemoveRows(QModelIndex(), row, row);
+        m_rows.erase(rowIt);
+        entries.remove(row);
+        reindexRows(row, entries.size() - 1);
+        endRemoveRows();
+        return;
+    }
+
+    Entry ent = mapIt.value();
+    ent.cyclePercent = cyclePercent(ent.cycleCount);
+
+    // Rows are sorted, including the group's own row with the old values
+    int pos = static_cast<int>(std::upper_bound(entries.begin(), entries.end(), ent, comp) - entries.begin());
+    if (rowIt == m_rows.end())
+    {
+        beginInsertRows(QModelIndex(), pos, pos);
+        entries.insert(pos, ent);
+        reindexRows(pos, entries.size() - 1);
+        endInsertRows();
+        return;
+    }
+
+    int row = rowIt.value();
+    if (pos == row || pos == row + 1)
+    {
+        // Still in order with its neighbours
+        entries[row] = ent;
+        emit dataChanged(index(row, 0), index(row, kColCount - 1));
+        return;
+    }
+
+    // Rows after the old one move up by one when it's taken out
+    int newRow = pos > row ? pos - 1 : pos;
+    beginMoveRows(QModelIndex(), row, row, QModelIndex(), pos);
+    entries.remove(row);
+    entries.insert(newRow, ent);
+    reindexRows(qMin(row, newRow), qMax(row, newRow));
+    endMoveRows();
+    emit dataChanged(index(newRow, 0), index(newRow, kColCount - 1));
+}
+
+//-----------------------------------------------------------------------------
+void ProfileTableModel::reindexRows(int first, int last)
+{
+    for (int row = first; row <= last; ++row)
+        m_rows[entries[row].address] = row;
+}
+
+//-----------------------------------------------------------------------------
+bool ProfileTableModel::addToGroup(uint32_t addr, uint32_t count, uint32_t cycles, uint32_t& groupAddr)
+{
     uint32_t bits;
     switch (m_grouping)
     {
@@ -195,66 +364,63 @@ void ProfileTableModel::rebuildEntries()
     uint32_t mask = 0xffffffff << bits;
     uint32_t rest = 0xffffffff ^ mask;
 
-    // This converts the entry to a label or a memory block
-    for (const ProfileData::Pair ent : data.m_entries)
+    if (m_grouping == kGroupingSymbol)
     {
-        uint32_t addr = 0;
-        QString label;
-
-        if (m_grouping == kGroupingSymbol)
-        {
-            if (!symbols.FindLowerOrEqual(ent.first, true, result))
-                continue;
-
-            addr = result.address;
-            label = QString::fromStdString(result.name);
-        }
-        else
-        {
-            // Group by bytes, rounding down the bits
-            addr = ent.first & mask;
-        }
-
-        QMap<uint32_t, Entry>::iterator it = map.find(addr);
-        if (it == map.end())
+        // Look up each address only once, rather than on every update
+        QHash<uint32_t, uint32_t>::iterator symIt = m_symbolIndex.find(addr);
+        if (symIt == m_symbolIndex.end())
         {
-            // New entry, so create a label here
-            if (m_grouping == kGroupingSymbol)
-                label = QString::fromStdString(result.name);
-            else
-                label = QString::asprintf("$%08x-$%08x", addr, addr + rest);
-
-            Entry entry;
-            entry.address = addr;
-            entry.text = label;
-            entry.instructionCount = ent.second.count;
-            entry.cycleCount = ent.second.cycles;
-            entry.cyclePercent = 0; // calculated at end
-            map.insert(addr, entry);
-        }
-        else {
-            it->instructionCount += ent.second.count;
-            it->cycleCount += ent.second.cycles;
+            Symbol result;
+            uint32_t symAddr = kNoSymbol;
+            if (m_pTargetModel->GetSymbolTable().FindLowerOrEqual(addr, true, result))
+            {
+                symAddr = result.address;
+                if (!m_symbolNames.contains(symAddr))
+                    m_symbolNames.insert(symAddr, QString::fromStdString(result.name));
+            }
+            symIt = m_symbolIndex.insert(addr, symAddr);
         }
+        groupAddr = symIt.value();
+        if (groupAddr == kNoSymbol)
+            return false;
     }
-    entries.clear();
-    for (auto it : map)
+    else
     {
-        uint64_t scaledPercent = it.cycleCount * 1000 / cycleTotal;
-        it.cyclePercent = static_cast<float>(scaledPercent) / 10.f;
-        entries.push_back(it);
+        // Group by bytes, rounding down the bits
+        groupAddr = addr & mask;
     }
 
-    sort(m_sortColumn, m_sortOrder);
-    // Don't need to "populate", that's called in sort()
+    QMap<uint32_t, Entry>::iterator it = map.find(groupAddr);
+    if (it == map.end())
+    {
+        // New entry, so create a label here
+        Entry entry;
+        entry.address = groupAddr;
+        if (m_grouping == kGroupingSymbol)
+            entry.text = m_symbolNames.value(groupAddr);
+        else
+            entry.text = QString::asprintf("$%08x-$%08x", groupAddr, groupAddr + rest);
+        entry.instructionCount = count;
+        entry.cycleCount = cycles;
+        entry.cyclePercent = 0; // calculated at end
+        map.insert(groupAddr, entry);
+    }
+    else {
+        it->instructionCount += count;
+        it->cycleCount += cycles;
+    }
+    return true;
 }
 
 //-----------------------------------------------------------------------------
-void ProfileTableModel::populateFromEntries()
+void ProfileTableModel::symbolTableChanged()
 {
-    // This is rubbish and will lose cursor position etc
-    emit beginResetModel();
-    emit endResetModel();
+    m_symbolIndex.clear();
+    m_symbolNames.clear();
+
+    // Regroup by the new symbols now, rather than at the next update
+    if (m_grouping == kGroupingSymbol && m_groupsValid)
+        rebuildEntries(false);
 }
 
 //-----------------------------------------------------------------------------
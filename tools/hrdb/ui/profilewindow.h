@@ -2,6 +2,7 @@
 #define PROFILEWINDOW_H
 
 #include <QDockWidget>
+#include <QHash>
 #include <QTableView>
 #include "showaddressactions.h"
 
@@ -66,7 +67,8 @@ public:
     void SetGrouping(Grouping g)
     {
         m_grouping = g;
-        rebuildEntries();
+        m_groupsValid = false;
+        rebuildEntries(true);
     }
 
     Grouping GetGrouping() const
@@ -76,8 +78,27 @@ public:
 
 private:
 
-    void rebuildEntries();
-    void populateFromEntries();
+    // Regroup all the profile data. With "reset", the whole model is
+    // reset, otherwise the new groups are merged into the current rows.
+    void rebuildEntries(bool reset);
+    // Add the last profile data deltas to the groups and rows
+    void updateEntries();
+    void symbolTableChanged();
+
+    // Add counts for a profiled address to its group in "map".
+    // Returns false if the address doesn't belong to any group.
+    bool addToGroup(uint32_t addr, uint32_t count, uint32_t cycles, uint32_t& groupAddr);
+
+    // Recalculate cycle percentages of all rows for a new cycle total.
+    // This doesn't change the row order.
+    void updatePercentages(uint64_t cycleTotal);
+    float cyclePercent(uint64_t cycleCount) const;
+
+    // Move a group's row to its sorted position, insert it or remove it
+    // according to its "map" entry, and emit the matching model signals
+    void mergeGroup(uint32_t groupAddr);
+    // Update m_rows for the given rows of "entries"
+    void reindexRows(int first, int last);
 
     TargetModel*    m_pTargetModel;
     Dispatcher*     m_pDispatcher;
@@ -87,6 +108,19 @@ private:
     int                     m_sortColumn;
     Qt::SortOrder           m_sortOrder;
     Grouping                m_grouping;
+
+    // "map" holds the totals up to this ProfileData generation
+    bool                    m_groupsValid;
+    uint32_t                m_dataGeneration;
+    uint64_t                m_cycleTotal;
+
+    // Group address -> its row in "entries", which is kept sorted
+    QHash<uint32_t, int>    m_rows;
+
+    // Cached symbol lookups: profiled address -> symbol address
+    // (or kNoSymbol), and symbol address -> name
+    QHash<uint32_t, uint32_t>   m_symbolIndex;
+    QHash<uint32_t, QString>    m_symbolNames;
 };
 
 //-----------------------------------------------------------------------------